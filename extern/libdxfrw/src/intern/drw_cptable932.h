@@ -83,7 +83,7 @@ static const int DRW_LeadTable932[] = {
 };
 
 //Table 932 tail byte
-static const int DRW_DoubleTable932[][2] = {
+static const unsigned short DRW_DoubleTable932[][2] = {
     {0x8140, 0x3000}, //1 #IDEOGRAPHIC SPACE
     {0x8141, 0x3001}, //2 #IDEOGRAPHIC COMMA
     {0x8142, 0x3002}, //3 #IDEOGRAPHIC FULL STOP
@@ -146,7 +146,7 @@ static const int DRW_LeadTable936[] = {
 };
 
 //Table 936 tail byte
-static const int DRW_DoubleTable936[][2] = {
+static const unsigned short DRW_DoubleTable936[][2] = {
     {0x8140, 0x4E02}, //1 #CJK UNIFIED IDEOGRAPH
     {0x8141, 0x4E04}, //2 #CJK UNIFIED IDEOGRAPH
     {0x8142, 0x4E05}, //3 #CJK UNIFIED IDEOGRAPH
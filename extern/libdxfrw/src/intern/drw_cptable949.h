@@ -145,7 +145,7 @@ static const int DRW_LeadTable949[] = {
 };
 
 //Table 949 tail byte
-static const int DRW_DoubleTable949[][2] = {
+static const unsigned short DRW_DoubleTable949[][2] = {
     {0x8141, 0xAC02}, //1 #HANGUL SYLLABLE KIYEOK A SSANGKIYEOK
     {0x8142, 0xAC03}, //2 #HANGUL SYLLABLE KIYEOK A KIYEOKSIOS
     {0x8143, 0xAC05}, //3 #HANGUL SYLLABLE KIYEOK A NIEUNCIEUC
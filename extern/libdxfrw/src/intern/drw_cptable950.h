@@ -145,7 +145,7 @@ static const int DRW_LeadTable950[] = {
 };
 
 //Table 950 tail byte
-static const int DRW_DoubleTable950[][2] = {
+static const unsigned short DRW_DoubleTable950[][2] = {
     {0xA140, 0x3000}, //1 #IDEOGRAPHIC SPACE
     {0xA141, 0xFF0C}, //2 #FULLWIDTH COMMA
     {0xA142, 0x3001}, //3 #IDEOGRAPHIC COMMA
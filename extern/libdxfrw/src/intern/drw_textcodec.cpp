@@ -298,6 +298,40 @@ int DRW_Converter::decodeNum(const std::string &s, int *b){
 }
 
 
+/* Double byte tables are sorted by code page value, so lookups by code are a
+ * binary search inside the rows of the lead byte. Lookups by unicode use an index
+ * built only when a drawing is actually written in that code page. The index is
+ * stable sorted so duplicated unicode values still map to the first (lowest) code.
+ */
+static int findDoubleCode(const unsigned short dt[][2], int sta, int end, int code){
+    while (sta < end) {
+        int mid = sta + (end - sta) / 2;
+        if (dt[mid][0] < code)
+            sta = mid + 1;
+        else
+            end = mid;
+    }
+    return sta;
+}
+
+static void buildUnicodeIndex(std::vector<unsigned short> &index, const unsigned short dt[][2], int length){
+    index.resize(length);
+    for (int k=0; k<length; k++)
+        index[k] = static_cast<unsigned short>(k);
+    std::stable_sort(index.begin(), index.end(), [dt](unsigned short a, unsigned short b) {
+        return dt[a][1] < dt[b][1];
+    });
+}
+
+static int findUnicode(const std::vector<unsigned short> &index, const unsigned short dt[][2], int code){
+    auto it = std::lower_bound(index.begin(), index.end(), code, [dt](unsigned short row, int c) {
+        return dt[row][1] < c;
+    });
+    if (it == index.end() || dt[*it][1] != code)
+        return -1;
+    return *it;
+}
+
 std::string DRW_ConvDBCSTable::fromUtf8(const std::string &s) {
     std::string result;
     bool notFound;
@@ -314,18 +348,18 @@ std::string DRW_ConvDBCSTable::fromUtf8(const std::string &s) {
             j = i+l;
             i = j - 1;
             notFound = true;
-                for (int k=0; k<cpLength; k++){
-                    if(doubleTable[k][1] == code) {
-                        int data = doubleTable[k][0];
-                        char d[3];
-                        d[0] = data >> 8;
-                        d[1] = data & 0xFF;
-                        d[2]= '\0';
-                        result += d; //translate from table
-                        notFound = false;
-                        break;
-                    }
-                }
+            if (unicodeIndex.empty())
+                buildUnicodeIndex(unicodeIndex, doubleTable, cpLength);
+            int k = findUnicode(unicodeIndex, doubleTable, code);
+            if (k >= 0) {
+                int data = doubleTable[k][0];
+                char d[3];
+                d[0] = data >> 8;
+                d[1] = data & 0xFF;
+                d[2]= '\0';
+                result += d; //translate from table
+                notFound = false;
+            }
             if (notFound)
                 result += decodeText(code);
         } //direct conversion
@@ -360,12 +394,10 @@ std::string DRW_ConvDBCSTable::toUtf8(const std::string &s) {
             int code = (c << 8) | static_cast<unsigned char >(*it);
             int sta = leadTable[c-0x81];
             int end = leadTable[c-0x80];
-            for (int k=sta; k<end; k++){
-                if(doubleTable[k][0] == code) {
-                    res += encodeNum(doubleTable[k][1]); //translate from table
-                    notFound = false;
-                    break;
-                }
+            int k = findDoubleCode(doubleTable, sta, end, code);
+            if (k < end && doubleTable[k][0] == code) {
+                res += encodeNum(doubleTable[k][1]); //translate from table
+                notFound = false;
             }
         }
         //not found
@@ -402,17 +434,17 @@ std::string DRW_Conv932Table::fromUtf8(const std::string &s) {
             }
             if (notFound && ( code<0xF8 || (code>0x390 && code<0x542) ||
                     (code>0x200F && code<0x9FA1) || code>0xF928 )) {
-                for (int k=0; k<cpLength; k++){
-                    if(DRW_DoubleTable932[k][1] == code) {
-                        int data = DRW_DoubleTable932[k][0];
-                        char d[3];
-                        d[0] = data >> 8;
-                        d[1] = data & 0xFF;
-                        d[2]= '\0';
-                        result += d; //translate from table
-                        notFound = false;
-                        break;
-                    }
+                if (unicodeIndex.empty())
+                    buildUnicodeIndex(unicodeIndex, DRW_DoubleTable932, cpLength);
+                int k = findUnicode(unicodeIndex, DRW_DoubleTable932, code);
+                if (k >= 0) {
+                    int data = DRW_DoubleTable932[k][0];
+                    char d[3];
+                    d[0] = data >> 8;
+                    d[1] = data & 0xFF;
+                    d[2]= '\0';
+                    result += d; //translate from table
+                    notFound = false;
                 }
             }
             if (notFound)
@@ -457,12 +489,10 @@ std::string DRW_Conv932Table::toUtf8(const std::string &s) {
                 end = DRW_LeadTable932[c-0xC0];
             }
             if (end > 0) {
-                for (int k=sta; k<end; k++){
-                    if(DRW_DoubleTable932[k][0] == code) {
-                        res += encodeNum(DRW_DoubleTable932[k][1]); //translate from table
-                        notFound = false;
-                        break;
-                    }
+                int k = findDoubleCode(DRW_DoubleTable932, sta, end, code);
+                if (k < end && DRW_DoubleTable932[k][0] == code) {
+                    res += encodeNum(DRW_DoubleTable932[k][1]); //translate from table
+                    notFound = false;
                 }
             }
         }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include "../drw_base.h"
 
 class DRW_Converter;
@@ -63,7 +64,7 @@ public:
 
 class DRW_ConvDBCSTable : public DRW_Converter {
 public:
-    DRW_ConvDBCSTable(const int *t,  const int *lt, const int dt[][2], int l)
+    DRW_ConvDBCSTable(const int *t,  const int *lt, const unsigned short dt[][2], int l)
         :DRW_Converter(t, l)
         ,leadTable{lt}
         ,doubleTable{dt}
@@ -73,7 +74,8 @@ public:
     std::string toUtf8(const std::string &s) override;
 private:
     const int *leadTable{nullptr};
-    const int (*doubleTable)[2];
+    const unsigned short (*doubleTable)[2];
+    std::vector<unsigned short> unicodeIndex; //doubleTable rows sorted by unicode, built on first fromUtf8()
 
 };
 
@@ -82,6 +84,8 @@ public:
     DRW_Conv932Table();
     std::string fromUtf8(const std::string &s) override;
     std::string toUtf8(const std::string &s) override;
+private:
+    std::vector<unsigned short> unicodeIndex; //DRW_DoubleTable932 rows sorted by unicode, built on first fromUtf8()
 
 };
 
@@ -15,6 +15,7 @@
 #include "../libdwgr.h"
 #include "drw_textcodec.h"
 #include "drw_dbg.h"
+#include <cstring>
 //#include <bitset>
 /*#include <fstream>
 #include <algorithm>
@@ -147,6 +148,7 @@ bool dwgCharStream::read(duint8* s, duint64 n){
 dwgBuffer::dwgBuffer(duint8 *buf, duint64 size, DRW_TextCodec *dc)
     :decoder{dc}
     ,filestr{new dwgCharStream(buf, size)}
+    ,memStream{static_cast<dwgCharStream*>(filestr.get())}
     ,maxSize{size}
 {}
 
@@ -159,6 +161,7 @@ dwgBuffer::dwgBuffer(std::ifstream *stream, DRW_TextCodec *dc)
 dwgBuffer::dwgBuffer( const dwgBuffer& org )
     :decoder{org.decoder}
     ,filestr{org.filestr->clone()}
+    ,memStream{dynamic_cast<dwgCharStream*>(filestr.get())}
     ,maxSize{filestr->size()}
     ,currByte{org.currByte}
     ,bitPos{org.bitPos}
@@ -166,6 +169,7 @@ dwgBuffer::dwgBuffer( const dwgBuffer& org )
 
 dwgBuffer& dwgBuffer::operator=( const dwgBuffer& org ){
     filestr.reset( org.filestr->clone());
+    memStream = dynamic_cast<dwgCharStream*>(filestr.get());
     decoder = org.decoder;
     maxSize = filestr->size();
     currByte = org.currByte;
@@ -173,6 +177,73 @@ dwgBuffer& dwgBuffer::operator=( const dwgBuffer& org ){
     return *this;
 }
 
+/* In-memory fast path.
+ * The stream position is always one byte past currByte when bitPos != 0, so the
+ * next unread bit lives in byte (pos - 1) or (pos) and up to 57 bits can be taken
+ * from a single big-endian 64 bit load. These helpers leave pos, bitPos and currByte
+ * exactly as the byte-at-a-time code would, and refuse (return false) near the end
+ * of the buffer so that error handling stays in the original stream path.
+ */
+
+/**Loads the next 64 bits aligned to the current bit position, at least 57 are valid **/
+inline bool dwgBuffer::peekWordFast(duint64 *word) const{
+    if (memStream == nullptr || !memStream->isOk)
+        return false;
+    duint64 byteIdx = (bitPos == 0) ? memStream->pos : memStream->pos - 1;
+    if (byteIdx + 8 > memStream->sz)
+        return false;
+    const duint8 *p = memStream->stream + byteIdx;
+    duint64 w = (static_cast<duint64>(p[0]) << 56) | (static_cast<duint64>(p[1]) << 48) |
+                (static_cast<duint64>(p[2]) << 40) | (static_cast<duint64>(p[3]) << 32) |
+                (static_cast<duint64>(p[4]) << 24) | (static_cast<duint64>(p[5]) << 16) |
+                (static_cast<duint64>(p[6]) << 8) | static_cast<duint64>(p[7]);
+    *word = w << bitPos;
+    return true;
+}
+
+/**Advances n (max 57) bits, only valid after a successful peekWordFast() **/
+inline void dwgBuffer::skipBitsFast(duint8 n){
+    duint64 byteIdx = (bitPos == 0) ? memStream->pos : memStream->pos - 1;
+    duint64 next = byteIdx * 8 + bitPos + n;
+    bitPos = next & 7;
+    if (bitPos == 0) {
+        memStream->pos = next >> 3;
+    } else {
+        currByte = memStream->stream[next >> 3];
+        memStream->pos = (next >> 3) + 1;
+    }
+}
+
+/**Reads n (1 to 57) bits as an unsigned value **/
+inline bool dwgBuffer::getBitsFast(duint8 n, duint64 *value){
+    duint64 w;
+    if (!peekWordFast(&w))
+        return false;
+    *value = w >> (64 - n);
+    skipBitsFast(n);
+    return true;
+}
+
+/**Reads size bytes at the current bit position without going through filestr **/
+bool dwgBuffer::getBytesFast(duint8 *buf, duint64 size){
+    if (memStream == nullptr || !memStream->isOk || size > memStream->sz - memStream->pos)
+        return false;
+    const duint8 *p = memStream->stream + memStream->pos;
+    if (bitPos == 0) {
+        memcpy(buf, p, size);
+    } else {
+        duint8 prev = currByte;
+        for (duint64 i = 0; i < size; i++) {
+            buf[i] = (prev << bitPos) | (p[i] >> (8 - bitPos));
+            prev = p[i];
+        }
+        if (size > 0)
+            currByte = prev;
+    }
+    memStream->pos += size;
+    return true;
+}
+
 /**Gets the current byte position in buffer **/
 duint64 dwgBuffer::getPosition() const{
      if (bitPos != 0)
@@ -219,6 +290,10 @@ bool dwgBuffer::moveBitPos(dint32 size){
 
 /**Reads one Bit returns a char with value 0/1 (B) **/
 duint8 dwgBuffer::getBit(){
+    duint64 fast;
+    if (getBitsFast(1, &fast))
+        return static_cast<duint8>(fast);
+
     duint8 buffer;
     duint8 ret = 0;
     if (bitPos == 0){
@@ -241,6 +316,10 @@ bool dwgBuffer::getBoolBit(){
 
 /**Reads two Bits returns a char (BB) **/
 duint8 dwgBuffer::get2Bits(){
+    duint64 fast;
+    if (getBitsFast(2, &fast))
+        return static_cast<duint8>(fast);
+
     duint8 buffer;
     duint8 ret = 0;
     if (bitPos == 0){
@@ -267,6 +346,10 @@ duint8 dwgBuffer::get2Bits(){
 /**Reads thee Bits returns a char (3B) **/
 //RLZ: todo verify this
 duint8 dwgBuffer::get3Bits(){
+    duint64 fast;
+    if (getBitsFast(3, &fast))
+        return static_cast<duint8>(fast);
+
     duint8 buffer;
     duint8 ret = 0;
     if (bitPos == 0){
@@ -277,12 +360,13 @@ duint8 dwgBuffer::get3Bits(){
     bitPos +=3;
     if (bitPos < 9)
         ret = currByte >>(8 - bitPos);
-    else {//read one bit per byte
-        ret = currByte << 1;
+    else {//bits split between two bytes
+        duint8 rest = bitPos - 8;
+        ret = currByte << rest;
         filestr->read (&buffer,1);
         currByte = buffer;
-        bitPos = 1;
-        ret = ret | currByte >> 7;
+        bitPos = rest;
+        ret = ret | currByte >> (8 - rest);
     }
     if (bitPos == 8)
         bitPos = 0;
@@ -295,6 +379,26 @@ duint8 dwgBuffer::get3Bits(){
 
 /**Reads compressed Short (max. 16 + 2 bits) little-endian order, returns a UNsigned 16 bits (BS) **/
 duint16 dwgBuffer::getBitShort(){
+    duint64 w;
+    if (peekWordFast(&w)) {
+        switch (w >> 62) {
+        case 0: {
+            duint16 raw = static_cast<duint16>(w >> 46);
+            skipBitsFast(18);
+            return static_cast<duint16>((raw >> 8) | (raw << 8));
+        }
+        case 1:
+            skipBitsFast(10);
+            return static_cast<duint8>(w >> 54);
+        case 2:
+            skipBitsFast(2);
+            return 0;
+        default:
+            skipBitsFast(2);
+            return 256;
+        }
+    }
+
     duint8 b = get2Bits();
     if (b == 0)
         return getRawShort16();
@@ -307,6 +411,9 @@ duint16 dwgBuffer::getBitShort(){
 }
 /**Reads compressed Short (max. 16 + 2 bits) little-endian order, returns a signed 16 bits (BS) **/
 dint16 dwgBuffer::getSBitShort(){
+    if (memStream != nullptr)
+        return static_cast<dint16>(getBitShort());
+
     duint8 b = get2Bits();
     if (b == 0)
         return static_cast<dint16>(getRawShort16());
@@ -321,6 +428,24 @@ dint16 dwgBuffer::getSBitShort(){
 /**Reads compressed 32 bits Int (max. 32 + 2 bits) little-endian order, returns a signed 32 bits (BL) **/
 //to be written
 dint32 dwgBuffer::getBitLong(){
+    duint64 w;
+    if (peekWordFast(&w)) {
+        switch (w >> 62) {
+        case 0: {
+            duint32 raw = static_cast<duint32>(w >> 30);
+            skipBitsFast(34);
+            return static_cast<dint32>((raw >> 24) | ((raw >> 8) & 0xFF00) |
+                                       ((raw << 8) & 0xFF0000) | (raw << 24));
+        }
+        case 1:
+            skipBitsFast(10);
+            return static_cast<duint8>(w >> 54);
+        default:
+            skipBitsFast(2);
+            return 0;
+        }
+    }
+
     dint8 b = get2Bits();
     if (b == 0)
         return getRawLong32();
@@ -348,6 +473,11 @@ double dwgBuffer::getBitDouble(){
         return 1.0;
     else if (b == 0){
         duint8 buffer[8];
+        if (getBytesFast(buffer, 8)) {
+            double ret;
+            memcpy(&ret, buffer, 8);
+            return ret;
+        }
         if (bitPos != 0) {
             for (int i = 0; i < 8; i++)
                 buffer[i] = getRawChar8();
@@ -372,6 +502,10 @@ DRW_Coord dwgBuffer::get3BitDouble(){
 
 /**Reads raw char 8 bits returns a unsigned char (RC) **/
 duint8 dwgBuffer::getRawChar8(){
+    duint64 fast;
+    if (getBitsFast(8, &fast))
+        return static_cast<duint8>(fast);
+
     duint8 ret=0;
     duint8 buffer=0;
     filestr->read (&buffer,1);
@@ -387,6 +521,12 @@ duint8 dwgBuffer::getRawChar8(){
 
 /**Reads raw short 16 bits little-endian order, returns a unsigned short (RS) **/
 duint16 dwgBuffer::getRawShort16(){
+    duint64 fast;
+    if (getBitsFast(16, &fast)) {
+        duint16 raw = static_cast<duint16>(fast);
+        return static_cast<duint16>((raw >> 8) | (raw << 8));
+    }
+
     duint8 buffer[2]={0,0};
     duint16 ret=0;
 
@@ -410,6 +550,11 @@ duint16 dwgBuffer::getRawShort16(){
 double dwgBuffer::getRawDouble(){
     duint8 buffer[8];
     memset(buffer,0,sizeof(buffer));
+    if (getBytesFast(buffer, 8)) {
+        double ret;
+        memcpy(&ret, buffer, 8);
+        return ret;
+    }
     if (bitPos == 0)
         filestr->read (buffer,8);
     else {
@@ -431,6 +576,12 @@ DRW_Coord dwgBuffer::get2RawDouble(){
 
 /**Reads raw int 32 bits little-endian order, returns a unsigned int (RL) **/
 duint32 dwgBuffer::getRawLong32(){
+    duint64 fast;
+    if (getBitsFast(32, &fast)) {
+        duint32 raw = static_cast<duint32>(fast);
+        return (raw >> 24) | ((raw >> 8) & 0xFF00) | ((raw << 8) & 0xFF0000) | (raw << 24);
+    }
+
     duint16 tmp1 = getRawShort16();
     duint16 tmp2 = getRawShort16();
     duint32 ret = (tmp2 << 16) | (tmp1 & 0x0000FFFF);
@@ -449,19 +600,27 @@ duint64 dwgBuffer::getRawLong64(){
 
 /**Reads modular unsigner int, char based, compressed form, little-endian order, returns a unsigned int (U-MC) **/
 duint32 dwgBuffer::getUModularChar(){
-    std::vector<duint8> buffer;
     duint32 result =0;
+    duint64 w;
+    if (peekWordFast(&w)) {
+        //all (max 4) bytes come from the same 64 bit load
+        int i = 0;
+        for (; i<4; i++){
+            duint8 b = static_cast<duint8>(w >> (56 - 8 * i));
+            result += static_cast<duint32>(b & 0x7F) << (7 * i);
+            if (! (b & 0x80))
+                break;
+        }
+        skipBitsFast(8 * (i < 4 ? i + 1 : 4));
+        return result;
+    }
+
     for (int i=0; i<4;i++){
         duint8 b= getRawChar8();
-        buffer.push_back(b & 0x7F);
+        result += static_cast<duint32>(b & 0x7F) << (7 * i);
         if (! (b & 0x80))
             break;
     }
-    int offset = 0;
-    for (unsigned int i=0; i<buffer.size();i++){
-        result += buffer[i] << offset;
-        offset +=7;
-    }
 //RLZ: WARNING!!! needed to verify on read handles
     //result = result & 0x7F;
     return result;
@@ -470,23 +629,34 @@ duint32 dwgBuffer::getUModularChar(){
 /**Reads modular int, char based, compressed form, little-endian order, returns a signed int (MC) **/
 dint32 dwgBuffer::getModularChar(){
     bool negative = false;
-    std::vector<dint8> buffer;
-    dint32 result =0;
-    for (int i=0; i<4;i++){
-        duint8 b= getRawChar8();
-        buffer.push_back(b & 0x7F);
-        if (! (b & 0x80))
-            break;
+    duint8 buffer[4];
+    int count = 0;
+    duint64 w;
+    if (peekWordFast(&w)) {
+        while (count < 4){
+            duint8 b = static_cast<duint8>(w >> (56 - 8 * count));
+            buffer[count++] = b & 0x7F;
+            if (! (b & 0x80))
+                break;
+        }
+        skipBitsFast(8 * count);
+    } else {
+        while (count < 4){
+            duint8 b= getRawChar8();
+            buffer[count++] = b & 0x7F;
+            if (! (b & 0x80))
+                break;
+        }
     }
-    dint8 b= buffer.back();
+    duint8 b= buffer[count - 1];
     if (b & 0x40) {
         negative = true;
-        buffer.pop_back();
-        buffer.push_back(b & 0x3F);
+        buffer[count - 1] = b & 0x3F;
     }
 
+    dint32 result =0;
     int offset = 0;
-    for (unsigned int i=0; i<buffer.size();i++){
+    for (int i=0; i<count;i++){
         result += buffer[i] << offset;
         offset +=7;
     }
@@ -498,11 +668,12 @@ dint32 dwgBuffer::getModularChar(){
 /**Reads modular int, short based, compressed form, little-endian order, returns a unsigned int (MC) **/
 dint32 dwgBuffer::getModularShort(){
 //    bool negative = false;
-    std::vector<dint16> buffer;
+    dint16 buffer[2];
+    int count = 0;
     dint32 result =0;
     for (int i=0; i<2;i++){
         duint16 b= getRawShort16();
-        buffer.push_back(b & 0x7FFF);
+        buffer[count++] = b & 0x7FFF;
         if (! (b & 0x8000))
             break;
     }
@@ -516,7 +687,7 @@ dint32 dwgBuffer::getModularShort(){
     }*/
 
     int offset = 0;
-    for (unsigned int i=0; i<buffer.size();i++){
+    for (int i=0; i<count;i++){
         result += buffer[i] << offset;
         offset +=15;
     }
@@ -831,6 +1002,9 @@ duint16 dwgBuffer::getBERawShort16(){
 
 /* reads "size" bytes and stores in "buf" return false if fail */
 bool dwgBuffer::getBytes(unsigned char *buf, duint64 size){
+    if (getBytesFast(buf, size))
+        return true;
+
     duint8 tmp;
     filestr->read (buf,size);
     if (!filestr->good())
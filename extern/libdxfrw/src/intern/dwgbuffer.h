@@ -55,6 +55,7 @@ private:
 };
 
 class dwgCharStream: public dwgBasicStream{
+    friend class dwgBuffer; //direct access for the in-memory bit reading fast path
 public:
     dwgCharStream(duint8 *buf, duint64 s)
         :stream{buf}
@@ -142,10 +143,17 @@ public:
 
 private:
     std::unique_ptr<dwgBasicStream> filestr;
+    dwgCharStream *memStream{nullptr}; //filestr when it is in memory, used to skip virtual calls
     duint64 maxSize{0};
     duint8 currByte{0};
     duint8 bitPos{0};
 
+    //in-memory fast path, return false when the caller must use filestr
+    bool peekWordFast(duint64 *word) const;
+    void skipBitsFast(duint8 n);
+    bool getBitsFast(duint8 n, duint64 *value);
+    bool getBytesFast(duint8 *buf, duint64 size);
+
     UTF8STRING get8bitStr();
     UTF8STRING get16bitStr(duint16 textSize, bool nullTerm = true);
 };
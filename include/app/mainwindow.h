@@ -39,6 +39,7 @@ protected:
 private slots:
     void importDXF();
     void importGDAL();
+    void importGDALArea();
     void updateCoordinates(const QPointF& pos);
     void updateZoom(double zoom);
     void updateLayerPanel();
@@ -63,6 +64,10 @@ private:
     void updatePropertiesPanel();
     void updatePegPanel();        // Refresh peg list
     void applyMenuFilters();
+#ifdef HAVE_DWG
+    void importDWG(const QString& fileName);  // Threaded DWG import via libdxfrw
+#endif
+    void exportBulk(bool flatGeobuf);         // Threaded GeoPackage/FlatGeobuf export
 
     CanvasWidget* m_canvas{nullptr};
     QLabel* m_coordLabel{nullptr};
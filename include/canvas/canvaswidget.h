@@ -9,11 +9,18 @@
 #include <QSet>
 #include <QMap>
 #include <QImage>
+#include <QPainterPath>
 #include <QPropertyAnimation>
+#include <memory>
 #include "tools/snapper.h"
 
 class QPropertyAnimation;
+class GdalRasterSource;
+class ElevationGrid;
+class SurfaceModel;
+class ContourEngine;
 struct GdalData;
+struct DxfBlockDef;
 class Snapper;
 
 // Tool state machine
@@ -70,7 +77,8 @@ enum class UndoType {
     DeleteLayer,        // Layer and all its contents deleted
     AddPeg,             // Single peg added
     DeletePeg,          // Single peg deleted
-    ModifyPeg           // Peg modified (position/name changed)
+    ModifyPeg,          // Peg modified (position/name changed)
+    DeleteInsert        // Block insert deleted
 };
 
 // Simple geometry structures for rendering
@@ -120,24 +128,6 @@ struct CanvasPolyline {
     QColor color;
 };
 
-// Undo command data (must be after CanvasPolyline)
-struct UndoCommand {
-    UndoType type;
-    CanvasPolyline polyline;              // For single add/delete/modify
-    CanvasPolyline oldPolyline;           // Previous state for modify
-    QVector<CanvasPolyline> polylines;    // For batch add/delete
-    QVector<int> indices;                 // Indices for batch operations
-    int index{-1};                        // Index for single operations
-    QString layerName;                    // For layer operations
-    
-    // Peg data (for AddPeg, DeletePeg, ModifyPeg)
-    QPointF pegPosition;
-    QPointF oldPegPosition;
-    QString pegName;
-    QString oldPegName;
-    QColor pegColor{Qt::red};
-};
-
 struct CanvasPolygon {
     QVector<QVector<QPointF>> rings;  // First is exterior, rest are holes
     QString layer;
@@ -165,6 +155,49 @@ struct CanvasRaster {
     QImage image;
     QRectF bounds;  // World coordinates
     QString layer;
+    std::shared_ptr<GdalRasterSource> source;  // Tiled large raster (image is empty)
+    std::shared_ptr<ElevationGrid> elevation;  // DEM surface for volume/contour tools
+};
+
+// Block definition, rendered once into cached paths in block-local coordinates
+struct CanvasBlockDef {
+    QString name;
+    QVector<QPair<QColor, QPainterPath>> paths;  // Line work grouped by color
+    QVector<CanvasText> texts;                   // Block-local, nested blocks included
+    QRectF bounds;                               // Block-local bounds
+};
+
+// Block reference drawn as a transformed instance of a CanvasBlockDef
+struct CanvasInsert {
+    QString blockName;
+    int blockIndex{-1};     // Index into the block definition list
+    QPointF insertPoint;
+    double scaleX{1.0};
+    double scaleY{1.0};
+    double rotation{0.0};   // degrees
+    QString layer;
+    QTransform transform;   // Block-local -> world
+    QRectF bounds;          // World-space bounds of the transformed block
+};
+
+// Undo command data (must be after CanvasPolyline and CanvasInsert)
+struct UndoCommand {
+    UndoType type;
+    CanvasPolyline polyline;              // For single add/delete/modify
+    CanvasPolyline oldPolyline;           // Previous state for modify
+    QVector<CanvasPolyline> polylines;    // For batch add/delete
+    QVector<int> indices;                 // Indices for batch operations
+    int index{-1};                        // Index for single operations
+    QString layerName;                    // For layer operations
+    
+    // Peg data (for AddPeg, DeletePeg, ModifyPeg)
+    QPointF pegPosition;
+    QPointF oldPegPosition;
+    QString pegName;
+    QString oldPegName;
+    QColor pegColor{Qt::red};
+    
+    CanvasInsert insert;                  // For DeleteInsert
 };
 
 struct CanvasPoint {
@@ -208,6 +241,7 @@ struct CanvasTIN {
     double designLevel{0.0};           // Reference level for cut/fill coloring
     bool visible{false};               // Whether to draw TIN
     bool colorByElevation{true};       // True = color by Z, False = color by cut/fill
+    bool wireframe{true};              // Draw triangle edges over the fill
     QString layer{"TIN"};
 };
 
@@ -235,8 +269,10 @@ public:
     void setAnimatedZoom(double zoom);
 
     // Load data
-    void loadDxfData(const DxfData& data);
-    void loadGdalData(const GdalData& data);
+    // The payloads are moved in and freed as they are consumed
+    void loadDxfData(DxfData&& data);
+    void loadGdalData(GdalData&& data);
+    void appendGdalData(GdalData&& data);   // Add to the drawing without clearing or refitting
     void clearAll();
     
     // Project save/load (JSON format)
@@ -253,6 +289,7 @@ public:
     void zoomOut();
     void zoomToPoint(const QPointF& worldPos);  // Zoom and center on point
     void resetView();
+    QRectF visibleWorldRect() const;             // World area currently on screen
     
     // Layer visibility
     QVector<CanvasLayer> layers() const { return m_layers; }
@@ -333,7 +370,10 @@ public:
     void startAddPegMode(const QString& pegName, double z = 0.0);  // Start mode to add peg by clicking
 
     const QVector<CanvasPeg>& pegs() const { return m_pegs; }
-    void clearPegs() { m_pegs.clear(); m_selectedPegIndex = -1; update(); }
+    
+    // Rasters, including DEM surfaces (CanvasRaster::elevation)
+    const QVector<CanvasRaster>& rasters() const { return m_rasters; }
+    void clearPegs() { m_pegs.clear(); pegsChanged(PegEdit::Reset); m_selectedPegIndex = -1; update(); }
     
     // Peg selection
     int selectedPegIndex() const { return m_selectedPegIndex; }
@@ -349,18 +389,61 @@ public:
     void clearTIN();
     bool hasTIN() const { return m_tin.visible && !m_tin.triangles.isEmpty(); }
     void setTINVisible(bool visible);
-    void generateTINFromPegs(double designLevel = 0.0);
+    void setTINWireframe(bool wireframe);
+    bool tinWireframe() const { return m_tin.wireframe; }
+    // Breaklines and boundary are polyline indices; the boundary must be closed
+    void generateTINFromPegs(double designLevel = 0.0,
+                             const QVector<int>& breaklines = QVector<int>(),
+                             int boundary = -1);
+
+    /**
+     * @brief Shared TIN of the pegs, rebuilt only when an input changes
+     *
+     * The last few surfaces asked for are kept, so a volume selection does
+     * not push out the all-pegs surface used by contours and the 3D view.
+     * @param pegIndices Ascending peg indices (empty = all pegs)
+     * @param breaklines Polyline indices forced in as triangle edges
+     * @param boundary Closed polyline index the surface is clipped to (-1 = hull)
+     * @return nullptr if the pegs cannot be triangulated or a breakline or
+     *         the boundary cannot be inserted (see surfaceModelError())
+     */
+    std::shared_ptr<const SurfaceModel> surfaceModel(const QVector<int>& pegIndices = QVector<int>(),
+                                                     const QVector<int>& breaklines = QVector<int>(),
+                                                     int boundary = -1) const;
+    QString surfaceModelError() const { return m_surfaceModelError; }
+    quint64 pegRevision() const { return m_pegRevision; }
     
     // Contour lines
     struct ContourLine {
         double elevation;
-        QVector<QPointF> points;
+        QVector<QPointF> points;    // Polyline vertices
         bool isMajor{false};
+        bool closed{false};         // Last point joins the first
     };
     void setContours(const QVector<ContourLine>& contours);
+    
+    /**
+     * @brief Show contours of the peg surface and keep them following peg
+     *        edits (only the lines through the edited triangles are redone)
+     * @param engine Built from surfaceModel(QVector<int>(), breaklines, boundary)
+     * @param revision pegRevision() the engine was built at; older ones are rebuilt
+     *
+     * The breakline and boundary geometry is copied here, so later polyline
+     * edits, deletions or reordering leave the contour surface as generated.
+     */
+    void setSurfaceContours(const ContourEngine& engine, quint64 revision, double majorInterval,
+                            const QVector<int>& breaklines = QVector<int>(), int boundary = -1);
     void clearContours();
     bool hasContours() const { return !m_contours.isEmpty(); }
 
+    /**
+     * @brief Overlay a cut/fill heatmap (north-up image over world bounds)
+     *        between the TIN and the contours
+     */
+    void setVolumeHeatmap(const QImage& image, const QRectF& bounds);
+    void clearVolumeHeatmap();
+    bool hasVolumeHeatmap() const { return !m_volumeHeatmap.image.isNull(); }
+
     
 
     // Offset tool workflow
@@ -481,7 +564,22 @@ private:
     void drawSelection(QPainter& painter);
     void drawPegs(QPainter& painter);
     void drawTIN(QPainter& painter);
+    void buildTINColors();
+    void rasterizeTIN(const QRect& area);
     void drawContours(QPainter& painter);
+    
+    // Peg edits: the cached surface follows single edits in place and
+    // live contours are spliced; anything else rebuilds on next use
+    enum class PegEdit { Reset, Insert, Remove, Move };
+    void pegsChanged(PegEdit edit, int index = -1);
+    void updateSurfaceContours(bool local);
+    // Surface for breakline and boundary geometry; the public overload
+    // copies it from polyline indices
+    std::shared_ptr<const SurfaceModel> surfaceModel(const QVector<int>& pegIndices,
+                                                     const QVector<CanvasPolyline>& breaklines,
+                                                     const QVector<QPointF>& boundary) const;
+    void polylineGeometry(const QVector<int>& breaklines, int boundary,
+                          QVector<CanvasPolyline>& lines, QVector<QPointF>& ring) const;
 
     void drawStation(QPainter& painter);
     void drawStakeoutLine(QPainter& painter);
@@ -489,6 +587,12 @@ private:
     // Hit testing
     int hitTestPolyline(const QPointF& worldPos, double tolerance);
     int hitTestText(const QPointF& worldPos, double tolerance);
+    int hitTestInsert(const QPointF& worldPos, double tolerance);
+    
+    // Block instancing
+    void drawInserts(QPainter& painter);
+    CanvasBlockDef buildBlockDef(const QString& name, const QMap<QString, DxfBlockDef>& blocks, int depth = 0);
+    void updateInsertGeometry(CanvasInsert& insert);
     
     // Offset execution
     void executeOffset(const QPointF& sideClickPos);
@@ -575,6 +679,29 @@ private:
     QVector<CanvasRaster> m_rasters;
     QVector<CanvasPeg> m_pegs;
     int m_selectedPegIndex{-1};   // Currently selected peg (-1 = none)
+    quint64 m_pegRevision{0};     // Bumped on every peg edit
+    
+    // Cached surface models and the inputs each was built from
+    struct SurfaceModelKey {
+        quint64 pegRevision{0};
+        QVector<int> pegs;
+        QVector<QVector<QPointF>> breaklinePoints;
+        QVector<bool> breaklineClosed;
+        QVector<QPointF> boundary;
+        bool operator==(const SurfaceModelKey& other) const;
+    };
+    struct SurfaceModelEntry {
+        SurfaceModelKey key;
+        std::shared_ptr<SurfaceModel> model;
+    };
+    static const int SurfaceModelCacheSize = 3;
+    mutable QVector<SurfaceModelEntry> m_surfaceModels;    // Most recently used first
+    mutable QString m_surfaceModelError;
+    
+    // Block instancing
+    QVector<CanvasBlockDef> m_blocks;
+    QVector<CanvasInsert> m_inserts;
+    int m_selectedInsertIndex{-1};
     
     // Station setup
     CanvasStation m_station;
@@ -582,8 +709,29 @@ private:
     // TIN/DTM surface
     CanvasTIN m_tin;
     
+    // TIN display: triangle colours are fixed per TIN; the screen mesh and
+    // its image are rebuilt when the zoom changes or a pan leaves the margin
+    struct TINRender {
+        QVector<uchar> shades;      // Palette index per triangle
+        QVector<QRgb> palette;      // Premultiplied ARGB
+        QVector<int> edges;         // Unique edges, two vertex indices each
+        QTransform view;            // World to screen the image was drawn for
+        QPointF origin;             // Screen position of the image's top left
+        QVector<QPointF> mesh;      // Vertices in image pixels
+        QImage image;
+    };
+    TINRender m_tinRender;
+    
     // Contour lines
     QVector<ContourLine> m_contours;
+    std::shared_ptr<ContourEngine> m_contourEngine;     // Set while contours follow the pegs
+    quint64 m_contourRevision{0};
+    double m_contourMajorInterval{0.0};
+    QVector<CanvasPolyline> m_contourBreaklines;   // Copied when the contours were set
+    QVector<QPointF> m_contourBoundary;
+
+    // Cut/fill heatmap from the grid volume method
+    CanvasRaster m_volumeHeatmap;
 
     
     // Undo/Redo stacks
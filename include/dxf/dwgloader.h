@@ -0,0 +1,82 @@
+#ifndef DWGLOADER_H
+#define DWGLOADER_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Forward declarations
+struct DxfData;
+
+/**
+ * @brief DwgLoader - Loads DWG files using the vendored libdxfrw dwgR reader
+ *
+ * Produces the same DxfData structures as GdalGeosLoader so DWG drawings go
+ * through the existing canvas pipeline:
+ * - Blocks are kept as definitions plus inserts (MINSERT arrays are expanded)
+ * - Polyline bulges are tessellated into arc segments
+ * - Paper space entities are skipped
+ *
+ * loadDwg() is self-contained and may be called from a worker thread.
+ */
+class DwgLoader {
+public:
+    /**
+     * @brief Called periodically from the loading thread with the number of entities read so far
+     */
+    using ProgressCallback = std::function<void(int entitiesRead)>;
+
+    DwgLoader();
+    ~DwgLoader();
+
+    /**
+     * @brief Load a DWG file and populate the target DxfData structure
+     * @param filepath Path to the DWG file
+     * @param targetData Output structure (will be cleared first)
+     * @return true on success, false on error (check lastError())
+     */
+    bool loadDwg(const QString& filepath, DxfData& targetData);
+
+    /**
+     * @brief Set the progress callback (invoked on the loading thread)
+     */
+    void setProgressCallback(ProgressCallback callback) { m_progressCallback = std::move(callback); }
+
+    /**
+     * @brief Get the last error message
+     */
+    QString lastError() const { return m_lastError; }
+
+    /**
+     * @brief Get the DWG release of the last file read (e.g. "AC1027")
+     */
+    QString version() const { return m_version; }
+
+    /**
+     * @brief Get statistics from the last load operation
+     */
+    int entitiesRead() const { return m_entitiesRead; }
+    int entitiesSkipped() const { return m_entitiesSkipped; }
+    qint64 elapsedMs() const { return m_elapsedMs; }
+    double entitiesPerSecond() const;
+
+    /**
+     * @brief Get list of non-fatal issues found while reading
+     */
+    QStringList issueLog() const { return m_issueLog; }
+
+private:
+    friend class DwgInterface;
+
+    QString m_lastError;
+    QString m_version;
+    ProgressCallback m_progressCallback;
+
+    // Statistics
+    int m_entitiesRead{0};
+    int m_entitiesSkipped{0};
+    qint64 m_elapsedMs{0};
+    QStringList m_issueLog;
+};
+
+#endif // DWGLOADER_H
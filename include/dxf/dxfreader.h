@@ -91,7 +91,17 @@ struct DxfLayer {
     bool locked;
 };
 
-// Block definition (kept for compatibility, but GDAL inlines blocks)
+// Block insert (INSERT entity referencing a block definition)
+struct DxfInsert {
+    QString blockName;
+    QPointF insertPoint;
+    double scaleX{1.0};
+    double scaleY{1.0};
+    double rotation{0.0};  // degrees
+    QString layer;
+};
+
+// Block definition (geometry in block-local coordinates)
 struct DxfBlockDef {
     QString name;
     QPointF basePoint;
@@ -99,18 +109,10 @@ struct DxfBlockDef {
     QVector<DxfCircle> circles;
     QVector<DxfArc> arcs;
     QVector<DxfEllipse> ellipses;
+    QVector<DxfSpline> splines;
     QVector<DxfPolyline> polylines;
     QVector<DxfText> texts;
-};
-
-// Block insert (kept for compatibility, but GDAL inlines blocks)
-struct DxfInsert {
-    QString blockName;
-    QPointF insertPoint;
-    double scaleX;
-    double scaleY;
-    double rotation;  // degrees
-    QString layer;
+    QVector<DxfInsert> inserts;  // Nested block references
 };
 
 // ============================================================================
@@ -126,8 +128,8 @@ struct DxfData {
     QVector<DxfText> texts;
     QVector<DxfHatch> hatches;
     QVector<DxfLayer> layers;
-    QMap<QString, DxfBlockDef> blocks;  // Empty when using GDAL (blocks are inlined)
-    QVector<DxfInsert> inserts;         // Empty when using GDAL (blocks are inlined)
+    QMap<QString, DxfBlockDef> blocks;  // Block definitions keyed by name
+    QVector<DxfInsert> inserts;         // Top-level block references
     
     void clear() {
         lines.clear();
@@ -146,13 +148,13 @@ struct DxfData {
     bool isEmpty() const {
         return lines.isEmpty() && circles.isEmpty() && arcs.isEmpty() &&
                ellipses.isEmpty() && splines.isEmpty() && polylines.isEmpty() &&
-               hatches.isEmpty();
+               hatches.isEmpty() && inserts.isEmpty();
     }
     
     int totalEntities() const {
         return lines.size() + circles.size() + arcs.size() +
                ellipses.size() + splines.size() + polylines.size() +
-               hatches.size() + texts.size();
+               hatches.size() + texts.size() + inserts.size();
     }
 };
 
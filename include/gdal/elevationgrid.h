@@ -0,0 +1,140 @@
+#ifndef ELEVATIONGRID_H
+#define ELEVATIONGRID_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QCache>
+#include <QPair>
+
+// Forward declaration of GDAL types
+class GDALDataset;
+class GDALRasterBand;
+
+/**
+ * @brief ElevationGrid - DEM surface backed by a GDAL raster band
+ *
+ * Elevations are read as float32 straight from the open band, a window at a
+ * time, so LiDAR-sized grids never have to become pegs or a TIN. NoData cells
+ * are returned as NaN. Sampling between cell centres is bilinear.
+ *
+ * Not thread-safe: each thread needs its own ElevationGrid.
+ */
+class ElevationGrid {
+public:
+    static const int BlockSize = 256;
+
+    struct VolumeResult {
+        double cut{0.0};      // Volume above the level (m3)
+        double fill{0.0};     // Volume below the level (m3)
+        double area{0.0};     // Plan area of the cells used (m2)
+        qint64 cells{0};      // Cells with data inside the boundary
+    };
+
+    struct ContourLevel {
+        double elevation;
+        QVector<QPointF> segments;  // Pairs of points, one pair per segment
+    };
+
+    ElevationGrid();
+    ~ElevationGrid();
+
+    /**
+     * @brief Open a DEM and keep the band open for windowed reads
+     * @return true on success, false on error (check lastError())
+     */
+    bool open(const QString& fileName, int bandIndex = 1);
+    bool isOpen() const { return m_band != nullptr; }
+
+    QString fileName() const { return m_fileName; }
+    QString name() const;
+    QString lastError() const { return m_lastError; }
+
+    /**
+     * @brief Grid size in cells and world extent (north-up)
+     */
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    QRectF bounds() const { return m_bounds; }
+    double cellWidth() const;
+    double cellHeight() const;
+
+    /**
+     * @brief Geographic grids are in degrees; sizes and areas in metres use
+     *        111120 m per degree (as the hillshade does), longitude scaled
+     *        by the cosine of the latitude
+     */
+    bool isGeographic() const { return m_geographic; }
+    double cellWidthMetres() const;     // At the middle row
+    double cellHeightMetres() const;
+    double cellArea(int row) const;     // m2
+    double areaScale(double y) const;   // m2 per square unit at northing/latitude y
+
+    bool hasNoData() const { return m_hasNoData; }
+    double noDataValue() const { return m_noData; }
+
+    /**
+     * @brief Elevation range of the band (from statistics, may be approximate)
+     */
+    double minimum() const { return m_minimum; }
+    double maximum() const { return m_maximum; }
+
+    /**
+     * @brief World position of a cell centre, and fractional cell-centre
+     *        coordinates (col, row) of a world position
+     */
+    QPointF cellCenter(int column, int row) const;
+    QPointF worldToCell(const QPointF& world) const;
+
+    /**
+     * @brief Read a window of elevations (NoData becomes NaN)
+     * @param outColumns/outRows Buffer size; defaults to the window size,
+     *        smaller values decimate (GDAL uses overviews when present)
+     */
+    bool readWindow(int column, int row, int columns, int rows, float* out,
+                    int outColumns = 0, int outRows = 0);
+    bool readWindow(int column, int row, int columns, int rows, double* out,
+                    int outColumns = 0, int outRows = 0);
+
+    /**
+     * @brief Bilinear elevation at a world position, NaN outside or on NoData
+     */
+    double elevationAt(const QPointF& world);
+
+    /**
+     * @brief Cut/fill against a level, cell by cell, inside an optional boundary
+     */
+    VolumeResult volumeAgainstLevel(double level, const QVector<QPointF>& boundary = QVector<QPointF>());
+
+    /**
+     * @brief Marching-squares contours at first, first + interval, ... <= last
+     * @param step Use every step-th cell (1 = full resolution)
+     */
+    QVector<ContourLevel> contours(double first, double interval, double last, int step = 1);
+
+private:
+    float cellValue(int column, int row);
+    const QVector<float>* block(int bx, int by);
+    void columnSpans(double y, const QVector<QPointF>& boundary, QVector<QPair<int, int>>& spans) const;
+
+    GDALDataset* m_dataset{nullptr};
+    GDALRasterBand* m_band{nullptr};
+    QString m_fileName;
+    QString m_lastError;
+
+    double m_geoTransform[6];
+    bool m_geographic{false};
+    int m_columns{0};
+    int m_rows{0};
+    QRectF m_bounds;
+
+    bool m_hasNoData{false};
+    double m_noData{0.0};
+    double m_minimum{0.0};
+    double m_maximum{0.0};
+
+    QCache<quint64, QVector<float>> m_blocks;  // Cost in KB
+};
+
+#endif // ELEVATIONGRID_H
@@ -15,7 +15,8 @@ class GDALDataset;
  * 
  * This class replaces the old libdxfrw-based DxfReader with a robust GDAL + GEOS pipeline.
  * Key features:
- * - Uses GDAL's OGR DXF driver with DXF_INLINE_BLOCKS=TRUE to explode blocks
+ * - Uses GDAL's OGR DXF driver with DXF_INLINE_BLOCKS=FALSE so blocks are kept as
+ *   definitions plus inserts (rendered as instances on the canvas)
  * - Uses GEOS C API for geometry validation (isValid, makeValid)
  * - Outputs to existing DxfData structures for UI compatibility
  */
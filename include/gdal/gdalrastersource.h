@@ -0,0 +1,121 @@
+#ifndef GDALRASTERSOURCE_H
+#define GDALRASTERSOURCE_H
+
+#include <QString>
+#include <QVector>
+#include <QRectF>
+#include <QSize>
+#include <QImage>
+#include <QCache>
+#include <functional>
+#include "gdal/rasterstretch.h"
+
+// Forward declaration of GDAL types
+class GDALDataset;
+
+/**
+ * @brief GdalRasterSource - Windowed, tiled access to a raster kept open in GDAL
+ *
+ * Large rasters (drone orthomosaics, scanned plans) are never decoded in full.
+ * The view is covered by 256x256 tiles from a power-of-two pyramid; each tile
+ * is read with a single decimating RasterIO call, which GDAL serves from the
+ * nearest overview level when the file has overviews. Decoded tiles are kept
+ * in an LRU cache. Elevation rasters can be rendered as hillshade instead of
+ * as a picture.
+ *
+ * Not thread-safe: use from the GUI thread only.
+ */
+class GdalRasterSource {
+public:
+    static const int TileSize = 256;
+
+    enum class Rendering {
+        Image,      // RGB(A) or grayscale picture
+        Hillshade   // Band 1 as elevation: hillshade over a hypsometric tint
+    };
+
+    struct Tile {
+        QImage image;
+        QRectF source;   // Part of image to draw (whole image unless a coarser fallback)
+        QRectF bounds;   // World coordinates
+    };
+
+    GdalRasterSource();
+    ~GdalRasterSource();
+
+    /**
+     * @brief Open a raster file and keep the dataset open for tile reads
+     * @return true on success, false on error (check lastError())
+     */
+    bool open(const QString& fileName, Rendering rendering = Rendering::Image);
+    bool isOpen() const { return m_dataset != nullptr; }
+
+    QString fileName() const { return m_fileName; }
+    QString lastError() const { return m_lastError; }
+
+    /**
+     * @brief Raster size in pixels and world extent (north-up)
+     */
+    QSize size() const { return m_size; }
+    QRectF bounds() const { return m_bounds; }
+
+    /**
+     * @brief Overview (pyramid) levels stored in the file or its .ovr
+     */
+    int overviewCount() const;
+    bool hasOverviews() const { return overviewCount() > 0; }
+
+    /**
+     * @brief Build external overviews (.ovr) so zoomed-out views read little data
+     * @param progress Called with 0..1, return false to cancel
+     */
+    bool buildOverviews(const std::function<bool(double)>& progress = {});
+
+    /**
+     * @brief Get tiles covering a world rectangle at a given display resolution
+     * @param worldRect Visible area in world coordinates
+     * @param worldPerPixel World units per screen pixel
+     * @param maxDecodes Maximum number of uncached tiles to read in this call
+     * @param complete Set to false when some tiles were substituted by coarser
+     *                 cached ones (or left out) because of maxDecodes
+     */
+    QVector<Tile> tiles(const QRectF& worldRect, double worldPerPixel,
+                        int maxDecodes = 16, bool* complete = nullptr);
+
+    /**
+     * @brief Set the tile cache budget in megabytes
+     */
+    void setCacheLimit(int megabytes) { m_cache.setMaxCost(megabytes * 1024); }
+
+private:
+    QImage readTile(int level, int tx, int ty);
+    QImage readHillshadeTile(int level, int tx, int ty);
+    QRectF tileBounds(int level, int tx, int ty) const;
+    static quint64 tileKey(int level, int tx, int ty);
+
+    GDALDataset* m_dataset{nullptr};
+    QString m_fileName;
+    QString m_lastError;
+
+    double m_geoTransform[6];
+    QSize m_size;
+    QRectF m_bounds;
+    int m_maxLevel{0};
+
+    QVector<int> m_bandMap;  // Bands read into the tile image (1-based)
+    QImage::Format m_format{QImage::Format_RGBA8888};
+    bool m_byteData{true};            // Otherwise tiles are read as float and stretched
+    RasterStretch::Params m_stretch;
+
+    // Hillshade rendering
+    Rendering m_rendering{Rendering::Image};
+    double m_minValue{0.0};
+    double m_maxValue{0.0};
+    bool m_hasNoData{false};
+    double m_noData{0.0};
+    double m_metersPerUnit{1.0};  // Horizontal units to elevation units
+
+    QCache<quint64, QImage> m_cache;  // Cost in KB
+};
+
+#endif // GDALRASTERSOURCE_H
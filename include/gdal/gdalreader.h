@@ -7,9 +7,14 @@
 #include <QColor>
 #include <QRectF>
 #include <QImage>
+#include <memory>
+#include <functional>
+#include <utility>
 
 // Forward declaration of GDAL types
 class GDALDataset;
+class GdalRasterSource;
+class ElevationGrid;
 
 // Vector geometry types
 struct GdalPoint {
@@ -42,9 +47,11 @@ struct GdalText {
 
 // Raster data
 struct GdalRaster {
-    QImage image;
+    QImage image;   // Full image (empty when source is set)
     QRectF bounds;  // World coordinates
     QString layer;
+    std::shared_ptr<GdalRasterSource> source;  // Tiled access for large rasters
+    std::shared_ptr<ElevationGrid> elevation;  // Set for DEMs (drawn as hillshade)
 };
 
 // Layer info
@@ -97,9 +104,31 @@ public:
     // Read a file (auto-detects vector vs raster)
     bool readFile(const QString& fileName);
     
+    // Filters for streamed vector reads
+    struct VectorFilter {
+        QRectF extent;            // Spatial filter in layer coordinates (null = whole layer)
+        QString attributeFilter;  // OGR SQL WHERE clause (empty = all features)
+    };
+    
+    // Receives each batch of features (it may be moved from); return false to stop reading
+    using BatchCallback = std::function<bool(GdalData&& batch)>;
+    
+    // Stream the vector layers of a file in batches of batchSize features
+    // without collecting them in data(). A batch carries the GdalLayer entries
+    // of layers that start in it. data() only holds layers and CRS afterwards.
+    // Filters are checked before any batch is sent; if reading fails part way
+    // it returns false after delivering the features read, featuresStreamed()
+    // of them.
+    bool streamVectorFile(const QString& fileName, const VectorFilter& filter,
+                          int batchSize, const BatchCallback& callback);
+    qint64 featuresStreamed() const { return m_featuresStreamed; }
+    
     // Get the loaded data
     const GdalData& data() const { return m_data; }
     
+    // Move the loaded data out, leaving the reader empty
+    GdalData takeData() { return std::exchange(m_data, GdalData()); }
+    
     // Get supported formats
     static QStringList supportedVectorFormats();
     static QStringList supportedRasterFormats();
@@ -107,14 +136,21 @@ public:
     
     // Get last error message
     QString lastError() const { return m_lastError; }
+    
+    // Rasters with more pixels than this are opened for tiled access instead
+    // of being decoded in full
+    static const qint64 TiledRasterThreshold = 4096LL * 4096LL;
 
 private:
     bool readVectorData(GDALDataset* dataset);
     bool readRasterData(GDALDataset* dataset);
+    static bool isElevationRaster(GDALDataset* dataset);
     QColor getLayerColor(int index);
     
     GdalData m_data;
+    QString m_fileName;
     QString m_lastError;
+    qint64 m_featuresStreamed{0};
 };
 
 #endif // GDALREADER_H
@@ -2,9 +2,11 @@
 #define GDALWRITER_H
 
 #include <QString>
+#include <QStringList>
 #include <QVector>
 #include <QPointF>
 #include <QColor>
+#include <functional>
 
 // Forward declarations
 struct CanvasPolyline;
@@ -69,13 +71,63 @@ public:
                     const QVector<CanvasPeg>& pegs,
                     const QString& filePath);
     
+    /**
+     * @brief Progress of the bulk exports: features written so far and in
+     *        total. Called from the exporting thread; return false to cancel.
+     */
+    using ProgressCallback = std::function<bool(qint64 written, qint64 total)>;
+    void setProgressCallback(ProgressCallback callback) { m_progressCallback = std::move(callback); }
+    
+    /**
+     * @brief Export polylines, polygons and pegs to one GeoPackage
+     *
+     * Layers "polylines", "polygons" and "pegs" are written in transactions of
+     * TransactionSize features, reusing one feature and geometry per layer,
+     * and get an R-tree spatial index. Safe to run on a worker thread.
+     * @param filePath Output file path (.gpkg)
+     * @return true if successful (false with lastError() "Export cancelled"
+     *         when the progress callback stops it; the file is removed)
+     */
+    bool exportToGeoPackage(const QVector<CanvasPolyline>& polylines,
+                            const QVector<CanvasPeg>& pegs,
+                            const QString& filePath,
+                            const QString& crs = "");
+    
+    /**
+     * @brief Export to FlatGeobuf with a packed Hilbert R-tree index
+     *
+     * FlatGeobuf holds one layer per file: polylines go to filePath, polygons
+     * to <name>_polygons.fgb and pegs to <name>_pegs.fgb. When there are no
+     * polylines the first layer written takes filePath instead; see
+     * filesWritten().
+     */
+    bool exportToFlatGeobuf(const QVector<CanvasPolyline>& polylines,
+                            const QVector<CanvasPeg>& pegs,
+                            const QString& filePath,
+                            const QString& crs = "");
+    
+    /**
+     * @brief Features written by the last bulk export
+     */
+    qint64 featuresWritten() const { return m_featuresWritten; }
+    QStringList filesWritten() const { return m_filesWritten; }
+    
+    static const int TransactionSize = 50000;
+    
     /**
      * @brief Get last error message
      */
     QString lastError() const { return m_lastError; }
     
 private:
+    bool exportBulk(const char* driverName, const QVector<CanvasPolyline>& polylines,
+                    const QVector<CanvasPeg>& pegs, const QString& filePath,
+                    const QString& crs, bool layerPerFile);
+    
     QString m_lastError;
+    ProgressCallback m_progressCallback;
+    qint64 m_featuresWritten{0};
+    QStringList m_filesWritten;
 };
 
 #endif // GDALWRITER_H
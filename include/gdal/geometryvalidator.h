@@ -0,0 +1,59 @@
+#ifndef GEOMETRYVALIDATOR_H
+#define GEOMETRYVALIDATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+
+// Forward declarations
+struct CanvasPolyline;
+
+/**
+ * @brief GeometryValidator - Parallel GEOS validity and topology checks
+ *
+ * Polygons are validated concurrently, each worker thread with its own GEOS
+ * context, and every problem comes back as a structured Issue rather than
+ * through GeosBridge::lastError(). Topology checks find overlapping polygons
+ * among the pairs whose envelopes meet in an STR-tree, and gaps as small
+ * holes in the union of all polygons (slivers between adjacent parcels).
+ */
+namespace GeometryValidator {
+
+enum class IssueType {
+    Invalid,    // Polygon fails GEOS validity (self-intersection, bad ring...)
+    Overlap,    // Interiors of two polygons overlap
+    Gap         // Small hole enclosed by neighbouring polygons
+};
+
+struct Issue {
+    IssueType type{IssueType::Invalid};
+    int index{-1};              // Polyline index (-1 for gaps)
+    int otherIndex{-1};         // Second polyline of an overlap
+    QString reason;
+    QPointF location;
+    bool hasLocation{false};
+    double area{0.0};           // Overlap or gap area
+    QVector<QPointF> region;    // Outline of the overlap or gap
+};
+
+struct Options {
+    bool checkTopology{true};
+    double minOverlapArea{1e-6};    // Smaller overlaps are treated as noise
+    double maxGapArea{1.0};         // Larger holes are real voids, not gaps
+};
+
+/**
+ * @brief Validate the closed polylines among indices (others are skipped)
+ * @param checked Receives the number of polygons checked (may be null)
+ * @return Issues ordered invalid polygons first, then overlaps, then gaps
+ *
+ * Topology is only checked between polygons that are themselves valid.
+ */
+QVector<Issue> validate(const QVector<CanvasPolyline>& polylines,
+                        const QVector<int>& indices,
+                        const Options& options = Options(),
+                        int* checked = nullptr);
+
+} // namespace GeometryValidator
+
+#endif // GEOMETRYVALIDATOR_H
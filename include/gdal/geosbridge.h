@@ -4,6 +4,8 @@
 #include <QString>
 #include <QVector>
 #include <QPointF>
+#include <QRectF>
+#include <memory>
 
 // Forward declarations
 struct DxfPolyline;
@@ -13,24 +15,79 @@ struct CanvasPolyline;
  * @brief GeosBridge - GEOS utility functions for CAD operations
  * 
  * Provides high-level geometry operations using the GEOS C API.
+ * All functions are reentrant: every thread works with its own GEOS context,
+ * created on first use, and lastError() reports the calling thread's error.
  */
 namespace GeosBridge {
 
 /**
- * @brief Initialize GEOS context (call once at startup)
+ * @brief Create the calling thread's GEOS context ahead of first use
  */
 void initialize();
 
 /**
- * @brief Cleanup GEOS context (call at shutdown)
+ * @brief Kept for compatibility; contexts are finished when their thread exits
  */
 void cleanup();
 
 /**
- * @brief Get last error message
+ * @brief Get the last error message of the calling thread
  */
 QString lastError();
 
+/**
+ * @brief Long-lived GEOS geometry, optionally prepared for repeated predicates
+ *
+ * Build a boundary once and test many points or polygons against it instead
+ * of converting the QVector<QPointF> on every call. Construction errors are
+ * returned in-band through error(). A Geometry belongs to the thread that
+ * created it (its GEOS context) and must be used and destroyed there.
+ */
+class Geometry {
+public:
+    Geometry();
+    ~Geometry();
+    Geometry(Geometry&& other) noexcept;
+    Geometry& operator=(Geometry&& other) noexcept;
+    Geometry(const Geometry&) = delete;
+    Geometry& operator=(const Geometry&) = delete;
+
+    static Geometry polygon(const QVector<QPointF>& points);
+    static Geometry lineString(const QVector<QPointF>& points);
+
+    bool isNull() const { return !d; }
+    QString error() const { return m_error; }
+    QRectF bounds() const { return m_bounds; }
+
+    /**
+     * @brief Build the GEOS prepared form (indexed edges) for fast predicates
+     */
+    bool prepare();
+    bool isPrepared() const;
+
+    bool contains(const QPointF& point) const;
+    bool intersects(const Geometry& other) const;
+    double area() const;
+
+private:
+    struct Data;
+    std::unique_ptr<Data> d;
+    QRectF m_bounds;
+    QString m_error;
+};
+
+/**
+ * @brief Validity of a polygon with the reason and location in-band
+ */
+struct Validity {
+    bool valid{false};
+    QString reason;          // Empty when valid
+    QPointF location;
+    bool hasLocation{false};
+};
+
+Validity checkValidity(const QVector<QPointF>& points);
+
 /**
  * @brief Create an offset (parallel) line from a polyline
  * 
@@ -56,7 +113,7 @@ double calculatePerimeter(const QVector<QPointF>& points, bool closed);
 /**
  * @brief Check if a polygon is geometrically valid (no self-intersections)
  * @param points Polygon vertices
- * @return True if valid, false if invalid or error
+ * @return True if valid, false if invalid or error (reason in lastError())
  */
 bool isValid(const QVector<QPointF>& points);
 
@@ -96,6 +153,8 @@ QVector<QPointF> makeValid(const QVector<QPointF>& points);
  * @param point Point to test
  * @param polygon Polygon vertices
  * @return True if point is inside polygon
+ *
+ * Builds the polygon on every call; use a prepared Geometry for many points.
  */
 bool pointInPolygon(const QPointF& point, const QVector<QPointF>& polygon);
 
@@ -103,6 +162,9 @@ bool pointInPolygon(const QPointF& point, const QVector<QPointF>& polygon);
  * @brief Create Delaunay triangulation from points
  * @param points 2D points to triangulate
  * @return Vector of triangles (each triangle is 3 point indices into input)
+ *
+ * Runs DelaunayTriangulator; use it directly for the flat index array,
+ * half-edges and duplicate handling.
  */
 QVector<QVector<int>> delaunayTriangulate(const QVector<QPointF>& points);
 
@@ -118,7 +180,9 @@ struct Point3D {
  * @brief Calculate volume between a TIN surface and a design level
  * @param surfacePoints Points with X,Y,Z defining the surface
  * @param designLevel Constant elevation for design surface
- * @param boundary Optional boundary polygon (empty = use convex hull)
+ * @param boundary Optional boundary polygon (empty = use convex hull);
+ *        triangles crossing it are clipped exactly, and triangles crossing
+ *        the design level are split at it (see VolumeEngine)
  * @return Pair of (cut volume, fill volume) in cubic units
  */
 QPair<double, double> calculateVolume(const QVector<Point3D>& surfacePoints,
@@ -0,0 +1,54 @@
+#ifndef GEOSCONTEXT_H
+#define GEOSCONTEXT_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+
+#ifdef HAVE_GEOS
+#include <geos_c.h>
+#endif
+
+/**
+ * @brief Per-thread GEOS contexts shared by the gdal module sources
+ *
+ * Internal header: it exposes GEOS C types, so only GeosBridge and the
+ * modules built on it include it. Geometries created with a thread's handle
+ * must be used and destroyed on that thread.
+ */
+namespace GeosBridge {
+
+/**
+ * @brief GEOS context of one thread, created on first use and finished when
+ *        the thread exits. GEOS errors are recorded in its lastError.
+ */
+struct ThreadContext {
+    GEOSContextHandle_t handle{nullptr};
+    QString lastError;
+
+    ThreadContext();
+    ~ThreadContext();
+    ThreadContext(const ThreadContext&) = delete;
+    ThreadContext& operator=(const ThreadContext&) = delete;
+};
+
+ThreadContext& threadContext();
+
+/**
+ * @brief Geometry builders (null on failure, reason in threadContext().lastError)
+ *
+ * Rings are closed automatically; a last point within 1e-9 of the first is
+ * snapped onto it.
+ */
+GEOSGeometry* createPolygon(GEOSContextHandle_t handle, const QVector<QPointF>& points);
+GEOSGeometry* createLineString(GEOSContextHandle_t handle, const QVector<QPointF>& points);
+GEOSGeometry* createPoint(GEOSContextHandle_t handle, const QPointF& point);
+
+/**
+ * @brief Vertices of a line string or ring
+ */
+QVector<QPointF> ringPoints(GEOSContextHandle_t handle, const GEOSGeometry* ring);
+
+} // namespace GeosBridge
+
+#endif // GEOSCONTEXT_H
@@ -0,0 +1,45 @@
+#ifndef RASTERSTRETCH_H
+#define RASTERSTRETCH_H
+
+#include <QtGlobal>
+
+/**
+ * @brief RasterStretch - Linear range stretch from raster samples to 8-bit
+ *
+ * Used to display non-Byte rasters (UInt16 imagery, Float32 DEMs) without
+ * letting GDAL clip them to 0..255. Samples are float, read by RasterIO.
+ */
+namespace RasterStretch {
+
+/**
+ * @brief Per-channel stretch parameters: out = (in - offset) * scale
+ *
+ * Four lanes match one RGBA pixel; single-band data uses the same value in
+ * every lane.
+ */
+struct Params {
+    float offset[4];
+    float scale[4];
+};
+
+/**
+ * @brief Build parameters mapping [minValue, maxValue] to [0, 255] on one lane
+ */
+void setRange(Params& params, int lane, double minValue, double maxValue);
+
+/**
+ * @brief Build parameters mapping [minValue, maxValue] to [0, 255] on all lanes
+ */
+Params uniform(double minValue, double maxValue);
+
+/**
+ * @brief Stretch count samples into bytes, clamped to 0..255 and rounded
+ *
+ * Sample i uses lane i % 4, so an RGBA scanline stretches in one call.
+ * NaN samples map to 0. Uses SSE2 where available.
+ */
+void stretchToByte(const float* src, uchar* dst, int count, const Params& params);
+
+} // namespace RasterStretch
+
+#endif // RASTERSTRETCH_H
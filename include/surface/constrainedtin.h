@@ -0,0 +1,185 @@
+#ifndef CONSTRAINEDTIN_H
+#define CONSTRAINEDTIN_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+#include <QPair>
+#include "gdal/geosbridge.h"
+#include "surface/surfaceboundary.h"
+
+// Forward declarations
+struct CanvasPolyline;
+
+/**
+ * @brief ConstrainedTin - Editable constrained Delaunay triangulation
+ *
+ * Starts from the Delaunay triangulation of the survey points and is then
+ * edited in place: points are inserted by locating their triangle with a
+ * walk and restoring the Delaunay property with local flips, and breaklines
+ * are inserted edge by edge by flipping away the edges they cross (Sloan's
+ * method). Constrained edges are never flipped, so kerbs, ridges and toes
+ * stay edges of the surface. Adding a breakline only touches the triangles
+ * along it.
+ *
+ * Breakline vertices take the elevation of a survey point they coincide
+ * with, otherwise the surface elevation at that position (the nearest hull
+ * edge outside the surface). Crossing breaklines are split at their
+ * intersection.
+ *
+ * Triangles are stored as half-edges: edge e runs from vertex
+ * triangleSlots()[e] to the next corner of triangle e / 3, and
+ * halfedges()[e] is the opposite half-edge (-1 on the hull).
+ */
+class ConstrainedTin {
+public:
+    ConstrainedTin();
+
+    /**
+     * @brief Points closer than this on both axes are one vertex (default 1e-6)
+     */
+    void setTolerance(double tolerance) { m_tolerance = tolerance; }
+    double tolerance() const { return m_tolerance; }
+
+    /**
+     * @brief Delaunay triangulation of the points (vertex i = points[i])
+     * @return false on failure (check lastError())
+     */
+    bool build(const QVector<GeosBridge::Point3D>& points);
+    void clear();
+
+    /**
+     * @brief Points build() left detached because they were numerically on
+     *        the hull (duplicates are not counted)
+     */
+    int skippedCount() const { return m_skipped; }
+
+    /**
+     * @brief Insert a vertex, or return the existing vertex at that position
+     * @return Vertex index, -1 if the TIN is empty
+     */
+    int insertPoint(const GeosBridge::Point3D& point);
+
+    /**
+     * @brief Append a vertex and insert it; one coinciding with an existing
+     *        vertex stays detached, like the duplicates build() skips
+     * @return Index of the new vertex
+     */
+    int addVertex(const GeosBridge::Point3D& point);
+
+    /**
+     * @brief Take a vertex out of the surface and retriangulate only its star
+     *
+     * The vertex keeps its index and can be attached again by moveVertex().
+     * @return false if it is on a breakline or the hole cannot be filled
+     *         locally (nothing is changed then)
+     */
+    bool removeVertex(int vertex);
+
+    /**
+     * @brief Change a vertex position; a pure elevation change leaves the
+     *        triangulation as it is, a plan move removes and reinserts it
+     */
+    bool moveVertex(int vertex, const GeosBridge::Point3D& point);
+
+    bool isAttached(int vertex) const { return m_vertexEdge.value(vertex, -1) >= 0; }
+
+    /**
+     * @brief Triangle slots written, removed or relinked since the last call
+     */
+    QVector<int> takeChangedTriangles();
+
+    /**
+     * @brief Make the segment between two vertices an edge that is never flipped
+     */
+    bool insertConstraint(int a, int b);
+
+    /**
+     * @brief Insert a polyline as a chain of constrained edges
+     */
+    bool insertBreakline(const QVector<QPointF>& points, bool closed);
+
+    /**
+     * @brief Insert the given polylines as breaklines
+     * @return Number of breaklines inserted
+     */
+    int insertBreaklines(const QVector<CanvasPolyline>& polylines, const QVector<int>& indices);
+
+    /**
+     * @brief Insert a ring as constraints and drop the triangles outside it
+     */
+    bool setBoundary(const QVector<QPointF>& ring);
+    bool hasBoundary() const { return !m_boundary.isEmpty(); }
+
+    /**
+     * @brief Surface elevation (linear on the triangle), false outside
+     */
+    bool elevationAt(const QPointF& point, double& z) const;
+
+    const QVector<GeosBridge::Point3D>& points() const { return m_points; }
+
+    /**
+     * @brief Vertex indices of the triangles inside the boundary, three per
+     *        triangle, counter-clockwise
+     */
+    QVector<int> triangles() const;
+
+    /**
+     * @brief Raw half-edge storage; slots of removed triangles hold -1
+     */
+    const QVector<int>& triangleSlots() const { return m_triangles; }
+    const QVector<int>& halfedges() const { return m_halfedges; }
+    /**
+     * @brief Whether triangle slot t is live and inside the boundary
+     */
+    bool isInside(int t) const;
+    bool isConstrained(int edge) const { return m_constrained[edge] != 0; }
+    int constrainedEdgeCount() const;
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    enum class Location { Inside, OnEdge, OnVertex, Outside, Failed };
+
+    Location locate(const QPointF& point, int& result) const;
+    QPointF xy(int vertex) const { return QPointF(m_points[vertex].x, m_points[vertex].y); }
+    double orient(int a, int b, const QPointF& p) const;
+    bool inCircle(int a, int b, int c, int d) const;
+
+    int newTriangle();
+    void setTriangle(int t, int a, int b, int c);
+    void freeTriangle(int t);
+    void link(int a, int b);
+    int appendVertex(const GeosBridge::Point3D& point);
+    bool attachVertex(int vertex);
+    void attachAt(Location location, int where, int vertex);
+    void flip(int edge);
+    void legalize(QVector<int>& edges);
+
+    void splitTriangle(int t, int vertex);
+    void splitEdge(int edge, int vertex);
+    void extendHull(int edge, int vertex);
+    int nextHullEdge(int edge) const;
+    int previousHullEdge(int edge) const;
+
+    QVector<int> outgoingEdges(int vertex) const;
+    int findEdge(int a, int b) const;
+    bool crossesSegment(int a, int b, int c, int d) const;
+    bool insertSegment(int a, int b, QVector<QPair<int, int>>& pending);
+
+    QVector<GeosBridge::Point3D> m_points;
+    QVector<int> m_triangles;
+    QVector<int> m_halfedges;
+    QVector<char> m_constrained;
+    QVector<int> m_vertexEdge;       // An outgoing half-edge per vertex, -1 if unused
+    QVector<int> m_freeTriangles;
+    QVector<int> m_changed;          // Triangle slots touched by edits
+    mutable int m_hint{0};           // Triangle the next walk starts from
+    int m_skipped{0};
+
+    SurfaceBoundary m_boundary;
+    double m_tolerance{1e-6};
+    QString m_lastError;
+};
+
+#endif // CONSTRAINEDTIN_H
@@ -0,0 +1,125 @@
+#ifndef CONTOURENGINE_H
+#define CONTOURENGINE_H
+
+#include <QHash>
+#include <QVector>
+#include <QPointF>
+#include "gdal/geosbridge.h"
+
+/**
+ * @brief ContourEngine - Contour polylines from a triangulated surface
+ *
+ * Each triangle is visited once and cut by every level inside its
+ * elevation range, so the cost is O(triangles + output) rather than
+ * levels x triangles. Triangles are processed in parallel chunks, then the
+ * segments of each level are joined into polylines through the triangle
+ * edge they cross (one hash lookup per segment).
+ *
+ * A vertex exactly on a level counts as below it, so every crossing lies
+ * on an edge and neighbouring triangles compute identical points.
+ * Polylines run with higher ground on their right.
+ *
+ * After build() the engine keeps each level's segments by triangle and
+ * edge, so an edit that redoes a few triangles
+ * (SurfaceModel::changedTriangles()) only re-cuts those and retraces the
+ * polylines running through them; see update().
+ */
+class ContourEngine {
+public:
+    struct Contour {
+        double elevation{0.0};
+        QVector<QPointF> points;
+        bool closed{false};     // Last point joins the first (not repeated)
+    };
+
+    ContourEngine();
+
+    /**
+     * @brief Multiples of interval from minZ to maxZ inclusive
+     */
+    static QVector<double> levels(double minZ, double maxZ, double interval);
+
+    /**
+     * @brief Contours of a surface at the given levels
+     * @param points Surface vertices
+     * @param triangles Vertex indices, three per triangle, counter-clockwise
+     * @param levels Elevations, any order
+     * @return Polylines sorted by elevation
+     */
+    QVector<Contour> generate(const QVector<GeosBridge::Point3D>& points,
+                              const QVector<int>& triangles,
+                              const QVector<double>& levels) const;
+
+    /**
+     * @brief Contour a surface and keep the state for update()
+     *
+     * Triangles with a negative index are empty slots and are skipped.
+     */
+    void build(const QVector<GeosBridge::Point3D>& points,
+               const QVector<int>& triangles,
+               const QVector<double>& levels);
+
+    /**
+     * @brief Re-cut the given triangle slots of the edited surface and
+     *        splice the retraced polylines in (the levels themselves stay)
+     * @return Number of levels touched
+     */
+    int update(const QVector<GeosBridge::Point3D>& points,
+               const QVector<int>& triangles,
+               const QVector<int>& changedTriangles);
+
+    /**
+     * @brief Polylines of the last build() or update(), sorted by elevation
+     */
+    QVector<Contour> contours() const;
+    const QVector<double>& levelValues() const { return m_levelValues; }
+
+    /**
+     * @brief Join loose segments (pairs of points) whose ends coincide
+     *        exactly, such as marching-squares output
+     */
+    static QVector<Contour> stitchSegments(double elevation, const QVector<QPointF>& segments);
+
+    /**
+     * @brief Triangles per parallel task (default 65536)
+     */
+    void setChunkSize(int triangles) { m_chunkSize = qMax(1, triangles); }
+
+private:
+    struct Segment {
+        int triangle;
+        int level;
+        quint64 from;       // Edge the segment enters through
+        quint64 to;         // Edge it leaves through
+        QPointF start;
+        QPointF end;
+        int contour{-1};    // Polyline of the level it is part of
+    };
+
+    struct Level {
+        double elevation{0.0};
+        QHash<int, Segment> segments;   // By triangle slot
+        QHash<quint64, int> entering;   // Triangle whose segment enters through an edge
+        QHash<quint64, int> leaving;    // Triangle whose segment leaves through an edge
+        QVector<Contour> contours;      // Empty entries are free
+        QVector<QVector<int>> members;  // Triangles along each polyline
+        QVector<int> freeContours;
+        QVector<int> touched;           // Polylines to retrace on the next splice
+        QVector<int> seeds;             // New segments waiting for a polyline
+    };
+
+    static void cutTriangle(int t, const QVector<GeosBridge::Point3D>& points, const QVector<int>& triangles,
+                            const QVector<double>& levels, QVector<Segment>& segments,
+                            int& firstLevel, int& lastLevel);
+    static void addSegment(Level& level, const Segment& segment);
+    static void traceLevel(Level& level, const QVector<int>& seeds);
+    static void spliceLevel(Level& level);
+
+    int m_chunkSize{65536};
+    QVector<double> m_levelValues;
+    QVector<Level> m_levels;
+    QVector<int> m_firstLevel;          // Levels [first, last) cut by each slot
+    QVector<int> m_lastLevel;
+};
+
+#endif // CONTOURENGINE_H
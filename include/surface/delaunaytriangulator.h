@@ -0,0 +1,74 @@
+#ifndef DELAUNAYTRIANGULATOR_H
+#define DELAUNAYTRIANGULATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+
+/**
+ * @brief DelaunayTriangulator - In-process 2D Delaunay triangulation
+ *
+ * Sweep-hull (Delaunator) triangulation straight on point indices: points
+ * are inserted in order of distance from a seed circle, each one attached
+ * to the visible part of the convex hull and made Delaunay by edge flips.
+ * O(n log n), about a second for a million survey points.
+ *
+ * Coincident points (within tolerance() in both x and y) are merged before
+ * the sweep: triangles use the lowest input index of each cluster, and
+ * representative() maps every input index to the one actually used.
+ * A point that is numerically on the hull when its turn comes cannot be
+ * attached; it is left out of every triangle and counted by skippedCount().
+ */
+class DelaunayTriangulator {
+public:
+    DelaunayTriangulator();
+
+    /**
+     * @brief Points closer than this on both axes are one vertex (default 1e-6)
+     */
+    void setTolerance(double tolerance) { m_tolerance = tolerance; }
+    double tolerance() const { return m_tolerance; }
+
+    /**
+     * @brief Triangulate; false if fewer than 3 distinct or all collinear
+     *        points (reason in lastError())
+     */
+    bool triangulate(const QVector<QPointF>& points);
+
+    /**
+     * @brief Input indices, three per triangle, counter-clockwise
+     */
+    const QVector<int>& triangles() const { return m_triangles; }
+    int triangleCount() const { return m_triangles.size() / 3; }
+
+    /**
+     * @brief Opposite half-edge of each half-edge, -1 on the convex hull
+     *
+     * Half-edge e runs from triangles()[e] to the next vertex of its
+     * triangle; its triangle is e / 3.
+     */
+    const QVector<int>& halfedges() const { return m_halfedges; }
+
+    /**
+     * @brief Convex hull as input indices, counter-clockwise
+     */
+    const QVector<int>& hull() const { return m_hull; }
+
+    int representative(int index) const { return m_representative[index]; }
+    int duplicateCount() const { return m_duplicates; }
+    int skippedCount() const { return m_skipped; }
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    QVector<int> m_triangles;
+    QVector<int> m_halfedges;
+    QVector<int> m_hull;
+    QVector<int> m_representative;
+    int m_duplicates{0};
+    int m_skipped{0};
+    double m_tolerance{1e-6};
+    QString m_lastError;
+};
+
+#endif // DELAUNAYTRIANGULATOR_H
@@ -0,0 +1,44 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <QVector>
+#include "gdal/geosbridge.h"
+
+/**
+ * @brief MeshSimplifier - Coarser levels of detail of a TIN
+ *
+ * Quadric error edge collapse (Garland-Heckbert): every vertex carries the
+ * sum of the squared distances to the planes of its triangles, and the
+ * cheapest collapse of a vertex into a neighbour is taken from a priority
+ * queue until the triangle count reaches each target in turn.
+ *
+ * Collapses are half-edge collapses, so every level is a subset of the
+ * input vertices and per-vertex data (colours, normals) carries over.
+ * A collapse that would fold a triangle over in plan is refused, which
+ * keeps each level a valid triangulation, and vertices on the outline are
+ * never moved, so the levels cover the same area as the input.
+ */
+class MeshSimplifier {
+public:
+    MeshSimplifier();
+
+    /**
+     * @brief Simplify towards each target triangle count (largest first)
+     * @param triangles Three indices per triangle; negative ones are empty slots
+     * @return false if there are no valid triangles
+     */
+    bool simplify(const QVector<GeosBridge::Point3D>& points, const QVector<int>& triangles,
+                  const QVector<int>& targets);
+
+    /**
+     * @brief One level per target, as input indices three per triangle; a
+     *        level stops short of its target when no collapse is left
+     */
+    int levelCount() const { return m_levels.size(); }
+    const QVector<int>& level(int index) const { return m_levels[index]; }
+
+private:
+    QVector<QVector<int>> m_levels;
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,79 @@
+#ifndef SURFACEBOUNDARY_H
+#define SURFACEBOUNDARY_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+
+/**
+ * @brief SurfaceBoundary - Boundary polygon prepared for surface computations
+ *
+ * The ring is indexed once: its edges are binned into a grid so that a
+ * triangle clear of every edge cell is wholly inside or outside and needs a
+ * single point test, and each grid row keeps the edges crossing it so that
+ * point tests only look at a band of edges. Triangles the boundary passes
+ * through are clipped exactly rather than judged by their centroid.
+ */
+class SurfaceBoundary {
+public:
+    enum class Coverage {
+        Outside,    // Triangle is clear of the boundary
+        Inside,     // Triangle lies wholly inside
+        Partial     // Boundary passes through the triangle's cells: clip it
+    };
+
+    /**
+     * @brief Area and centroid of the part of a triangle inside the boundary
+     */
+    struct Clip {
+        double area{0.0};
+        QPointF centroid;
+    };
+
+    SurfaceBoundary();
+    explicit SurfaceBoundary(const QVector<QPointF>& ring);
+
+    /**
+     * @brief Index a ring (auto-closed); fewer than 3 vertices clears it
+     */
+    void setRing(const QVector<QPointF>& ring);
+
+    bool isEmpty() const { return m_ring.size() < 3; }
+    QRectF bounds() const { return m_bounds; }
+    const QVector<QPointF>& ring() const { return m_ring; }
+
+    bool contains(const QPointF& point) const;
+    Coverage classify(const QPointF& a, const QPointF& b, const QPointF& c) const;
+
+    /**
+     * @brief Exact intersection of the triangle abc with the boundary
+     */
+    Clip clip(const QPointF& a, const QPointF& b, const QPointF& c) const;
+
+    /**
+     * @brief As above, keeping only the part left of the line from -> to
+     *        (used to split a triangle where it crosses a design surface)
+     */
+    Clip clip(const QPointF& a, const QPointF& b, const QPointF& c,
+              const QPointF& from, const QPointF& to) const;
+
+private:
+    int rowOf(double y) const;
+    int columnOf(double x) const;
+    int edgeCellsIn(int col0, int row0, int col1, int row1) const;
+    Clip clipTriangle(const QPointF& a, const QPointF& b, const QPointF& c, const QPointF* line) const;
+
+    QVector<QPointF> m_ring;
+    QRectF m_bounds;
+    double m_orientation{1.0};      // +1 counter-clockwise ring, -1 clockwise
+
+    // Edge grid over m_bounds
+    int m_columns{0};
+    int m_rows{0};
+    double m_cellWidth{0.0};
+    double m_cellHeight{0.0};
+    QVector<int> m_cellSums;        // (rows+1) x (columns+1) prefix sums of edge cells
+    QVector<QVector<int>> m_bands;  // Per row: edges (start vertex) crossing it
+};
+
+#endif // SURFACEBOUNDARY_H
@@ -0,0 +1,84 @@
+#ifndef SURFACEDIFFERENCE_H
+#define SURFACEDIFFERENCE_H
+
+#include <QVector>
+#include <QPointF>
+#include "gdal/geosbridge.h"
+#include "surface/contourengine.h"
+#include "surface/triangleindex.h"
+#include "surface/volumeengine.h"
+
+/**
+ * @brief SurfaceDifference - Volume and isopachs between two surfaces
+ *
+ * Two triangulated surfaces, such as survey epochs of a stockpile or a pit,
+ * are overlaid: every comparison triangle is clipped against the base
+ * triangles the base's TriangleIndex lists around it. Each convex piece
+ * lies in one triangle of both surfaces, so the thickness (comparison
+ * minus base) is linear over it and its cut and fill are exact
+ * (VolumeEngine::prism(), which also applies the boundary).
+ *
+ * The pieces are never stored: they are visited in parallel chunks of
+ * comparison triangles, summed, and cut by the isopach levels on the spot,
+ * so memory is the two indexes plus the isopach output. A piece corner is
+ * a vertex of either surface or the crossing of two edges, computed the
+ * same way by every piece sharing it, so isopach segments meet exactly and
+ * ContourEngine::stitchSegments() joins them.
+ */
+class SurfaceDifference {
+public:
+    SurfaceDifference();
+
+    /**
+     * @brief Restrict volumes and isopachs to a polygon (empty = the overlap)
+     */
+    void setBoundary(const QVector<QPointF>& boundary);
+
+    /**
+     * @brief The two surfaces; negative triangle indices are empty slots
+     *
+     * Cut is where the comparison surface lies below the base (material
+     * removed since the base survey), fill where it lies above.
+     */
+    void setSurfaces(const QVector<GeosBridge::Point3D>& basePoints,
+                     const QVector<int>& baseTriangles,
+                     const QVector<GeosBridge::Point3D>& comparisonPoints,
+                     const QVector<int>& comparisonTriangles);
+
+    /**
+     * @brief Thickness range at the vertices of either surface over the other
+     */
+    double minThickness() const { return m_minThickness; }
+    double maxThickness() const { return m_maxThickness; }
+
+    /**
+     * @brief Cut and fill over the overlap, with isopachs at the given
+     *        thicknesses (see isopachs())
+     * @return Totals; triangles counts the facets of the overlay
+     */
+    VolumeEngine::Result compute(const QVector<double>& isopachLevels = QVector<double>());
+
+    /**
+     * @brief Lines of equal thickness from the last compute(), sorted by
+     *        thickness (pieces reaching inside the boundary are kept whole)
+     */
+    const QVector<ContourEngine::Contour>& isopachs() const { return m_isopachs; }
+
+    /**
+     * @brief Comparison triangles per parallel task (default 16384)
+     */
+    void setChunkSize(int triangles) { m_chunkSize = qMax(1, triangles); }
+
+private:
+    VolumeEngine m_engine;
+    TriangleIndex m_base;
+    TriangleIndex m_comparison;
+    QVector<double> m_baseDepth;          // Base minus comparison at base vertices
+    QVector<double> m_comparisonDepth;    // The same at comparison vertices
+    double m_minThickness{0.0};
+    double m_maxThickness{0.0};
+    QVector<ContourEngine::Contour> m_isopachs;
+    int m_chunkSize{16384};
+};
+
+#endif // SURFACEDIFFERENCE_H
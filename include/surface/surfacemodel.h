@@ -0,0 +1,139 @@
+#ifndef SURFACEMODEL_H
+#define SURFACEMODEL_H
+
+#include <QString>
+#include <QVector>
+#include <QPointF>
+#include "gdal/geosbridge.h"
+#include "surface/constrainedtin.h"
+
+// Forward declarations
+struct CanvasPolyline;
+
+/**
+ * @brief SurfaceModel - Triangulated surface shared by the TIN tools
+ *
+ * Built once from the survey points (plus optional breaklines and
+ * boundary) and then read by contours, volumes, the canvas TIN and the 3D
+ * viewer. Besides the vertices and counter-clockwise triangles it keeps
+ * the triangle adjacency and per-triangle plan area, unit normal and
+ * elevation range, so consumers do not recompute them.
+ *
+ * The owner stamps the model with the revision of the data it was built
+ * from (see CanvasWidget::surfaceModel()) and rebuilds it when that moves.
+ * A surface without breaklines or boundary can instead be edited point by
+ * point: only the triangles around the point are redone, and
+ * changedTriangles() lists them so contours can follow.
+ *
+ * Triangles are kept by slot so edits do not renumber them; empty slots
+ * hold -1 and are skipped by every consumer.
+ */
+class SurfaceModel {
+public:
+    struct TriangleInfo {
+        double area{0.0};                   // Plan area (m2)
+        double nx{0.0}, ny{0.0}, nz{1.0};   // Unit normal, pointing up
+        double minZ{0.0}, maxZ{0.0};
+    };
+
+    SurfaceModel();
+
+    /**
+     * @brief Triangulate the points, force in the breaklines and clip to the
+     *        boundary ring (empty = convex hull)
+     * @return false on failure, including a breakline or boundary that could
+     *         not be inserted (check lastError())
+     */
+    bool build(const QVector<GeosBridge::Point3D>& points,
+               const QVector<CanvasPolyline>& polylines = QVector<CanvasPolyline>(),
+               const QVector<int>& breaklines = QVector<int>(),
+               const QVector<QPointF>& boundary = QVector<QPointF>());
+
+    quint64 revision() const { return m_revision; }
+    void setRevision(quint64 revision) { m_revision = revision; }
+
+    bool isEmpty() const { return m_triangleCount == 0; }
+
+    /**
+     * @brief Vertices: the input points first, then breakline vertices,
+     *        then points added by edits (removed ones stay, unused)
+     */
+    const QVector<GeosBridge::Point3D>& points() const { return m_tin.points(); }
+    int inputPointCount() const { return m_inputVertex.size(); }
+
+    /**
+     * @brief Vertex indices, three per slot, counter-clockwise; -1 for an
+     *        empty slot
+     */
+    const QVector<int>& triangles() const { return m_triangles; }
+    int triangleCount() const { return m_triangleCount; }
+
+    /**
+     * @brief True when the surface has no breaklines or boundary, so the
+     *        point edits below apply
+     */
+    bool isEditable() const { return m_editable; }
+
+    /**
+     * @brief Insert, remove or move input point index (indices after it
+     *        shift as in the caller's point list)
+     * @return false if the edit cannot be made locally; rebuild instead
+     */
+    bool insertPoint(int index, const GeosBridge::Point3D& point);
+    bool removePoint(int index);
+    bool movePoint(int index, const GeosBridge::Point3D& point);
+
+    /**
+     * @brief Triangle slots redone by the last point edit
+     */
+    const QVector<int>& changedTriangles() const { return m_changed; }
+
+    /**
+     * @brief Triangle across each edge, -1 on the outer edge
+     *
+     * neighbours()[3 * t + i] is the triangle sharing the edge from corner
+     * i to corner (i + 1) % 3 of triangle t.
+     */
+    const QVector<int>& neighbours() const { return m_neighbours; }
+
+    /**
+     * @brief Per slot, like neighbours()
+     */
+    const QVector<TriangleInfo>& triangleInfo() const { return m_info; }
+
+    double minZ() const { return m_minZ; }
+    double maxZ() const { return m_maxZ; }
+    double planArea() const { return m_planArea; }
+    double surfaceArea() const { return m_surfaceArea; }
+    int breaklineCount() const { return m_breaklineCount; }
+    int skippedCount() const { return m_tin.skippedCount(); }   // Points build() could not attach
+
+    /**
+     * @brief Underlying editable triangulation
+     */
+    const ConstrainedTin& tin() const { return m_tin; }
+
+    QString lastError() const { return m_lastError; }
+
+private:
+    void refreshTriangles(const QVector<int>& changed);
+    void attachDuplicate(const GeosBridge::Point3D& position);
+
+    ConstrainedTin m_tin;
+    QVector<int> m_triangles;
+    QVector<int> m_neighbours;
+    QVector<TriangleInfo> m_info;
+    QVector<int> m_changed;
+    QVector<int> m_inputVertex;         // Vertex of each input point
+    int m_triangleCount{0};
+    int m_breaklineCount{0};
+    bool m_editable{false};
+    double m_minZ{0.0};
+    double m_maxZ{0.0};
+    double m_planArea{0.0};
+    double m_surfaceArea{0.0};
+    quint64 m_revision{0};
+    QString m_lastError;
+};
+
+#endif // SURFACEMODEL_H
@@ -0,0 +1,65 @@
+#ifndef TRIANGLEINDEX_H
+#define TRIANGLEINDEX_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include "gdal/geosbridge.h"
+
+/**
+ * @brief TriangleIndex - Grid of triangles for point location on a surface
+ *
+ * Each grid cell lists the triangles whose bounding box overlaps it. The
+ * lists are stored back to back in one array with per-cell offsets (about
+ * one cell per triangle), so memory stays linear in the triangle count and
+ * a lookup scans one short list. Read-only once built, so any number of
+ * threads can query it.
+ */
+class TriangleIndex {
+public:
+    TriangleIndex();
+
+    /**
+     * @brief Index a surface; triangles with a negative index are skipped
+     */
+    void build(const QVector<GeosBridge::Point3D>& points, const QVector<int>& triangles);
+
+    bool isEmpty() const { return m_cellTriangles.isEmpty(); }
+    QRectF bounds() const { return m_bounds; }
+
+    const QVector<GeosBridge::Point3D>& points() const { return m_points; }
+    const QVector<int>& triangles() const { return m_triangles; }
+
+    /**
+     * @brief Triangle containing a point (edges included), -1 if none
+     * @param u,v Barycentric weights of its second and third corners
+     */
+    int triangleAt(const QPointF& point, double& u, double& v) const;
+
+    /**
+     * @brief Surface elevation at a point, NaN off the surface
+     */
+    double elevationAt(const QPointF& point) const;
+
+    /**
+     * @brief Append the triangles listed in the cells a rectangle touches
+     *        (a superset of those overlapping it), each once
+     */
+    void trianglesIn(const QRectF& rect, QVector<int>& triangles) const;
+
+private:
+    int columnOf(double x) const;
+    int rowOf(double y) const;
+
+    QVector<GeosBridge::Point3D> m_points;
+    QVector<int> m_triangles;
+    QRectF m_bounds;
+    int m_columns{0};
+    int m_rows{0};
+    double m_cellWidth{0.0};
+    double m_cellHeight{0.0};
+    QVector<int> m_cellStart;       // Offsets into m_cellTriangles, one per cell plus one
+    QVector<int> m_cellTriangles;
+};
+
+#endif // TRIANGLEINDEX_H
@@ -0,0 +1,148 @@
+#ifndef VOLUMEENGINE_H
+#define VOLUMEENGINE_H
+
+#include <QVector>
+#include <QPointF>
+#include "gdal/geosbridge.h"
+#include "surface/surfaceboundary.h"
+#include "surface/triangleindex.h"
+
+class ElevationGrid;
+
+/**
+ * @brief VolumeEngine - Cut and fill between a triangulated surface and a design
+ *
+ * The design is a level, a sloped plane, another triangulated surface or a
+ * DEM. Its height is taken at every surface vertex, so the difference is
+ * linear over each triangle, and a triangle crossing the design is split
+ * along the zero line: the part above is cut and the part below is fill,
+ * exactly, instead of the whole prism going one way by its mean height.
+ *
+ * The optional boundary is prepared once (see SurfaceBoundary). Triangles
+ * wholly inside count in full; triangles the boundary passes through are
+ * clipped to it, and to the split line when they also cross the design.
+ *
+ * Triangles are processed in parallel chunks with compensated (Kahan)
+ * sums, within each chunk and across chunks in order, so totals over
+ * millions of triangles neither drift nor depend on thread scheduling.
+ */
+class VolumeEngine {
+public:
+    enum class Design {
+        Level,      // Horizontal plane
+        Plane,      // Sloped plane
+        Surface,    // Another TIN (TIN vs TIN)
+        Grid        // A DEM (TIN vs DEM)
+    };
+
+    struct Result {
+        double cut{0.0};        // Volume above the design (m3)
+        double fill{0.0};       // Volume below the design (m3)
+        double area{0.0};       // Plan area inside the boundary (m2)
+        int triangles{0};       // Triangles with area inside the boundary
+        int clipped{0};         // Of those, triangles cut by the boundary
+        int split{0};           // Of those, triangles crossing the design
+        int uncovered{0};       // Triangles skipped: a corner is off the design
+    };
+
+    /**
+     * @brief Neumaier's form of Kahan summation: the compensation also holds
+     *        when a term is larger than the running sum
+     */
+    struct CompensatedSum {
+        double sum{0.0};
+        double compensation{0.0};
+
+        void add(double value)
+        {
+            const double total = sum + value;
+            if (qAbs(sum) >= qAbs(value)) {
+                compensation += (sum - total) + value;
+            } else {
+                compensation += (value - total) + sum;
+            }
+            sum = total;
+        }
+
+        double value() const { return sum + compensation; }
+    };
+
+    VolumeEngine();
+
+    /**
+     * @brief Restrict volumes to a polygon (empty = the whole surface)
+     */
+    void setBoundary(const QVector<QPointF>& boundary);
+    const SurfaceBoundary& boundary() const { return m_boundary; }
+
+    /**
+     * @brief Horizontal design at a level (the default, level 0)
+     */
+    void setDesignLevel(double level);
+
+    /**
+     * @brief Plane through level at origin, rising gradeX per metre east
+     *        and gradeY per metre north (0.02 = 2 %)
+     */
+    void setDesignPlane(const QPointF& origin, double level, double gradeX, double gradeY);
+
+    /**
+     * @brief Another triangulated surface; negative triangle indices are
+     *        empty slots
+     */
+    void setDesignSurface(const QVector<GeosBridge::Point3D>& points, const QVector<int>& triangles);
+
+    /**
+     * @brief A DEM, sampled bilinearly on the calling thread (ElevationGrid
+     *        is not thread-safe); NoData leaves triangles uncovered
+     */
+    void setDesignGrid(ElevationGrid* grid);
+
+    Design design() const { return m_design; }
+
+    /**
+     * @brief Volume between a surface and the design
+     * @param points Surface vertices
+     * @param triangles Vertex indices, three per triangle (negative = empty slot)
+     */
+    Result compute(const QVector<GeosBridge::Point3D>& points,
+                   const QVector<int>& triangles) const;
+
+    /**
+     * @brief Volume between a surface and a horizontal design level
+     */
+    Result computeAgainstLevel(const QVector<GeosBridge::Point3D>& points,
+                               const QVector<int>& triangles,
+                               double level) const;
+
+    /**
+     * @brief Volume of one triangle within the boundary, its height above
+     *        the design varying linearly from d[0] at a to d[2] at c
+     *
+     * This is the step compute() takes per triangle, for callers that
+     * produce their own facets (see SurfaceDifference).
+     * @return Totals for this triangle alone (uncovered if a d is NaN)
+     */
+    Result prism(const QPointF& a, const QPointF& b, const QPointF& c, const double d[3]) const;
+
+    /**
+     * @brief Triangles per parallel task (default 65536)
+     */
+    void setChunkSize(int triangles) { m_chunkSize = qMax(1, triangles); }
+
+private:
+    QVector<double> designHeights(const QVector<GeosBridge::Point3D>& points,
+                                  const QVector<int>& triangles) const;
+
+    SurfaceBoundary m_boundary;
+    Design m_design{Design::Level};
+    QPointF m_origin;
+    double m_level{0.0};
+    double m_gradeX{0.0};
+    double m_gradeY{0.0};
+    TriangleIndex m_designSurface;
+    ElevationGrid* m_designGrid{nullptr};
+    int m_chunkSize{65536};
+};
+
+#endif // VOLUMEENGINE_H
@@ -8,6 +8,9 @@
 #include <QPushButton>
 #include <QTableWidget>
 #include <QTextEdit>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
+#include "gdal/geometryvalidator.h"
 
 class CanvasWidget;
 
@@ -35,24 +38,25 @@ private slots:
 private:
     void setupUi();
     void runAnalysis();
-    void addIssueRow(int polyIndex, const QString& layer, const QString& error);
+    void addIssueRow(const QString& id, int polyIndex, const QString& layer, const QString& error);
 
     CanvasWidget* m_canvas;
     CheckMode m_mode;
     
     struct Issue {
-        int polyIndex;
+        GeometryValidator::IssueType type;
+        int polyIndex;         // -1 for gaps
         QString layer;
         QString error;
         QVector<QPointF> originalPoints;
         QPointF errorLocation; // For visual marker
     };
     QVector<Issue> m_issues; // Stores index in parallel with table rows
-    
-    QPointF parseErrorLocation(const QString& error); // Helper
 
     // UI Elements
     QLabel* m_statusLabel;
+    QCheckBox* m_topologyCheck;
+    QDoubleSpinBox* m_gapAreaSpin;
     QTableWidget* m_issueTable;
     QPushButton* m_fixBtn;
     QPushButton* m_autoFixBtn;
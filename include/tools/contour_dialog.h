@@ -5,18 +5,22 @@
 #include <QVector>
 #include <QPointF>
 #include "canvas/canvaswidget.h"
+#include "surface/contourengine.h"
 
 class QDoubleSpinBox;
 class QSpinBox;
 class QLabel;
 class QPushButton;
 class QCheckBox;
+class QComboBox;
+class ElevationGrid;
 
 /**
  * @brief Contour Generator Dialog
  * 
- * Generates contour lines from TIN surface using linear interpolation
- * along triangle edges.
+ * Generates contour polylines from the TIN surface (see ContourEngine),
+ * or from a DEM surface by marching squares. TIN contours applied to the
+ * canvas follow later peg edits.
  */
 class ContourDialog : public QDialog
 {
@@ -32,21 +36,34 @@ private slots:
 
 private:
     void setupUi();
+    void generateFromElevationGrid(ElevationGrid* grid);
+    void showSummary(const QString& source);
     
     CanvasWidget* m_canvas;
     
     // UI
+    QComboBox* m_surfaceCombo;
     QDoubleSpinBox* m_intervalSpin;
     QSpinBox* m_majorFactorSpin;
     QDoubleSpinBox* m_minElevSpin;
     QDoubleSpinBox* m_maxElevSpin;
     QCheckBox* m_autoRangeCheck;
+    QCheckBox* m_breaklineCheck;
+    QComboBox* m_boundaryCombo;
     QLabel* m_statusLabel;
     QPushButton* m_generateBtn;
     QPushButton* m_applyBtn;
     
     // Generated contours (using CanvasWidget's ContourLine type)
     QVector<CanvasWidget::ContourLine> m_contours;
+    
+    // TIN contours keep their engine so the canvas can update them
+    ContourEngine m_engine;
+    quint64 m_engineRevision{0};
+    bool m_fromSurface{false};
+    double m_majorInterval{0.0};
+    QVector<int> m_breaklines;
+    int m_boundary{-1};
 };
 
 #endif // CONTOURDIALOG_H
@@ -6,14 +6,27 @@
 #include <QVector>
 #include <QVector3D>
 #include <QMatrix4x4>
+#include <QImage>
+#include <QTimer>
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QPainter>
+#include "gdal/geosbridge.h"
 
 class CanvasWidget;
 
 /**
- * @brief Software-rendered 3D TIN viewer using QPainter (no OpenGL required)
+ * @brief Software-rendered 3D TIN viewer (no OpenGL required)
+ *
+ * Triangles are rasterized with edge functions into an image and a depth
+ * buffer, so overlapping parts of the surface hide each other per pixel.
+ * Colours and normals are worked out per vertex when the data is set and
+ * interpolated across each triangle. Triangles are binned into screen
+ * tiles that are filled in parallel.
+ *
+ * Large meshes get coarser levels of detail (MeshSimplifier, built in the
+ * background); while the view is being dragged or zoomed a coarse level is
+ * drawn, and the full mesh once the mouse is idle.
  */
 class TIN3DSoftwareWidget : public QWidget
 {
@@ -22,8 +35,11 @@ class TIN3DSoftwareWidget : public QWidget
 public:
     explicit TIN3DSoftwareWidget(QWidget *parent = nullptr);
     
-    void setTINData(const QVector<QVector3D>& vertices, 
-                    const QVector<QVector<int>>& triangles,
+    /**
+     * @brief Show a TIN (three indices per triangle; negative ones are empty slots)
+     */
+    void setTINData(const QVector<GeosBridge::Point3D>& points, 
+                    const QVector<int>& triangles,
                     double minZ, double maxZ);
     
 public slots:
@@ -33,16 +49,48 @@ protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
 
 private:
+    // A coarser mesh on a subset of the vertices
+    struct DetailLevel {
+        QVector<int> triangles;     // Three vertex indices each
+        QVector<int> vertices;      // The vertices they use
+    };
+    
+    void buildDetailLevels();
+    void interact();
+
     QColor getColorForElevation(double z, double minZ, double maxZ);
-    QPointF project3Dto2D(const QVector3D& point3D);
+    void updateView();
+    void render(const QVector<int>& triangles, const QVector<int>* vertices);
     
-    QVector<QVector3D> m_vertices;
-    QVector<QVector<int>> m_triangles;
+    QVector<QVector3D> m_vertices;  // Relative to the centre of the TIN
+    QVector<int> m_triangles;       // Valid triangles, three indices each
+    QVector<QVector3D> m_normals;   // Area-weighted vertex normals
+    QVector<QRgb> m_colors;         // Shaded elevation colour per vertex
     double m_minZ{0}, m_maxZ{1};
     
+    // Model to screen (pixels, depth) for the current view; rebuilt only
+    // when the view, the widget size or the model changes
+    QMatrix4x4 m_view;
+    QSize m_viewSize;
+    bool m_viewDirty{true};
+    
+    // Frame buffers, kept until the view or the level drawn changes
+    QVector<QVector3D> m_screen;    // Projected vertices: pixels and depth
+    QImage m_image;
+    QVector<float> m_depth;         // Larger is nearer the viewer
+    bool m_frameValid{false};
+    int m_frameLevel{-1};           // Level in m_image, -1 for full detail
+    
+    // Levels of detail, finest first, and the interaction that uses them
+    QVector<DetailLevel> m_levels;
+    quint64 m_levelGeneration{0};   // Results for older data are dropped
+    bool m_interacting{false};
+    QTimer m_idleTimer;
+    
     // View parameters
     float m_rotationX{30.0f};
     float m_rotationZ{45.0f};
@@ -52,8 +100,7 @@ private:
     
     QPoint m_lastMousePos;
     
-    // Model center and scale
-    QVector3D m_center;
+    // Model size
     float m_scale{1.0f};
 };
 
@@ -4,11 +4,15 @@
 #include <QDialog>
 #include <QVector>
 #include <QPointF>
+#include <QImage>
+#include "canvas/canvaswidget.h"
 
-class CanvasWidget;
+class ElevationGrid;
+class SurfaceModel;
 class QLabel;
 class QDoubleSpinBox;
 class QComboBox;
+class QCheckBox;
 class QPushButton;
 class QTextEdit;
 class QTableWidget;
@@ -26,9 +30,14 @@ public:
 private slots:
     void calculate();
     void onBoundaryChanged(int index);
+    void onSurfaceChanged(int index);
+    void onDesignChanged(int index);
+    void onMethodChanged(int index);
     void showTIN();
     void hideTIN();
     void view3D();
+    void showIsopachs();
+    void toggleHeatmap(bool shown);
     void selectAllPegs();
     void deselectAllPegs();
     void exportReport();
@@ -37,22 +46,44 @@ private slots:
 private:
     void setupUi();
     void populateBoundaryList();
+    void populateSurfaceList();
+    void populateLayerList();
+    ElevationGrid* selectedElevationGrid() const;
+    ElevationGrid* designElevationGrid() const;
+    QString designLayer() const;
+    QString designDescription() const;
+    void calculateBetweenSurveys(const QVector<int>& selectedIndices, const QVector<QPointF>& boundary);
+    void calculateGrid(ElevationGrid* surface, const SurfaceModel* model, const QVector<QPointF>& boundary);
+    bool gridMethod() const;
     void populatePegTable();
     void applyTheme();
     QVector<int> getSelectedPegIndices();
+    QVector<int> breaklineIndices() const;
     
     CanvasWidget* m_canvas;
     
     // UI Elements
     QTableWidget* m_pegTable{nullptr};
+    QComboBox* m_surfaceCombo{nullptr};
     QComboBox* m_boundaryCombo{nullptr};
+    QComboBox* m_designCombo{nullptr};
+    QComboBox* m_methodCombo{nullptr};
+    QDoubleSpinBox* m_cellSizeSpin{nullptr};
     QDoubleSpinBox* m_designLevelSpin{nullptr};
+    QDoubleSpinBox* m_originXSpin{nullptr};
+    QDoubleSpinBox* m_originYSpin{nullptr};
+    QDoubleSpinBox* m_slopeXSpin{nullptr};
+    QDoubleSpinBox* m_slopeYSpin{nullptr};
+    QDoubleSpinBox* m_isopachSpin{nullptr};
+    QCheckBox* m_breaklineCheck{nullptr};
     QLabel* m_selectedCountLabel{nullptr};
     QTextEdit* m_resultText{nullptr};
     QPushButton* m_calculateBtn{nullptr};
     QPushButton* m_showTinBtn{nullptr};
     QPushButton* m_hideTinBtn{nullptr};
     QPushButton* m_view3DBtn{nullptr};
+    QPushButton* m_isopachBtn{nullptr};
+    QPushButton* m_heatmapBtn{nullptr};
     QPushButton* m_exportBtn{nullptr};
     
     // Last calculation results for export
@@ -60,6 +91,14 @@ private:
     double m_lastFillVol{0};
     double m_lastSurfaceArea{0};
     int m_lastTriangleCount{0};
+    int m_lastSplitCount{0};
+    qint64 m_lastCellCount{0};  // DEM surface only
+    QString m_lastSurfaceName;
+    QString m_lastDesign;
+    QString m_lastMethod;       // Grid method only
+    QVector<CanvasWidget::ContourLine> m_isopachs;  // Survey to survey only
+    QImage m_heatmap;           // Last grid calculation
+    QRectF m_heatmapBounds;
 };
 
 #endif // VOLUMEDIALOG_H
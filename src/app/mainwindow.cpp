@@ -9,8 +9,12 @@
 #include "canvas/canvaswidget.h"
 #include "dxf/dxfreader.h"
 #include "gdal/gdalreader.h"
+#include "gdal/gdalrastersource.h"
 #include "gdal/gdalwriter.h"
 #include "gdal/gdalgeosloader.h"
+#ifdef HAVE_DWG
+#include "dxf/dwgloader.h"
+#endif
 #include "gdal/geosbridge.h"
 #include "gama/gamaexporter.h"
 #include "gama/gamarunner.h"
@@ -37,6 +41,9 @@
 #include <QMenu>
 #include <QAction>
 #include <QDialogButtonBox>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QFormLayout>
 #include <QFileDialog>
 #include <QStatusBar>
 #include <QLabel>
@@ -58,6 +65,12 @@
 #include <QSettings>
 #include <QDesktopServices>
 #include <QTextStream>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QtConcurrent>
+#include <memory>
+#include <atomic>
 #include <QRegularExpression>
 
 #include <QUrl>
@@ -288,7 +301,11 @@ void MainWindow::setupMenus()
     
     fileMenu->addSeparator();
     
+#ifdef HAVE_DWG
+    QAction* importDxfAction = fileMenu->addAction("Import &DXF/DWG...");
+#else
     QAction* importDxfAction = fileMenu->addAction("Import &DXF...");
+#endif
     importDxfAction->setShortcut(QKeySequence("Ctrl+D"));
     connect(importDxfAction, &QAction::triggered, this, &MainWindow::importDXF);
     
@@ -296,6 +313,9 @@ void MainWindow::setupMenus()
     importGisAction->setShortcut(QKeySequence("Ctrl+G"));
     connect(importGisAction, &QAction::triggered, this, &MainWindow::importGDAL);
     
+    QAction* importGisAreaAction = fileMenu->addAction("Import GIS Data (&Area of Interest)...");
+    connect(importGisAreaAction, &QAction::triggered, this, &MainWindow::importGDALArea);
+    
     QAction* importCsvAction = fileMenu->addAction("Import &CSV Points...");
     connect(importCsvAction, &QAction::triggered, this, &MainWindow::importCSVPoints);
     
@@ -390,6 +410,14 @@ void MainWindow::setupMenus()
         }
     });
     
+    QAction* exportGpkgAction = exportMenu->addAction("Export to Geo&Package...");
+    exportGpkgAction->setToolTip("Export polylines, polygons and pegs to one GeoPackage with a spatial index");
+    connect(exportGpkgAction, &QAction::triggered, this, [this]() { exportBulk(false); });
+    
+    QAction* exportFgbAction = exportMenu->addAction("Export to &FlatGeobuf...");
+    exportFgbAction->setToolTip("Export to indexed FlatGeobuf files for fast streaming");
+    connect(exportFgbAction, &QAction::triggered, this, [this]() { exportBulk(true); });
+    
     fileMenu->addSeparator();
     
     QAction* exitAction = fileMenu->addAction("E&xit");
@@ -1706,12 +1734,25 @@ void MainWindow::updatePropertiesPanel()
 
 void MainWindow::importDXF()
 {
+#ifdef HAVE_DWG
+    QString fileName = QFileDialog::getOpenFileName(this, 
+        "Import Drawing", QString(), 
+        "CAD Drawings (*.dxf *.dwg);;DXF Files (*.dxf);;DWG Files (*.dwg);;All Files (*)");
+#else
     QString fileName = QFileDialog::getOpenFileName(this, 
         "Import DXF", QString(), 
         "DXF Files (*.dxf);;All Files (*)");
+#endif
     
     if (fileName.isEmpty()) return;
     
+#ifdef HAVE_DWG
+    if (QFileInfo(fileName).suffix().compare("dwg", Qt::CaseInsensitive) == 0) {
+        importDWG(fileName);
+        return;
+    }
+#endif
+    
     QApplication::setOverrideCursor(Qt::WaitCursor);
     
     // Use the new GDAL + GEOS loader
@@ -1722,13 +1763,15 @@ void MainWindow::importDXF()
     QApplication::restoreOverrideCursor();
     
     if (success) {
-        m_canvas->loadDxfData(data);
+        const int polylineCount = data.polylines.size();
+        const int textCount = data.texts.size();
+        m_canvas->loadDxfData(std::move(data));
         setWindowTitle(QString("SiteSurveyor - %1").arg(QFileInfo(fileName).fileName()));
         m_crsLabel->setText("DXF");
         
         statusBar()->showMessage(QString("Loaded: %1 polylines, %2 texts | Processed: %3, Repaired: %4, Failed: %5")
-            .arg(data.polylines.size())
-            .arg(data.texts.size())
+            .arg(polylineCount)
+            .arg(textCount)
             .arg(loader.geometriesProcessed())
             .arg(loader.geometriesRepaired())
             .arg(loader.geometriesFailed()), 5000);
@@ -1768,6 +1811,125 @@ void MainWindow::importDXF()
     }
 }
 
+#ifdef HAVE_DWG
+void MainWindow::importDWG(const QString& fileName)
+{
+    // DWG decoding runs on a worker thread; the dialog shows a running entity count
+    QPointer<QProgressDialog> progress = new QProgressDialog(
+        QString("Reading %1...").arg(QFileInfo(fileName).fileName()), QString(), 0, 0, this);
+    progress->setWindowTitle("Import DWG");
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    
+    auto loader = std::make_shared<DwgLoader>();
+    auto data = std::make_shared<DxfData>();
+    loader->setProgressCallback([this, progress](int entitiesRead) {
+        QMetaObject::invokeMethod(this, [progress, entitiesRead]() {
+            if (progress) progress->setLabelText(QString("Read %1 entities...").arg(entitiesRead));
+        }, Qt::QueuedConnection);
+    });
+    
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, loader, data, fileName]() {
+        bool success = watcher->result();
+        watcher->deleteLater();
+        if (progress) progress->deleteLater();
+        
+        if (!success) {
+            QMessageBox::warning(this, "Import DWG", 
+                QString("Failed to load DWG file:\n%1\n\nError: %2")
+                    .arg(fileName)
+                    .arg(loader->lastError()));
+            return;
+        }
+        
+        const int blockCount = data->blocks.size();
+        m_canvas->loadDxfData(std::move(*data));
+        setWindowTitle(QString("SiteSurveyor - %1").arg(QFileInfo(fileName).fileName()));
+        m_crsLabel->setText("DWG");
+        
+        statusBar()->showMessage(QString("Loaded %1 (%2): %3 entities, %4 blocks, %5 skipped | %6 ms, %7 entities/s")
+            .arg(QFileInfo(fileName).fileName())
+            .arg(loader->version())
+            .arg(loader->entitiesRead())
+            .arg(blockCount)
+            .arg(loader->entitiesSkipped())
+            .arg(loader->elapsedMs())
+            .arg(qRound(loader->entitiesPerSecond())), 8000);
+        
+        QStringList issues = loader->issueLog();
+        if (!issues.isEmpty()) {
+            QMessageBox::warning(this, "Import DWG", issues.join("\n"));
+        }
+    });
+    
+    watcher->setFuture(QtConcurrent::run([loader, data, fileName]() {
+        return loader->loadDwg(fileName, *data);
+    }));
+}
+#endif
+
+void MainWindow::exportBulk(bool flatGeobuf)
+{
+    if (!m_canvas) return;
+    
+    const QString title = flatGeobuf ? "Export to FlatGeobuf" : "Export to GeoPackage";
+    const QString suffix = flatGeobuf ? ".fgb" : ".gpkg";
+    QString filePath = QFileDialog::getSaveFileName(this, title, QString(),
+        flatGeobuf ? "FlatGeobuf (*.fgb)" : "GeoPackage (*.gpkg)");
+    if (filePath.isEmpty()) return;
+    if (!filePath.endsWith(suffix)) filePath += suffix;
+    
+    // The worker gets its own (implicitly shared) copies of the drawing
+    QVector<CanvasPolyline> polylines = m_canvas->polylines();
+    QVector<CanvasPeg> pegs = m_canvas->pegs();
+    QString crs = m_canvas->crs();
+    
+    QPointer<QProgressDialog> progress = new QProgressDialog("Writing features...", "Cancel", 0, 100, this);
+    progress->setWindowTitle(title);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    
+    auto writer = std::make_shared<GdalWriter>();
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    connect(progress, &QProgressDialog::canceled, this, [cancelled]() { cancelled->store(true); });
+    writer->setProgressCallback([this, progress, cancelled](qint64 written, qint64 total) {
+        int percent = total > 0 ? static_cast<int>(written * 100 / total) : 100;
+        QMetaObject::invokeMethod(this, [progress, written, percent]() {
+            if (!progress) return;
+            progress->setLabelText(QString("Wrote %1 features...").arg(written));
+            progress->setValue(percent);
+        }, Qt::QueuedConnection);
+        return !cancelled->load();
+    });
+    
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, writer, cancelled, title]() {
+        bool success = watcher->result();
+        watcher->deleteLater();
+        if (progress) progress->deleteLater();
+        
+        if (success) {
+            // FlatGeobuf splits layers over several files; name them all
+            QStringList names;
+            for (const QString& path : writer->filesWritten()) {
+                names << QFileInfo(path).fileName();
+            }
+            statusBar()->showMessage(QString("Exported %1 features to %2")
+                .arg(writer->featuresWritten()).arg(names.join(", ")), 5000);
+        } else if (cancelled->load()) {
+            statusBar()->showMessage("Export cancelled", 3000);
+        } else {
+            QMessageBox::warning(this, title, writer->lastError());
+        }
+    });
+    
+    watcher->setFuture(QtConcurrent::run([writer, polylines, pegs, filePath, crs, flatGeobuf]() {
+        return flatGeobuf ? writer->exportToFlatGeobuf(polylines, pegs, filePath, crs)
+                          : writer->exportToGeoPackage(polylines, pegs, filePath, crs);
+    }));
+}
+
 void MainWindow::importGDAL()
 {
     QString fileName = QFileDialog::getOpenFileName(this, 
@@ -1784,23 +1946,53 @@ void MainWindow::importGDAL()
     QApplication::restoreOverrideCursor();
     
     if (success) {
-        m_canvas->loadGdalData(reader.data());
-        setWindowTitle(QString("SiteSurveyor - %1").arg(QFileInfo(fileName).fileName()));
-        
-        // Show CRS in status bar
-        if (!reader.data().crs.isEmpty()) {
-            m_crsLabel->setText(reader.data().crs);
-        } else {
-            m_crsLabel->setText("Unknown CRS");
+        // Large rasters without overviews read every pixel when zoomed out
+        for (const auto& raster : reader.data().rasters) {
+            if (!raster.source || raster.source->hasOverviews()) continue;
+            QSize size = raster.source->size();
+            if (static_cast<qint64>(size.width()) * size.height() <= GdalReader::TiledRasterThreshold) continue;
+            
+            auto answer = QMessageBox::question(this, "Import GIS Data",
+                QString("%1 is %2 x %3 pixels and has no overviews.\n\n"
+                        "Build overviews (.ovr) now for faster display when zoomed out?")
+                    .arg(QFileInfo(fileName).fileName())
+                    .arg(size.width())
+                    .arg(size.height()));
+            if (answer != QMessageBox::Yes) continue;
+            
+            QProgressDialog progress("Building overviews...", "Cancel", 0, 100, this);
+            progress.setWindowModality(Qt::WindowModal);
+            progress.setMinimumDuration(0);
+            bool built = raster.source->buildOverviews([&progress](double complete) {
+                progress.setValue(static_cast<int>(complete * 100));
+                QApplication::processEvents();
+                return !progress.wasCanceled();
+            });
+            progress.setValue(100);
+            
+            if (!built && !progress.wasCanceled()) {
+                QMessageBox::warning(this, "Import GIS Data", raster.source->lastError());
+            }
         }
         
         const auto& data = reader.data();
-        statusBar()->showMessage(QString("Loaded: %1 points, %2 lines, %3 polygons, %4 rasters, %5 layers")
+        QString message = QString("Loaded: %1 points, %2 lines, %3 polygons, %4 rasters, %5 layers")
             .arg(data.points.size())
             .arg(data.lineStrings.size())
             .arg(data.polygons.size())
             .arg(data.rasters.size())
-            .arg(data.layers.size()), 5000);
+            .arg(data.layers.size());
+        
+        // Show CRS in status bar
+        if (!data.crs.isEmpty()) {
+            m_crsLabel->setText(data.crs);
+        } else {
+            m_crsLabel->setText("Unknown CRS");
+        }
+        
+        m_canvas->loadGdalData(reader.takeData());
+        setWindowTitle(QString("SiteSurveyor - %1").arg(QFileInfo(fileName).fileName()));
+        statusBar()->showMessage(message, 5000);
     } else {
         QMessageBox::warning(this, "Import GIS Data", 
             QString("Failed to load GIS file:\n%1\n\nError: %2")
@@ -1809,6 +2001,86 @@ void MainWindow::importGDAL()
     }
 }
 
+void MainWindow::importGDALArea()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, 
+        "Import GIS Data (Area of Interest)", QString(), 
+        GdalReader::fileFilter());
+    
+    if (fileName.isEmpty()) return;
+    
+    // Filter options
+    QDialog dialog(this);
+    dialog.setWindowTitle("Area of Interest");
+    QFormLayout* form = new QFormLayout(&dialog);
+    
+    QComboBox* extentCombo = new QComboBox();
+    extentCombo->addItem("Current view");
+    extentCombo->addItem("Whole file");
+    form->addRow("Extent:", extentCombo);
+    
+    QLineEdit* whereEdit = new QLineEdit();
+    whereEdit->setPlaceholderText("e.g. land_use = 'residential'");
+    form->addRow("Attribute filter:", whereEdit);
+    
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+    
+    if (dialog.exec() != QDialog::Accepted) return;
+    
+    GdalReader::VectorFilter filter;
+    if (extentCombo->currentIndex() == 0) {
+        filter.extent = m_canvas->visibleWorldRect();
+    }
+    filter.attributeFilter = whereEdit->text();
+    
+    // Features go to the canvas batch by batch, added to the current drawing
+    QProgressDialog progress("Reading features...", "Stop", 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+    
+    GdalReader reader;
+    bool success = reader.streamVectorFile(fileName, filter, 5000,
+        [this, &progress, &reader](GdalData&& batch) {
+            m_canvas->appendGdalData(std::move(batch));
+            progress.setLabelText(QString("Read %1 features...").arg(reader.featuresStreamed()));
+            QApplication::processEvents();
+            return !progress.wasCanceled();
+        });
+    progress.close();
+    
+    // Batches already on the canvas stay there; say so when the read failed
+    // part way through
+    if (!success && reader.featuresStreamed() == 0) {
+        QMessageBox::warning(this, "Import GIS Data", 
+            QString("Failed to load GIS file:\n%1\n\nError: %2")
+                .arg(fileName)
+                .arg(reader.lastError()));
+        return;
+    }
+    if (!success) {
+        QMessageBox::warning(this, "Import GIS Data", 
+            QString("Partial import of GIS file:\n%1\n\n%2 features were added before the error; "
+                    "the rest of the file is missing.\n\nError: %3")
+                .arg(fileName)
+                .arg(reader.featuresStreamed())
+                .arg(reader.lastError()));
+    }
+    
+    if (!reader.data().crs.isEmpty()) {
+        m_crsLabel->setText(reader.data().crs);
+    }
+    if (filter.extent.isNull()) {
+        m_canvas->fitToWindow();
+    }
+    statusBar()->showMessage(QString("Loaded %1 features from %2 layers%3")
+        .arg(reader.featuresStreamed())
+        .arg(reader.data().layers.size())
+        .arg(!success ? " (partial, read error)" : progress.wasCanceled() ? " (stopped)" : ""), 5000);
+}
+
 
 void MainWindow::importCSVPoints()
 {
@@ -1,15 +1,19 @@
 #include "canvas/canvaswidget.h"
 #include "dxf/dxfreader.h"
 #include "gdal/gdalreader.h"
+#include "gdal/gdalrastersource.h"
 #include "tools/check_geometry_dialog.h"
 #include "tools/check_point_dialog.h"
 #include "gdal/geosbridge.h"
+#include "surface/contourengine.h"
+#include "surface/surfacemodel.h"
 #include <QPainter>
 #include <QPaintEvent>
 #include <QWheelEvent>
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QPainterPath>
+#include <QHash>
 #include <QtMath>
 #include <QInputDialog>
 #include <QJsonDocument>
@@ -18,6 +22,7 @@
 #include <QFile>
 #include <QSettings>
 #include <QMessageBox>
+#include <QTimer>
 #include <limits>
 #include <ogr_spatialref.h>
 
@@ -38,161 +43,148 @@ CanvasWidget::~CanvasWidget()
     delete m_snapper;
 }
 
-void CanvasWidget::loadDxfData(const DxfData& data)
+// Free a consumed import vector right away instead of at the end of the load
+template <typename T>
+static void releaseVector(QVector<T>& vector)
+{
+    QVector<T>().swap(vector);
+}
+
+// Rough world box of a text, used for picking and block bounds
+static QRectF textBox(const CanvasText& text)
+{
+    const double width = text.text.length() * text.height * 0.6;  // Approximate
+    return QRectF(text.position.x(), text.position.y() - text.height, width, text.height * 1.5);
+}
+
+void CanvasWidget::loadDxfData(DxfData&& data)
 {
     clearAll();
     
     // Load layers
-    for (const auto& layer : data.layers) {
-        CanvasLayer cl;
-        cl.name = layer.name;
-        cl.color = layer.color;
-        cl.visible = layer.visible;
-        m_layers.append(cl);
+    for (auto& layer : data.layers) {
         if (!layer.visible) {
             m_hiddenLayers.insert(layer.name);
         }
+        CanvasLayer cl;
+        cl.name = std::move(layer.name);
+        cl.color = layer.color;
+        cl.visible = layer.visible;
+        m_layers.append(std::move(cl));
     }
+    releaseVector(data.layers);
     
-    // Load lines
     // Load lines as 2-point polylines to allow editing/merging
-    for (const auto& line : data.lines) {
+    m_polylines.reserve(data.lines.size() + data.polylines.size());
+    for (auto& line : data.lines) {
         CanvasPolyline poly;
+        poly.points.reserve(2);
         poly.points.append(line.start);
         poly.points.append(line.end);
         poly.closed = false;
-        poly.layer = line.layer;
+        poly.layer = std::move(line.layer);
         poly.color = line.color;
-        m_polylines.append(poly);
+        m_polylines.append(std::move(poly));
     }
+    releaseVector(data.lines);
     
     // Load circles
-    for (const auto& circle : data.circles) {
-        m_circles.append({circle.center, circle.radius, circle.layer, circle.color});
+    m_circles.reserve(data.circles.size());
+    for (auto& circle : data.circles) {
+        m_circles.append({circle.center, circle.radius, std::move(circle.layer), circle.color});
     }
+    releaseVector(data.circles);
     
     // Load arcs
-    for (const auto& arc : data.arcs) {
-        m_arcs.append({arc.center, arc.radius, arc.startAngle, arc.endAngle, arc.layer, arc.color});
+    m_arcs.reserve(data.arcs.size());
+    for (auto& arc : data.arcs) {
+        m_arcs.append({arc.center, arc.radius, arc.startAngle, arc.endAngle, std::move(arc.layer), arc.color});
     }
+    releaseVector(data.arcs);
     
     // Load ellipses
-    for (const auto& ellipse : data.ellipses) {
+    m_ellipses.reserve(data.ellipses.size());
+    for (auto& ellipse : data.ellipses) {
         m_ellipses.append({ellipse.center, ellipse.majorAxis, ellipse.ratio, 
-                          ellipse.startAngle, ellipse.endAngle, ellipse.layer, ellipse.color});
+                          ellipse.startAngle, ellipse.endAngle, std::move(ellipse.layer), ellipse.color});
     }
+    releaseVector(data.ellipses);
     
     // Load splines - approximate as polylines
-    for (const auto& spline : data.splines) {
+    for (auto& spline : data.splines) {
         CanvasSpline cs;
-        cs.layer = spline.layer;
+        cs.layer = std::move(spline.layer);
         cs.color = spline.color;
         
         // Use fit points if available, otherwise control points
-        QVector<QPointF> pts = spline.fitPoints.isEmpty() ? spline.controlPoints : spline.fitPoints;
+        const QVector<QPointF>& pts = spline.fitPoints.isEmpty() ? spline.controlPoints : spline.fitPoints;
         
         if (pts.size() >= 2) {
             cs.points = interpolateSpline(pts, spline.degree, 50);
         }
         
         if (!cs.points.isEmpty()) {
-            m_splines.append(cs);
+            m_splines.append(std::move(cs));
         }
     }
+    releaseVector(data.splines);
     
-    // Load polylines
-    for (const auto& poly : data.polylines) {
-        m_polylines.append({poly.points, poly.closed, poly.layer, poly.color});
+    // Load polylines (DxfPolyline and CanvasPolyline share a layout, so the
+    // point buffers are moved, not copied)
+    for (auto& poly : data.polylines) {
+        m_polylines.append({std::move(poly.points), poly.closed, std::move(poly.layer), poly.color});
     }
+    releaseVector(data.polylines);
     
     // Load hatches
-    for (const auto& hatch : data.hatches) {
+    for (auto& hatch : data.hatches) {
         CanvasHatch ch;
         ch.solid = hatch.solid;
-        ch.layer = hatch.layer;
+        ch.layer = std::move(hatch.layer);
         ch.color = hatch.color;
-        for (const auto& loop : hatch.loops) {
-            ch.loops.append(loop.points);
+        ch.loops.reserve(hatch.loops.size());
+        for (auto& loop : hatch.loops) {
+            ch.loops.append(std::move(loop.points));
         }
         if (!ch.loops.isEmpty()) {
-            m_hatches.append(ch);
+            m_hatches.append(std::move(ch));
         }
     }
+    releaseVector(data.hatches);
     
     // Load text
-    for (const auto& text : data.texts) {
-        m_texts.append({text.text, text.position, text.height, text.angle, text.layer, text.color});
+    m_texts.reserve(data.texts.size());
+    for (auto& text : data.texts) {
+        m_texts.append({std::move(text.text), text.position, text.height, text.angle, std::move(text.layer), text.color});
     }
+    releaseVector(data.texts);
     
-    // Expand block inserts
-    for (const auto& insert : data.inserts) {
-        if (!data.blocks.contains(insert.blockName)) continue;
-        const auto& block = data.blocks[insert.blockName];
-        
-        double cosA = qCos(qDegreesToRadians(insert.rotation));
-        double sinA = qSin(qDegreesToRadians(insert.rotation));
-        
-        auto transformPoint = [&](const QPointF& pt) -> QPointF {
-            // Translate by base point, scale, rotate, then translate to insert point
-            double x = (pt.x() - block.basePoint.x()) * insert.scaleX;
-            double y = (pt.y() - block.basePoint.y()) * insert.scaleY;
-            double rx = x * cosA - y * sinA;
-            double ry = x * sinA + y * cosA;
-            return QPointF(rx + insert.insertPoint.x(), ry + insert.insertPoint.y());
-        };
-        
-        // Transform and add block entities
-        for (const auto& line : block.lines) {
-            CanvasPolyline poly;
-            poly.points.append(transformPoint(line.start));
-            poly.points.append(transformPoint(line.end));
-                poly.closed = false;
-                poly.layer = insert.layer;
-                poly.color = line.color;
-                
-                m_polylines.append(poly);
-        }
-        for (const auto& circle : block.circles) {
-            double avgScale = (qAbs(insert.scaleX) + qAbs(insert.scaleY)) / 2.0;
-            m_circles.append({transformPoint(circle.center), circle.radius * avgScale, insert.layer, circle.color});
-        }
-        for (const auto& arc : block.arcs) {
-            double avgScale = (qAbs(insert.scaleX) + qAbs(insert.scaleY)) / 2.0;
-            m_arcs.append({transformPoint(arc.center), arc.radius * avgScale, 
-                          arc.startAngle + insert.rotation, arc.endAngle + insert.rotation, 
-                          insert.layer, arc.color});
-        }
-        for (const auto& ellipse : block.ellipses) {
-            CanvasEllipse ce;
-            ce.center = transformPoint(ellipse.center);
-            // Transform major axis vector
-            double mx = ellipse.majorAxis.x() * insert.scaleX;
-            double my = ellipse.majorAxis.y() * insert.scaleY;
-            ce.majorAxis = QPointF(mx * cosA - my * sinA, mx * sinA + my * cosA);
-            ce.ratio = ellipse.ratio;
-            ce.startAngle = ellipse.startAngle;
-            ce.endAngle = ellipse.endAngle;
-            ce.layer = insert.layer;
-            ce.color = ellipse.color;
-            m_ellipses.append(ce);
-        }
-        for (const auto& poly : block.polylines) {
-            CanvasPolyline cp;
-            cp.closed = poly.closed;
-            cp.layer = insert.layer;
-            cp.color = poly.color;
-            for (const auto& pt : poly.points) {
-                cp.points.append(transformPoint(pt));
-            }
-            m_polylines.append(cp);
-        }
-        for (const auto& text : block.texts) {
-            m_texts.append({text.text, transformPoint(text.position), 
-                           text.height * qAbs(insert.scaleY), text.angle + insert.rotation, 
-                           insert.layer, text.color});
-        }
+    // Block definitions are rendered once and shared by every insert
+    QHash<QString, int> blockLookup;
+    for (auto it = data.blocks.constBegin(); it != data.blocks.constEnd(); ++it) {
+        blockLookup.insert(it.key(), m_blocks.size());
+        m_blocks.append(buildBlockDef(it.key(), data.blocks));
     }
     
+    m_inserts.reserve(data.inserts.size());
+    for (auto& insert : data.inserts) {
+        auto blockIt = blockLookup.constFind(insert.blockName);
+        if (blockIt == blockLookup.constEnd()) continue;
+        
+        CanvasInsert ci;
+        ci.blockIndex = blockIt.value();
+        ci.insertPoint = insert.insertPoint;
+        ci.scaleX = insert.scaleX;
+        ci.scaleY = insert.scaleY;
+        ci.rotation = insert.rotation;
+        ci.layer = insert.layer;
+        updateInsertGeometry(ci);
+        ci.blockName = std::move(insert.blockName);
+        m_inserts.append(std::move(ci));
+    }
+    releaseVector(data.inserts);
+    data.blocks.clear();
+    
     emit layersChanged();
     fitToWindow();
     update();
@@ -211,17 +203,22 @@ void CanvasWidget::clearAll()
     m_hatches.clear();
     m_texts.clear();
     m_rasters.clear();
+    m_volumeHeatmap = CanvasRaster();
+    m_blocks.clear();
+    m_inserts.clear();
     m_layers.clear();
     m_hiddenLayers.clear();
     
     // Clear pegs and station
     m_pegs.clear();
+    pegsChanged(PegEdit::Reset);
     m_station = CanvasStation();  // Reset to default
     
     // Clear selection state
     m_selectedPolylineIndex = -1;
     m_selectedVertexIndex = -1;
     m_selectedPolylines.clear();
+    m_selectedInsertIndex = -1;
     
     // Clear undo/redo stacks
     m_undoStack.clear();
@@ -303,10 +300,14 @@ void CanvasWidget::removeLayer(const QString& name)
                 [&name](const CanvasRaster& r) { return r.layer == name; }), m_rasters.end());
             m_pegs.erase(std::remove_if(m_pegs.begin(), m_pegs.end(),
                 [&name](const CanvasPeg& p) { return p.layer == name; }), m_pegs.end());
+            pegsChanged(PegEdit::Reset);
+            m_inserts.erase(std::remove_if(m_inserts.begin(), m_inserts.end(),
+                [&name](const CanvasInsert& b) { return b.layer == name; }), m_inserts.end());
             
             // Clear selection if deleted polyline was selected
             m_selectedPolylineIndex = -1;
             m_selectedPolylines.clear();
+            m_selectedInsertIndex = -1;
             emit selectionChanged(-1);
             
             emit layersChanged();
@@ -363,6 +364,9 @@ void CanvasWidget::renameLayer(const QString& oldName, const QString& newName)
             for (auto& peg : m_pegs) {
                 if (peg.layer == oldName) peg.layer = newName;
             }
+            for (auto& insert : m_inserts) {
+                if (insert.layer == oldName) insert.layer = newName;
+            }
             
             emit layersChanged();
             update();
@@ -581,6 +585,9 @@ void CanvasWidget::paintEvent(QPaintEvent *event)
     // TIN surface (draw before pegs so triangles appear behind peg markers)
     drawTIN(painter);
     
+    // Cut/fill heatmap over the TIN
+    drawRaster(painter, m_volumeHeatmap);
+    
     // Contour lines (after TIN, before pegs)
     drawContours(painter);
     
@@ -863,6 +870,9 @@ void CanvasWidget::drawEntities(QPainter& painter)
         }
     }
     
+    // Draw block inserts
+    drawInserts(painter);
+    
     // Draw points
     for (const auto& point : m_points) {
         if (m_hiddenLayers.contains(point.layer)) continue;
@@ -981,6 +991,200 @@ void CanvasWidget::drawHatch(QPainter& painter, const CanvasHatch& hatch)
     painter.drawPath(path);
 }
 
+void CanvasWidget::drawInserts(QPainter& painter)
+{
+    if (m_inserts.isEmpty()) return;
+    
+    QRectF viewRect = m_screenToWorld.mapRect(QRectF(rect()));
+    double pixelSize = 1.0 / m_zoom;
+    
+    painter.save();
+    painter.setBrush(Qt::NoBrush);
+    
+    for (const auto& insert : m_inserts) {
+        if (m_hiddenLayers.contains(insert.layer)) continue;
+        if (insert.blockIndex < 0 || insert.blockIndex >= m_blocks.size()) continue;
+        
+        // Cull instances outside the viewport
+        const QRectF& b = insert.bounds;
+        if (b.right() < viewRect.left() || b.left() > viewRect.right() ||
+            b.bottom() < viewRect.top() || b.top() > viewRect.bottom()) {
+            continue;
+        }
+        
+        const auto& block = m_blocks[insert.blockIndex];
+        if (block.paths.isEmpty() && block.texts.isEmpty()) continue;
+        
+        // Sub-pixel instances collapse to a single dot
+        if (b.width() < 2 * pixelSize && b.height() < 2 * pixelSize) {
+            painter.resetTransform();
+            QPen pen(block.paths.isEmpty() ? block.texts.first().color : block.paths.first().first, 1);
+            pen.setCosmetic(true);
+            painter.setPen(pen);
+            painter.drawPoint(m_worldToScreen.map(b.center()));
+            continue;
+        }
+        
+        // Draw the cached block line work through the insert transform
+        painter.setTransform(insert.transform * m_worldToScreen);
+        for (const auto& part : block.paths) {
+            QPen pen(part.first, 1);
+            pen.setCosmetic(true);
+            painter.setPen(pen);
+            painter.drawPath(part.second);
+        }
+        
+        // Text keeps a screen-space font, so only its anchor goes through the
+        // transform; height and angle follow the insert scale and rotation
+        if (block.texts.isEmpty()) continue;
+        painter.resetTransform();
+        for (const auto& text : block.texts) {
+            QFont font = painter.font();
+            font.setPointSizeF(qMax(8.0, text.height * qAbs(insert.scaleY) * m_zoom));
+            painter.setFont(font);
+            painter.save();
+            painter.translate(worldToScreen(insert.transform.map(text.position)));
+            painter.rotate(text.angle + insert.rotation);
+            painter.setPen(text.color);
+            painter.drawText(0, 0, text.text);
+            painter.restore();
+        }
+    }
+    
+    painter.restore();
+}
+
+CanvasBlockDef CanvasWidget::buildBlockDef(const QString& name, const QMap<QString, DxfBlockDef>& blocks, int depth)
+{
+    CanvasBlockDef def;
+    def.name = name;
+    
+    auto blockIt = blocks.constFind(name);
+    if (blockIt == blocks.constEnd() || depth > 8) return def;  // Missing or cyclic reference
+    const DxfBlockDef& block = blockIt.value();
+    const QPointF base = block.basePoint;
+    
+    // Line work is grouped by color so each block draws with a handful of paths
+    auto pathFor = [&def](const QColor& color) -> QPainterPath& {
+        for (auto& part : def.paths) {
+            if (part.first == color) return part.second;
+        }
+        def.paths.append(qMakePair(color, QPainterPath()));
+        return def.paths.last().second;
+    };
+    
+    auto addPolyline = [&](const QVector<QPointF>& points, bool closed, const QColor& color) {
+        if (points.size() < 2) return;
+        QPainterPath& path = pathFor(color);
+        path.moveTo(points.first() - base);
+        for (int i = 1; i < points.size(); ++i) {
+            path.lineTo(points[i] - base);
+        }
+        if (closed) path.closeSubpath();
+    };
+    
+    for (const auto& line : block.lines) {
+        QPainterPath& path = pathFor(line.color);
+        path.moveTo(line.start - base);
+        path.lineTo(line.end - base);
+    }
+    
+    for (const auto& circle : block.circles) {
+        pathFor(circle.color).addEllipse(circle.center - base, circle.radius, circle.radius);
+    }
+    
+    for (const auto& arc : block.arcs) {
+        // QPainterPath angles run clockwise in Y-up world coordinates, so negate them
+        QPointF c = arc.center - base;
+        QRectF rect(c.x() - arc.radius, c.y() - arc.radius, arc.radius * 2, arc.radius * 2);
+        double span = arc.endAngle - arc.startAngle;
+        if (span < 0) span += 360.0;
+        QPainterPath& path = pathFor(arc.color);
+        path.arcMoveTo(rect, -arc.startAngle);
+        path.arcTo(rect, -arc.startAngle, -span);
+    }
+    
+    for (const auto& ellipse : block.ellipses) {
+        double majorLen = qSqrt(ellipse.majorAxis.x() * ellipse.majorAxis.x() +
+                               ellipse.majorAxis.y() * ellipse.majorAxis.y());
+        double minorLen = majorLen * ellipse.ratio;
+        double rotation = qAtan2(ellipse.majorAxis.y(), ellipse.majorAxis.x());
+        double startAngle = ellipse.startAngle;
+        double endAngle = ellipse.endAngle;
+        if (endAngle <= startAngle) endAngle += 2 * M_PI;
+        
+        QVector<QPointF> points;
+        const int segments = 64;
+        for (int i = 0; i <= segments; ++i) {
+            double t = startAngle + (endAngle - startAngle) * i / segments;
+            double x = majorLen * qCos(t);
+            double y = minorLen * qSin(t);
+            points.append(QPointF(ellipse.center.x() + x * qCos(rotation) - y * qSin(rotation),
+                                  ellipse.center.y() + x * qSin(rotation) + y * qCos(rotation)));
+        }
+        addPolyline(points, false, ellipse.color);
+    }
+    
+    for (const auto& spline : block.splines) {
+        QVector<QPointF> pts = spline.fitPoints.isEmpty() ? spline.controlPoints : spline.fitPoints;
+        if (pts.size() >= 2) {
+            addPolyline(interpolateSpline(pts, spline.degree, 50), spline.closed, spline.color);
+        }
+    }
+    
+    for (const auto& poly : block.polylines) {
+        addPolyline(poly.points, poly.closed, poly.color);
+    }
+    
+    for (const auto& text : block.texts) {
+        def.texts.append({text.text, text.position - base, text.height, text.angle, text.layer, text.color});
+    }
+    
+    // Nested blocks are flattened into this definition once, not per insert
+    for (const auto& nested : block.inserts) {
+        CanvasBlockDef child = buildBlockDef(nested.blockName, blocks, depth + 1);
+        CanvasInsert placement;
+        placement.insertPoint = nested.insertPoint - base;
+        placement.scaleX = nested.scaleX;
+        placement.scaleY = nested.scaleY;
+        placement.rotation = nested.rotation;
+        updateInsertGeometry(placement);
+        for (const auto& part : child.paths) {
+            pathFor(part.first).addPath(placement.transform.map(part.second));
+        }
+        for (CanvasText text : child.texts) {
+            text.position = placement.transform.map(text.position);
+            text.height *= qAbs(nested.scaleY);
+            text.angle += nested.rotation;
+            def.texts.append(text);
+        }
+    }
+    
+    for (const auto& part : def.paths) {
+        def.bounds = def.bounds.united(part.second.controlPointRect());
+    }
+    for (const auto& text : def.texts) {
+        def.bounds = def.bounds.united(textBox(text));
+    }
+    
+    return def;
+}
+
+void CanvasWidget::updateInsertGeometry(CanvasInsert& insert)
+{
+    // Scale, then rotate, then move to the insertion point
+    insert.transform = QTransform();
+    insert.transform.translate(insert.insertPoint.x(), insert.insertPoint.y());
+    insert.transform.rotate(insert.rotation);
+    insert.transform.scale(insert.scaleX, insert.scaleY);
+    
+    if (insert.blockIndex >= 0 && insert.blockIndex < m_blocks.size()) {
+        insert.bounds = insert.transform.mapRect(m_blocks[insert.blockIndex].bounds);
+    } else {
+        insert.bounds = QRectF(insert.insertPoint, QSizeF(0, 0));
+    }
+}
+
 QVector<QPointF> CanvasWidget::interpolateSpline(const QVector<QPointF>& controlPoints, int degree, int segments)
 {
     Q_UNUSED(degree);
@@ -1380,6 +1584,11 @@ void CanvasWidget::mousePressEvent(QMouseEvent *event)
         double tolerance = m_snapTolerance / m_zoom;
         int hitIndex = hitTestPolyline(worldPos, tolerance);
         int hitTextIndex = hitTestText(worldPos, tolerance);
+        int hitInsertIndex = (hitIndex < 0 && hitTextIndex < 0) ? hitTestInsert(worldPos, tolerance) : -1;
+        
+        if (hitIndex >= 0 || hitTextIndex >= 0 || !(event->modifiers() & Qt::ShiftModifier)) {
+            m_selectedInsertIndex = -1;
+        }
         
         if (hitIndex >= 0) {
             // Hit a polyline - single or multi-select
@@ -1418,6 +1627,15 @@ void CanvasWidget::mousePressEvent(QMouseEvent *event)
             }
             emit statusMessage(QString("Selected text: %1").arg(m_texts[hitTextIndex].text));
             update();
+        } else if (hitInsertIndex >= 0) {
+            // Hit a block insert
+            m_selectedPolylines.clear();
+            m_selectedPolylineIndex = -1;
+            m_selectedTexts.clear();
+            m_selectedInsertIndex = hitInsertIndex;
+            emit selectionChanged(m_selectedPolylineIndex);
+            emit statusMessage(QString("Selected block: %1").arg(m_inserts[hitInsertIndex].blockName));
+            update();
         } else {
             // No hit - start selection box drag
             m_isSelectingBox = true;
@@ -1574,6 +1792,11 @@ void CanvasWidget::resizeEvent(QResizeEvent *event)
     updateTransform();
 }
 
+QRectF CanvasWidget::visibleWorldRect() const
+{
+    return m_screenToWorld.mapRect(QRectF(rect()));
+}
+
 void CanvasWidget::fitToWindow()
 {
     double minX = 0, maxX = 0, minY = 0, maxY = 0;
@@ -1624,6 +1847,14 @@ void CanvasWidget::fitToWindow()
     for (const auto& text : m_texts) {
         updateBounds(text.position);
     }
+    for (const auto& insert : m_inserts) {
+        updateBounds(insert.bounds.topLeft());
+        updateBounds(insert.bounds.bottomRight());
+    }
+    for (const auto& raster : m_rasters) {
+        updateBounds(raster.bounds.topLeft());
+        updateBounds(raster.bounds.bottomRight());
+    }
     
     if (!hasData) {
         resetView();
@@ -1692,75 +1923,80 @@ void CanvasWidget::resetView()
 }
 
 // GDAL data loading
-void CanvasWidget::loadGdalData(const GdalData& data)
+void CanvasWidget::loadGdalData(GdalData&& data)
 {
     clearAll();
-    
-    // Load layers
-    for (const auto& layer : data.layers) {
-        CanvasLayer cl;
-        cl.name = layer.name;
-        cl.color = Qt::white;
-        cl.visible = layer.visible;
-        m_layers.append(cl);
+    appendGdalData(std::move(data));
+    fitToWindow();
+}
+
+void CanvasWidget::appendGdalData(GdalData&& data)
+{
+    // Load layers (streamed batches may repeat a layer already added)
+    bool layersAdded = false;
+    for (auto& layer : data.layers) {
+        bool exists = std::any_of(m_layers.begin(), m_layers.end(),
+            [&layer](const CanvasLayer& l) { return l.name == layer.name; });
+        if (exists) continue;
+        
         if (!layer.visible) {
             m_hiddenLayers.insert(layer.name);
         }
+        CanvasLayer cl;
+        cl.name = std::move(layer.name);
+        cl.color = Qt::white;
+        cl.visible = layer.visible;
+        m_layers.append(std::move(cl));
+        layersAdded = true;
     }
+    releaseVector(data.layers);
     
     // Load points
-    for (const auto& pt : data.points) {
+    m_points.reserve(m_points.size() + data.points.size());
+    for (auto& pt : data.points) {
         CanvasPoint cp;
         cp.position = pt.position;
-        cp.layer = pt.layer;
+        cp.layer = std::move(pt.layer);
         cp.color = pt.color;
-        m_points.append(cp);
+        m_points.append(std::move(cp));
     }
+    releaseVector(data.points);
     
     // Load line strings as polylines
-    // Load line strings as polylines
-    for (const auto& ls : data.lineStrings) {
-        CanvasPolyline cp;
-        cp.points = ls.points;
-        cp.closed = false;
-        cp.layer = ls.layer;
-        cp.color = ls.color;
-        m_polylines.append(cp);
+    m_polylines.reserve(m_polylines.size() + data.lineStrings.size());
+    for (auto& ls : data.lineStrings) {
+        m_polylines.append({std::move(ls.points), false, std::move(ls.layer), ls.color});
     }
+    releaseVector(data.lineStrings);
     
     // Load polygons
-    for (const auto& poly : data.polygons) {
-        CanvasPolygon cp;
-        cp.rings = poly.rings;
-        cp.layer = poly.layer;
-        cp.color = poly.color;
-        cp.fillColor = poly.fillColor;
-        m_polygons.append(cp);
+    m_polygons.reserve(m_polygons.size() + data.polygons.size());
+    for (auto& poly : data.polygons) {
+        m_polygons.append({std::move(poly.rings), std::move(poly.layer), poly.color, poly.fillColor});
     }
+    releaseVector(data.polygons);
     
     // Load text
-    for (const auto& text : data.texts) {
-        CanvasText ct;
-        ct.text = text.text;
-        ct.position = text.position;
-        ct.height = text.height;
-        ct.angle = text.angle;
-        ct.layer = text.layer;
-        ct.color = text.color;
-        m_texts.append(ct);
+    for (auto& text : data.texts) {
+        m_texts.append({std::move(text.text), text.position, text.height, text.angle, std::move(text.layer), text.color});
     }
+    releaseVector(data.texts);
     
     // Load rasters
-    for (const auto& raster : data.rasters) {
+    for (auto& raster : data.rasters) {
         CanvasRaster cr;
-        cr.image = raster.image;
+        cr.image = std::move(raster.image);
         cr.bounds = raster.bounds;
-        cr.layer = raster.layer;
-        m_rasters.append(cr);
+        cr.layer = std::move(raster.layer);
+        cr.source = std::move(raster.source);
+        cr.elevation = std::move(raster.elevation);
+        m_rasters.append(std::move(cr));
     }
+    releaseVector(data.rasters);
     
-    emit layersChanged();
-    fitToWindow();
+    if (layersAdded) {
+        emit layersChanged();
+    }
     update();
 }
 
@@ -1805,6 +2041,24 @@ void CanvasWidget::drawPolygon(QPainter& painter, const CanvasPolygon& polygon)
 
 void CanvasWidget::drawRaster(QPainter& painter, const CanvasRaster& raster)
 {
+    if (raster.source) {
+        // Only the tiles covering the view are read, at screen resolution
+        QRectF viewRect = m_screenToWorld.mapRect(QRectF(rect()));
+        bool complete = true;
+        const auto tiles = raster.source->tiles(viewRect, 1.0 / m_zoom, 16, &complete);
+        for (const auto& tile : tiles) {
+            QPointF topLeft = m_worldToScreen.map(QPointF(tile.bounds.left(), tile.bounds.bottom()));
+            QPointF bottomRight = m_worldToScreen.map(QPointF(tile.bounds.right(), tile.bounds.top()));
+            painter.drawImage(QRectF(topLeft, bottomRight), tile.image, tile.source);
+        }
+        
+        // Read the remaining tiles on the next paint so the UI stays responsive
+        if (!complete) {
+            QTimer::singleShot(0, this, [this]() { update(); });
+        }
+        return;
+    }
+    
     if (raster.image.isNull()) return;
     
     // Calculate screen coordinates for the raster bounds
@@ -1994,6 +2248,7 @@ void CanvasWidget::undo()
                 redoCmd.pegName = m_pegs[cmd.index].name;
                 redoCmd.pegColor = m_pegs[cmd.index].color;
                 m_pegs.remove(cmd.index);
+                pegsChanged(PegEdit::Remove, cmd.index);
             }
             break;
             
@@ -2005,6 +2260,7 @@ void CanvasWidget::undo()
                 peg.name = cmd.pegName;
                 peg.color = cmd.pegColor;
                 m_pegs.insert(cmd.index, peg);
+                pegsChanged(PegEdit::Insert, cmd.index);
                 redoCmd.pegPosition = cmd.pegPosition;
                 redoCmd.pegName = cmd.pegName;
                 redoCmd.pegColor = cmd.pegColor;
@@ -2020,6 +2276,16 @@ void CanvasWidget::undo()
                 redoCmd.oldPegName = cmd.oldPegName;
                 m_pegs[cmd.index].position = cmd.oldPegPosition;
                 m_pegs[cmd.index].name = cmd.oldPegName;
+                pegsChanged(PegEdit::Move, cmd.index);
+            }
+            break;
+            
+        case UndoType::DeleteInsert:
+            // Re-insert the deleted block insert
+            if (cmd.index >= 0 && cmd.index <= m_inserts.size()) {
+                m_inserts.insert(cmd.index, cmd.insert);
+                redoCmd.insert = cmd.insert;
+                if (m_selectedInsertIndex >= cmd.index) ++m_selectedInsertIndex;
             }
             break;
     }
@@ -2108,6 +2374,7 @@ void CanvasWidget::redo()
                 peg.name = cmd.pegName;
                 peg.color = cmd.pegColor;
                 m_pegs.insert(cmd.index, peg);
+                pegsChanged(PegEdit::Insert, cmd.index);
                 undoCmd.pegPosition = cmd.pegPosition;
                 undoCmd.pegName = cmd.pegName;
                 undoCmd.pegColor = cmd.pegColor;
@@ -2121,6 +2388,7 @@ void CanvasWidget::redo()
                 undoCmd.pegName = m_pegs[cmd.index].name;
                 undoCmd.pegColor = m_pegs[cmd.index].color;
                 m_pegs.remove(cmd.index);
+                pegsChanged(PegEdit::Remove, cmd.index);
             }
             break;
             
@@ -2133,6 +2401,20 @@ void CanvasWidget::redo()
                 undoCmd.pegName = cmd.pegName;
                 m_pegs[cmd.index].position = cmd.pegPosition;
                 m_pegs[cmd.index].name = cmd.pegName;
+                pegsChanged(PegEdit::Move, cmd.index);
+            }
+            break;
+            
+        case UndoType::DeleteInsert:
+            // Remove the block insert again
+            if (cmd.index >= 0 && cmd.index < m_inserts.size()) {
+                undoCmd.insert = m_inserts[cmd.index];
+                m_inserts.remove(cmd.index);
+                if (m_selectedInsertIndex == cmd.index) {
+                    m_selectedInsertIndex = -1;
+                } else if (m_selectedInsertIndex > cmd.index) {
+                    --m_selectedInsertIndex;
+                }
             }
             break;
     }
@@ -2145,6 +2427,10 @@ void CanvasWidget::redo()
 
 void CanvasWidget::clearSelection()
 {
+    if (m_selectedInsertIndex >= 0) {
+        m_selectedInsertIndex = -1;
+        update();
+    }
     if (m_selectedPolylineIndex >= 0 || !m_selectedPolylines.isEmpty()) {
         m_selectedPolylineIndex = -1;
         m_selectedPolylines.clear();
@@ -2285,15 +2571,8 @@ int CanvasWidget::hitTestText(const QPointF& worldPos, double tolerance)
         // Check if layer is visible
         if (m_hiddenLayers.contains(text.layer)) continue;
         
-        // Create a rough bounding box for the text
-        double textWidth = text.text.length() * text.height * 0.6;  // Approximate
-        double textHeight = text.height;
-        
-        QRectF textBounds(text.position.x(), text.position.y() - textHeight, 
-                          textWidth, textHeight * 1.5);
-        
-        // Expand by tolerance
-        textBounds.adjust(-tolerance, -tolerance, tolerance, tolerance);
+        // Rough bounding box expanded by the tolerance
+        QRectF textBounds = textBox(text).adjusted(-tolerance, -tolerance, tolerance, tolerance);
         
         if (textBounds.contains(worldPos)) {
             return i;  // Hit!
@@ -2302,6 +2581,56 @@ int CanvasWidget::hitTestText(const QPointF& worldPos, double tolerance)
     return -1;  // No hit
 }
 
+// Distance from a point to the segment a-b
+static double segmentDistance(const QPointF& p, const QPointF& a, const QPointF& b)
+{
+    const double dx = b.x() - a.x();
+    const double dy = b.y() - a.y();
+    const double lengthSq = dx * dx + dy * dy;
+    double t = 0;
+    if (lengthSq > 1e-12) {
+        t = qBound(0.0, ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / lengthSq, 1.0);
+    }
+    return qHypot(p.x() - (a.x() + t * dx), p.y() - (a.y() + t * dy));
+}
+
+int CanvasWidget::hitTestInsert(const QPointF& worldPos, double tolerance)
+{
+    // Reverse order for top-most selection
+    for (int i = m_inserts.size() - 1; i >= 0; --i) {
+        const auto& insert = m_inserts[i];
+        if (m_hiddenLayers.contains(insert.layer)) continue;
+        if (insert.blockIndex < 0 || insert.blockIndex >= m_blocks.size()) continue;
+        
+        // Cheap reject against the insert's transformed bounds
+        QRectF hitBounds = insert.bounds.adjusted(-tolerance, -tolerance, tolerance, tolerance);
+        if (!hitBounds.contains(worldPos)) continue;
+        
+        // Refine against the cached line work in world space (intersects()
+        // would treat open paths as filled, so measure to each segment)
+        for (const auto& part : m_blocks[insert.blockIndex].paths) {
+            const QList<QPolygonF> polygons = part.second.toSubpathPolygons(insert.transform);
+            for (const QPolygonF& polygon : polygons) {
+                if (polygon.size() == 1 && segmentDistance(worldPos, polygon[0], polygon[0]) <= tolerance) {
+                    return i;  // Hit!
+                }
+                for (int k = 0; k + 1 < polygon.size(); ++k) {
+                    if (segmentDistance(worldPos, polygon[k], polygon[k + 1]) <= tolerance) {
+                        return i;  // Hit!
+                    }
+                }
+            }
+        }
+        for (const auto& text : m_blocks[insert.blockIndex].texts) {
+            QRectF textBounds = insert.transform.mapRect(textBox(text));
+            if (textBounds.adjusted(-tolerance, -tolerance, tolerance, tolerance).contains(worldPos)) {
+                return i;
+            }
+        }
+    }
+    return -1;  // No hit
+}
+
 bool CanvasWidget::isLeft(const QPointF& a, const QPointF& b, const QPointF& p)
 {
     // Cross product: (B-A) × (P-A)
@@ -2502,6 +2831,23 @@ void CanvasWidget::keyPressEvent(QKeyEvent *event)
             return;
         }
         
+        // Delete selected block insert
+        if (m_selectedInsertIndex >= 0 && m_selectedInsertIndex < m_inserts.size()) {
+            UndoCommand cmd;
+            cmd.type = UndoType::DeleteInsert;
+            cmd.index = m_selectedInsertIndex;
+            cmd.insert = m_inserts[m_selectedInsertIndex];
+            m_undoStack.append(cmd);
+            m_redoStack.clear();
+            emit undoRedoChanged();
+            
+            m_inserts.remove(m_selectedInsertIndex);
+            m_selectedInsertIndex = -1;
+            emit statusMessage(QString("Deleted block insert: %1 (Ctrl+Z to undo)").arg(cmd.insert.blockName));
+            update();
+            return;
+        }
+        
         // Delete selected text objects
         if (!m_selectedTexts.isEmpty()) {
             QVector<int> textIndices = m_selectedTexts.values().toVector();
@@ -2526,6 +2872,18 @@ void CanvasWidget::keyPressEvent(QKeyEvent *event)
 
 void CanvasWidget::drawSelection(QPainter& painter)
 {
+    // Draw selected block insert as its transformed bounds
+    if (m_selectedInsertIndex >= 0 && m_selectedInsertIndex < m_inserts.size()) {
+        const auto& insert = m_inserts[m_selectedInsertIndex];
+        QPen insertPen(Qt::cyan, 2);
+        insertPen.setCosmetic(true);
+        insertPen.setStyle(Qt::DashLine);
+        painter.setPen(insertPen);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawPolygon(m_worldToScreen.map(insert.transform.map(
+            QPolygonF(m_blocks.value(insert.blockIndex).bounds))));
+    }
+    
     // Draw all selected polylines
     if (m_selectedPolylines.isEmpty() && m_selectedPolylineIndex < 0) {
         return;
@@ -2604,6 +2962,7 @@ void CanvasWidget::addPeg(const CanvasPeg& peg)
     emit undoRedoChanged();
     
     m_pegs.append(peg);
+    pegsChanged(PegEdit::Insert, m_pegs.size() - 1);
     emit pegAdded();  // Auto-refresh peg panel
     update();
 }
@@ -2654,6 +3013,7 @@ void CanvasWidget::addPegsFromPolyline(const CanvasPolyline& polyline, const QSt
         peg.color = Qt::red;
         m_pegs.append(peg);
     }
+    pegsChanged(PegEdit::Reset);
     update();
 }
 
@@ -2706,6 +3066,7 @@ void CanvasWidget::deleteSelectedPeg()
         emit undoRedoChanged();
         
         m_pegs.remove(m_selectedPegIndex);
+        pegsChanged(PegEdit::Remove, m_selectedPegIndex);
         m_selectedPegIndex = -1;
         update();
         emit statusMessage(QString("Deleted peg '%1'").arg(name));
@@ -2731,6 +3092,7 @@ void CanvasWidget::updatePeg(int index, const QString& name, double x, double y,
         m_pegs[index].name = name;
         m_pegs[index].position = QPointF(x, y);
         m_pegs[index].z = z;
+        pegsChanged(PegEdit::Move, index);
         
         update();
         emit statusMessage(QString("Updated peg '%1' to (%2, %3, %4)")
@@ -2817,12 +3179,14 @@ void CanvasWidget::drawPegs(QPainter& painter)
 void CanvasWidget::setTIN(const CanvasTIN& tin)
 {
     m_tin = tin;
+    m_tinRender = TINRender();
     update();
 }
 
 void CanvasWidget::clearTIN()
 {
     m_tin = CanvasTIN();
+    m_tinRender = TINRender();
     update();
 }
 
@@ -2832,114 +3196,439 @@ void CanvasWidget::setTINVisible(bool visible)
     update();
 }
 
-void CanvasWidget::generateTINFromPegs(double designLevel)
+void CanvasWidget::setTINWireframe(bool wireframe)
+{
+    m_tin.wireframe = wireframe;
+    m_tinRender.image = QImage();
+    update();
+}
+
+bool CanvasWidget::SurfaceModelKey::operator==(const SurfaceModelKey& other) const
+{
+    return pegRevision == other.pegRevision && pegs == other.pegs
+        && breaklinePoints == other.breaklinePoints
+        && breaklineClosed == other.breaklineClosed && boundary == other.boundary;
+}
+
+std::shared_ptr<const SurfaceModel> CanvasWidget::surfaceModel(const QVector<int>& pegIndices,
+                                                               const QVector<int>& breaklines,
+                                                               int boundary) const
+{
+    QVector<CanvasPolyline> lines;
+    QVector<QPointF> ring;
+    polylineGeometry(breaklines, boundary, lines, ring);
+    return surfaceModel(pegIndices, lines, ring);
+}
+
+void CanvasWidget::polylineGeometry(const QVector<int>& breaklines, int boundary,
+                                    QVector<CanvasPolyline>& lines, QVector<QPointF>& ring) const
+{
+    lines.clear();
+    for (int index : breaklines) {
+        if (index >= 0 && index < m_polylines.size()) lines.append(m_polylines[index]);
+    }
+    ring.clear();
+    if (boundary >= 0 && boundary < m_polylines.size() && m_polylines[boundary].closed) {
+        ring = m_polylines[boundary].points;
+    }
+}
+
+std::shared_ptr<const SurfaceModel> CanvasWidget::surfaceModel(const QVector<int>& pegIndices,
+                                                               const QVector<CanvasPolyline>& breaklines,
+                                                               const QVector<QPointF>& boundary) const
 {
+    // Breaklines and the boundary are compared by geometry, so polyline
+    // edits invalidate the model without a revision of their own
+    SurfaceModelKey key;
+    key.pegRevision = m_pegRevision;
+    key.pegs = pegIndices.size() == m_pegs.size() ? QVector<int>() : pegIndices;
+    QVector<int> lineIndices;
+    for (int i = 0; i < breaklines.size(); ++i) {
+        lineIndices.append(i);
+        key.breaklinePoints.append(breaklines[i].points);
+        key.breaklineClosed.append(breaklines[i].closed);
+    }
+    key.boundary = boundary;
+    
+    // Tools asking for different surfaces (all pegs for contours and the
+    // 3D view, a selection for volumes) each keep theirs
+    for (int i = 0; i < m_surfaceModels.size(); ++i) {
+        if (m_surfaceModels[i].key == key) {
+            if (i > 0) m_surfaceModels.move(i, 0);
+            return m_surfaceModels.first().model;
+        }
+    }
+    
+    QVector<GeosBridge::Point3D> points;
+    if (key.pegs.isEmpty()) {
+        points.reserve(m_pegs.size());
+        for (const auto& peg : m_pegs) {
+            points.append(GeosBridge::Point3D(peg.position.x(), peg.position.y(), peg.z));
+        }
+    } else {
+        points.reserve(key.pegs.size());
+        for (int index : key.pegs) {
+            if (index < 0 || index >= m_pegs.size()) continue;
+            const auto& peg = m_pegs[index];
+            points.append(GeosBridge::Point3D(peg.position.x(), peg.position.y(), peg.z));
+        }
+    }
+    
+    if (points.size() < 3) {
+        m_surfaceModelError = "Need at least 3 points";
+        return nullptr;
+    }
+    auto model = std::make_shared<SurfaceModel>();
+    if (!model->build(points, breaklines, lineIndices, key.boundary)) {
+        m_surfaceModelError = model->lastError();
+        return nullptr;
+    }
+    model->setRevision(m_pegRevision);
+    m_surfaceModelError.clear();
+    
+    m_surfaceModels.prepend({key, model});
+    if (m_surfaceModels.size() > SurfaceModelCacheSize) m_surfaceModels.removeLast();
+    return model;
+}
+
+void CanvasWidget::pegsChanged(PegEdit edit, int index)
+{
+    ++m_pegRevision;
+    
+    // The cached surface of all pegs without breaklines or boundary takes a
+    // single insert, delete or move in place; every other cached surface
+    // is out of date and rebuilt on next use
+    SurfaceModelEntry editable;
+    for (const auto& entry : m_surfaceModels) {
+        if (entry.key.pegs.isEmpty() && entry.model->isEditable()) {
+            editable = entry;
+            break;
+        }
+    }
+    m_surfaceModels.clear();
+    
+    bool local = false;
+    if (editable.model && edit != PegEdit::Reset) {
+        if (editable.model.use_count() > 1) {
+            editable.model = std::make_shared<SurfaceModel>(*editable.model);
+        }
+        GeosBridge::Point3D point;
+        if (index >= 0 && index < m_pegs.size()) {
+            point = GeosBridge::Point3D(m_pegs[index].position.x(), m_pegs[index].position.y(), m_pegs[index].z);
+        }
+        if (edit == PegEdit::Insert) {
+            local = index >= 0 && index < m_pegs.size() && editable.model->insertPoint(index, point);
+        } else if (edit == PegEdit::Remove) {
+            local = editable.model->removePoint(index);
+        } else {
+            local = index >= 0 && index < m_pegs.size() && editable.model->movePoint(index, point);
+        }
+        local = local && editable.model->inputPointCount() == m_pegs.size();
+    }
+    
+    const bool contoursCurrent = editable.model && m_contourRevision == editable.key.pegRevision;
+    if (local) {
+        editable.key.pegRevision = m_pegRevision;
+        editable.model->setRevision(m_pegRevision);
+        m_surfaceModels.append(editable);
+    }
+    
+    if (m_contourEngine) {
+        updateSurfaceContours(local && contoursCurrent && m_contourBreaklines.isEmpty() && m_contourBoundary.isEmpty());
+    }
+}
+
+void CanvasWidget::generateTINFromPegs(double designLevel, const QVector<int>& breaklines, int boundary)
+{
+    const bool wireframe = m_tin.wireframe;
     m_tin = CanvasTIN();
+    m_tin.wireframe = wireframe;
+    m_tinRender = TINRender();
     
     if (m_pegs.size() < 3) {
         emit statusMessage("Need at least 3 pegs with Z to generate TIN");
         return;
     }
     
-    // Collect 3D points
-    QVector<QPointF> points2D;
-    double minZ = std::numeric_limits<double>::max();
-    double maxZ = std::numeric_limits<double>::lowest();
+    std::shared_ptr<const SurfaceModel> model = surfaceModel(QVector<int>(), breaklines, boundary);
+    if (!model) {
+        emit statusMessage(QString("Failed to triangulate pegs: %1").arg(m_surfaceModelError));
+        return;
+    }
     
-    for (const auto& peg : m_pegs) {
-        m_tin.points.append(CanvasTIN::Point3D(peg.position.x(), peg.position.y(), peg.z));
-        points2D.append(peg.position);
-        minZ = qMin(minZ, peg.z);
-        maxZ = qMax(maxZ, peg.z);
+    // Breakline vertices are appended after the pegs
+    m_tin.points.reserve(model->points().size());
+    for (const auto& p : model->points()) {
+        m_tin.points.append(CanvasTIN::Point3D(p.x, p.y, p.z));
     }
     
-    m_tin.minZ = minZ;
-    m_tin.maxZ = maxZ;
+    m_tin.minZ = model->minZ();
+    m_tin.maxZ = model->maxZ();
     m_tin.designLevel = designLevel;
     
-    // Triangulate
-    m_tin.triangles = GeosBridge::delaunayTriangulate(points2D);
+    const QVector<int>& triangles = model->triangles();
+    m_tin.triangles.reserve(model->triangleCount());
+    for (int i = 0; i + 2 < triangles.size(); i += 3) {
+        if (triangles[i] < 0) continue;     // Empty slot
+        m_tin.triangles.append({triangles[i], triangles[i + 1], triangles[i + 2]});
+    }
     m_tin.visible = true;
     
-    emit statusMessage(QString("Generated TIN with %1 triangles from %2 points")
-        .arg(m_tin.triangles.size()).arg(m_pegs.size()));
+    // Points the triangulator could not attach are left out of the surface
+    const QString skipped = model->skippedCount() > 0
+        ? QString(" (%1 points on the hull skipped)").arg(model->skippedCount()) : QString();
+    if (model->breaklineCount() > 0) {
+        emit statusMessage(QString("Generated TIN with %1 triangles from %2 points and %3 breaklines%4")
+            .arg(m_tin.triangles.size()).arg(m_pegs.size()).arg(model->breaklineCount()).arg(skipped));
+    } else {
+        emit statusMessage(QString("Generated TIN with %1 triangles from %2 points%3")
+            .arg(m_tin.triangles.size()).arg(m_pegs.size()).arg(skipped));
+    }
     
     update();
 }
 
-void CanvasWidget::drawTIN(QPainter& painter)
+// Fill the pixels whose centres lie in a triangle (image coordinates).
+// Spans are half-open and a shared edge is interpolated from the same end
+// by both triangles, so neighbours neither overlap nor leave gaps.
+static void fillTriangle(QRgb* pixels, int stride, int width, int height,
+                         QPointF a, QPointF b, QPointF c, QRgb color)
 {
-    if (!m_tin.visible || m_tin.triangles.isEmpty()) return;
+    if (a.y() > b.y()) std::swap(a, b);
+    if (b.y() > c.y()) std::swap(b, c);
+    if (a.y() > b.y()) std::swap(a, b);
     
-    painter.setRenderHint(QPainter::Antialiasing, true);
+    // Clamp before rounding: zoomed in, vertices can be far off the image
+    const int first = qCeil(qBound(-1.0, a.y() - 0.5, double(height)));
+    const int last = qCeil(qBound(-1.0, c.y() - 0.5, double(height)));
+    const double longSlope = (c.x() - a.x()) / (c.y() - a.y());
+    for (int row = qMax(first, 0); row < last; ++row) {
+        const double y = row + 0.5;
+        const double longX = a.x() + (y - a.y()) * longSlope;
+        const double shortX = y < b.y() ? a.x() + (y - a.y()) * (b.x() - a.x()) / (b.y() - a.y())
+                                        : b.x() + (y - b.y()) * (c.x() - b.x()) / (c.y() - b.y());
+        const int x0 = qCeil(qBound(-1.0, qMin(longX, shortX) - 0.5, double(width)));
+        const int x1 = qCeil(qBound(-1.0, qMax(longX, shortX) - 0.5, double(width)));
+        if (x0 >= x1) continue;
+        QRgb* line = pixels + qint64(row) * stride;
+        std::fill(line + qMax(x0, 0), line + x1, color);
+    }
+}
+
+void CanvasWidget::buildTINColors()
+{
+    TINRender& render = m_tinRender;
+    
+    // Palette entry 0 marks triangles that are not drawn
+    render.palette.fill(0, 256);
+    if (m_tin.colorByElevation) {
+        // Blue=low, green=mid, red=high
+        for (int i = 1; i < 256; ++i) {
+            const double t = (i - 1) / 254.0;
+            int r = static_cast<int>(t < 0.5 ? 0 : (t - 0.5) * 2 * 255);
+            int g = static_cast<int>(t < 0.5 ? t * 2 * 255 : (1.0 - t) * 2 * 255);
+            int b = static_cast<int>(t < 0.5 ? (1.0 - t * 2) * 255 : 0);
+            render.palette[i] = qPremultiply(qRgba(r, g, b, 100));
+        }
+    } else {
+        render.palette[1] = qPremultiply(qRgba(200, 50, 50, 100));     // Red = cut
+        render.palette[2] = qPremultiply(qRgba(50, 200, 50, 100));     // Green = fill
+        render.palette[3] = qPremultiply(qRgba(200, 200, 50, 100));    // Yellow = on grade
+    }
     
     double zRange = m_tin.maxZ - m_tin.minZ;
     if (zRange < 0.001) zRange = 1.0;
     
-    for (const auto& tri : m_tin.triangles) {
+    const int count = m_tin.points.size();
+    render.shades.fill(0, m_tin.triangles.size());
+    QVector<quint64> edgeKeys;
+    edgeKeys.reserve(3 * m_tin.triangles.size());
+    for (int t = 0; t < m_tin.triangles.size(); ++t) {
+        const auto& tri = m_tin.triangles[t];
         if (tri.size() != 3) continue;
-        
-        int i0 = tri[0], i1 = tri[1], i2 = tri[2];
-        if (i0 >= m_tin.points.size() || i1 >= m_tin.points.size() || i2 >= m_tin.points.size()) {
+        if (tri[0] < 0 || tri[1] < 0 || tri[2] < 0 || tri[0] >= count || tri[1] >= count || tri[2] >= count) {
             continue;
         }
         
-        const auto& p0 = m_tin.points[i0];
-        const auto& p1 = m_tin.points[i1];
-        const auto& p2 = m_tin.points[i2];
-        
-        // Convert to screen coordinates
-        QPoint s0 = worldToScreen(QPointF(p0.x, p0.y));
-        QPoint s1 = worldToScreen(QPointF(p1.x, p1.y));
-        QPoint s2 = worldToScreen(QPointF(p2.x, p2.y));
-        
-        // Calculate average Z for coloring
-        double avgZ = (p0.z + p1.z + p2.z) / 3.0;
-        
-        QColor fillColor;
+        // Colour by the average Z of the triangle
+        const double avgZ = (m_tin.points[tri[0]].z + m_tin.points[tri[1]].z + m_tin.points[tri[2]].z) / 3.0;
         if (m_tin.colorByElevation) {
-            // Color by elevation (blue=low, green=mid, red=high)
-            double t = (avgZ - m_tin.minZ) / zRange;
-            int r = static_cast<int>(t < 0.5 ? 0 : (t - 0.5) * 2 * 255);
-            int g = static_cast<int>(t < 0.5 ? t * 2 * 255 : (1.0 - t) * 2 * 255);
-            int b = static_cast<int>(t < 0.5 ? (1.0 - t * 2) * 255 : 0);
-            fillColor = QColor(r, g, b, 100);
+            const double level = qBound(0.0, (avgZ - m_tin.minZ) / zRange, 1.0);
+            render.shades[t] = static_cast<uchar>(1 + qRound(level * 254));
         } else {
-            // Color by cut/fill relative to design level
-            if (avgZ > m_tin.designLevel) {
-                fillColor = QColor(200, 50, 50, 100);  // Red = cut
-            } else if (avgZ < m_tin.designLevel) {
-                fillColor = QColor(50, 200, 50, 100);  // Green = fill
-            } else {
-                fillColor = QColor(200, 200, 50, 100); // Yellow = on grade
-            }
+            render.shades[t] = avgZ > m_tin.designLevel ? 1 : (avgZ < m_tin.designLevel ? 2 : 3);
         }
         
-        QPolygon triangle;
-        triangle << s0 << s1 << s2;
-        
-        painter.setBrush(fillColor);
-        painter.setPen(QPen(QColor(100, 100, 100, 150), 1));
-        painter.drawPolygon(triangle);
+        // Inner edges are shared by two triangles but drawn once
+        for (int i = 0; i < 3; ++i) {
+            const quint32 a = tri[i], b = tri[(i + 1) % 3];
+            edgeKeys.append(a < b ? (quint64(a) << 32 | b) : (quint64(b) << 32 | a));
+        }
+    }
+    std::sort(edgeKeys.begin(), edgeKeys.end());
+    edgeKeys.erase(std::unique(edgeKeys.begin(), edgeKeys.end()), edgeKeys.end());
+    render.edges.resize(2 * edgeKeys.size());
+    for (int i = 0; i < edgeKeys.size(); ++i) {
+        render.edges[2 * i] = static_cast<int>(edgeKeys[i] >> 32);
+        render.edges[2 * i + 1] = static_cast<int>(edgeKeys[i] & 0xffffffffu);
     }
 }
 
+void CanvasWidget::rasterizeTIN(const QRect& area)
+{
+    TINRender& render = m_tinRender;
+    render.view = m_worldToScreen;
+    render.origin = area.topLeft();
+    if (render.image.size() != area.size()) {
+        render.image = QImage(area.size(), QImage::Format_ARGB32_Premultiplied);
+    }
+    render.image.fill(Qt::transparent);
+    
+    // Screen-space mesh for this view
+    const int count = m_tin.points.size();
+    render.mesh.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const auto& p = m_tin.points[i];
+        render.mesh[i] = m_worldToScreen.map(QPointF(p.x, p.y)) - render.origin;
+    }
+    
+    // Triangles straight into the pixels, one palette colour each
+    const int width = render.image.width();
+    const int height = render.image.height();
+    const int stride = render.image.bytesPerLine() / int(sizeof(QRgb));
+    QRgb* pixels = reinterpret_cast<QRgb*>(render.image.bits());
+    for (int t = 0; t < m_tin.triangles.size(); ++t) {
+        const uchar shade = render.shades[t];
+        if (shade == 0) continue;
+        const auto& tri = m_tin.triangles[t];
+        fillTriangle(pixels, stride, width, height,
+                     render.mesh[tri[0]], render.mesh[tri[1]], render.mesh[tri[2]], render.palette[shade]);
+    }
+    
+    if (!m_tin.wireframe) return;
+    
+    // Edges touching the image, in one batch
+    QVector<QLineF> lines;
+    lines.reserve(render.edges.size() / 2);
+    for (int i = 0; i + 1 < render.edges.size(); i += 2) {
+        const QPointF& a = render.mesh[render.edges[i]];
+        const QPointF& b = render.mesh[render.edges[i + 1]];
+        if ((a.x() < 0 && b.x() < 0) || (a.y() < 0 && b.y() < 0)
+            || (a.x() > width && b.x() > width) || (a.y() > height && b.y() > height)) {
+            continue;
+        }
+        lines.append(QLineF(a, b));
+    }
+    QPainter painter(&render.image);
+    painter.setPen(QPen(QColor(100, 100, 100, 150), 1));
+    painter.drawLines(lines);
+}
+
+void CanvasWidget::drawTIN(QPainter& painter)
+{
+    if (!m_tin.visible || m_tin.triangles.isEmpty()) return;
+    
+    if (m_tinRender.palette.isEmpty()) {
+        buildTINColors();
+    }
+    
+    // A pan only moves the cached image until the view leaves its margin;
+    // a zoom or a resize past the margin draws it again
+    const QTransform& view = m_tinRender.view;
+    QPointF origin = m_tinRender.origin
+        + QPointF(m_worldToScreen.dx() - view.dx(), m_worldToScreen.dy() - view.dy());
+    const bool panned = !m_tinRender.image.isNull()
+        && view.m11() == m_worldToScreen.m11() && view.m12() == m_worldToScreen.m12()
+        && view.m21() == m_worldToScreen.m21() && view.m22() == m_worldToScreen.m22()
+        && QRectF(origin, QSizeF(m_tinRender.image.size())).contains(QRectF(rect()));
+    if (!panned) {
+        const int marginX = width() / 4;
+        const int marginY = height() / 4;
+        rasterizeTIN(rect().adjusted(-marginX, -marginY, marginX, marginY));
+        origin = m_tinRender.origin;
+    }
+    painter.drawImage(QPoint(qRound(origin.x()), qRound(origin.y())), m_tinRender.image);
+}
+
 // ===== Contour Line Methods =====
 
 void CanvasWidget::setContours(const QVector<ContourLine>& contours)
 {
+    m_contourEngine.reset();
     m_contours = contours;
-    emit statusMessage(QString("Set %1 contour levels").arg(contours.size()));
+    emit statusMessage(QString("Set %1 contour lines").arg(contours.size()));
+    update();
+}
+
+void CanvasWidget::setSurfaceContours(const ContourEngine& engine, quint64 revision, double majorInterval,
+                                      const QVector<int>& breaklines, int boundary)
+{
+    m_contourEngine = std::make_shared<ContourEngine>(engine);
+    m_contourMajorInterval = majorInterval;
+    polylineGeometry(breaklines, boundary, m_contourBreaklines, m_contourBoundary);
+    m_contourRevision = revision;
+    updateSurfaceContours(false);
+    emit statusMessage(QString("Set %1 contour lines").arg(m_contours.size()));
+}
+
+void CanvasWidget::updateSurfaceContours(bool local)
+{
+    std::shared_ptr<const SurfaceModel> model = surfaceModel(QVector<int>(), m_contourBreaklines, m_contourBoundary);
+    if (!model) {
+        m_contourEngine.reset();
+        m_contours.clear();
+        emit statusMessage(QString("Contours removed: %1").arg(m_surfaceModelError));
+        update();
+        return;
+    }
+    
+    // A local edit re-cuts the triangles it touched and splices the lines
+    // through them; otherwise contour the rebuilt surface at the same levels
+    if (m_contourRevision != m_pegRevision) {
+        if (local) {
+            m_contourEngine->update(model->points(), model->triangles(), model->changedTriangles());
+        } else {
+            m_contourEngine->build(model->points(), model->triangles(), m_contourEngine->levelValues());
+        }
+        m_contourRevision = m_pegRevision;
+    }
+    
+    const QVector<ContourEngine::Contour> contours = m_contourEngine->contours();
+    m_contours.clear();
+    m_contours.reserve(contours.size());
+    for (const auto& c : contours) {
+        ContourLine contour;
+        contour.elevation = c.elevation;
+        contour.isMajor = (qAbs(fmod(c.elevation, m_contourMajorInterval)) < 0.001);
+        contour.points = c.points;
+        contour.closed = c.closed;
+        m_contours.append(contour);
+    }
     update();
 }
 
 void CanvasWidget::clearContours()
 {
+    m_contourEngine.reset();
     m_contours.clear();
     emit statusMessage("Contours cleared");
     update();
 }
 
+void CanvasWidget::setVolumeHeatmap(const QImage& image, const QRectF& bounds)
+{
+    m_volumeHeatmap = CanvasRaster();
+    m_volumeHeatmap.image = image;
+    m_volumeHeatmap.bounds = bounds;
+    update();
+}
+
+void CanvasWidget::clearVolumeHeatmap()
+{
+    m_volumeHeatmap = CanvasRaster();
+    update();
+}
+
 void CanvasWidget::drawContours(QPainter& painter)
 {
     if (m_contours.isEmpty()) return;
@@ -2959,12 +3648,16 @@ void CanvasWidget::drawContours(QPainter& painter)
             painter.setPen(QPen(QColor(139, 69, 19, 180), 1.0));  // Brown, thinner
         }
         
-        // Draw line segments
-        for (int i = 0; i + 1 < contour.points.size(); i += 2) {
-            QPoint s0 = worldToScreen(contour.points[i]);
-            QPoint s1 = worldToScreen(contour.points[i + 1]);
-            painter.drawLine(s0, s1);
+        // Draw the polyline
+        QPolygon screenLine;
+        screenLine.reserve(contour.points.size() + 1);
+        for (const QPointF& point : contour.points) {
+            screenLine.append(worldToScreen(point));
+        }
+        if (contour.closed && !screenLine.isEmpty()) {
+            screenLine.append(screenLine.first());
         }
+        painter.drawPolyline(screenLine);
         
         // Draw elevation labels on major contours (every other major to reduce clutter)
         if (contour.isMajor && !contour.points.isEmpty() && contour.points.size() >= 4) {
@@ -3087,6 +3780,7 @@ int CanvasWidget::projectPartitionToOffset(const QString& pegPrefix)
     }
     
     if (pegsCreated > 0) {
+        pegsChanged(PegEdit::Reset);
         emit statusMessage(QString("Created %1 partition projection peg(s)").arg(pegsCreated));
         update();
     } else {
@@ -3657,6 +4351,7 @@ bool CanvasWidget::loadProjectFromJson(const QByteArray& jsonData)
         peg.color = QColor(pegObj["color"].toString());
         m_pegs.append(peg);
     }
+    pegsChanged(PegEdit::Reset);
 
     
     // Load station setup
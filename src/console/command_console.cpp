@@ -419,8 +419,11 @@ void CommandConsole::executeCommand(const QString& cmd, const QStringList& args)
                 if (option == "CLEAR") {
                     m_canvas->clearTIN();
                     appendMessage("TIN cleared.", "success");
+                } else if (option == "WIREFRAME") {
+                    m_canvas->setTINWireframe(!m_canvas->tinWireframe());
+                    appendMessage(QString("TIN wireframe %1.").arg(m_canvas->tinWireframe() ? "on" : "off"), "success");
                 } else {
-                    appendMessage("Usage: TIN [CLEAR]", "info");
+                    appendMessage("Usage: TIN [CLEAR|WIREFRAME]", "info");
                 }
             }
         }
@@ -891,6 +894,7 @@ void CommandConsole::cmdHelp(const QStringList& args)
     appendMessage("DTM & TERRAIN:", "system");
     appendMessage("  PEGS               - List all pegs with coords", "result");
     appendMessage("  TIN [CLEAR]        - Show TIN status / clear", "result");
+    appendMessage("  TIN WIREFRAME      - Toggle TIN triangle edges", "result");
     appendMessage("  CONTOUR            - Contour generation info", "result");
     appendMessage("  VOLUME             - Volume calculation info", "result");
     appendMessage("", "info");
@@ -0,0 +1,525 @@
+#include "dxf/dwgloader.h"
+#include "dxf/dxfreader.h"
+
+#include <libdwgr.h>
+#include <drw_interface.h>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QtMath>
+
+// Progress is reported every this many entities
+static const int s_progressInterval = 2000;
+
+static QString drwString(const std::string& s)
+{
+    return QString::fromStdString(s);
+}
+
+static QPointF drwPoint(const DRW_Coord& c)
+{
+    return QPointF(c.x, c.y);
+}
+
+static QString drwErrorString(DRW::error error)
+{
+    switch (error) {
+        case DRW::BAD_NONE: return "No error";
+        case DRW::BAD_OPEN: return "Cannot open file";
+        case DRW::BAD_VERSION: return "Unsupported DWG version";
+        case DRW::BAD_READ_METADATA: return "Error reading metadata";
+        case DRW::BAD_READ_FILE_HEADER: return "Error reading file header";
+        case DRW::BAD_READ_HEADER: return "Error reading header variables";
+        case DRW::BAD_READ_HANDLES: return "Error reading object map";
+        case DRW::BAD_READ_CLASSES: return "Error reading classes";
+        case DRW::BAD_READ_TABLES: return "Error reading tables";
+        case DRW::BAD_READ_BLOCKS: return "Error reading blocks";
+        case DRW::BAD_READ_ENTITIES: return "Error reading entities";
+        case DRW::BAD_READ_OBJECTS: return "Error reading objects";
+        case DRW::BAD_READ_SECTION: return "Error reading sections";
+        case DRW::BAD_CODE_PARSED: return "Error parsing entity data";
+        default: return "Unknown error";
+    }
+}
+
+static QString drwVersionString(DRW::Version version)
+{
+    for (const auto& entry : DRW::dwgVersionStrings) {
+        if (entry.second == version) return QString::fromLatin1(entry.first);
+    }
+    return "Unknown";
+}
+
+// Append a polyline segment, tessellating it as an arc when the bulge is non-zero
+static void appendBulgeSegment(QVector<QPointF>& points, const QPointF& from, const QPointF& to, double bulge)
+{
+    if (qAbs(bulge) < 1e-9) {
+        points.append(to);
+        return;
+    }
+
+    // bulge = tan(theta / 4), theta being the included angle (positive = CCW)
+    double theta = 4.0 * qAtan(bulge);
+    double dx = to.x() - from.x();
+    double dy = to.y() - from.y();
+    double chord = qSqrt(dx * dx + dy * dy);
+    if (chord < 1e-12) {
+        points.append(to);
+        return;
+    }
+
+    double radius = chord / (2.0 * qSin(qAbs(theta) / 2.0));
+    double sagitta = bulge * chord / 2.0;
+    double apothem = radius - qAbs(sagitta);
+
+    // Centre lies on the chord's perpendicular bisector, to the left for CCW arcs
+    QPointF mid((from.x() + to.x()) / 2.0, (from.y() + to.y()) / 2.0);
+    double nx = -dy / chord;
+    double ny = dx / chord;
+    double side = (bulge > 0) ? 1.0 : -1.0;
+    QPointF center(mid.x() + side * nx * apothem, mid.y() + side * ny * apothem);
+
+    double startAngle = qAtan2(from.y() - center.y(), from.x() - center.x());
+    int segments = qBound(2, static_cast<int>(qAbs(theta) / (M_PI / 32.0)), 64);
+    for (int i = 1; i < segments; ++i) {
+        double a = startAngle + theta * i / segments;
+        points.append(QPointF(center.x() + radius * qCos(a), center.y() + radius * qSin(a)));
+    }
+    points.append(to);
+}
+
+// ============================================================================
+// DwgInterface - receives libdxfrw callbacks and fills DxfData
+// ============================================================================
+class DwgInterface : public DRW_Interface {
+public:
+    DwgInterface(DwgLoader* loader, DxfData& data)
+        : m_loader(loader), m_data(data) {}
+
+    // Tables
+    void addHeader(const DRW_Header*) override {}
+    void addLType(const DRW_LType&) override {}
+    void addDimStyle(const DRW_Dimstyle&) override {}
+    void addVport(const DRW_Vport&) override {}
+    void addTextStyle(const DRW_Textstyle&) override {}
+    void addAppId(const DRW_AppId&) override {}
+
+    void addLayer(const DRW_Layer& data) override
+    {
+        DxfLayer layer;
+        layer.name = drwString(data.name);
+        layer.color = (data.color24 >= 0) ? QColor::fromRgb(data.color24 & 0xFFFFFF)
+                                          : aciToColor(qAbs(data.color));
+        layer.visible = data.color >= 0 && !(data.flags & 0x01);  // Negative color = off, bit 1 = frozen
+        layer.locked = (data.flags & 0x04) != 0;
+        m_layerColors.insert(layer.name, layer.color);
+        m_data.layers.append(layer);
+    }
+
+    // Blocks
+    void addBlock(const DRW_Block& data) override
+    {
+        QString name = drwString(data.name);
+
+        // Model/paper space records carry no entities of their own in DWG
+        if (name.startsWith("*Model_Space", Qt::CaseInsensitive) ||
+            name.startsWith("*Paper_Space", Qt::CaseInsensitive)) {
+            m_currentBlock = nullptr;
+            return;
+        }
+
+        DxfBlockDef& block = m_data.blocks[name];
+        block.name = name;
+        block.basePoint = drwPoint(data.basePoint);
+        m_currentBlock = &block;
+    }
+
+    void setBlock(const int) override {}
+    void endBlock() override { m_currentBlock = nullptr; }
+
+    // Entities
+    void addPoint(const DRW_Point&) override { skip(); }
+    void addRay(const DRW_Ray&) override { skip(); }
+    void addXline(const DRW_Xline&) override { skip(); }
+    void addKnot(const DRW_Entity&) override {}
+    void addTrace(const DRW_Trace&) override { skip(); }
+    void add3dFace(const DRW_3Dface&) override { skip(); }
+    void addSolid(const DRW_Solid&) override { skip(); }
+    void addDimAlign(const DRW_DimAligned*) override { skip(); }
+    void addDimLinear(const DRW_DimLinear*) override { skip(); }
+    void addDimRadial(const DRW_DimRadial*) override { skip(); }
+    void addDimDiametric(const DRW_DimDiametric*) override { skip(); }
+    void addDimAngular(const DRW_DimAngular*) override { skip(); }
+    void addDimAngular3P(const DRW_DimAngular3p*) override { skip(); }
+    void addDimOrdinate(const DRW_DimOrdinate*) override { skip(); }
+    void addLeader(const DRW_Leader*) override { skip(); }
+    void addViewport(const DRW_Viewport&) override {}
+    void addImage(const DRW_Image*) override { skip(); }
+    void linkImage(const DRW_ImageDef*) override {}
+    void addComment(const char*) override {}
+    void addPlotSettings(const DRW_PlotSettings*) override {}
+
+    void addLine(const DRW_Line& data) override
+    {
+        if (!accept(data)) return;
+        DxfLine line{drwPoint(data.basePoint), drwPoint(data.secPoint), layerOf(data), colorOf(data)};
+        if (m_currentBlock) m_currentBlock->lines.append(line);
+        else m_data.lines.append(line);
+        counted();
+    }
+
+    void addCircle(const DRW_Circle& data) override
+    {
+        if (!accept(data)) return;
+        DxfCircle circle{drwPoint(data.basePoint), data.radious, layerOf(data), colorOf(data)};
+        if (m_currentBlock) m_currentBlock->circles.append(circle);
+        else m_data.circles.append(circle);
+        counted();
+    }
+
+    void addArc(const DRW_Arc& data) override
+    {
+        if (!accept(data)) return;
+        DxfArc arc{drwPoint(data.basePoint), data.radious,
+                   qRadiansToDegrees(data.staangle), qRadiansToDegrees(data.endangle),
+                   layerOf(data), colorOf(data)};
+        if (m_currentBlock) m_currentBlock->arcs.append(arc);
+        else m_data.arcs.append(arc);
+        counted();
+    }
+
+    void addEllipse(const DRW_Ellipse& data) override
+    {
+        if (!accept(data)) return;
+        DxfEllipse ellipse{drwPoint(data.basePoint), drwPoint(data.secPoint), data.ratio,
+                           data.staparam, data.endparam, layerOf(data), colorOf(data)};
+        if (m_currentBlock) m_currentBlock->ellipses.append(ellipse);
+        else m_data.ellipses.append(ellipse);
+        counted();
+    }
+
+    void addLWPolyline(const DRW_LWPolyline& data) override
+    {
+        if (!accept(data)) return;
+
+        DxfPolyline poly;
+        poly.closed = (data.flags & 0x01) != 0;
+        poly.layer = layerOf(data);
+        poly.color = colorOf(data);
+
+        const auto& verts = data.vertlist;
+        int count = static_cast<int>(verts.size());
+        if (count < 2) {
+            skip();
+            return;
+        }
+
+        poly.points.reserve(count);
+        poly.points.append(QPointF(verts[0]->x, verts[0]->y));
+        for (int i = 1; i < count; ++i) {
+            appendBulgeSegment(poly.points, poly.points.last(),
+                               QPointF(verts[i]->x, verts[i]->y), verts[i - 1]->bulge);
+        }
+        if (poly.closed && qAbs(verts[count - 1]->bulge) > 1e-9) {
+            // Closing segment is an arc; keep the ring implicitly closed
+            appendBulgeSegment(poly.points, poly.points.last(), poly.points.first(), verts[count - 1]->bulge);
+            poly.points.removeLast();
+        }
+
+        addPolylineEntity(poly);
+    }
+
+    void addPolyline(const DRW_Polyline& data) override
+    {
+        if (!accept(data)) return;
+
+        // Polygon and polyface meshes are 3D surfaces, not line work
+        if (data.flags & (0x10 | 0x40)) {
+            skip();
+            return;
+        }
+
+        DxfPolyline poly;
+        poly.closed = (data.flags & 0x01) != 0;
+        poly.layer = layerOf(data);
+        poly.color = colorOf(data);
+
+        const auto& verts = data.vertlist;
+        int count = static_cast<int>(verts.size());
+        if (count < 2) {
+            skip();
+            return;
+        }
+
+        poly.points.reserve(count);
+        poly.points.append(drwPoint(verts[0]->basePoint));
+        for (int i = 1; i < count; ++i) {
+            appendBulgeSegment(poly.points, poly.points.last(),
+                               drwPoint(verts[i]->basePoint), verts[i - 1]->bulge);
+        }
+        if (poly.closed && qAbs(verts[count - 1]->bulge) > 1e-9) {
+            appendBulgeSegment(poly.points, poly.points.last(), poly.points.first(), verts[count - 1]->bulge);
+            poly.points.removeLast();
+        }
+
+        addPolylineEntity(poly);
+    }
+
+    void addSpline(const DRW_Spline* data) override
+    {
+        if (!data || !accept(*data)) return;
+
+        DxfSpline spline;
+        spline.degree = data->degree;
+        spline.closed = (data->flags & 0x01) != 0;
+        spline.layer = layerOf(*data);
+        spline.color = colorOf(*data);
+        spline.controlPoints.reserve(static_cast<int>(data->controllist.size()));
+        for (const auto& pt : data->controllist) {
+            spline.controlPoints.append(drwPoint(*pt));
+        }
+        spline.fitPoints.reserve(static_cast<int>(data->fitlist.size()));
+        for (const auto& pt : data->fitlist) {
+            spline.fitPoints.append(drwPoint(*pt));
+        }
+
+        if (m_currentBlock) m_currentBlock->splines.append(spline);
+        else m_data.splines.append(spline);
+        counted();
+    }
+
+    void addInsert(const DRW_Insert& data) override
+    {
+        if (!accept(data)) return;
+
+        DxfInsert insert;
+        insert.blockName = drwString(data.name);
+        insert.scaleX = data.xscale;
+        insert.scaleY = data.yscale;
+        insert.rotation = qRadiansToDegrees(data.angle);
+        insert.layer = layerOf(data);
+
+        // MINSERT arrays are expanded into one insert per cell, laid out in the rotated frame
+        int cols = qMax(1, data.colcount);
+        int rows = qMax(1, data.rowcount);
+        double cosA = qCos(data.angle);
+        double sinA = qSin(data.angle);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                double ox = c * data.colspace;
+                double oy = r * data.rowspace;
+                insert.insertPoint = QPointF(data.basePoint.x + ox * cosA - oy * sinA,
+                                             data.basePoint.y + ox * sinA + oy * cosA);
+                if (m_currentBlock) m_currentBlock->inserts.append(insert);
+                else m_data.inserts.append(insert);
+            }
+        }
+        counted();
+    }
+
+    void addText(const DRW_Text& data) override
+    {
+        if (!accept(data)) return;
+
+        // Aligned text is positioned by its second alignment point
+        bool aligned = data.alignH != DRW_Text::HLeft || data.alignV != DRW_Text::VBaseLine;
+        DxfText text{drwString(data.text), drwPoint(aligned ? data.secPoint : data.basePoint),
+                     data.height, data.angle, layerOf(data), colorOf(data)};
+        addTextEntity(text);
+    }
+
+    void addMText(const DRW_MText& data) override
+    {
+        if (!accept(data)) return;
+
+        // Flatten paragraph breaks; inline formatting codes are kept verbatim
+        QString value = drwString(data.text);
+        value.replace("\\P", " ");
+        DxfText text{value, drwPoint(data.basePoint), data.height, data.angle,
+                     layerOf(data), colorOf(data)};
+        addTextEntity(text);
+    }
+
+    void addHatch(const DRW_Hatch* data) override
+    {
+        if (!data || !accept(*data)) return;
+
+        DxfHatch hatch;
+        hatch.pattern = drwString(data->name);
+        hatch.solid = data->solid == 1;
+        hatch.layer = layerOf(*data);
+        hatch.color = colorOf(*data);
+
+        // Only polyline and line-edge boundaries are converted
+        for (const auto& loop : data->looplist) {
+            DxfHatchLoop hatchLoop;
+            hatchLoop.closed = true;
+            for (const auto& edge : loop->objlist) {
+                if (edge->eType == DRW::LWPOLYLINE) {
+                    auto pl = std::static_pointer_cast<DRW_LWPolyline>(edge);
+                    for (const auto& v : pl->vertlist) {
+                        hatchLoop.points.append(QPointF(v->x, v->y));
+                    }
+                } else if (edge->eType == DRW::LINE) {
+                    auto ln = std::static_pointer_cast<DRW_Line>(edge);
+                    if (hatchLoop.points.isEmpty()) hatchLoop.points.append(drwPoint(ln->basePoint));
+                    hatchLoop.points.append(drwPoint(ln->secPoint));
+                }
+            }
+            if (hatchLoop.points.size() >= 3) hatch.loops.append(hatchLoop);
+        }
+
+        // Hatches are not part of block definitions in DxfData
+        if (hatch.loops.isEmpty() || m_currentBlock) {
+            skip();
+            return;
+        }
+        m_data.hatches.append(hatch);
+        counted();
+    }
+
+    // Writing is not used
+    void writeHeader(DRW_Header&) override {}
+    void writeBlocks() override {}
+    void writeBlockRecords() override {}
+    void writeEntities() override {}
+    void writeLTypes() override {}
+    void writeLayers() override {}
+    void writeTextstyles() override {}
+    void writeVports() override {}
+    void writeDimstyles() override {}
+    void writeObjects() override {}
+    void writeAppId() override {}
+
+private:
+    // Paper space layouts are not shown on the canvas
+    bool accept(const DRW_Entity& entity)
+    {
+        if (!m_currentBlock && entity.space == DRW::PaperSpace) {
+            skip();
+            return false;
+        }
+        return true;
+    }
+
+    QString layerOf(const DRW_Entity& entity) const
+    {
+        return drwString(entity.layer);
+    }
+
+    QColor colorOf(const DRW_Entity& entity) const
+    {
+        if (entity.color24 >= 0) {
+            return QColor::fromRgb(entity.color24 & 0xFFFFFF);
+        }
+        if (entity.color == DRW::ColorByLayer) {
+            return m_layerColors.value(drwString(entity.layer), QColor(255, 255, 255));
+        }
+        if (entity.color == DRW::ColorByBlock) {
+            return QColor(255, 255, 255);
+        }
+        return aciToColor(entity.color);
+    }
+
+    void addPolylineEntity(const DxfPolyline& poly)
+    {
+        if (m_currentBlock) m_currentBlock->polylines.append(poly);
+        else m_data.polylines.append(poly);
+        counted();
+    }
+
+    void addTextEntity(const DxfText& text)
+    {
+        if (text.text.isEmpty()) {
+            skip();
+            return;
+        }
+        if (m_currentBlock) m_currentBlock->texts.append(text);
+        else m_data.texts.append(text);
+        counted();
+    }
+
+    void counted()
+    {
+        ++m_loader->m_entitiesRead;
+        if (m_loader->m_progressCallback && m_loader->m_entitiesRead % s_progressInterval == 0) {
+            m_loader->m_progressCallback(m_loader->m_entitiesRead);
+        }
+    }
+
+    void skip()
+    {
+        ++m_loader->m_entitiesSkipped;
+    }
+
+    DwgLoader* m_loader;
+    DxfData& m_data;
+    DxfBlockDef* m_currentBlock{nullptr};
+    QHash<QString, QColor> m_layerColors;
+};
+
+// ============================================================================
+// DwgLoader
+// ============================================================================
+DwgLoader::DwgLoader()
+{
+}
+
+DwgLoader::~DwgLoader()
+{
+}
+
+double DwgLoader::entitiesPerSecond() const
+{
+    if (m_elapsedMs <= 0) return 0.0;
+    return m_entitiesRead * 1000.0 / m_elapsedMs;
+}
+
+bool DwgLoader::loadDwg(const QString& filepath, DxfData& targetData)
+{
+    targetData.clear();
+    m_lastError.clear();
+    m_version.clear();
+    m_entitiesRead = 0;
+    m_entitiesSkipped = 0;
+    m_elapsedMs = 0;
+    m_issueLog.clear();
+
+    if (!QFileInfo::exists(filepath)) {
+        m_lastError = QString("File not found: %1").arg(filepath);
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray path = QFile::encodeName(filepath);
+    dwgR reader(path.constData());
+    reader.setDebug(DRW::DebugLevel::None);
+    DwgInterface iface(this, targetData);
+
+    // ext=true applies entity extrusion so mirrored (0,0,-1) geometry lands in 2D
+    bool ok = reader.read(&iface, true);
+
+    m_elapsedMs = timer.elapsed();
+    m_version = drwVersionString(reader.getVersion());
+
+    if (!ok) {
+        QString reason = drwErrorString(reader.getError());
+        if (m_entitiesRead == 0) {
+            m_lastError = QString("Failed to read DWG (%1): %2").arg(m_version, reason);
+            targetData.clear();
+            return false;
+        }
+        // libdxfrw stops at the first bad object; keep what was read so far
+        m_issueLog.append(QString("[PARTIAL] %1 - drawing may be incomplete").arg(reason));
+    }
+
+    if (m_progressCallback) {
+        m_progressCallback(m_entitiesRead);
+    }
+
+    return true;
+}
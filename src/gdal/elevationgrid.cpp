@@ -0,0 +1,426 @@
+#include "gdal/elevationgrid.h"
+#include <gdal_priv.h>
+#include <cpl_conv.h>
+#include <ogr_spatialref.h>
+#include <QFileInfo>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Block cache for point sampling (a float block is 256 KB)
+static const int s_blockCacheMB = 64;
+
+// Ground distance of a degree (same factor as the hillshade and gdaldem -s)
+static const double s_metresPerDegree = 111120.0;
+
+ElevationGrid::ElevationGrid()
+{
+    m_blocks.setMaxCost(s_blockCacheMB * 1024);
+}
+
+ElevationGrid::~ElevationGrid()
+{
+    m_blocks.clear();
+    if (m_dataset) {
+        GDALClose(m_dataset);
+    }
+}
+
+bool ElevationGrid::open(const QString& fileName, int bandIndex)
+{
+    m_lastError.clear();
+    m_blocks.clear();
+    if (m_dataset) {
+        GDALClose(m_dataset);
+        m_dataset = nullptr;
+        m_band = nullptr;
+    }
+
+    m_dataset = static_cast<GDALDataset*>(
+        GDALOpenEx(fileName.toUtf8().constData(), GDAL_OF_READONLY | GDAL_OF_RASTER,
+                   nullptr, nullptr, nullptr));
+    if (!m_dataset) {
+        m_lastError = QString("Failed to open DEM: %1").arg(CPLGetLastErrorMsg());
+        return false;
+    }
+
+    if (bandIndex < 1 || bandIndex > m_dataset->GetRasterCount()) {
+        m_lastError = QString("DEM has no band %1").arg(bandIndex);
+        GDALClose(m_dataset);
+        m_dataset = nullptr;
+        return false;
+    }
+
+    m_band = m_dataset->GetRasterBand(bandIndex);
+    m_fileName = fileName;
+    m_columns = m_dataset->GetRasterXSize();
+    m_rows = m_dataset->GetRasterYSize();
+
+    if (m_dataset->GetGeoTransform(m_geoTransform) != CE_None) {
+        // No transform, use cell coordinates
+        m_geoTransform[0] = 0;
+        m_geoTransform[1] = 1;
+        m_geoTransform[2] = 0;
+        m_geoTransform[3] = m_rows;
+        m_geoTransform[4] = 0;
+        m_geoTransform[5] = -1;
+    }
+
+    const OGRSpatialReference* srs = m_dataset->GetSpatialRef();
+    m_geographic = srs && srs->IsGeographic();
+
+    double minX = m_geoTransform[0];
+    double maxY = m_geoTransform[3];
+    double maxX = m_geoTransform[0] + m_columns * m_geoTransform[1];
+    double minY = m_geoTransform[3] + m_rows * m_geoTransform[5];
+    m_bounds = QRectF(minX, minY, maxX - minX, maxY - minY);
+
+    int hasNoData = FALSE;
+    m_noData = m_band->GetNoDataValue(&hasNoData);
+    m_hasNoData = hasNoData;
+
+    double minMax[2] = {0.0, 0.0};
+    if (m_band->ComputeRasterMinMax(TRUE, minMax) == CE_None) {
+        m_minimum = minMax[0];
+        m_maximum = minMax[1];
+    }
+
+    return true;
+}
+
+QString ElevationGrid::name() const
+{
+    return QFileInfo(m_fileName).completeBaseName();
+}
+
+double ElevationGrid::cellWidth() const
+{
+    return qAbs(m_geoTransform[1]);
+}
+
+double ElevationGrid::cellHeight() const
+{
+    return qAbs(m_geoTransform[5]);
+}
+
+double ElevationGrid::cellWidthMetres() const
+{
+    if (!m_geographic) return cellWidth();
+    const double latitude = cellCenter(0, m_rows / 2).y();
+    return cellWidth() * s_metresPerDegree * qCos(qDegreesToRadians(latitude));
+}
+
+double ElevationGrid::cellHeightMetres() const
+{
+    return m_geographic ? cellHeight() * s_metresPerDegree : cellHeight();
+}
+
+double ElevationGrid::cellArea(int row) const
+{
+    return cellWidth() * cellHeight() * areaScale(cellCenter(0, row).y());
+}
+
+double ElevationGrid::areaScale(double y) const
+{
+    if (!m_geographic) return 1.0;
+    return s_metresPerDegree * s_metresPerDegree * qCos(qDegreesToRadians(y));
+}
+
+QPointF ElevationGrid::cellCenter(int column, int row) const
+{
+    return QPointF(m_geoTransform[0] + (column + 0.5) * m_geoTransform[1],
+                   m_geoTransform[3] + (row + 0.5) * m_geoTransform[5]);
+}
+
+QPointF ElevationGrid::worldToCell(const QPointF& world) const
+{
+    return QPointF((world.x() - m_geoTransform[0]) / m_geoTransform[1] - 0.5,
+                   (world.y() - m_geoTransform[3]) / m_geoTransform[5] - 0.5);
+}
+
+// Windowed read in the buffer's own precision, NoData replaced by NaN
+template <typename T>
+static bool readBandWindow(GDALRasterBand* band, GDALDataType type, bool hasNoData, double noDataValue,
+                           int column, int row, int columns, int rows, T* out,
+                           int outColumns, int outRows, QString& error)
+{
+    CPLErr err = band->RasterIO(GF_Read, column, row, columns, rows, out, outColumns, outRows,
+                                type, 0, 0, nullptr);
+    if (err != CE_None) {
+        error = QString("Failed to read DEM window: %1").arg(CPLGetLastErrorMsg());
+        return false;
+    }
+
+    if (hasNoData) {
+        const T noData = static_cast<T>(noDataValue);
+        const T nan = std::numeric_limits<T>::quiet_NaN();
+        qint64 count = static_cast<qint64>(outColumns) * outRows;
+        for (qint64 i = 0; i < count; ++i) {
+            if (out[i] == noData) out[i] = nan;
+        }
+    }
+    return true;
+}
+
+bool ElevationGrid::readWindow(int column, int row, int columns, int rows, float* out,
+                               int outColumns, int outRows)
+{
+    if (!m_band) return false;
+    if (outColumns <= 0) outColumns = columns;
+    if (outRows <= 0) outRows = rows;
+    return readBandWindow(m_band, GDT_Float32, m_hasNoData, m_noData, column, row, columns, rows, out,
+                          outColumns, outRows, m_lastError);
+}
+
+bool ElevationGrid::readWindow(int column, int row, int columns, int rows, double* out,
+                               int outColumns, int outRows)
+{
+    if (!m_band) return false;
+    if (outColumns <= 0) outColumns = columns;
+    if (outRows <= 0) outRows = rows;
+    return readBandWindow(m_band, GDT_Float64, m_hasNoData, m_noData, column, row, columns, rows, out,
+                          outColumns, outRows, m_lastError);
+}
+
+const QVector<float>* ElevationGrid::block(int bx, int by)
+{
+    quint64 key = (static_cast<quint64>(by) << 32) | static_cast<quint64>(bx);
+    if (QVector<float>* cached = m_blocks.object(key)) {
+        return cached;
+    }
+
+    int column = bx * BlockSize;
+    int row = by * BlockSize;
+    int width = qMin(BlockSize, m_columns - column);
+    int height = qMin(BlockSize, m_rows - row);
+
+    auto* values = new QVector<float>(width * height);
+    if (!readWindow(column, row, width, height, values->data())) {
+        values->fill(std::numeric_limits<float>::quiet_NaN());
+    }
+    int costKB = qMax(1, static_cast<int>(values->size() * sizeof(float) / 1024));
+    m_blocks.insert(key, values, costKB);
+    return m_blocks.object(key);
+}
+
+float ElevationGrid::cellValue(int column, int row)
+{
+    const QVector<float>* values = block(column / BlockSize, row / BlockSize);
+    if (!values) return std::numeric_limits<float>::quiet_NaN();
+
+    int width = qMin(BlockSize, m_columns - (column / BlockSize) * BlockSize);
+    return (*values)[(row % BlockSize) * width + (column % BlockSize)];
+}
+
+double ElevationGrid::elevationAt(const QPointF& world)
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    if (!m_band) return nan;
+
+    QPointF cell = worldToCell(world);
+    double c = cell.x();
+    double r = cell.y();
+    if (c < -0.5 || r < -0.5 || c > m_columns - 0.5 || r > m_rows - 0.5) return nan;
+
+    // Half a cell at the grid edge uses the edge values
+    c = qBound(0.0, c, m_columns - 1.0);
+    r = qBound(0.0, r, m_rows - 1.0);
+    int c0 = static_cast<int>(c);
+    int r0 = static_cast<int>(r);
+    int c1 = qMin(c0 + 1, m_columns - 1);
+    int r1 = qMin(r0 + 1, m_rows - 1);
+    double tx = c - c0;
+    double ty = r - r0;
+
+    // Nearest cell decides whether there is data; NoData neighbours are left
+    // out of the weights
+    int nearestC = (tx < 0.5) ? c0 : c1;
+    int nearestR = (ty < 0.5) ? r0 : r1;
+    if (std::isnan(cellValue(nearestC, nearestR))) return nan;
+
+    const float z[4] = { cellValue(c0, r0), cellValue(c1, r0), cellValue(c0, r1), cellValue(c1, r1) };
+    const double w[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+
+    double sum = 0.0;
+    double weight = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        if (std::isnan(z[i])) continue;
+        sum += z[i] * w[i];
+        weight += w[i];
+    }
+    return (weight > 0.0) ? sum / weight : nan;
+}
+
+void ElevationGrid::columnSpans(double y, const QVector<QPointF>& boundary, QVector<QPair<int, int>>& spans) const
+{
+    spans.clear();
+
+    QVector<double> crossings;
+    int n = boundary.size();
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        const QPointF& p = boundary[i];
+        const QPointF& q = boundary[j];
+        if ((p.y() > y) != (q.y() > y)) {
+            crossings.append(p.x() + (y - p.y()) * (q.x() - p.x()) / (q.y() - p.y()));
+        }
+    }
+    std::sort(crossings.begin(), crossings.end());
+
+    // Cells whose centres fall between each pair of crossings
+    for (int i = 0; i + 1 < crossings.size(); i += 2) {
+        double a = (crossings[i] - m_geoTransform[0]) / m_geoTransform[1] - 0.5;
+        double b = (crossings[i + 1] - m_geoTransform[0]) / m_geoTransform[1] - 0.5;
+        int first = qMax(0, static_cast<int>(qCeil(qMin(a, b))));
+        int last = qMin(m_columns - 1, static_cast<int>(qFloor(qMax(a, b))));
+        if (first <= last) {
+            spans.append(qMakePair(first, last));
+        }
+    }
+}
+
+ElevationGrid::VolumeResult ElevationGrid::volumeAgainstLevel(double level, const QVector<QPointF>& boundary)
+{
+    VolumeResult result;
+    if (!m_band) return result;
+
+    // Rows to visit: all, or those under the boundary's extent
+    int firstRow = 0;
+    int lastRow = m_rows - 1;
+    if (boundary.size() >= 3) {
+        double minY = boundary[0].y(), maxY = boundary[0].y();
+        for (const auto& p : boundary) {
+            minY = qMin(minY, p.y());
+            maxY = qMax(maxY, p.y());
+        }
+        double ra = (maxY - m_geoTransform[3]) / m_geoTransform[5] - 0.5;
+        double rb = (minY - m_geoTransform[3]) / m_geoTransform[5] - 0.5;
+        firstRow = qMax(firstRow, static_cast<int>(qCeil(qMin(ra, rb))));
+        lastRow = qMin(lastRow, static_cast<int>(qFloor(qMax(ra, rb))));
+    }
+
+    QVector<float> values(m_columns);
+    QVector<QPair<int, int>> spans;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        if (boundary.size() >= 3) {
+            columnSpans(cellCenter(0, row).y(), boundary, spans);
+        } else {
+            spans.clear();
+            spans.append(qMakePair(0, m_columns - 1));
+        }
+
+        // Cells of a geographic grid shrink towards the poles, so each row
+        // is weighted by its own area
+        double cut = 0.0;
+        double fill = 0.0;
+        qint64 cells = 0;
+        for (const auto& span : spans) {
+            int count = span.second - span.first + 1;
+            if (!readWindow(span.first, row, count, 1, values.data())) return result;
+
+            for (int i = 0; i < count; ++i) {
+                float z = values[i];
+                if (std::isnan(z)) continue;
+                double dz = z - level;
+                if (dz > 0) cut += dz;
+                else fill -= dz;
+                ++cells;
+            }
+        }
+        const double area = cellArea(row);
+        result.cut += cut * area;
+        result.fill += fill * area;
+        result.area += cells * area;
+        result.cells += cells;
+    }
+
+    return result;
+}
+
+QVector<ElevationGrid::ContourLevel> ElevationGrid::contours(double first, double interval, double last, int step)
+{
+    QVector<ContourLevel> levels;
+    if (!m_band || interval <= 0 || last < first) return levels;
+    step = qMax(1, step);
+
+    int levelCount = static_cast<int>(qFloor((last - first) / interval)) + 1;
+    if (levelCount > 100000) return levels;
+    levels.resize(levelCount);
+    for (int k = 0; k < levelCount; ++k) {
+        levels[k].elevation = first + k * interval;
+    }
+
+    // Lattice of every step-th cell centre, visited one row pair at a time
+    int latticeColumns = (m_columns - 1) / step + 1;
+    QVector<float> rowBuffer(m_columns);
+    QVector<float> previous(latticeColumns);
+    QVector<float> current(latticeColumns);
+    QVector<double> xs(latticeColumns);
+    for (int i = 0; i < latticeColumns; ++i) {
+        xs[i] = cellCenter(i * step, 0).x();
+    }
+
+    double previousY = 0.0;
+    for (int row = 0; row < m_rows; row += step) {
+        if (!readWindow(0, row, m_columns, 1, rowBuffer.data())) break;
+        for (int i = 0; i < latticeColumns; ++i) {
+            current[i] = rowBuffer[i * step];
+        }
+        double y = cellCenter(0, row).y();
+
+        if (row > 0) {
+            for (int i = 0; i + 1 < latticeColumns; ++i) {
+                // Corners: a top-left, b top-right, c bottom-right, d bottom-left
+                float a = previous[i], b = previous[i + 1];
+                float c = current[i + 1], d = current[i];
+                if (std::isnan(a) || std::isnan(b) || std::isnan(c) || std::isnan(d)) continue;
+
+                float lo = qMin(qMin(a, b), qMin(c, d));
+                float hi = qMax(qMax(a, b), qMax(c, d));
+                int k0 = qMax(0, static_cast<int>(qCeil((lo - first) / interval)));
+                int k1 = qMin(levelCount - 1, static_cast<int>(qFloor((hi - first) / interval)));
+
+                double x0 = xs[i], x1 = xs[i + 1];
+                for (int k = k0; k <= k1; ++k) {
+                    double z = levels[k].elevation;
+                    bool ua = a > z, ub = b > z, uc = c > z, ud = d > z;
+                    if (ua == ub && ub == uc && uc == ud) continue;
+
+                    // Crossing points on each edge that changes side
+                    QPointF top, right, bottom, left;
+                    if (ua != ub) top = QPointF(x0 + (z - a) / (b - a) * (x1 - x0), previousY);
+                    if (ub != uc) right = QPointF(x1, previousY + (z - b) / (c - b) * (y - previousY));
+                    if (ud != uc) bottom = QPointF(x0 + (z - d) / (c - d) * (x1 - x0), y);
+                    if (ua != ud) left = QPointF(x0, previousY + (z - a) / (d - a) * (y - previousY));
+
+                    QVector<QPointF>& seg = levels[k].segments;
+                    if (ua == uc && ub == ud) {
+                        // Saddle: the centre decides which diagonal pair is joined
+                        bool centerUp = (a + b + c + d) * 0.25f > z;
+                        if (centerUp == ua) {
+                            seg << top << right << bottom << left;
+                        } else {
+                            seg << top << left << right << bottom;
+                        }
+                    } else {
+                        QPointF ends[2];
+                        int n = 0;
+                        if (ua != ub) ends[n++] = top;
+                        if (ub != uc) ends[n++] = right;
+                        if (ud != uc && n < 2) ends[n++] = bottom;
+                        if (ua != ud && n < 2) ends[n++] = left;
+                        if (n == 2) seg << ends[0] << ends[1];
+                    }
+                }
+            }
+        }
+
+        std::swap(previous, current);
+        previousY = y;
+    }
+
+    levels.erase(std::remove_if(levels.begin(), levels.end(),
+        [](const ContourLevel& level) { return level.segments.isEmpty(); }), levels.end());
+    return levels;
+}
@@ -69,9 +69,10 @@ bool GdalGeosLoader::loadDxf(const QString& filepath, DxfData& targetData)
     }
     
     // Configure GDAL DXF driver options
-    // DXF_INLINE_BLOCKS=TRUE - Explodes blocks into simple primitives
+    // DXF_INLINE_BLOCKS=FALSE - Keep block references as inserts; block geometry
+    //                           is exposed once through the "blocks" layer
     // DXF_MERGE_BLOCK_GEOMETRIES=FALSE - Keep geometries separate
-    CPLSetConfigOption("DXF_INLINE_BLOCKS", "TRUE");
+    CPLSetConfigOption("DXF_INLINE_BLOCKS", "FALSE");
     CPLSetConfigOption("DXF_MERGE_BLOCK_GEOMETRIES", "FALSE");
     
     // Suppress OGR warnings (Non closed ring, etc)
@@ -92,6 +93,9 @@ bool GdalGeosLoader::loadDxf(const QString& filepath, DxfData& targetData)
     QMap<QString, QColor> layerColors;
     int layerIndex = 0;
     
+    // Block definition geometry, collected per block name
+    QMap<QString, DxfData> blockContents;
+    
     // Iterate through all layers
     int layerCount = dataset->GetLayerCount();
     for (int i = 0; i < layerCount; ++i) {
@@ -106,6 +110,21 @@ bool GdalGeosLoader::loadDxf(const QString& filepath, DxfData& targetData)
             layerColors[layerName] = getLayerColor(layerIndex++);
         }
         
+        // Block definitions live in their own layer, tagged with the block name
+        if (layerName == "blocks") {
+            layer->ResetReading();
+            OGRFeature* feature;
+            while ((feature = layer->GetNextFeature()) != nullptr) {
+                int blockIndex = feature->GetFieldIndex("Block");
+                if (blockIndex >= 0 && feature->IsFieldSet(blockIndex)) {
+                    QString blockName = QString::fromUtf8(feature->GetFieldAsString(blockIndex));
+                    processFeature(feature, layerName, blockContents[blockName]);
+                }
+                OGRFeature::DestroyFeature(feature);
+            }
+            continue;
+        }
+        
         // Process all features in this layer
         layer->ResetReading();
         OGRFeature* feature;
@@ -115,6 +134,22 @@ bool GdalGeosLoader::loadDxf(const QString& filepath, DxfData& targetData)
         }
     }
     
+    // Convert collected block contents into block definitions.
+    // GDAL reports block geometry relative to the block origin, so the base point stays at (0,0).
+    for (auto it = blockContents.constBegin(); it != blockContents.constEnd(); ++it) {
+        DxfBlockDef block;
+        block.name = it.key();
+        block.lines = it.value().lines;
+        block.circles = it.value().circles;
+        block.arcs = it.value().arcs;
+        block.ellipses = it.value().ellipses;
+        block.splines = it.value().splines;
+        block.polylines = it.value().polylines;
+        block.texts = it.value().texts;
+        block.inserts = it.value().inserts;
+        targetData.blocks.insert(block.name, block);
+    }
+    
     // Cleanup
     GDALClose(dataset);
     
@@ -172,6 +207,37 @@ void GdalGeosLoader::processFeature(void* featurePtr, const QString& layerName,
         targetData.layers.append(newLayer);
     }
     
+    // Block references arrive as point features carrying the block name.
+    // Keep them as inserts so each block definition is only stored once.
+    int blockNameIndex = feature->GetFieldIndex("BlockName");
+    if (blockNameIndex >= 0 && feature->IsFieldSet(blockNameIndex) &&
+        wkbFlatten(ogrGeom->getGeometryType()) == wkbPoint) {
+        OGRPoint* pt = static_cast<OGRPoint*>(ogrGeom);
+        DxfInsert insert;
+        insert.blockName = QString::fromUtf8(feature->GetFieldAsString(blockNameIndex));
+        insert.insertPoint = QPointF(pt->getX(), pt->getY());
+        insert.layer = featureLayer;
+        
+        int angleField = feature->GetFieldIndex("BlockAngle");
+        if (angleField >= 0 && feature->IsFieldSet(angleField)) {
+            insert.rotation = feature->GetFieldAsDouble(angleField);
+        }
+        
+        int scaleField = feature->GetFieldIndex("BlockScale");
+        if (scaleField >= 0 && feature->IsFieldSet(scaleField)) {
+            int count = 0;
+            const double* scales = feature->GetFieldAsDoubleList(scaleField, &count);
+            if (scales && count >= 2) {
+                insert.scaleX = scales[0];
+                insert.scaleY = scales[1];
+            }
+        }
+        
+        targetData.inserts.append(insert);
+        m_geometriesProcessed++;
+        return;
+    }
+    
     // Get text properties if this is a text entity
     QString textValue;
     double textHeight = 2.5;  // Default
@@ -0,0 +1,421 @@
+#include "gdal/gdalrastersource.h"
+#include <gdal_priv.h>
+#include <cpl_conv.h>
+#include <ogr_spatialref.h>
+#include <QDebug>
+#include <QtMath>
+#include <cmath>
+#include <limits>
+
+// Default tile cache budget (decoded RGBA tiles are 256 KB each)
+static const int s_defaultCacheMB = 256;
+
+static int CPL_STDCALL overviewProgress(double complete, const char* /*message*/, void* data)
+{
+    auto* progress = static_cast<const std::function<bool(double)>*>(data);
+    if (progress && *progress) {
+        return (*progress)(complete) ? TRUE : FALSE;
+    }
+    return TRUE;
+}
+
+GdalRasterSource::GdalRasterSource()
+{
+    m_cache.setMaxCost(s_defaultCacheMB * 1024);
+}
+
+GdalRasterSource::~GdalRasterSource()
+{
+    m_cache.clear();
+    if (m_dataset) {
+        GDALClose(m_dataset);
+    }
+}
+
+bool GdalRasterSource::open(const QString& fileName, Rendering rendering)
+{
+    m_lastError.clear();
+    m_cache.clear();
+    if (m_dataset) {
+        GDALClose(m_dataset);
+        m_dataset = nullptr;
+    }
+
+    m_dataset = static_cast<GDALDataset*>(
+        GDALOpenEx(fileName.toUtf8().constData(), GDAL_OF_READONLY | GDAL_OF_RASTER,
+                   nullptr, nullptr, nullptr));
+    if (!m_dataset) {
+        m_lastError = QString("Failed to open raster: %1").arg(CPLGetLastErrorMsg());
+        return false;
+    }
+
+    int bandCount = m_dataset->GetRasterCount();
+    if (bandCount == 0) {
+        m_lastError = "File has no raster bands";
+        GDALClose(m_dataset);
+        m_dataset = nullptr;
+        return false;
+    }
+
+    m_fileName = fileName;
+    m_size = QSize(m_dataset->GetRasterXSize(), m_dataset->GetRasterYSize());
+
+    if (m_dataset->GetGeoTransform(m_geoTransform) != CE_None) {
+        // No transform, use pixel coordinates
+        m_geoTransform[0] = 0;
+        m_geoTransform[1] = 1;
+        m_geoTransform[2] = 0;
+        m_geoTransform[3] = m_size.height();
+        m_geoTransform[4] = 0;
+        m_geoTransform[5] = -1;
+    }
+
+    double minX = m_geoTransform[0];
+    double maxY = m_geoTransform[3];
+    double maxX = m_geoTransform[0] + m_size.width() * m_geoTransform[1];
+    double minY = m_geoTransform[3] + m_size.height() * m_geoTransform[5];
+    m_bounds = QRectF(minX, minY, maxX - minX, maxY - minY);
+
+    // Same band interpretation as GdalReader: RGB(A) or grayscale
+    m_rendering = rendering;
+    m_bandMap.clear();
+    if (m_rendering == Rendering::Hillshade) {
+        m_format = QImage::Format_RGBA8888;
+        m_bandMap << 1;
+    } else if (bandCount >= 3) {
+        m_format = QImage::Format_RGBA8888;
+        m_bandMap << 1 << 2 << 3;
+        if (bandCount >= 4) m_bandMap << 4;
+    } else {
+        m_format = QImage::Format_Grayscale8;
+        m_bandMap << 1;
+    }
+
+    if (m_rendering == Rendering::Hillshade) {
+        GDALRasterBand* band = m_dataset->GetRasterBand(1);
+        int hasNoData = FALSE;
+        m_noData = band->GetNoDataValue(&hasNoData);
+        m_hasNoData = hasNoData;
+
+        double minMax[2] = {0.0, 0.0};
+        band->ComputeRasterMinMax(TRUE, minMax);
+        m_minValue = minMax[0];
+        m_maxValue = minMax[1];
+
+        // Degrees horizontally, metres vertically (same factor as gdaldem -s)
+        const OGRSpatialReference* srs = m_dataset->GetSpatialRef();
+        m_metersPerUnit = (srs && srs->IsGeographic()) ? 111120.0 : 1.0;
+    } else {
+        // Non-Byte bands are stretched over their (approximate) value range
+        m_byteData = true;
+        m_stretch = RasterStretch::uniform(0.0, 255.0);
+        for (int i = 0; i < m_bandMap.size(); ++i) {
+            GDALRasterBand* band = m_dataset->GetRasterBand(m_bandMap[i]);
+            if (band->GetRasterDataType() == GDT_Byte) continue;
+            m_byteData = false;
+
+            double minMax[2] = {0.0, 255.0};
+            band->ComputeRasterMinMax(TRUE, minMax);
+            if (m_format == QImage::Format_Grayscale8) {
+                m_stretch = RasterStretch::uniform(minMax[0], minMax[1]);
+            } else {
+                RasterStretch::setRange(m_stretch, i, minMax[0], minMax[1]);
+            }
+        }
+    }
+
+    // Coarsest level is the one where a single tile covers the whole raster
+    m_maxLevel = 0;
+    int largest = qMax(m_size.width(), m_size.height());
+    while ((TileSize << m_maxLevel) < largest && m_maxLevel < 24) {
+        ++m_maxLevel;
+    }
+
+    return true;
+}
+
+int GdalRasterSource::overviewCount() const
+{
+    if (!m_dataset) return 0;
+    return m_dataset->GetRasterBand(1)->GetOverviewCount();
+}
+
+bool GdalRasterSource::buildOverviews(const std::function<bool(double)>& progress)
+{
+    if (!m_dataset) return false;
+
+    // Power-of-two levels down to roughly one tile
+    QVector<int> levels;
+    for (int factor = 2; (TileSize * factor) / 2 < qMax(m_size.width(), m_size.height()); factor *= 2) {
+        levels.append(factor);
+    }
+    if (levels.isEmpty()) return true;
+
+    // Read-only datasets get an external .ovr next to the file
+    CPLErr err = m_dataset->BuildOverviews("AVERAGE", levels.size(), levels.data(), 0, nullptr,
+                                           overviewProgress, const_cast<std::function<bool(double)>*>(&progress));
+    if (err != CE_None) {
+        m_lastError = QString("Failed to build overviews: %1").arg(CPLGetLastErrorMsg());
+        return false;
+    }
+
+    m_cache.clear();
+    return true;
+}
+
+quint64 GdalRasterSource::tileKey(int level, int tx, int ty)
+{
+    return (static_cast<quint64>(level) << 56) | (static_cast<quint64>(ty) << 28) | static_cast<quint64>(tx);
+}
+
+QRectF GdalRasterSource::tileBounds(int level, int tx, int ty) const
+{
+    int span = TileSize << level;
+    int x0 = tx * span;
+    int y0 = ty * span;
+    int xs = qMin(span, m_size.width() - x0);
+    int ys = qMin(span, m_size.height() - y0);
+
+    double left = m_geoTransform[0] + x0 * m_geoTransform[1];
+    double right = m_geoTransform[0] + (x0 + xs) * m_geoTransform[1];
+    double top = m_geoTransform[3] + y0 * m_geoTransform[5];
+    double bottom = m_geoTransform[3] + (y0 + ys) * m_geoTransform[5];
+    return QRectF(QPointF(qMin(left, right), qMin(top, bottom)),
+                  QPointF(qMax(left, right), qMax(top, bottom)));
+}
+
+QImage GdalRasterSource::readTile(int level, int tx, int ty)
+{
+    if (m_rendering == Rendering::Hillshade) {
+        return readHillshadeTile(level, tx, ty);
+    }
+
+    int span = TileSize << level;
+    int x0 = tx * span;
+    int y0 = ty * span;
+    int xs = qMin(span, m_size.width() - x0);
+    int ys = qMin(span, m_size.height() - y0);
+    if (xs <= 0 || ys <= 0) return QImage();
+
+    // Output size at this level; GDAL decimates from the closest overview
+    int step = 1 << level;
+    int bw = qMax(1, (xs + step - 1) / step);
+    int bh = qMax(1, (ys + step - 1) / step);
+
+    QImage image(bw, bh, m_format);
+    if (image.isNull()) return QImage();
+
+    int channels = (m_format == QImage::Format_RGBA8888) ? 4 : 1;
+    CPLErr err;
+    if (m_byteData) {
+        // Opaque unless an alpha band overwrites the fourth channel
+        if (m_bandMap.size() == 3) {
+            image.fill(Qt::white);
+        }
+        err = m_dataset->RasterIO(GF_Read, x0, y0, xs, ys, image.bits(), bw, bh, GDT_Byte,
+                                  m_bandMap.size(), m_bandMap.data(),
+                                  channels, image.bytesPerLine(), 1, nullptr);
+    } else {
+        int rowSamples = bw * channels;
+        QVector<float> samples(rowSamples * bh, 255.0f);  // Unread alpha lane stays opaque
+        err = m_dataset->RasterIO(GF_Read, x0, y0, xs, ys, samples.data(), bw, bh, GDT_Float32,
+                                  m_bandMap.size(), m_bandMap.data(),
+                                  channels * sizeof(float), rowSamples * sizeof(float), sizeof(float),
+                                  nullptr);
+        if (err == CE_None) {
+            for (int y = 0; y < bh; ++y) {
+                RasterStretch::stretchToByte(samples.constData() + y * rowSamples, image.scanLine(y),
+                                             rowSamples, m_stretch);
+            }
+        }
+    }
+
+    if (err != CE_None) {
+        qWarning() << "GdalRasterSource: tile read failed" << level << tx << ty << CPLGetLastErrorMsg();
+        return QImage();
+    }
+    return image;
+}
+
+// Hypsometric tint from low (green) to high (white)
+static void elevationTint(double t, int& r, int& g, int& b)
+{
+    static const double stops[][4] = {
+        {0.00,  70, 120,  60},
+        {0.35, 150, 170,  90},
+        {0.65, 200, 170, 110},
+        {0.85, 150, 110,  80},
+        {1.00, 245, 245, 245},
+    };
+    t = qBound(0.0, t, 1.0);
+    int i = 1;
+    while (i < 4 && t > stops[i][0]) ++i;
+    double f = (t - stops[i - 1][0]) / (stops[i][0] - stops[i - 1][0]);
+    r = static_cast<int>(stops[i - 1][1] + f * (stops[i][1] - stops[i - 1][1]));
+    g = static_cast<int>(stops[i - 1][2] + f * (stops[i][2] - stops[i - 1][2]));
+    b = static_cast<int>(stops[i - 1][3] + f * (stops[i][3] - stops[i - 1][3]));
+}
+
+QImage GdalRasterSource::readHillshadeTile(int level, int tx, int ty)
+{
+    int span = TileSize << level;
+    int x0 = tx * span;
+    int y0 = ty * span;
+    int xs = qMin(span, m_size.width() - x0);
+    int ys = qMin(span, m_size.height() - y0);
+    if (xs <= 0 || ys <= 0) return QImage();
+
+    int step = 1 << level;
+    int bw = qMax(1, (xs + step - 1) / step);
+    int bh = qMax(1, (ys + step - 1) / step);
+
+    // Elevations with a one-sample border so slopes match across tiles
+    int pw = bw + 2;
+    int ph = bh + 2;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    QVector<float> z(pw * ph, nan);
+
+    int ox = (x0 - step < 0) ? 1 : 0;
+    int oy = (y0 - step < 0) ? 1 : 0;
+    int wx0 = x0 - step + ox * step;
+    int wy0 = y0 - step + oy * step;
+    int bufW = qMin(pw - ox, (m_size.width() - wx0 + step - 1) / step);
+    int bufH = qMin(ph - oy, (m_size.height() - wy0 + step - 1) / step);
+    int wxs = qMin(bufW * step, m_size.width() - wx0);
+    int wys = qMin(bufH * step, m_size.height() - wy0);
+
+    CPLErr err = m_dataset->GetRasterBand(1)->RasterIO(GF_Read, wx0, wy0, wxs, wys, z.data() + oy * pw + ox,
+                                                       bufW, bufH, GDT_Float32,
+                                                       sizeof(float), pw * sizeof(float), nullptr);
+    if (err != CE_None) {
+        qWarning() << "GdalRasterSource: hillshade read failed" << level << tx << ty << CPLGetLastErrorMsg();
+        return QImage();
+    }
+    if (m_hasNoData) {
+        const float noData = static_cast<float>(m_noData);
+        for (float& v : z) {
+            if (v == noData) v = nan;
+        }
+    }
+
+    QImage image(bw, bh, QImage::Format_RGBA8888);
+    if (image.isNull()) return QImage();
+
+    // Horn's method, light from the north-west at 45 degrees
+    const double cellX = qAbs(m_geoTransform[1]) * step * m_metersPerUnit;
+    const double cellY = qAbs(m_geoTransform[5]) * step * m_metersPerUnit;
+    const double lightX = -0.5, lightY = 0.5, lightZ = 0.70710678;
+    const double range = (m_maxValue > m_minValue) ? (m_maxValue - m_minValue) : 1.0;
+
+    for (int j = 0; j < bh; ++j) {
+        uchar* line = image.scanLine(j);
+        const float* above = z.constData() + j * pw;
+        const float* middle = above + pw;
+        const float* below = middle + pw;
+
+        for (int i = 0; i < bw; ++i) {
+            float e = middle[i + 1];
+            if (std::isnan(e)) {
+                line[i * 4 + 0] = line[i * 4 + 1] = line[i * 4 + 2] = line[i * 4 + 3] = 0;
+                continue;
+            }
+
+            // Missing neighbours (NoData or off the raster) take the centre value
+            auto at = [e](float v) { return std::isnan(v) ? e : v; };
+            double a = at(above[i]), b = at(above[i + 1]), c = at(above[i + 2]);
+            double d = at(middle[i]), f = at(middle[i + 2]);
+            double g = at(below[i]), h = at(below[i + 1]), k = at(below[i + 2]);
+
+            double dzdx = ((c + 2 * f + k) - (a + 2 * d + g)) / (8.0 * cellX);
+            double dzdy = ((g + 2 * h + k) - (a + 2 * b + c)) / (8.0 * cellY);  // Rows run south
+            double shade = (-dzdx * lightX + dzdy * lightY + lightZ) / std::sqrt(1.0 + dzdx * dzdx + dzdy * dzdy);
+            shade = 0.35 + 0.65 * qBound(0.0, shade, 1.0);
+
+            int r, gr, bl;
+            elevationTint((e - m_minValue) / range, r, gr, bl);
+            line[i * 4 + 0] = static_cast<uchar>(r * shade);
+            line[i * 4 + 1] = static_cast<uchar>(gr * shade);
+            line[i * 4 + 2] = static_cast<uchar>(bl * shade);
+            line[i * 4 + 3] = 255;
+        }
+    }
+
+    return image;
+}
+
+QVector<GdalRasterSource::Tile> GdalRasterSource::tiles(const QRectF& worldRect, double worldPerPixel,
+                                                        int maxDecodes, bool* complete)
+{
+    QVector<Tile> result;
+    if (complete) *complete = true;
+    if (!m_dataset || worldPerPixel <= 0) return result;
+
+    // Pick the pyramid level whose pixels are just finer than screen pixels
+    double ratio = worldPerPixel / qAbs(m_geoTransform[1]);
+    int level = (ratio > 1.0) ? static_cast<int>(qFloor(std::log2(ratio))) : 0;
+    level = qBound(0, level, m_maxLevel);
+
+    // Visible window in full-resolution pixel coordinates
+    double px0 = (worldRect.left() - m_geoTransform[0]) / m_geoTransform[1];
+    double px1 = (worldRect.right() - m_geoTransform[0]) / m_geoTransform[1];
+    double py0 = (worldRect.top() - m_geoTransform[3]) / m_geoTransform[5];
+    double py1 = (worldRect.bottom() - m_geoTransform[3]) / m_geoTransform[5];
+
+    int minPx = qMax(0, static_cast<int>(qFloor(qMin(px0, px1))));
+    int maxPx = qMin(m_size.width(), static_cast<int>(qCeil(qMax(px0, px1))));
+    int minPy = qMax(0, static_cast<int>(qFloor(qMin(py0, py1))));
+    int maxPy = qMin(m_size.height(), static_cast<int>(qCeil(qMax(py0, py1))));
+    if (minPx >= maxPx || minPy >= maxPy) return result;
+
+    int span = TileSize << level;
+    int tx0 = minPx / span;
+    int tx1 = (maxPx - 1) / span;
+    int ty0 = minPy / span;
+    int ty1 = (maxPy - 1) / span;
+
+    int decodes = 0;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            Tile tile;
+            tile.bounds = tileBounds(level, tx, ty);
+
+            quint64 key = tileKey(level, tx, ty);
+            if (QImage* cached = m_cache.object(key)) {
+                tile.image = *cached;
+            } else if (decodes < maxDecodes) {
+                ++decodes;
+                QImage image = readTile(level, tx, ty);
+                if (image.isNull()) continue;
+                int costKB = qMax<qsizetype>(1, image.sizeInBytes() / 1024);
+                m_cache.insert(key, new QImage(image), costKB);
+                tile.image = image;
+            } else {
+                // Over budget: show the part of a cached coarser tile meanwhile
+                if (complete) *complete = false;
+                for (int parent = level + 1; parent <= m_maxLevel; ++parent) {
+                    int shift = parent - level;
+                    QImage* cached = m_cache.object(tileKey(parent, tx >> shift, ty >> shift));
+                    if (!cached) continue;
+
+                    int parentSpan = TileSize << parent;
+                    double scale = 1.0 / (1 << parent);
+                    int x0 = tx * span - (tx >> shift) * parentSpan;
+                    int y0 = ty * span - (ty >> shift) * parentSpan;
+                    int xs = qMin(span, m_size.width() - tx * span);
+                    int ys = qMin(span, m_size.height() - ty * span);
+                    tile.image = *cached;
+                    tile.source = QRectF(x0 * scale, y0 * scale, xs * scale, ys * scale);
+                    break;
+                }
+                if (tile.image.isNull()) continue;
+            }
+
+            if (tile.source.isNull()) {
+                tile.source = QRectF(tile.image.rect());
+            }
+            result.append(tile);
+        }
+    }
+
+    return result;
+}
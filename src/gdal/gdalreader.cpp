@@ -1,4 +1,7 @@
 #include "gdal/gdalreader.h"
+#include "gdal/gdalrastersource.h"
+#include "gdal/elevationgrid.h"
+#include "gdal/rasterstretch.h"
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
 #include <cpl_conv.h>
@@ -41,6 +44,7 @@ bool GdalReader::readFile(const QString& fileName)
 {
     m_data.clear();
     m_lastError.clear();
+    m_fileName = fileName;
     
     // Suppress OGR warnings (Non closed ring, etc)
     CPLPushErrorHandler(CPLQuietErrorHandler);
@@ -83,6 +87,146 @@ bool GdalReader::readFile(const QString& fileName)
     return success;
 }
 
+// Convert one OGR geometry into GdalData entries (multi-geometries are split)
+static void appendGeometry(OGRGeometry* geometry, const QString& layerName, const QColor& layerColor,
+                           GdalData& target)
+{
+    OGRwkbGeometryType geomType = wkbFlatten(geometry->getGeometryType());
+    
+    switch (geomType) {
+        case wkbPoint:
+        case wkbPoint25D: {
+            OGRPoint* point = static_cast<OGRPoint*>(geometry);
+            GdalPoint gp;
+            gp.position = QPointF(point->getX(), point->getY());
+            gp.layer = layerName;
+            gp.color = layerColor;
+            target.points.append(gp);
+            break;
+        }
+        
+        case wkbMultiPoint:
+        case wkbMultiPoint25D: {
+            OGRMultiPoint* multiPoint = static_cast<OGRMultiPoint*>(geometry);
+            for (int j = 0; j < multiPoint->getNumGeometries(); ++j) {
+                OGRPoint* point = static_cast<OGRPoint*>(multiPoint->getGeometryRef(j));
+                GdalPoint gp;
+                gp.position = QPointF(point->getX(), point->getY());
+                gp.layer = layerName;
+                gp.color = layerColor;
+                target.points.append(gp);
+            }
+            break;
+        }
+        
+        case wkbLineString:
+        case wkbLineString25D: {
+            OGRLineString* lineString = static_cast<OGRLineString*>(geometry);
+            GdalLineString gls;
+            gls.layer = layerName;
+            gls.color = layerColor;
+            for (int j = 0; j < lineString->getNumPoints(); ++j) {
+                gls.points.append(QPointF(lineString->getX(j), lineString->getY(j)));
+            }
+            if (gls.points.size() >= 2) {
+                target.lineStrings.append(gls);
+            }
+            break;
+        }
+        
+        case wkbMultiLineString:
+        case wkbMultiLineString25D: {
+            OGRMultiLineString* multiLine = static_cast<OGRMultiLineString*>(geometry);
+            for (int k = 0; k < multiLine->getNumGeometries(); ++k) {
+                OGRLineString* lineString = static_cast<OGRLineString*>(multiLine->getGeometryRef(k));
+                GdalLineString gls;
+                gls.layer = layerName;
+                gls.color = layerColor;
+                for (int j = 0; j < lineString->getNumPoints(); ++j) {
+                    gls.points.append(QPointF(lineString->getX(j), lineString->getY(j)));
+                }
+                if (gls.points.size() >= 2) {
+                    target.lineStrings.append(gls);
+                }
+            }
+            break;
+        }
+        
+        case wkbPolygon:
+        case wkbPolygon25D: {
+            OGRPolygon* polygon = static_cast<OGRPolygon*>(geometry);
+            GdalPolygon gp;
+            gp.layer = layerName;
+            gp.color = layerColor;
+            gp.fillColor = QColor(layerColor.red(), layerColor.green(), layerColor.blue(), 50);
+            
+            // Exterior ring
+            OGRLinearRing* extRing = polygon->getExteriorRing();
+            if (extRing) {
+                QVector<QPointF> ring;
+                for (int j = 0; j < extRing->getNumPoints(); ++j) {
+                    ring.append(QPointF(extRing->getX(j), extRing->getY(j)));
+                }
+                gp.rings.append(ring);
+            }
+            
+            // Interior rings (holes)
+            for (int r = 0; r < polygon->getNumInteriorRings(); ++r) {
+                OGRLinearRing* intRing = polygon->getInteriorRing(r);
+                QVector<QPointF> ring;
+                for (int j = 0; j < intRing->getNumPoints(); ++j) {
+                    ring.append(QPointF(intRing->getX(j), intRing->getY(j)));
+                }
+                gp.rings.append(ring);
+            }
+            
+            if (!gp.rings.isEmpty()) {
+                target.polygons.append(gp);
+            }
+            break;
+        }
+        
+        case wkbMultiPolygon:
+        case wkbMultiPolygon25D: {
+            OGRMultiPolygon* multiPoly = static_cast<OGRMultiPolygon*>(geometry);
+            for (int p = 0; p < multiPoly->getNumGeometries(); ++p) {
+                OGRPolygon* polygon = static_cast<OGRPolygon*>(multiPoly->getGeometryRef(p));
+                GdalPolygon gp;
+                gp.layer = layerName;
+                gp.color = layerColor;
+                gp.fillColor = QColor(layerColor.red(), layerColor.green(), layerColor.blue(), 50);
+                
+                OGRLinearRing* extRing = polygon->getExteriorRing();
+                if (extRing) {
+                    QVector<QPointF> ring;
+                    for (int j = 0; j < extRing->getNumPoints(); ++j) {
+                        ring.append(QPointF(extRing->getX(j), extRing->getY(j)));
+                    }
+                    gp.rings.append(ring);
+                }
+                
+                for (int r = 0; r < polygon->getNumInteriorRings(); ++r) {
+                    OGRLinearRing* intRing = polygon->getInteriorRing(r);
+                    QVector<QPointF> ring;
+                    for (int j = 0; j < intRing->getNumPoints(); ++j) {
+                        ring.append(QPointF(intRing->getX(j), intRing->getY(j)));
+                    }
+                    gp.rings.append(ring);
+                }
+                
+                if (!gp.rings.isEmpty()) {
+                    target.polygons.append(gp);
+                }
+            }
+            break;
+        }
+        
+        default:
+            // Unsupported geometry type
+            break;
+    }
+}
+
 bool GdalReader::readVectorData(GDALDataset* dataset)
 {
     int layerCount = dataset->GetLayerCount();
@@ -139,146 +283,152 @@ bool GdalReader::readVectorData(GDALDataset* dataset)
                 continue;
             }
             
-            OGRwkbGeometryType geomType = wkbFlatten(geometry->getGeometryType());
+            appendGeometry(geometry, layerName, layerColor, m_data);
             
-            switch (geomType) {
-                case wkbPoint:
-                case wkbPoint25D: {
-                    OGRPoint* point = static_cast<OGRPoint*>(geometry);
-                    GdalPoint gp;
-                    gp.position = QPointF(point->getX(), point->getY());
-                    gp.layer = layerName;
-                    gp.color = layerColor;
-                    m_data.points.append(gp);
-                    break;
-                }
-                
-                case wkbMultiPoint:
-                case wkbMultiPoint25D: {
-                    OGRMultiPoint* multiPoint = static_cast<OGRMultiPoint*>(geometry);
-                    for (int j = 0; j < multiPoint->getNumGeometries(); ++j) {
-                        OGRPoint* point = static_cast<OGRPoint*>(multiPoint->getGeometryRef(j));
-                        GdalPoint gp;
-                        gp.position = QPointF(point->getX(), point->getY());
-                        gp.layer = layerName;
-                        gp.color = layerColor;
-                        m_data.points.append(gp);
-                    }
-                    break;
-                }
-                
-                case wkbLineString:
-                case wkbLineString25D: {
-                    OGRLineString* lineString = static_cast<OGRLineString*>(geometry);
-                    GdalLineString gls;
-                    gls.layer = layerName;
-                    gls.color = layerColor;
-                    for (int j = 0; j < lineString->getNumPoints(); ++j) {
-                        gls.points.append(QPointF(lineString->getX(j), lineString->getY(j)));
-                    }
-                    if (gls.points.size() >= 2) {
-                        m_data.lineStrings.append(gls);
-                    }
-                    break;
-                }
-                
-                case wkbMultiLineString:
-                case wkbMultiLineString25D: {
-                    OGRMultiLineString* multiLine = static_cast<OGRMultiLineString*>(geometry);
-                    for (int k = 0; k < multiLine->getNumGeometries(); ++k) {
-                        OGRLineString* lineString = static_cast<OGRLineString*>(multiLine->getGeometryRef(k));
-                        GdalLineString gls;
-                        gls.layer = layerName;
-                        gls.color = layerColor;
-                        for (int j = 0; j < lineString->getNumPoints(); ++j) {
-                            gls.points.append(QPointF(lineString->getX(j), lineString->getY(j)));
-                        }
-                        if (gls.points.size() >= 2) {
-                            m_data.lineStrings.append(gls);
-                        }
-                    }
-                    break;
-                }
-                
-                case wkbPolygon:
-                case wkbPolygon25D: {
-                    OGRPolygon* polygon = static_cast<OGRPolygon*>(geometry);
-                    GdalPolygon gp;
-                    gp.layer = layerName;
-                    gp.color = layerColor;
-                    gp.fillColor = QColor(layerColor.red(), layerColor.green(), layerColor.blue(), 50);
-                    
-                    // Exterior ring
-                    OGRLinearRing* extRing = polygon->getExteriorRing();
-                    if (extRing) {
-                        QVector<QPointF> ring;
-                        for (int j = 0; j < extRing->getNumPoints(); ++j) {
-                            ring.append(QPointF(extRing->getX(j), extRing->getY(j)));
-                        }
-                        gp.rings.append(ring);
-                    }
-                    
-                    // Interior rings (holes)
-                    for (int r = 0; r < polygon->getNumInteriorRings(); ++r) {
-                        OGRLinearRing* intRing = polygon->getInteriorRing(r);
-                        QVector<QPointF> ring;
-                        for (int j = 0; j < intRing->getNumPoints(); ++j) {
-                            ring.append(QPointF(intRing->getX(j), intRing->getY(j)));
-                        }
-                        gp.rings.append(ring);
-                    }
-                    
-                    if (!gp.rings.isEmpty()) {
-                        m_data.polygons.append(gp);
-                    }
-                    break;
-                }
-                
-                case wkbMultiPolygon:
-                case wkbMultiPolygon25D: {
-                    OGRMultiPolygon* multiPoly = static_cast<OGRMultiPolygon*>(geometry);
-                    for (int p = 0; p < multiPoly->getNumGeometries(); ++p) {
-                        OGRPolygon* polygon = static_cast<OGRPolygon*>(multiPoly->getGeometryRef(p));
-                        GdalPolygon gp;
-                        gp.layer = layerName;
-                        gp.color = layerColor;
-                        gp.fillColor = QColor(layerColor.red(), layerColor.green(), layerColor.blue(), 50);
-                        
-                        OGRLinearRing* extRing = polygon->getExteriorRing();
-                        if (extRing) {
-                            QVector<QPointF> ring;
-                            for (int j = 0; j < extRing->getNumPoints(); ++j) {
-                                ring.append(QPointF(extRing->getX(j), extRing->getY(j)));
-                            }
-                            gp.rings.append(ring);
-                        }
-                        
-                        for (int r = 0; r < polygon->getNumInteriorRings(); ++r) {
-                            OGRLinearRing* intRing = polygon->getInteriorRing(r);
-                            QVector<QPointF> ring;
-                            for (int j = 0; j < intRing->getNumPoints(); ++j) {
-                                ring.append(QPointF(intRing->getX(j), intRing->getY(j)));
-                            }
-                            gp.rings.append(ring);
-                        }
-                        
-                        if (!gp.rings.isEmpty()) {
-                            m_data.polygons.append(gp);
-                        }
-                    }
-                    break;
+            OGRFeature::DestroyFeature(feature);
+        }
+    }
+    
+    return !m_data.points.isEmpty() || !m_data.lineStrings.isEmpty() || !m_data.polygons.isEmpty();
+}
+
+bool GdalReader::streamVectorFile(const QString& fileName, const VectorFilter& filter,
+                                  int batchSize, const BatchCallback& callback)
+{
+    m_data.clear();
+    m_lastError.clear();
+    m_fileName = fileName;
+    m_featuresStreamed = 0;
+    
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    
+    GDALDataset* dataset = static_cast<GDALDataset*>(
+        GDALOpenEx(fileName.toUtf8().constData(), GDAL_OF_READONLY | GDAL_OF_VECTOR,
+                   nullptr, nullptr, nullptr));
+    if (!dataset) {
+        m_lastError = QString("Failed to open file: %1").arg(CPLGetLastErrorMsg());
+        CPLPopErrorHandler();
+        return false;
+    }
+    
+    GdalData batch;
+    int pending = 0;
+    auto flush = [&]() {
+        if (pending == 0 && batch.layers.isEmpty()) return true;
+        bool more = callback(std::move(batch));
+        batch.clear();
+        pending = 0;
+        return more;
+    };
+    
+    QRectF extent = filter.extent.normalized();
+    QByteArray attributeFilter = filter.attributeFilter.trimmed().toUtf8();
+    bool stopped = false;
+    
+    // Filters are applied by the driver (spatial index, SQL) before any
+    // feature is materialized. All layers are set up first, so a filter
+    // that does not apply fails the import before anything is delivered.
+    for (int i = 0; i < dataset->GetLayerCount(); ++i) {
+        OGRLayer* layer = dataset->GetLayer(i);
+        if (!layer) continue;
+        if (!extent.isNull()) {
+            layer->SetSpatialFilterRect(extent.left(), extent.top(), extent.right(), extent.bottom());
+        }
+        if (!attributeFilter.isEmpty() && layer->SetAttributeFilter(attributeFilter.constData()) != OGRERR_NONE) {
+            m_lastError = QString("Invalid attribute filter for layer %1: %2")
+                .arg(QString::fromUtf8(layer->GetName()), QString::fromUtf8(CPLGetLastErrorMsg()));
+            GDALClose(dataset);
+            CPLPopErrorHandler();
+            return false;
+        }
+    }
+    
+    for (int i = 0; i < dataset->GetLayerCount() && !stopped; ++i) {
+        OGRLayer* layer = dataset->GetLayer(i);
+        if (!layer) continue;
+        
+        QString layerName = QString::fromUtf8(layer->GetName());
+        QColor layerColor = getLayerColor(i);
+        
+        const OGRSpatialReference* srs = layer->GetSpatialRef();
+        if (srs && m_data.crs.isEmpty()) {
+            const char* authName = srs->GetAuthorityName(nullptr);
+            const char* authCode = srs->GetAuthorityCode(nullptr);
+            if (authName && authCode) {
+                m_data.crs = QString("%1:%2").arg(authName).arg(authCode);
+            }
+        }
+        
+        // The layer envelope when the driver has it without a scan, else the
+        // envelope of the features read; clipped to the import rectangle
+        auto layerExtent = [&extent](const OGREnvelope& envelope) {
+            QRectF rect(envelope.MinX, envelope.MinY,
+                        envelope.MaxX - envelope.MinX, envelope.MaxY - envelope.MinY);
+            return extent.isNull() ? rect : rect.intersected(extent);
+        };
+        OGREnvelope envelope;
+        const bool knownExtent = layer->GetExtent(&envelope, FALSE) == OGRERR_NONE;
+        OGREnvelope readEnvelope;
+        
+        GdalLayer layerInfo;
+        layerInfo.name = layerName;
+        layerInfo.type = "vector";
+        layerInfo.featureCount = static_cast<int>(layer->GetFeatureCount(FALSE));  // -1 if costly to count
+        layerInfo.extent = knownExtent ? layerExtent(envelope) : QRectF();
+        layerInfo.visible = true;
+        m_data.layers.append(layerInfo);
+        batch.layers.append(layerInfo);
+        
+        layer->ResetReading();
+        CPLErrorReset();
+        OGRFeature* feature;
+        while ((feature = layer->GetNextFeature()) != nullptr) {
+            OGRGeometry* geometry = feature->GetGeometryRef();
+            if (geometry) {
+                if (!knownExtent) {
+                    OGREnvelope featureEnvelope;
+                    geometry->getEnvelope(&featureEnvelope);
+                    readEnvelope.Merge(featureEnvelope);
                 }
-                
-                default:
-                    // Unsupported geometry type
-                    break;
+                appendGeometry(geometry, layerName, layerColor, batch);
+                ++pending;
+                ++m_featuresStreamed;
             }
-            
             OGRFeature::DestroyFeature(feature);
+            
+            if (pending >= batchSize && !flush()) {
+                stopped = true;
+                break;
+            }
+        }
+        
+        // A read error ends the layer early; what was read is delivered so
+        // the caller can report exactly what it holds
+        if (!stopped && CPLGetLastErrorType() >= CE_Failure) {
+            m_lastError = QString("Failed reading layer %1: %2")
+                .arg(layerName, QString::fromUtf8(CPLGetLastErrorMsg()));
+            flush();
+            GDALClose(dataset);
+            CPLPopErrorHandler();
+            return false;
+        }
+        
+        // The layer entry is still pending unless a batch went out since
+        if (!knownExtent && readEnvelope.IsInit()) {
+            m_data.layers.last().extent = layerExtent(readEnvelope);
+            if (!batch.layers.isEmpty() && batch.layers.last().name == layerName) {
+                batch.layers.last().extent = m_data.layers.last().extent;
+            }
         }
     }
     
-    return !m_data.points.isEmpty() || !m_data.lineStrings.isEmpty() || !m_data.polygons.isEmpty();
+    if (!stopped) {
+        flush();
+    }
+    
+    GDALClose(dataset);
+    CPLPopErrorHandler();
+    return true;
 }
 
 bool GdalReader::readRasterData(GDALDataset* dataset)
@@ -327,73 +477,127 @@ bool GdalReader::readRasterData(GDALDataset* dataset)
         }
     }
     
+    bool elevation = isElevationRaster(dataset);
+    
     // Add layer info
     GdalLayer layerInfo;
-    layerInfo.name = "Raster";
+    layerInfo.name = elevation ? "DEM" : "Raster";
     layerInfo.type = "raster";
     layerInfo.featureCount = 1;
     layerInfo.extent = rasterExtent;
     layerInfo.visible = true;
     m_data.layers.append(layerInfo);
     
-    // Read raster data into QImage
-    QImage image;
-    
-    if (bandCount >= 3) {
-        // RGB or RGBA
-        image = QImage(width, height, QImage::Format_RGBA8888);
-        image.fill(Qt::transparent);
-        
-        GDALRasterBand* redBand = dataset->GetRasterBand(1);
-        GDALRasterBand* greenBand = dataset->GetRasterBand(2);
-        GDALRasterBand* blueBand = dataset->GetRasterBand(3);
-        GDALRasterBand* alphaBand = (bandCount >= 4) ? dataset->GetRasterBand(4) : nullptr;
-        
-        QVector<uint8_t> redData(width * height);
-        QVector<uint8_t> greenData(width * height);
-        QVector<uint8_t> blueData(width * height);
-        QVector<uint8_t> alphaData(width * height, 255);
-        
-        CPLErr err1 = redBand->RasterIO(GF_Read, 0, 0, width, height, redData.data(), width, height, GDT_Byte, 0, 0);
-        CPLErr err2 = greenBand->RasterIO(GF_Read, 0, 0, width, height, greenData.data(), width, height, GDT_Byte, 0, 0);
-        CPLErr err3 = blueBand->RasterIO(GF_Read, 0, 0, width, height, blueData.data(), width, height, GDT_Byte, 0, 0);
-        CPLErr err4 = CE_None;
-        if (alphaBand) {
-            err4 = alphaBand->RasterIO(GF_Read, 0, 0, width, height, alphaData.data(), width, height, GDT_Byte, 0, 0);
+    // Elevation models stay open as a surface for the volume and contour
+    // tools, and are drawn as hillshade tiles
+    if (elevation) {
+        auto grid = std::make_shared<ElevationGrid>();
+        if (!grid->open(m_fileName)) {
+            m_lastError = grid->lastError();
+            return false;
         }
-        
-        if (err1 != CE_None || err2 != CE_None || err3 != CE_None || err4 != CE_None) {
-            m_lastError = "Failed to read raster band data";
+        auto source = std::make_shared<GdalRasterSource>();
+        if (!source->open(m_fileName, GdalRasterSource::Rendering::Hillshade)) {
+            m_lastError = source->lastError();
             return false;
         }
         
-        for (int y = 0; y < height; ++y) {
-            uchar* line = image.scanLine(y);
-            for (int x = 0; x < width; ++x) {
-                int idx = y * width + x;
-                line[x * 4 + 0] = redData[idx];
-                line[x * 4 + 1] = greenData[idx];
-                line[x * 4 + 2] = blueData[idx];
-                line[x * 4 + 3] = alphaData[idx];
-            }
+        GdalRaster raster;
+        raster.bounds = rasterExtent;
+        raster.layer = "DEM";
+        raster.source = source;
+        raster.elevation = grid;
+        m_data.rasters.append(raster);
+        return true;
+    }
+    
+    // Large rasters stay open and are read tile by tile as the view needs them
+    if (static_cast<qint64>(width) * height > TiledRasterThreshold) {
+        auto source = std::make_shared<GdalRasterSource>();
+        if (!source->open(m_fileName)) {
+            m_lastError = source->lastError();
+            return false;
         }
-    } else {
-        // Grayscale
-        image = QImage(width, height, QImage::Format_Grayscale8);
-        
-        GDALRasterBand* band = dataset->GetRasterBand(1);
-        QVector<uint8_t> data(width * height);
-        CPLErr err = band->RasterIO(GF_Read, 0, 0, width, height, data.data(), width, height, GDT_Byte, 0, 0);
         
+        GdalRaster raster;
+        raster.bounds = rasterExtent;
+        raster.layer = "Raster";
+        raster.source = source;
+        m_data.rasters.append(raster);
+        return true;
+    }
+    
+    // Bands shown: RGB(A) or grayscale
+    QVector<int> bandMap;
+    QImage::Format format;
+    if (bandCount >= 3) {
+        format = QImage::Format_RGBA8888;
+        bandMap << 1 << 2 << 3;
+        if (bandCount >= 4) bandMap << 4;
+    } else {
+        format = QImage::Format_Grayscale8;
+        bandMap << 1;
+    }
+    int channels = (format == QImage::Format_RGBA8888) ? 4 : 1;
+    
+    QImage image(width, height, format);
+    if (image.isNull()) {
+        m_lastError = "Not enough memory for raster image";
+        return false;
+    }
+    
+    bool byteData = true;
+    for (int b : bandMap) {
+        if (dataset->GetRasterBand(b)->GetRasterDataType() != GDT_Byte) byteData = false;
+    }
+    
+    if (byteData) {
+        // One RasterIO call writes every band straight into the scanlines
+        if (bandMap.size() == 3) {
+            image.fill(Qt::white);  // Opaque alpha channel
+        }
+        CPLErr err = dataset->RasterIO(GF_Read, 0, 0, width, height, image.bits(), width, height, GDT_Byte,
+                                       bandMap.size(), bandMap.data(),
+                                       channels, image.bytesPerLine(), 1, nullptr);
         if (err != CE_None) {
-            m_lastError = "Failed to read grayscale raster band data";
+            m_lastError = "Failed to read raster band data";
             return false;
         }
+    } else {
+        // Stretch each band's min..max to 0..255 instead of letting GDAL clip
+        RasterStretch::Params params = RasterStretch::uniform(0.0, 255.0);
+        for (int i = 0; i < bandMap.size(); ++i) {
+            GDALRasterBand* band = dataset->GetRasterBand(bandMap[i]);
+            if (band->GetRasterDataType() == GDT_Byte) continue;
+            
+            double minMax[2] = {0.0, 255.0};
+            band->ComputeRasterMinMax(TRUE, minMax);
+            if (channels == 1) {
+                params = RasterStretch::uniform(minMax[0], minMax[1]);
+            } else {
+                RasterStretch::setRange(params, i, minMax[0], minMax[1]);
+            }
+        }
+        
+        // Float samples are read a strip of rows at a time (about 16 MB),
+        // pixel-interleaved so each row stretches straight into its scanline
+        int rowSamples = width * channels;
+        int stripRows = static_cast<int>(qBound<qint64>(1, (16LL << 20) / (rowSamples * qint64(sizeof(float))), height));
+        QVector<float> strip(rowSamples * stripRows, 255.0f);  // Unread alpha lane stays opaque
         
-        for (int y = 0; y < height; ++y) {
-            uchar* line = image.scanLine(y);
-            for (int x = 0; x < width; ++x) {
-                line[x] = data[y * width + x];
+        for (int y0 = 0; y0 < height; y0 += stripRows) {
+            int rows = qMin(stripRows, height - y0);
+            CPLErr err = dataset->RasterIO(GF_Read, 0, y0, width, rows, strip.data(), width, rows, GDT_Float32,
+                                           bandMap.size(), bandMap.data(),
+                                           channels * sizeof(float), rowSamples * sizeof(float), sizeof(float),
+                                           nullptr);
+            if (err != CE_None) {
+                m_lastError = "Failed to read raster band data";
+                return false;
+            }
+            for (int r = 0; r < rows; ++r) {
+                RasterStretch::stretchToByte(strip.constData() + r * rowSamples, image.scanLine(y0 + r),
+                                             rowSamples, params);
             }
         }
     }
@@ -407,6 +611,25 @@ bool GdalReader::readRasterData(GDALDataset* dataset)
     return true;
 }
 
+bool GdalReader::isElevationRaster(GDALDataset* dataset)
+{
+    // Single band of signed or floating point samples, not a palette image
+    if (dataset->GetRasterCount() != 1) return false;
+    
+    GDALRasterBand* band = dataset->GetRasterBand(1);
+    if (band->GetColorInterpretation() == GCI_PaletteIndex) return false;
+    
+    switch (band->GetRasterDataType()) {
+        case GDT_Int16:
+        case GDT_Int32:
+        case GDT_Float32:
+        case GDT_Float64:
+            return true;
+        default:
+            return false;
+    }
+}
+
 QColor GdalReader::getLayerColor(int index)
 {
     return s_layerColors[index % s_numColors];
@@ -4,8 +4,236 @@
 #include <ogrsf_frmts.h>
 #include <cpl_conv.h>
 #include <QFileInfo>
+#include <QFile>
 #include <QDebug>
 
+// Features between progress reports in the bulk exports
+static const qint64 ProgressInterval = 4096;
+
+// State of one bulk export: the open dataset, its running transaction and
+// the progress across all layers
+struct BulkExport {
+    GDALDataset* dataset{nullptr};
+    bool transactions{false};
+    bool inTransaction{false};
+    int pending{0};
+    qint64 written{0};
+    qint64 total{0};
+    const GdalWriter::ProgressCallback* progress{nullptr};
+    QString error;
+    
+    void begin()
+    {
+        pending = 0;
+        inTransaction = transactions && dataset->StartTransaction() == OGRERR_NONE;
+    }
+    
+    bool report()
+    {
+        if (progress && *progress && !(*progress)(written, total)) {
+            error = "Export cancelled";
+            return false;
+        }
+        return true;
+    }
+    
+    // Count a written feature, committing every TransactionSize features
+    bool featureWritten()
+    {
+        ++written;
+        if (inTransaction && ++pending >= GdalWriter::TransactionSize) {
+            inTransaction = false;
+            if (dataset->CommitTransaction() != OGRERR_NONE) {
+                error = QString("Failed to commit features: %1").arg(CPLGetLastErrorMsg());
+                return false;
+            }
+            begin();
+        }
+        return written % ProgressInterval != 0 || report();
+    }
+    
+    bool finish()
+    {
+        if (!inTransaction) return true;
+        inTransaction = false;
+        if (dataset->CommitTransaction() != OGRERR_NONE) {
+            error = QString("Failed to commit features: %1").arg(CPLGetLastErrorMsg());
+            return false;
+        }
+        return true;
+    }
+    
+    void rollback()
+    {
+        if (inTransaction) {
+            dataset->RollbackTransaction();
+            inTransaction = false;
+        }
+    }
+};
+
+// Consecutive features mostly share a layer, so its UTF-8 is converted once
+struct Utf8Cache {
+    QString text;
+    QByteArray utf8;
+    
+    const char* get(const QString& value)
+    {
+        if (utf8.isNull() || value != text) {
+            text = value;
+            utf8 = value.toUtf8();
+        }
+        return utf8.constData();
+    }
+};
+
+static bool isExportable(const CanvasPolyline& poly)
+{
+    return poly.points.size() >= (poly.closed ? 3 : 2);
+}
+
+static bool createFields(OGRLayer* layer, const QVector<OGRFieldDefn*>& fields, QString& error)
+{
+    for (OGRFieldDefn* field : fields) {
+        if (layer->CreateField(field) != OGRERR_NONE) {
+            error = QString("Failed to create %1 field: %2").arg(field->GetNameRef()).arg(CPLGetLastErrorMsg());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the open (closed = false) or closed polylines as one layer. A single
+// feature owns one line string or polygon that is refilled for every record.
+static bool writeLineLayer(BulkExport& bulk, const char* name, OGRSpatialReference* srs, char** options,
+                           const QVector<CanvasPolyline>& polylines, bool closed)
+{
+    OGRLayer* layer = bulk.dataset->CreateLayer(name, srs, closed ? wkbPolygon : wkbLineString, options);
+    if (!layer) {
+        bulk.error = QString("Failed to create layer %1: %2").arg(name).arg(CPLGetLastErrorMsg());
+        return false;
+    }
+    
+    OGRFieldDefn indexField("Index", OFTInteger);
+    OGRFieldDefn layerField("Layer", OFTString);
+    layerField.SetWidth(64);
+    OGRFieldDefn areaField("Area", OFTReal);
+    QVector<OGRFieldDefn*> fields = {&indexField, &layerField};
+    if (closed) fields.append(&areaField);
+    if (!createFields(layer, fields, bulk.error)) return false;
+    
+    OGRFeatureDefn* definition = layer->GetLayerDefn();
+    const int indexColumn = definition->GetFieldIndex("Index");
+    const int layerColumn = definition->GetFieldIndex("Layer");
+    const int areaColumn = definition->GetFieldIndex("Area");
+    
+    OGRFeature* feature = OGRFeature::CreateFeature(definition);
+    OGRSimpleCurve* curve = nullptr;
+    OGRPolygon* polygon = nullptr;
+    if (closed) {
+        polygon = new OGRPolygon();
+        polygon->addRingDirectly(new OGRLinearRing());
+        curve = polygon->getExteriorRing();
+        feature->SetGeometryDirectly(polygon);
+    } else {
+        auto* line = new OGRLineString();
+        curve = line;
+        feature->SetGeometryDirectly(line);
+    }
+    
+    Utf8Cache layerNames;
+    bool ok = true;
+    bulk.begin();
+    for (int i = 0; ok && i < polylines.size(); ++i) {
+        const auto& poly = polylines[i];
+        if (poly.closed != closed || !isExportable(poly)) continue;
+        
+        const int count = poly.points.size();
+        const bool closeRing = closed && poly.points.first() != poly.points.last();
+        curve->setNumPoints(count + (closeRing ? 1 : 0), FALSE);
+        for (int p = 0; p < count; ++p) {
+            curve->setPoint(p, poly.points[p].x(), poly.points[p].y());
+        }
+        if (closeRing) {
+            curve->setPoint(count, poly.points[0].x(), poly.points[0].y());
+        }
+        
+        feature->SetFID(OGRNullFID);
+        feature->SetField(indexColumn, i);
+        feature->SetField(layerColumn, layerNames.get(poly.layer));
+        if (closed) {
+            feature->SetField(areaColumn, polygon->get_Area());
+        }
+        
+        if (layer->CreateFeature(feature) != OGRERR_NONE) {
+            bulk.error = QString("Failed to write feature %1: %2").arg(i).arg(CPLGetLastErrorMsg());
+            ok = false;
+        } else {
+            ok = bulk.featureWritten();
+        }
+    }
+    OGRFeature::DestroyFeature(feature);
+    
+    return ok && bulk.finish();
+}
+
+static bool writePegLayer(BulkExport& bulk, const char* name, OGRSpatialReference* srs, char** options,
+                          const QVector<CanvasPeg>& pegs)
+{
+    OGRLayer* layer = bulk.dataset->CreateLayer(name, srs, wkbPoint25D, options);
+    if (!layer) {
+        bulk.error = QString("Failed to create layer %1: %2").arg(name).arg(CPLGetLastErrorMsg());
+        return false;
+    }
+    
+    OGRFieldDefn nameField("Name", OFTString);
+    nameField.SetWidth(64);
+    OGRFieldDefn xField("X", OFTReal);
+    OGRFieldDefn yField("Y", OFTReal);
+    OGRFieldDefn zField("Z", OFTReal);
+    OGRFieldDefn layerField("Layer", OFTString);
+    layerField.SetWidth(64);
+    if (!createFields(layer, {&nameField, &xField, &yField, &zField, &layerField}, bulk.error)) return false;
+    
+    OGRFeatureDefn* definition = layer->GetLayerDefn();
+    const int nameColumn = definition->GetFieldIndex("Name");
+    const int xColumn = definition->GetFieldIndex("X");
+    const int yColumn = definition->GetFieldIndex("Y");
+    const int zColumn = definition->GetFieldIndex("Z");
+    const int layerColumn = definition->GetFieldIndex("Layer");
+    
+    OGRFeature* feature = OGRFeature::CreateFeature(definition);
+    auto* point = new OGRPoint(0.0, 0.0, 0.0);
+    feature->SetGeometryDirectly(point);
+    
+    Utf8Cache layerNames;
+    bool ok = true;
+    bulk.begin();
+    for (int i = 0; ok && i < pegs.size(); ++i) {
+        const auto& peg = pegs[i];
+        point->setX(peg.position.x());
+        point->setY(peg.position.y());
+        point->setZ(peg.z);
+        
+        feature->SetFID(OGRNullFID);
+        feature->SetField(nameColumn, peg.name.toUtf8().constData());
+        feature->SetField(xColumn, peg.position.x());
+        feature->SetField(yColumn, peg.position.y());
+        feature->SetField(zColumn, peg.z);
+        feature->SetField(layerColumn, layerNames.get(peg.layer));
+        
+        if (layer->CreateFeature(feature) != OGRERR_NONE) {
+            bulk.error = QString("Failed to write peg %1: %2").arg(peg.name).arg(CPLGetLastErrorMsg());
+            ok = false;
+        } else {
+            ok = bulk.featureWritten();
+        }
+    }
+    OGRFeature::DestroyFeature(feature);
+    
+    return ok && bulk.finish();
+}
+
 GdalWriter::GdalWriter() {}
 GdalWriter::~GdalWriter() {}
 
@@ -478,3 +706,141 @@ bool GdalWriter::exportToKML(const QVector<CanvasPolyline>& polylines,
     GDALClose(dataset);
     return true;
 }
+
+bool GdalWriter::exportToGeoPackage(const QVector<CanvasPolyline>& polylines,
+                                    const QVector<CanvasPeg>& pegs,
+                                    const QString& filePath,
+                                    const QString& crs)
+{
+    return exportBulk("GPKG", polylines, pegs, filePath, crs, false);
+}
+
+bool GdalWriter::exportToFlatGeobuf(const QVector<CanvasPolyline>& polylines,
+                                    const QVector<CanvasPeg>& pegs,
+                                    const QString& filePath,
+                                    const QString& crs)
+{
+    return exportBulk("FlatGeobuf", polylines, pegs, filePath, crs, true);
+}
+
+bool GdalWriter::exportBulk(const char* driverName, const QVector<CanvasPolyline>& polylines,
+                            const QVector<CanvasPeg>& pegs, const QString& filePath,
+                            const QString& crs, bool layerPerFile)
+{
+    m_lastError.clear();
+    m_featuresWritten = 0;
+    m_filesWritten.clear();
+    
+    qint64 lineCount = 0;
+    qint64 polygonCount = 0;
+    for (const auto& poly : polylines) {
+        if (!isExportable(poly)) continue;
+        if (poly.closed) ++polygonCount;
+        else ++lineCount;
+    }
+    
+    if (lineCount + polygonCount + pegs.size() == 0) {
+        m_lastError = "No data to export";
+        return false;
+    }
+    
+    GDALDriver* driver = GetGDALDriverManager()->GetDriverByName(driverName);
+    if (!driver) {
+        m_lastError = QString("%1 driver not available").arg(driverName);
+        return false;
+    }
+    
+    OGRSpatialReference srs;
+    OGRSpatialReference* layerSrs = nullptr;
+    if (!crs.isEmpty() && srs.SetFromUserInput(crs.toUtf8().constData()) == OGRERR_NONE) {
+        layerSrs = &srs;
+    }
+    
+    // Both drivers build the spatial index once per layer, after the inserts
+    const char* layerOptions[] = {"SPATIAL_INDEX=YES", nullptr};
+    
+    // GeoPackage is SQLite: sync to disk per transaction is enough
+    CPLSetThreadLocalConfigOption("OGR_SQLITE_SYNCHRONOUS", "OFF");
+    
+    // FlatGeobuf holds one layer per file, named like the Shapefile pegs
+    // export. The first layer with features takes the chosen file name, so
+    // that file exists whatever the drawing holds.
+    QFileInfo info(filePath);
+    QString stem = info.path() + "/" + info.completeBaseName();
+    QString suffix = "." + info.suffix();
+    
+    enum PartKind { Lines, Polygons, Pegs };
+    struct Part {
+        PartKind kind;
+        const char* layerName;
+        QString path;
+        qint64 count;
+    };
+    QVector<Part> parts = {
+        {Lines, "polylines", filePath, lineCount},
+        {Polygons, "polygons", layerPerFile ? stem + "_polygons" + suffix : filePath, polygonCount},
+        {Pegs, "pegs", layerPerFile ? stem + "_pegs" + suffix : filePath, pegs.size()}
+    };
+    for (auto& part : parts) {
+        if (part.count == 0) continue;
+        part.path = filePath;
+        break;
+    }
+    
+    BulkExport bulk;
+    bulk.total = lineCount + polygonCount + pegs.size();
+    bulk.progress = &m_progressCallback;
+    
+    QStringList created;
+    bool ok = true;
+    for (const auto& part : parts) {
+        if (part.count == 0) continue;
+        
+        if (!bulk.dataset) {
+            bulk.dataset = driver->Create(part.path.toUtf8().constData(), 0, 0, 0, GDT_Unknown, nullptr);
+            if (!bulk.dataset) {
+                bulk.error = QString("Failed to create file: %1").arg(CPLGetLastErrorMsg());
+                ok = false;
+                break;
+            }
+            created << part.path;
+            bulk.transactions = bulk.dataset->TestCapability(ODsCTransactions);
+        }
+        
+        char** options = const_cast<char**>(layerOptions);
+        if (part.kind == Pegs) {
+            ok = writePegLayer(bulk, part.layerName, layerSrs, options, pegs);
+        } else {
+            ok = writeLineLayer(bulk, part.layerName, layerSrs, options, polylines, part.kind == Polygons);
+        }
+        if (!ok) break;
+        
+        if (layerPerFile) {
+            GDALClose(bulk.dataset);
+            bulk.dataset = nullptr;
+        }
+    }
+    
+    if (bulk.dataset) {
+        if (!ok) bulk.rollback();
+        GDALClose(bulk.dataset);
+    }
+    CPLSetThreadLocalConfigOption("OGR_SQLITE_SYNCHRONOUS", nullptr);
+    
+    m_featuresWritten = bulk.written;
+    
+    if (!ok) {
+        m_lastError = bulk.error;
+        // Don't leave a partial export behind
+        for (const auto& path : created) {
+            if (driver->Delete(path.toUtf8().constData()) != CE_None) {
+                QFile::remove(path);
+            }
+        }
+        return false;
+    }
+    
+    bulk.report();
+    m_filesWritten = created;
+    return true;
+}
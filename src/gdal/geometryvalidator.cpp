@@ -0,0 +1,250 @@
+#include "gdal/geometryvalidator.h"
+#include "gdal/geoscontext.h"
+#include "gdal/geosbridge.h"
+#include "canvas/canvaswidget.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace GeometryValidator {
+
+using GeosBridge::threadContext;
+using GeosBridge::createPolygon;
+using GeosBridge::ringPoints;
+
+static bool pointOf(GEOSContextHandle_t h, const GEOSGeometry* point, QPointF& result)
+{
+    double x, y;
+    if (!point || !GEOSGeomGetX_r(h, point, &x) || !GEOSGeomGetY_r(h, point, &y)) return false;
+    result = QPointF(x, y);
+    return true;
+}
+
+// Representative point and outline of the largest polygon in a geometry
+static void describeRegion(GEOSContextHandle_t h, const GEOSGeometry* geometry, Issue& issue)
+{
+    GEOSGeometry* onSurface = GEOSPointOnSurface_r(h, geometry);
+    issue.hasLocation = pointOf(h, onSurface, issue.location);
+    if (onSurface) GEOSGeom_destroy_r(h, onSurface);
+
+    const GEOSGeometry* largest = nullptr;
+    double largestArea = 0.0;
+    const int parts = GEOSGetNumGeometries_r(h, geometry);
+    for (int i = 0; i < parts; ++i) {
+        const GEOSGeometry* part = GEOSGetGeometryN_r(h, geometry, i);
+        double area = 0.0;
+        if (GEOSGeomTypeId_r(h, part) == GEOS_POLYGON && GEOSArea_r(h, part, &area) && area > largestArea) {
+            largestArea = area;
+            largest = part;
+        }
+    }
+    if (largest) {
+        issue.region = ringPoints(h, GEOSGetExteriorRing_r(h, largest));
+    }
+}
+
+// One polygon to validate; filled in on a worker thread
+struct PolygonCheck {
+    int index;
+    const QVector<QPointF>* points;
+    bool valid{false};
+    Issue issue;
+};
+
+static void checkValidity(PolygonCheck& check)
+{
+    // GeosBridge is reentrant: this uses the worker thread's own context
+    GeosBridge::Validity validity = GeosBridge::checkValidity(*check.points);
+    check.valid = validity.valid;
+    check.issue.type = IssueType::Invalid;
+    check.issue.index = check.index;
+    check.issue.reason = validity.reason;
+    check.issue.location = validity.location;
+    check.issue.hasLocation = validity.hasLocation;
+}
+
+// A polygon and the later polygons whose envelopes meet it
+struct OverlapTask {
+    int index;
+    const QVector<QPointF>* points;
+    QVector<QPair<int, const QVector<QPointF>*>> candidates;
+    double minArea;
+    QVector<Issue> issues;
+};
+
+static void findOverlaps(OverlapTask& task)
+{
+    GEOSContextHandle_t h = threadContext().handle;
+    if (!h) return;
+
+    GEOSGeometry* polygon = createPolygon(h, *task.points);
+    if (!polygon) return;
+    const GEOSPreparedGeometry* prepared = GEOSPrepare_r(h, polygon);
+
+    for (const auto& candidate : task.candidates) {
+        GEOSGeometry* other = createPolygon(h, *candidate.second);
+        if (!other) continue;
+
+        // Neighbours that only share edges have no 2D interior intersection
+        if (prepared && GEOSPreparedIntersects_r(h, prepared, other) == 1
+            && GEOSRelatePattern_r(h, polygon, other, "2********") == 1) {
+            GEOSGeometry* overlap = GEOSIntersection_r(h, polygon, other);
+            double area = 0.0;
+            if (overlap && GEOSArea_r(h, overlap, &area) && area >= task.minArea) {
+                Issue issue;
+                issue.type = IssueType::Overlap;
+                issue.index = task.index;
+                issue.otherIndex = candidate.first;
+                issue.area = area;
+                issue.reason = QString("Overlaps polygon %1 (area %2)").arg(candidate.first).arg(area, 0, 'f', 3);
+                describeRegion(h, overlap, issue);
+                task.issues.append(issue);
+            }
+            if (overlap) GEOSGeom_destroy_r(h, overlap);
+        }
+        GEOSGeom_destroy_r(h, other);
+    }
+
+    if (prepared) GEOSPreparedGeom_destroy_r(h, prepared);
+    GEOSGeom_destroy_r(h, polygon);
+}
+
+static void collectCandidate(void* item, void* userdata)
+{
+    static_cast<QVector<int>*>(userdata)->append(*static_cast<const int*>(item));
+}
+
+// Pairs (i < j) of valid polygons whose envelopes intersect, from an STR-tree
+static QVector<OverlapTask> overlapTasks(const QVector<PolygonCheck>& polygons, double minArea)
+{
+    QVector<OverlapTask> tasks;
+    GEOSContextHandle_t h = threadContext().handle;
+    if (!h || polygons.size() < 2) return tasks;
+
+    QVector<int> ids(polygons.size());
+    QVector<GEOSGeometry*> envelopes(polygons.size(), nullptr);
+    GEOSSTRtree* tree = GEOSSTRtree_create_r(h, 10);
+    if (!tree) return tasks;
+
+    for (int i = 0; i < polygons.size(); ++i) {
+        ids[i] = i;
+        GEOSGeometry* polygon = createPolygon(h, *polygons[i].points);
+        if (!polygon) continue;
+        envelopes[i] = GEOSEnvelope_r(h, polygon);
+        GEOSGeom_destroy_r(h, polygon);
+        if (envelopes[i]) {
+            GEOSSTRtree_insert_r(h, tree, envelopes[i], &ids[i]);
+        }
+    }
+
+    QVector<int> hits;
+    for (int i = 0; i < polygons.size(); ++i) {
+        if (!envelopes[i]) continue;
+        hits.clear();
+        GEOSSTRtree_query_r(h, tree, envelopes[i], collectCandidate, &hits);
+
+        OverlapTask task{polygons[i].index, polygons[i].points, {}, minArea, {}};
+        std::sort(hits.begin(), hits.end());
+        for (int j : hits) {
+            if (j > i) task.candidates.append(qMakePair(polygons[j].index, polygons[j].points));
+        }
+        if (!task.candidates.isEmpty()) tasks.append(task);
+    }
+
+    GEOSSTRtree_destroy_r(h, tree);
+    for (GEOSGeometry* envelope : envelopes) {
+        if (envelope) GEOSGeom_destroy_r(h, envelope);
+    }
+    return tasks;
+}
+
+// Holes in the union of all polygons that are small enough to be slivers
+static QVector<Issue> findGaps(const QVector<PolygonCheck>& polygons, double maxArea)
+{
+    QVector<Issue> issues;
+    GEOSContextHandle_t h = threadContext().handle;
+    if (!h || polygons.size() < 2) return issues;
+
+    QVector<GEOSGeometry*> parts;
+    parts.reserve(polygons.size());
+    for (const auto& polygon : polygons) {
+        if (GEOSGeometry* g = createPolygon(h, *polygon.points)) parts.append(g);
+    }
+
+    // The collection takes ownership of the parts
+    GEOSGeometry* collection = GEOSGeom_createCollection_r(h, GEOS_MULTIPOLYGON, parts.data(), parts.size());
+    if (!collection) {
+        for (GEOSGeometry* g : parts) GEOSGeom_destroy_r(h, g);
+        return issues;
+    }
+    GEOSGeometry* merged = GEOSUnaryUnion_r(h, collection);
+    GEOSGeom_destroy_r(h, collection);
+    if (!merged) return issues;
+
+    const int count = GEOSGetNumGeometries_r(h, merged);
+    for (int i = 0; i < count; ++i) {
+        const GEOSGeometry* part = GEOSGetGeometryN_r(h, merged, i);
+        if (GEOSGeomTypeId_r(h, part) != GEOS_POLYGON) continue;
+
+        const int holes = GEOSGetNumInteriorRings_r(h, part);
+        for (int r = 0; r < holes; ++r) {
+            QVector<QPointF> ring = ringPoints(h, GEOSGetInteriorRingN_r(h, part, r));
+            GEOSGeometry* hole = createPolygon(h, ring);
+            double area = 0.0;
+            if (hole && GEOSArea_r(h, hole, &area) && area > 0.0 && area <= maxArea) {
+                Issue issue;
+                issue.type = IssueType::Gap;
+                issue.area = area;
+                issue.reason = QString("Gap between polygons (area %1)").arg(area, 0, 'f', 3);
+                describeRegion(h, hole, issue);
+                issue.region = ring;
+                issues.append(issue);
+            }
+            if (hole) GEOSGeom_destroy_r(h, hole);
+        }
+    }
+
+    GEOSGeom_destroy_r(h, merged);
+    return issues;
+}
+
+QVector<Issue> validate(const QVector<CanvasPolyline>& polylines,
+                        const QVector<int>& indices,
+                        const Options& options,
+                        int* checked)
+{
+    QVector<PolygonCheck> checks;
+    checks.reserve(indices.size());
+    for (int idx : indices) {
+        if (idx < 0 || idx >= polylines.size() || !polylines[idx].closed) continue;
+        checks.append({idx, &polylines[idx].points});
+    }
+    if (checked) *checked = checks.size();
+
+    // Validity, one polygon per task on the global thread pool
+    QtConcurrent::blockingMap(checks, checkValidity);
+
+    QVector<Issue> issues;
+    QVector<PolygonCheck> valid;
+    valid.reserve(checks.size());
+    for (const auto& check : checks) {
+        if (check.valid) valid.append(check);
+        else issues.append(check.issue);
+    }
+
+    if (!options.checkTopology || valid.size() < 2) return issues;
+
+    // The union for gaps runs alongside the pairwise overlap tests
+    QFuture<QVector<Issue>> gaps = QtConcurrent::run(findGaps, valid, options.maxGapArea);
+
+    QVector<OverlapTask> tasks = overlapTasks(valid, options.minOverlapArea);
+    QtConcurrent::blockingMap(tasks, findOverlaps);
+    for (const auto& task : tasks) {
+        issues += task.issues;
+    }
+
+    issues += gaps.result();
+    return issues;
+}
+
+} // namespace GeometryValidator
@@ -1,5 +1,8 @@
 #include "gdal/geosbridge.h"
+#include "gdal/geoscontext.h"
 #include "dxf/dxfreader.h"
+#include "surface/delaunaytriangulator.h"
+#include "surface/volumeengine.h"
 
 #ifdef HAVE_GEOS
 #include <geos_c.h>
@@ -11,16 +14,11 @@
 #include <QtMath>
 #include <QLineF>
 
-// Static GEOS context
-#ifdef HAVE_GEOS
-static GEOSContextHandle_t s_geosContext = nullptr;
-#endif
-static QString s_lastError;
-
 // Error handlers
 #ifdef HAVE_GEOS
-static void geosErrorHandler(const char* message, void* /*userdata*/) {
-    s_lastError = QString::fromUtf8(message);
+static void geosErrorHandler(const char* message, void* userdata) {
+    // Each context reports into its own thread's ThreadContext
+    static_cast<GeosBridge::ThreadContext*>(userdata)->lastError = QString::fromUtf8(message);
     qDebug() << "GEOS Bridge Error:" << message;
 }
 #endif
@@ -32,30 +30,42 @@ static void geosNoticeHandler(const char* /*message*/, void* /*userdata*/) {
 
 namespace GeosBridge {
 
-void initialize()
+ThreadContext::ThreadContext()
 {
-    if (!s_geosContext) {
-        s_geosContext = GEOS_init_r();
-        if (s_geosContext) {
-            GEOSContext_setErrorMessageHandler_r(s_geosContext, geosErrorHandler, nullptr);
-            GEOSContext_setNoticeMessageHandler_r(s_geosContext, geosNoticeHandler, nullptr);
-        }
+    handle = GEOS_init_r();
+    if (handle) {
+        GEOSContext_setErrorMessageHandler_r(handle, geosErrorHandler, this);
+        GEOSContext_setNoticeMessageHandler_r(handle, geosNoticeHandler, nullptr);
     }
 }
 
-void cleanup()
+ThreadContext::~ThreadContext()
 {
-    if (s_geosContext) {
-        GEOS_finish_r(s_geosContext);
-        s_geosContext = nullptr;
+    if (handle) {
+        GEOS_finish_r(handle);
     }
 }
 
+ThreadContext& threadContext()
+{
+    thread_local ThreadContext context;
+    return context;
+}
+
+void initialize()
+{
+    threadContext();
+}
+
+void cleanup()
+{
+    // Contexts are thread_local and finished when their thread exits
+}
+
 // Helper class for RAII CPL Error Handling scope
 class ScopedCPLHandler {
 public:
     ScopedCPLHandler() {
-        initialize();
         CPLPushErrorHandler(CPLQuietErrorHandler);
     }
     ~ScopedCPLHandler() {
@@ -65,7 +75,7 @@ public:
 
 QString lastError()
 {
-    return s_lastError;
+    return threadContext().lastError;
 }
 
 // Helper: compute perpendicular offset of a line segment
@@ -131,22 +141,23 @@ static bool lineIntersection(const QPointF& a1, const QPointF& a2,
  */
 DxfPolyline createOffset(const DxfPolyline& input, double distance)
 {
+    ThreadContext& context = threadContext();
     DxfPolyline result;
     result.layer = input.layer;
     result.color = input.color;
     result.closed = input.closed;
     
-    s_lastError.clear();
+    context.lastError.clear();
     
     int n = input.points.size();
     if (n < 2) {
-        s_lastError = "Need at least 2 points";
+        context.lastError = "Need at least 2 points";
         return result;
     }
     
     // For closed polygons, we need at least 3 points
     if (input.closed && n < 3) {
-        s_lastError = "Closed polygon needs at least 3 points";
+        context.lastError = "Closed polygon needs at least 3 points";
         return result;
     }
     
@@ -197,9 +208,9 @@ DxfPolyline createOffset(const DxfPolyline& input, double distance)
 }
 
 // Helper: Create GEOS coordinate sequence from QPointF vector
-static GEOSCoordSequence* createCoordSeq(const QVector<QPointF>& points, bool closeRing)
+static GEOSCoordSequence* createCoordSeq(GEOSContextHandle_t handle, const QVector<QPointF>& points, bool closeRing)
 {
-    if (!s_geosContext || points.size() < 2) return nullptr;
+    if (!handle || points.size() < 2) return nullptr;
     
     int size = points.size();
     bool needsClosing = false;
@@ -217,7 +228,7 @@ static GEOSCoordSequence* createCoordSeq(const QVector<QPointF>& points, bool cl
         size += 1;  // Add closing point
     }
     
-    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(s_geosContext, size, 2);
+    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(handle, size, 2);
     if (!seq) return nullptr;
     
     for (int i = 0; i < points.size(); ++i) {
@@ -234,62 +245,231 @@ static GEOSCoordSequence* createCoordSeq(const QVector<QPointF>& points, bool cl
              }
         }
         
-        GEOSCoordSeq_setXY_r(s_geosContext, seq, i, x, y);
+        GEOSCoordSeq_setXY_r(handle, seq, i, x, y);
     }
     
     // Close the ring if needed (Append point)
     if (needsClosing) {
-        GEOSCoordSeq_setXY_r(s_geosContext, seq, size - 1, points.first().x(), points.first().y());
+        GEOSCoordSeq_setXY_r(handle, seq, size - 1, points.first().x(), points.first().y());
     }
     
     return seq;
 }
 
 // Helper: Create GEOS polygon from points
-static GEOSGeometry* createPolygon(const QVector<QPointF>& points)
+GEOSGeometry* createPolygon(GEOSContextHandle_t handle, const QVector<QPointF>& points)
 {
-    if (!s_geosContext || points.size() < 3) return nullptr;
+    if (!handle || points.size() < 3) return nullptr;
     
-    GEOSCoordSequence* seq = createCoordSeq(points, true);
+    GEOSCoordSequence* seq = createCoordSeq(handle, points, true);
     if (!seq) return nullptr;
     
-    GEOSGeometry* ring = GEOSGeom_createLinearRing_r(s_geosContext, seq);
+    GEOSGeometry* ring = GEOSGeom_createLinearRing_r(handle, seq);
     if (!ring) {
-        GEOSCoordSeq_destroy_r(s_geosContext, seq);
+        GEOSCoordSeq_destroy_r(handle, seq);
         return nullptr;
     }
     
-    GEOSGeometry* polygon = GEOSGeom_createPolygon_r(s_geosContext, ring, nullptr, 0);
+    GEOSGeometry* polygon = GEOSGeom_createPolygon_r(handle, ring, nullptr, 0);
     if (!polygon) {
-        GEOSGeom_destroy_r(s_geosContext, ring);
+        GEOSGeom_destroy_r(handle, ring);
     }
     
     return polygon;
 }
 
 // Helper: Create GEOS linestring from points
-static GEOSGeometry* createLineString(const QVector<QPointF>& points)
+GEOSGeometry* createLineString(GEOSContextHandle_t handle, const QVector<QPointF>& points)
 {
-    if (!s_geosContext || points.size() < 2) return nullptr;
+    if (!handle || points.size() < 2) return nullptr;
     
-    GEOSCoordSequence* seq = createCoordSeq(points, false);
+    GEOSCoordSequence* seq = createCoordSeq(handle, points, false);
     if (!seq) return nullptr;
     
-    GEOSGeometry* line = GEOSGeom_createLineString_r(s_geosContext, seq);
+    GEOSGeometry* line = GEOSGeom_createLineString_r(handle, seq);
     if (!line) {
-        GEOSCoordSeq_destroy_r(s_geosContext, seq);
+        GEOSCoordSeq_destroy_r(handle, seq);
     }
     
     return line;
 }
 
+// Helper: Create GEOS point
+GEOSGeometry* createPoint(GEOSContextHandle_t handle, const QPointF& point)
+{
+    if (!handle) return nullptr;
+    
+    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(handle, 1, 2);
+    if (!seq) return nullptr;
+    GEOSCoordSeq_setXY_r(handle, seq, 0, point.x(), point.y());
+    
+    GEOSGeometry* pointGeom = GEOSGeom_createPoint_r(handle, seq);
+    if (!pointGeom) {
+        GEOSCoordSeq_destroy_r(handle, seq);
+    }
+    return pointGeom;
+}
+
+QVector<QPointF> ringPoints(GEOSContextHandle_t handle, const GEOSGeometry* ring)
+{
+    QVector<QPointF> points;
+    const GEOSCoordSequence* seq = ring ? GEOSGeom_getCoordSeq_r(handle, ring) : nullptr;
+    unsigned int size = 0;
+    if (!seq || !GEOSCoordSeq_getSize_r(handle, seq, &size)) return points;
+    
+    points.reserve(size);
+    for (unsigned int i = 0; i < size; ++i) {
+        double x, y;
+        GEOSCoordSeq_getXY_r(handle, seq, i, &x, &y);
+        points.append(QPointF(x, y));
+    }
+    return points;
+}
+
+// Geometry handle
+
+struct Geometry::Data {
+    GEOSContextHandle_t handle{nullptr};
+    GEOSGeometry* geometry{nullptr};
+    const GEOSPreparedGeometry* prepared{nullptr};
+    
+    ~Data()
+    {
+        if (prepared) GEOSPreparedGeom_destroy_r(handle, prepared);
+        if (geometry) GEOSGeom_destroy_r(handle, geometry);
+    }
+};
+
+Geometry::Geometry() = default;
+Geometry::~Geometry() = default;
+Geometry::Geometry(Geometry&& other) noexcept = default;
+Geometry& Geometry::operator=(Geometry&& other) noexcept = default;
+
+static QRectF pointBounds(const QVector<QPointF>& points)
+{
+    if (points.isEmpty()) return QRectF();
+    double minX = points[0].x(), maxX = minX;
+    double minY = points[0].y(), maxY = minY;
+    for (const auto& p : points) {
+        minX = qMin(minX, p.x());
+        maxX = qMax(maxX, p.x());
+        minY = qMin(minY, p.y());
+        maxY = qMax(maxY, p.y());
+    }
+    return QRectF(QPointF(minX, minY), QPointF(maxX, maxY));
+}
+
+Geometry Geometry::polygon(const QVector<QPointF>& points)
+{
+    ThreadContext& context = threadContext();
+    context.lastError.clear();
+    Geometry result;
+    
+    if (points.size() < 3) {
+        result.m_error = "Need at least 3 points";
+        return result;
+    }
+    
+    GEOSGeometry* geometry = createPolygon(context.handle, points);
+    if (!geometry) {
+        result.m_error = context.lastError.isEmpty() ? QString("Failed to create polygon") : context.lastError;
+        return result;
+    }
+    
+    result.d.reset(new Data);
+    result.d->handle = context.handle;
+    result.d->geometry = geometry;
+    result.m_bounds = pointBounds(points);
+    return result;
+}
+
+Geometry Geometry::lineString(const QVector<QPointF>& points)
+{
+    ThreadContext& context = threadContext();
+    context.lastError.clear();
+    Geometry result;
+    
+    if (points.size() < 2) {
+        result.m_error = "Need at least 2 points";
+        return result;
+    }
+    
+    GEOSGeometry* geometry = createLineString(context.handle, points);
+    if (!geometry) {
+        result.m_error = context.lastError.isEmpty() ? QString("Failed to create line string") : context.lastError;
+        return result;
+    }
+    
+    result.d.reset(new Data);
+    result.d->handle = context.handle;
+    result.d->geometry = geometry;
+    result.m_bounds = pointBounds(points);
+    return result;
+}
+
+bool Geometry::prepare()
+{
+    if (!d) return false;
+    if (!d->prepared) {
+        d->prepared = GEOSPrepare_r(d->handle, d->geometry);
+        if (!d->prepared) {
+            m_error = threadContext().lastError;
+        }
+    }
+    return d->prepared != nullptr;
+}
+
+bool Geometry::isPrepared() const
+{
+    return d && d->prepared;
+}
+
+bool Geometry::contains(const QPointF& point) const
+{
+    // Most points of a large survey fall outside a boundary's envelope
+    if (!d || !m_bounds.contains(point)) return false;
+    
+    GEOSGeometry* pointGeom = createPoint(d->handle, point);
+    if (!pointGeom) return false;
+    
+    char result = d->prepared ? GEOSPreparedContains_r(d->handle, d->prepared, pointGeom)
+                              : GEOSContains_r(d->handle, d->geometry, pointGeom);
+    GEOSGeom_destroy_r(d->handle, pointGeom);
+    
+    return result == 1;
+}
+
+bool Geometry::intersects(const Geometry& other) const
+{
+    if (!d || !other.d) return false;
+    
+    // Inclusive envelope test (QRectF::intersects rejects zero-width lines)
+    if (m_bounds.right() < other.m_bounds.left() || other.m_bounds.right() < m_bounds.left()
+        || m_bounds.bottom() < other.m_bounds.top() || other.m_bounds.bottom() < m_bounds.top()) {
+        return false;
+    }
+    
+    char result = d->prepared ? GEOSPreparedIntersects_r(d->handle, d->prepared, other.d->geometry)
+                              : GEOSIntersects_r(d->handle, d->geometry, other.d->geometry);
+    return result == 1;
+}
+
+double Geometry::area() const
+{
+    double area = 0.0;
+    if (d) {
+        GEOSArea_r(d->handle, d->geometry, &area);
+    }
+    return area;
+}
+
 double calculateArea(const QVector<QPointF>& points)
 {
-    ScopedCPLHandler handler;
-    s_lastError.clear();
+    ThreadContext& context = threadContext();
+    context.lastError.clear();
     
     if (points.size() < 3) {
-        s_lastError = "Need at least 3 points for area calculation";
+        context.lastError = "Need at least 3 points for area calculation";
         return 0.0;
     }
     
@@ -308,10 +488,11 @@ double calculateArea(const QVector<QPointF>& points)
 
 double calculatePerimeter(const QVector<QPointF>& points, bool closed)
 {
-    s_lastError.clear();
+    ThreadContext& context = threadContext();
+    context.lastError.clear();
     
     if (points.size() < 2) {
-        s_lastError = "Need at least 2 points for perimeter calculation";
+        context.lastError = "Need at least 2 points for perimeter calculation";
         return 0.0;
     }
     
@@ -329,117 +510,145 @@ double calculatePerimeter(const QVector<QPointF>& points, bool closed)
     return perimeter;
 }
 
-bool isValid(const QVector<QPointF>& points)
+Validity checkValidity(const QVector<QPointF>& points)
 {
+    ThreadContext& context = threadContext();
+    GEOSContextHandle_t h = context.handle;
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    context.lastError.clear();
+    Validity result;
     
     if (points.size() < 3) {
-        s_lastError = "Need at least 3 points";
-        return false;
+        result.reason = "Need at least 3 points";
+        return result;
     }
     
-    GEOSGeometry* polygon = createPolygon(points);
+    GEOSGeometry* polygon = createPolygon(h, points);
     if (!polygon) {
-        s_lastError = "Failed to create polygon for validation";
-        return false;
+        // GEOS reports why the ring was rejected (e.g. too few distinct points)
+        result.reason = context.lastError.isEmpty() ? QString("Failed to create polygon for validation")
+                                                    : context.lastError;
+        return result;
     }
     
-    char valid = GEOSisValid_r(s_geosContext, polygon);
+    char* reason = nullptr;
+    GEOSGeometry* location = nullptr;
+    char valid = GEOSisValidDetail_r(h, polygon, 0, &reason, &location);
     
-    if (valid == 0) {
-        // Get the reason for invalidity
-        char* reason = GEOSisValidReason_r(s_geosContext, polygon);
-        if (reason) {
-            s_lastError = QString::fromUtf8(reason);
-            GEOSFree_r(s_geosContext, reason);
+    if (valid == 1) {
+        result.valid = true;
+    } else if (valid == 0) {
+        result.reason = reason ? QString::fromUtf8(reason) : QString("Invalid geometry");
+        double x, y;
+        if (location && GEOSGeomGetX_r(h, location, &x) && GEOSGeomGetY_r(h, location, &y)) {
+            result.location = QPointF(x, y);
+            result.hasLocation = true;
         }
+    } else {
+        result.reason = context.lastError.isEmpty() ? QString("Validation failed") : context.lastError;
     }
     
-    GEOSGeom_destroy_r(s_geosContext, polygon);
+    if (reason) GEOSFree_r(h, reason);
+    if (location) GEOSGeom_destroy_r(h, location);
+    GEOSGeom_destroy_r(h, polygon);
     
-    return valid == 1;
+    return result;
+}
+
+bool isValid(const QVector<QPointF>& points)
+{
+    Validity validity = checkValidity(points);
+    if (!validity.valid) {
+        threadContext().lastError = validity.reason;
+    }
+    return validity.valid;
 }
 
 bool polygonsOverlap(const QVector<QPointF>& poly1, const QVector<QPointF>& poly2)
 {
+    ThreadContext& context = threadContext();
+    GEOSContextHandle_t h = context.handle;
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    context.lastError.clear();
     
     if (poly1.size() < 3 || poly2.size() < 3) {
-        s_lastError = "Both polygons need at least 3 points";
+        context.lastError = "Both polygons need at least 3 points";
         return false;
     }
     
-    GEOSGeometry* geom1 = createPolygon(poly1);
-    GEOSGeometry* geom2 = createPolygon(poly2);
+    GEOSGeometry* geom1 = createPolygon(h, poly1);
+    GEOSGeometry* geom2 = createPolygon(h, poly2);
     
     if (!geom1 || !geom2) {
-        if (geom1) GEOSGeom_destroy_r(s_geosContext, geom1);
-        if (geom2) GEOSGeom_destroy_r(s_geosContext, geom2);
-        s_lastError = "Failed to create polygons for overlap check";
+        if (geom1) GEOSGeom_destroy_r(h, geom1);
+        if (geom2) GEOSGeom_destroy_r(h, geom2);
+        context.lastError = "Failed to create polygons for overlap check";
         return false;
     }
     
-    char result = GEOSIntersects_r(s_geosContext, geom1, geom2);
+    char result = GEOSIntersects_r(h, geom1, geom2);
     
-    GEOSGeom_destroy_r(s_geosContext, geom1);
-    GEOSGeom_destroy_r(s_geosContext, geom2);
+    GEOSGeom_destroy_r(h, geom1);
+    GEOSGeom_destroy_r(h, geom2);
     
     return result == 1;
 }
 
 QVector<QPointF> createBuffer(const QVector<QPointF>& points, double distance, bool closed)
 {
+    ThreadContext& context = threadContext();
+    GEOSContextHandle_t h = context.handle;
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    context.lastError.clear();
     QVector<QPointF> result;
     
     if (points.size() < 2) {
-        s_lastError = "Need at least 2 points for buffer";
+        context.lastError = "Need at least 2 points for buffer";
         return result;
     }
     
-    GEOSGeometry* inputGeom = closed ? createPolygon(points) : createLineString(points);
+    GEOSGeometry* inputGeom = closed ? createPolygon(h, points) : createLineString(h, points);
     if (!inputGeom) {
-        s_lastError = "Failed to create input geometry for buffer";
+        context.lastError = "Failed to create input geometry for buffer";
         return result;
     }
     
     // Create buffer with 8 quadrant segments for smooth curves
-    GEOSGeometry* bufferGeom = GEOSBuffer_r(s_geosContext, inputGeom, distance, 8);
-    GEOSGeom_destroy_r(s_geosContext, inputGeom);
+    GEOSGeometry* bufferGeom = GEOSBuffer_r(h, inputGeom, distance, 8);
+    GEOSGeom_destroy_r(h, inputGeom);
     
     if (!bufferGeom) {
-        s_lastError = "Buffer operation failed";
+        context.lastError = "Buffer operation failed";
         return result;
     }
     
     // Extract exterior ring from buffer polygon
-    const GEOSGeometry* extRing = GEOSGetExteriorRing_r(s_geosContext, bufferGeom);
+    const GEOSGeometry* extRing = GEOSGetExteriorRing_r(h, bufferGeom);
     if (extRing) {
-        const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq_r(s_geosContext, extRing);
+        const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq_r(h, extRing);
         if (seq) {
             unsigned int size;
-            GEOSCoordSeq_getSize_r(s_geosContext, seq, &size);
+            GEOSCoordSeq_getSize_r(h, seq, &size);
             
             for (unsigned int i = 0; i < size; ++i) {
                 double x, y;
-                GEOSCoordSeq_getXY_r(s_geosContext, seq, i, &x, &y);
+                GEOSCoordSeq_getXY_r(h, seq, i, &x, &y);
                 result.append(QPointF(x, y));
             }
         }
     }
     
-    GEOSGeom_destroy_r(s_geosContext, bufferGeom);
+    GEOSGeom_destroy_r(h, bufferGeom);
     
     return result;
 }
 
 QPointF calculateCentroid(const QVector<QPointF>& points)
 {
+    ThreadContext& context = threadContext();
+    GEOSContextHandle_t h = context.handle;
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    context.lastError.clear();
     
     if (points.size() < 3) {
         // For less than 3 points, return average
@@ -452,59 +661,61 @@ QPointF calculateCentroid(const QVector<QPointF>& points)
         return QPointF(sumX / points.size(), sumY / points.size());
     }
     
-    GEOSGeometry* polygon = createPolygon(points);
+    GEOSGeometry* polygon = createPolygon(h, points);
     if (!polygon) {
-        s_lastError = "Failed to create polygon for centroid";
+        context.lastError = "Failed to create polygon for centroid";
         return QPointF(0, 0);
     }
     
-    GEOSGeometry* centroid = GEOSGetCentroid_r(s_geosContext, polygon);
-    GEOSGeom_destroy_r(s_geosContext, polygon);
+    GEOSGeometry* centroid = GEOSGetCentroid_r(h, polygon);
+    GEOSGeom_destroy_r(h, polygon);
     
     if (!centroid) {
-        s_lastError = "Centroid calculation failed";
+        context.lastError = "Centroid calculation failed";
         return QPointF(0, 0);
     }
     
     double x, y;
-    GEOSGeomGetX_r(s_geosContext, centroid, &x);
-    GEOSGeomGetY_r(s_geosContext, centroid, &y);
-    GEOSGeom_destroy_r(s_geosContext, centroid);
+    GEOSGeomGetX_r(h, centroid, &x);
+    GEOSGeomGetY_r(h, centroid, &y);
+    GEOSGeom_destroy_r(h, centroid);
     
     return QPointF(x, y);
 }
 
 QVector<QPointF> makeValid(const QVector<QPointF>& points)
 {
+    ThreadContext& context = threadContext();
+    GEOSContextHandle_t h = context.handle;
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    context.lastError.clear();
     QVector<QPointF> result;
     
     if (points.size() < 3) {
-        s_lastError = "Need at least 3 points";
+        context.lastError = "Need at least 3 points";
         return result;
     }
     
-    GEOSGeometry* polygon = createPolygon(points);
+    GEOSGeometry* polygon = createPolygon(h, points);
     if (!polygon) {
-        s_lastError = "Failed to create polygon for repair";
+        context.lastError = "Failed to create polygon for repair";
         return result;
     }
     
     // Check if already valid
-    char valid = GEOSisValid_r(s_geosContext, polygon);
+    char valid = GEOSisValid_r(h, polygon);
     if (valid == 1) {
         // Already valid, return original points
-        GEOSGeom_destroy_r(s_geosContext, polygon);
+        GEOSGeom_destroy_r(h, polygon);
         return points;
     }
     
     // Try to repair
-    GEOSGeometry* validGeom = GEOSMakeValid_r(s_geosContext, polygon);
-    GEOSGeom_destroy_r(s_geosContext, polygon);
+    GEOSGeometry* validGeom = GEOSMakeValid_r(h, polygon);
+    GEOSGeom_destroy_r(h, polygon);
     
     if (!validGeom) {
-        s_lastError = "MakeValid failed to repair geometry";
+        context.lastError = "MakeValid failed to repair geometry";
         return result;
     }
     
@@ -512,19 +723,19 @@ QVector<QPointF> makeValid(const QVector<QPointF>& points)
     // MakeValid may return a different geometry type (e.g., MultiPolygon)
     // We'll try to extract the largest polygon
     GEOSGeometry* targetGeom = validGeom;
-    int geomType = GEOSGeomTypeId_r(s_geosContext, validGeom);
+    int geomType = GEOSGeomTypeId_r(h, validGeom);
     
     if (geomType == GEOS_MULTIPOLYGON || geomType == GEOS_GEOMETRYCOLLECTION) {
         // Find the largest polygon by area
-        int numGeoms = GEOSGetNumGeometries_r(s_geosContext, validGeom);
+        int numGeoms = GEOSGetNumGeometries_r(h, validGeom);
         double maxArea = 0;
         const GEOSGeometry* largest = nullptr;
         
         for (int i = 0; i < numGeoms; ++i) {
-            const GEOSGeometry* part = GEOSGetGeometryN_r(s_geosContext, validGeom, i);
-            if (GEOSGeomTypeId_r(s_geosContext, part) == GEOS_POLYGON) {
+            const GEOSGeometry* part = GEOSGetGeometryN_r(h, validGeom, i);
+            if (GEOSGeomTypeId_r(h, part) == GEOS_POLYGON) {
                 double area = 0;
-                GEOSArea_r(s_geosContext, part, &area);
+                GEOSArea_r(h, part, &area);
                 if (area > maxArea) {
                     maxArea = area;
                     largest = part;
@@ -538,27 +749,27 @@ QVector<QPointF> makeValid(const QVector<QPointF>& points)
     }
     
     // Get exterior ring
-    if (GEOSGeomTypeId_r(s_geosContext, targetGeom) == GEOS_POLYGON) {
-        const GEOSGeometry* ring = GEOSGetExteriorRing_r(s_geosContext, targetGeom);
+    if (GEOSGeomTypeId_r(h, targetGeom) == GEOS_POLYGON) {
+        const GEOSGeometry* ring = GEOSGetExteriorRing_r(h, targetGeom);
         if (ring) {
-            const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq_r(s_geosContext, ring);
+            const GEOSCoordSequence* seq = GEOSGeom_getCoordSeq_r(h, ring);
             if (seq) {
                 unsigned int size;
-                GEOSCoordSeq_getSize_r(s_geosContext, seq, &size);
+                GEOSCoordSeq_getSize_r(h, seq, &size);
                 
                 for (unsigned int i = 0; i < size; ++i) {
                     double x, y;
-                    GEOSCoordSeq_getXY_r(s_geosContext, seq, i, &x, &y);
+                    GEOSCoordSeq_getXY_r(h, seq, i, &x, &y);
                     result.append(QPointF(x, y));
                 }
             }
         }
     }
     
-    GEOSGeom_destroy_r(s_geosContext, validGeom);
+    GEOSGeom_destroy_r(h, validGeom);
     
     if (result.isEmpty()) {
-        s_lastError = "Could not extract vertices from repaired geometry";
+        context.lastError = "Could not extract vertices from repaired geometry";
     }
     
     return result;
@@ -567,118 +778,35 @@ QVector<QPointF> makeValid(const QVector<QPointF>& points)
 bool pointInPolygon(const QPointF& point, const QVector<QPointF>& polygon)
 {
     ScopedCPLHandler handler;
-    s_lastError.clear();
+    threadContext().lastError.clear();
     
     if (polygon.size() < 3) {
         return false;
     }
     
-    GEOSGeometry* polyGeom = createPolygon(polygon);
-    if (!polyGeom) {
-        return false;
-    }
-    
-    // Create point geometry
-    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(s_geosContext, 1, 2);
-    GEOSCoordSeq_setXY_r(s_geosContext, seq, 0, point.x(), point.y());
-    GEOSGeometry* pointGeom = GEOSGeom_createPoint_r(s_geosContext, seq);
-    
-    if (!pointGeom) {
-        GEOSGeom_destroy_r(s_geosContext, polyGeom);
-        return false;
-    }
-    
-    char result = GEOSContains_r(s_geosContext, polyGeom, pointGeom);
-    
-    GEOSGeom_destroy_r(s_geosContext, pointGeom);
-    GEOSGeom_destroy_r(s_geosContext, polyGeom);
-    
-    return result == 1;
+    return Geometry::polygon(polygon).contains(point);
 }
 
 QVector<QVector<int>> delaunayTriangulate(const QVector<QPointF>& points)
 {
-    ScopedCPLHandler handler;
-    s_lastError.clear();
+    ThreadContext& context = threadContext();
+    context.lastError.clear();
     QVector<QVector<int>> triangles;
     
-    if (points.size() < 3) {
-        s_lastError = "Need at least 3 points for triangulation";
-        return triangles;
-    }
-    
-    // Create multipoint geometry from input points
-    GEOSCoordSequence* seq = GEOSCoordSeq_create_r(s_geosContext, points.size(), 2);
-    for (int i = 0; i < points.size(); ++i) {
-        GEOSCoordSeq_setXY_r(s_geosContext, seq, i, points[i].x(), points[i].y());
-    }
-    
-    // Create points as a collection
-    QVector<GEOSGeometry*> pointGeoms;
-    for (int i = 0; i < points.size(); ++i) {
-        GEOSCoordSequence* pSeq = GEOSCoordSeq_create_r(s_geosContext, 1, 2);
-        GEOSCoordSeq_setXY_r(s_geosContext, pSeq, 0, points[i].x(), points[i].y());
-        GEOSGeometry* pt = GEOSGeom_createPoint_r(s_geosContext, pSeq);
-        if (pt) pointGeoms.append(pt);
-    }
-    
-    GEOSGeometry* multiPoint = GEOSGeom_createCollection_r(s_geosContext, GEOS_MULTIPOINT,
-                                                           pointGeoms.data(), pointGeoms.size());
-    
-    if (!multiPoint) {
-        for (auto* g : pointGeoms) GEOSGeom_destroy_r(s_geosContext, g);
-        s_lastError = "Failed to create multipoint";
-        return triangles;
-    }
-    
-    // Create Delaunay triangulation
-    GEOSGeometry* delaunay = GEOSDelaunayTriangulation_r(s_geosContext, multiPoint, 0.0, 0);
-    GEOSGeom_destroy_r(s_geosContext, multiPoint);
-    
-    if (!delaunay) {
-        s_lastError = "Delaunay triangulation failed";
+    // Native sweep-hull triangulation keeps the input indices, so there is
+    // no coordinate matching back to the points
+    DelaunayTriangulator triangulator;
+    if (!triangulator.triangulate(points)) {
+        context.lastError = triangulator.lastError();
         return triangles;
     }
     
-    // Extract triangles - result is a GeometryCollection of polygons
-    int numTriangles = GEOSGetNumGeometries_r(s_geosContext, delaunay);
-    
-    for (int i = 0; i < numTriangles; ++i) {
-        const GEOSGeometry* tri = GEOSGetGeometryN_r(s_geosContext, delaunay, i);
-        if (!tri) continue;
-        
-        const GEOSGeometry* ring = GEOSGetExteriorRing_r(s_geosContext, tri);
-        if (!ring) continue;
-        
-        const GEOSCoordSequence* triSeq = GEOSGeom_getCoordSeq_r(s_geosContext, ring);
-        if (!triSeq) continue;
-        
-        unsigned int size;
-        GEOSCoordSeq_getSize_r(s_geosContext, triSeq, &size);
-        
-        if (size >= 4) { // Triangle + closing point
-            QVector<int> triIndices;
-            for (unsigned int j = 0; j < 3; ++j) {
-                double x, y;
-                GEOSCoordSeq_getXY_r(s_geosContext, triSeq, j, &x, &y);
-                
-                // Find matching input point
-                for (int k = 0; k < points.size(); ++k) {
-                    if (qAbs(points[k].x() - x) < 1e-9 && qAbs(points[k].y() - y) < 1e-9) {
-                        triIndices.append(k);
-                        break;
-                    }
-                }
-            }
-            
-            if (triIndices.size() == 3) {
-                triangles.append(triIndices);
-            }
-        }
+    const QVector<int>& indices = triangulator.triangles();
+    triangles.reserve(indices.size() / 3);
+    for (int t = 0; t < indices.size(); t += 3) {
+        triangles.append(QVector<int>{indices[t], indices[t + 1], indices[t + 2]});
     }
     
-    GEOSGeom_destroy_r(s_geosContext, delaunay);
-    
     return triangles;
 }
 
@@ -686,14 +814,12 @@ QPair<double, double> calculateVolume(const QVector<Point3D>& surfacePoints,
                                        double designLevel,
                                        const QVector<QPointF>& boundary)
 {
+    ThreadContext& context = threadContext();
     ScopedCPLHandler handler;
-    s_lastError.clear();
-    
-    double cutVolume = 0.0;
-    double fillVolume = 0.0;
+    context.lastError.clear();
     
     if (surfacePoints.size() < 3) {
-        s_lastError = "Need at least 3 points for volume calculation";
+        context.lastError = "Need at least 3 points for volume calculation";
         return qMakePair(0.0, 0.0);
     }
     
@@ -704,61 +830,18 @@ QPair<double, double> calculateVolume(const QVector<Point3D>& surfacePoints,
     }
     
     // Triangulate
-    QVector<QVector<int>> triangles = delaunayTriangulate(points2D);
-    
-    if (triangles.isEmpty()) {
-        s_lastError = "Triangulation produced no triangles";
+    DelaunayTriangulator triangulator;
+    if (!triangulator.triangulate(points2D)) {
+        context.lastError = triangulator.lastError();
         return qMakePair(0.0, 0.0);
     }
     
-    // Calculate volume for each triangle
-    for (const auto& tri : triangles) {
-        if (tri.size() != 3) continue;
-        
-        int i0 = tri[0];
-        int i1 = tri[1];
-        int i2 = tri[2];
-        
-        if (i0 >= surfacePoints.size() || i1 >= surfacePoints.size() || i2 >= surfacePoints.size()) {
-            continue;
-        }
-        
-        const Point3D& p0 = surfacePoints[i0];
-        const Point3D& p1 = surfacePoints[i1];
-        const Point3D& p2 = surfacePoints[i2];
-        
-        // Calculate triangle centroid for boundary check
-        QPointF centroid((p0.x + p1.x + p2.x) / 3.0, (p0.y + p1.y + p2.y) / 3.0);
-        
-        // If boundary specified, check if triangle centroid is inside
-        if (!boundary.isEmpty()) {
-            if (!pointInPolygon(centroid, boundary)) {
-                continue;
-            }
-        }
-        
-        // Calculate triangle area using Shoelace formula
-        double area = qAbs((p0.x * (p1.y - p2.y) + p1.x * (p2.y - p0.y) + p2.x * (p0.y - p1.y)) / 2.0);
-        
-        // Average elevation of triangle
-        double avgZ = (p0.z + p1.z + p2.z) / 3.0;
-        
-        // Height difference from design level
-        double dz = avgZ - designLevel;
-        
-        // Volume of triangular prism
-        double volume = area * qAbs(dz);
-        
-        if (dz > 0) {
-            // Surface is above design level = CUT needed
-            cutVolume += volume;
-        } else if (dz < 0) {
-            // Surface is below design level = FILL needed
-            fillVolume += volume;
-        }
-    }
+    // The boundary is indexed once; triangles crossing it are clipped exactly
+    VolumeEngine engine;
+    engine.setBoundary(boundary);
+    VolumeEngine::Result result = engine.computeAgainstLevel(surfacePoints, triangulator.triangles(), designLevel);
     
-    return qMakePair(cutVolume, fillVolume);
+    return qMakePair(result.cut, result.fill);
 }
 
 } // namespace GeosBridge
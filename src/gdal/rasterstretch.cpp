@@ -0,0 +1,70 @@
+#include "gdal/rasterstretch.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTERSTRETCH_SSE2
+#endif
+
+namespace RasterStretch {
+
+void setRange(Params& params, int lane, double minValue, double maxValue)
+{
+    params.offset[lane] = static_cast<float>(minValue);
+    params.scale[lane] = (maxValue > minValue) ? static_cast<float>(255.0 / (maxValue - minValue)) : 0.0f;
+}
+
+Params uniform(double minValue, double maxValue)
+{
+    Params params;
+    for (int lane = 0; lane < 4; ++lane) {
+        setRange(params, lane, minValue, maxValue);
+    }
+    return params;
+}
+
+static inline uchar stretchSample(float value, float offset, float scale)
+{
+    float v = (value - offset) * scale;
+    if (!(v > 0.0f)) return 0;  // Also catches NaN
+    if (v >= 255.0f) return 255;
+    return static_cast<uchar>(std::lrint(v));
+}
+
+void stretchToByte(const float* src, uchar* dst, int count, const Params& params)
+{
+    int i = 0;
+
+#ifdef RASTERSTRETCH_SSE2
+    // 16 samples per iteration; lane pattern repeats every 4 so one register
+    // of offsets/scales serves all four loads
+    const __m128 offset = _mm_loadu_ps(params.offset);
+    const __m128 scale = _mm_loadu_ps(params.scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 top = _mm_set1_ps(255.0f);
+
+    for (; i + 16 <= count; i += 16) {
+        __m128 v0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i), offset), scale);
+        __m128 v1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i + 4), offset), scale);
+        __m128 v2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i + 8), offset), scale);
+        __m128 v3 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i + 12), offset), scale);
+
+        // max(v, 0) returns 0 for NaN, then clamp before converting
+        v0 = _mm_min_ps(_mm_max_ps(v0, zero), top);
+        v1 = _mm_min_ps(_mm_max_ps(v1, zero), top);
+        v2 = _mm_min_ps(_mm_max_ps(v2, zero), top);
+        v3 = _mm_min_ps(_mm_max_ps(v3, zero), top);
+
+        __m128i lo = _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+        __m128i hi = _mm_packs_epi32(_mm_cvtps_epi32(v2), _mm_cvtps_epi32(v3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        int lane = i & 3;
+        dst[i] = stretchSample(src[i], params.offset[lane], params.scale[lane]);
+    }
+}
+
+} // namespace RasterStretch
@@ -0,0 +1,945 @@
+#include "surface/constrainedtin.h"
+#include "surface/delaunaytriangulator.h"
+#include "canvas/canvaswidget.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+using GeosBridge::Point3D;
+
+static inline int nextEdge(int e) { return e % 3 == 2 ? e - 2 : e + 1; }
+static inline int previousEdge(int e) { return e % 3 == 0 ? e + 2 : e - 1; }
+
+ConstrainedTin::ConstrainedTin()
+{
+}
+
+void ConstrainedTin::clear()
+{
+    m_points.clear();
+    m_triangles.clear();
+    m_halfedges.clear();
+    m_constrained.clear();
+    m_vertexEdge.clear();
+    m_freeTriangles.clear();
+    m_changed.clear();
+    m_boundary.setRing(QVector<QPointF>());
+    m_hint = 0;
+    m_skipped = 0;
+}
+
+bool ConstrainedTin::build(const QVector<Point3D>& points)
+{
+    clear();
+    m_lastError.clear();
+
+    QVector<QPointF> points2D;
+    points2D.reserve(points.size());
+    for (const auto& p : points) {
+        points2D.append(QPointF(p.x, p.y));
+    }
+
+    DelaunayTriangulator triangulator;
+    triangulator.setTolerance(m_tolerance);
+    if (!triangulator.triangulate(points2D)) {
+        m_lastError = triangulator.lastError();
+        return false;
+    }
+
+    m_points = points;
+    m_skipped = triangulator.skippedCount();
+    m_triangles = triangulator.triangles();
+    m_halfedges = triangulator.halfedges();
+    m_constrained.fill(0, m_triangles.size());
+    m_vertexEdge.fill(-1, m_points.size());
+    for (int e = 0; e < m_triangles.size(); ++e) {
+        m_vertexEdge[m_triangles[e]] = e;
+    }
+    return true;
+}
+
+double ConstrainedTin::orient(int a, int b, const QPointF& p) const
+{
+    const Point3D& pa = m_points[a];
+    const Point3D& pb = m_points[b];
+    return (pb.x - pa.x) * (p.y() - pa.y) - (pb.y - pa.y) * (p.x() - pa.x);
+}
+
+// True when d lies inside the circumcircle of the counter-clockwise a, b, c
+bool ConstrainedTin::inCircle(int a, int b, int c, int d) const
+{
+    const Point3D& pd = m_points[d];
+    const double ax = m_points[a].x - pd.x, ay = m_points[a].y - pd.y;
+    const double bx = m_points[b].x - pd.x, by = m_points[b].y - pd.y;
+    const double cx = m_points[c].x - pd.x, cy = m_points[c].y - pd.y;
+    const double det = (ax * ax + ay * ay) * (bx * cy - cx * by)
+                     - (bx * bx + by * by) * (ax * cy - cx * ay)
+                     + (cx * cx + cy * cy) * (ax * by - bx * ay);
+    return det > 0.0;
+}
+
+int ConstrainedTin::newTriangle()
+{
+    if (!m_freeTriangles.isEmpty()) {
+        int t = m_freeTriangles.last();
+        m_freeTriangles.removeLast();
+        return t;
+    }
+    const int t = m_triangles.size() / 3;
+    m_triangles.resize(m_triangles.size() + 3);
+    m_halfedges.resize(m_halfedges.size() + 3);
+    m_constrained.resize(m_constrained.size() + 3);
+    return t;
+}
+
+void ConstrainedTin::setTriangle(int t, int a, int b, int c)
+{
+    const int e = 3 * t;
+    m_triangles[e] = a;
+    m_triangles[e + 1] = b;
+    m_triangles[e + 2] = c;
+    m_changed.append(t);
+    for (int i = 0; i < 3; ++i) {
+        m_halfedges[e + i] = -1;
+        m_constrained[e + i] = 0;
+    }
+    m_vertexEdge[a] = e;
+    m_vertexEdge[b] = e + 1;
+    m_vertexEdge[c] = e + 2;
+}
+
+void ConstrainedTin::link(int a, int b)
+{
+    if (a != -1) {
+        m_halfedges[a] = b;
+        m_changed.append(a / 3);
+    }
+    if (b != -1) {
+        m_halfedges[b] = a;
+        m_changed.append(b / 3);
+    }
+}
+
+void ConstrainedTin::freeTriangle(int t)
+{
+    for (int i = 0; i < 3; ++i) {
+        m_triangles[3 * t + i] = -1;
+        m_halfedges[3 * t + i] = -1;
+        m_constrained[3 * t + i] = 0;
+    }
+    m_freeTriangles.append(t);
+    m_changed.append(t);
+}
+
+int ConstrainedTin::appendVertex(const Point3D& point)
+{
+    m_points.append(point);
+    m_vertexEdge.append(-1);
+    return m_points.size() - 1;
+}
+
+// Replace the diagonal of the quad around edge a by the other diagonal
+void ConstrainedTin::flip(int a)
+{
+    const int b = m_halfedges[a];
+    const int a0 = a - a % 3;
+    const int b0 = b - b % 3;
+    const int al = a0 + (a + 1) % 3;
+    const int ar = a0 + (a + 2) % 3;
+    const int bl = b0 + (b + 2) % 3;
+    const int br = b0 + (b + 1) % 3;
+
+    const int p0 = m_triangles[ar];
+    const int p1 = m_triangles[bl];
+    m_triangles[a] = p1;
+    m_triangles[b] = p0;
+
+    const int hbl = m_halfedges[bl];
+    const int har = m_halfedges[ar];
+    const char cbl = m_constrained[bl];
+    const char car = m_constrained[ar];
+    link(a, hbl);
+    link(b, har);
+    link(ar, bl);
+    m_constrained[a] = cbl;
+    m_constrained[b] = car;
+    m_constrained[ar] = 0;
+    m_constrained[bl] = 0;
+    m_changed.append(a / 3);
+    m_changed.append(b / 3);
+
+    for (int e : {a, al, ar, b, br, bl}) {
+        m_vertexEdge[m_triangles[e]] = e;
+    }
+}
+
+// Lawson flips from edges opposite a new vertex (the vertex is the third
+// corner of each edge's triangle)
+void ConstrainedTin::legalize(QVector<int>& edges)
+{
+    while (!edges.isEmpty()) {
+        const int e = edges.last();
+        edges.removeLast();
+
+        const int f = m_halfedges[e];
+        if (f == -1 || m_constrained[e]) continue;
+
+        const int x = m_triangles[e];
+        const int y = m_triangles[nextEdge(e)];
+        const int v = m_triangles[previousEdge(e)];
+        const int q = m_triangles[previousEdge(f)];
+        if (!inCircle(x, y, v, q)) continue;
+
+        flip(e);
+        edges.append(e);
+        edges.append(f - f % 3 + (f + 1) % 3);
+    }
+}
+
+ConstrainedTin::Location ConstrainedTin::locate(const QPointF& point, int& result) const
+{
+    const int slotCount = m_triangles.size() / 3;
+    if (slotCount == 0) return Location::Failed;
+
+    int t = (m_hint >= 0 && m_hint < slotCount && m_triangles[3 * m_hint] >= 0) ? m_hint : -1;
+    for (int i = 0; t < 0 && i < slotCount; ++i) {
+        if (m_triangles[3 * i] >= 0) t = i;
+    }
+    if (t < 0) return Location::Failed;
+
+    // Walk towards the point; rotating the first edge tested stops the
+    // walk from cycling on degenerate configurations
+    const int maxSteps = slotCount + 16;
+    for (int step = 0; step < maxSteps; ++step) {
+        int exit = -1;
+        for (int i = 0; i < 3; ++i) {
+            const int e = 3 * t + (i + step) % 3;
+            const int a = m_triangles[e];
+            const int b = m_triangles[nextEdge(e)];
+            const double length = std::hypot(m_points[b].x - m_points[a].x, m_points[b].y - m_points[a].y);
+            if (orient(a, b, point) < -m_tolerance * length) {
+                exit = e;
+                break;
+            }
+        }
+
+        if (exit >= 0) {
+            if (m_halfedges[exit] == -1) {
+                m_hint = t;
+                result = exit;
+                return Location::Outside;
+            }
+            t = m_halfedges[exit] / 3;
+            continue;
+        }
+
+        m_hint = t;
+        for (int i = 0; i < 3; ++i) {
+            const int v = m_triangles[3 * t + i];
+            if (qAbs(m_points[v].x - point.x()) <= m_tolerance && qAbs(m_points[v].y - point.y()) <= m_tolerance) {
+                result = v;
+                return Location::OnVertex;
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            const int e = 3 * t + i;
+            const int a = m_triangles[e];
+            const int b = m_triangles[nextEdge(e)];
+            const double length = std::hypot(m_points[b].x - m_points[a].x, m_points[b].y - m_points[a].y);
+            if (orient(a, b, point) <= m_tolerance * length) {
+                result = e;
+                return Location::OnEdge;
+            }
+        }
+        result = t;
+        return Location::Inside;
+    }
+    return Location::Failed;
+}
+
+int ConstrainedTin::insertPoint(const Point3D& point)
+{
+    int where = -1;
+    const Location location = locate(QPointF(point.x, point.y), where);
+    if (location == Location::Failed) return -1;
+    if (location == Location::OnVertex) return where;
+
+    const int vertex = appendVertex(point);
+    attachAt(location, where, vertex);
+    return vertex;
+}
+
+int ConstrainedTin::addVertex(const Point3D& point)
+{
+    const int vertex = appendVertex(point);
+    attachVertex(vertex);
+    return vertex;
+}
+
+bool ConstrainedTin::attachVertex(int vertex)
+{
+    int where = -1;
+    const Location location = locate(xy(vertex), where);
+    if (location == Location::Failed || location == Location::OnVertex) return false;
+    attachAt(location, where, vertex);
+    return true;
+}
+
+void ConstrainedTin::attachAt(Location location, int where, int vertex)
+{
+    if (location == Location::Inside) {
+        splitTriangle(where, vertex);
+    } else if (location == Location::OnEdge) {
+        splitEdge(where, vertex);
+    } else {
+        extendHull(where, vertex);
+    }
+}
+
+bool ConstrainedTin::removeVertex(int v)
+{
+    if (v < 0 || v >= m_points.size()) return false;
+    if (m_vertexEdge[v] < 0) return true;
+
+    // The star of v: triangles v, x, y with the link edge x -> y opposite v
+    const QVector<int> star = outgoingEdges(v);
+    QVector<int> ring;
+    QVector<QPointF> link2D;
+    bool onHull = false;
+    for (int e : star) {
+        if (m_constrained[e] || m_constrained[previousEdge(e)]) {
+            m_lastError = "Vertex is on a breakline";
+            return false;
+        }
+        if (m_halfedges[e] == -1 || m_halfedges[previousEdge(e)] == -1) onHull = true;
+        for (int corner : {m_triangles[nextEdge(e)], m_triangles[previousEdge(e)]}) {
+            if (!ring.contains(corner)) {
+                ring.append(corner);
+                link2D.append(xy(corner));
+            }
+        }
+    }
+
+    // The hole is filled by the Delaunay triangles of the link that lie
+    // inside the star (its edges are Delaunay for the full point set, so
+    // they are Delaunay for the link alone). A hull vertex whose link is a
+    // straight line leaves no hole at all.
+    DelaunayTriangulator triangulator;
+    triangulator.setTolerance(m_tolerance);
+    if (!triangulator.triangulate(link2D) || triangulator.duplicateCount() > 0
+        || triangulator.skippedCount() > 0) {
+        if (!onHull) {
+            m_lastError = "Cannot retriangulate around the vertex";
+            return false;
+        }
+    }
+
+    auto inStar = [&](const QPointF& p) {
+        for (int e : star) {
+            const int x = m_triangles[nextEdge(e)];
+            const int y = m_triangles[previousEdge(e)];
+            if (orient(v, x, p) >= 0 && orient(x, y, p) >= 0 && orient(y, v, p) >= 0) return true;
+        }
+        return false;
+    };
+
+    QVector<int> fill;
+    const QVector<int>& local = triangulator.triangles();
+    for (int i = 0; i + 2 < local.size(); i += 3) {
+        const int a = ring[local[i]], b = ring[local[i + 1]], c = ring[local[i + 2]];
+        const QPointF centroid((m_points[a].x + m_points[b].x + m_points[c].x) / 3.0,
+                               (m_points[a].y + m_points[b].y + m_points[c].y) / 3.0);
+        if (inStar(centroid)) fill << a << b << c;
+    }
+
+    // Every link edge must be an edge of the fill, except on the hull where
+    // the ones left over become the new outer edge
+    auto fillEdge = [&](int a, int b) {
+        for (int i = 0; i < fill.size(); ++i) {
+            if (fill[i] == a && fill[i - i % 3 + (i + 1) % 3] == b) return i;
+        }
+        return -1;
+    };
+    QVector<int> outer(fill.size(), -2);
+    for (int e : star) {
+        const int l = nextEdge(e);
+        const int i = fillEdge(m_triangles[l], m_triangles[nextEdge(l)]);
+        if (i >= 0) {
+            outer[i] = m_halfedges[l];
+        } else if (!onHull) {
+            m_lastError = "Cannot retriangulate around the vertex";
+            return false;
+        }
+    }
+    for (int i = 0; i < fill.size(); ++i) {
+        if (outer[i] != -2) continue;
+        const int twin = fillEdge(fill[i - i % 3 + (i + 1) % 3], fill[i]);
+        if (twin < 0 && !onHull) {
+            m_lastError = "Cannot retriangulate around the vertex";
+            return false;
+        }
+    }
+
+    // Replace the star by the fill
+    QVector<int> uncovered;
+    for (int e : star) {
+        const int l = nextEdge(e);
+        if (m_halfedges[l] >= 0 && fillEdge(m_triangles[l], m_triangles[nextEdge(l)]) < 0) {
+            uncovered.append(m_halfedges[l]);
+        }
+    }
+    for (int e : star) {
+        freeTriangle(e / 3);
+    }
+    for (int o : uncovered) {
+        m_halfedges[o] = -1;
+        m_changed.append(o / 3);
+    }
+    QVector<int> slotOf(fill.size() / 3);
+    for (int i = 0; i < slotOf.size(); ++i) {
+        slotOf[i] = newTriangle();
+        setTriangle(slotOf[i], fill[3 * i], fill[3 * i + 1], fill[3 * i + 2]);
+    }
+    for (int i = 0; i < fill.size(); ++i) {
+        const int edge = 3 * slotOf[i / 3] + i % 3;
+        if (outer[i] != -2) {
+            link(edge, outer[i]);
+            continue;
+        }
+        const int twin = fillEdge(fill[i - i % 3 + (i + 1) % 3], fill[i]);
+        if (twin > i) link(edge, 3 * slotOf[twin / 3] + twin % 3);
+    }
+
+    // Link vertices left without a fill triangle hang on to the outer side
+    for (int x : ring) {
+        const int e = m_vertexEdge[x];
+        if (e >= 0 && m_triangles[e] == x) continue;
+        m_vertexEdge[x] = -1;
+        for (int o : uncovered) {
+            if (m_triangles[o] == x) m_vertexEdge[x] = o;
+            else if (m_triangles[nextEdge(o)] == x) m_vertexEdge[x] = nextEdge(o);
+        }
+    }
+    m_vertexEdge[v] = -1;
+    if (!slotOf.isEmpty()) m_hint = slotOf.first();
+    return true;
+}
+
+bool ConstrainedTin::moveVertex(int v, const Point3D& point)
+{
+    if (v < 0 || v >= m_points.size()) return false;
+
+    // Elevation only: the plan triangulation stays as it is
+    if (isAttached(v) && m_points[v].x == point.x && m_points[v].y == point.y) {
+        m_points[v].z = point.z;
+        for (int e : outgoingEdges(v)) {
+            m_changed.append(e / 3);
+        }
+        return true;
+    }
+
+    if (!removeVertex(v)) return false;
+    m_points[v] = point;
+    attachVertex(v);
+    return true;
+}
+
+QVector<int> ConstrainedTin::takeChangedTriangles()
+{
+    QVector<int> changed;
+    changed.swap(m_changed);
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+void ConstrainedTin::splitTriangle(int t, int v)
+{
+    const int e = 3 * t;
+    const int a = m_triangles[e], b = m_triangles[e + 1], c = m_triangles[e + 2];
+    const int hab = m_halfedges[e], hbc = m_halfedges[e + 1], hca = m_halfedges[e + 2];
+    const char cab = m_constrained[e], cbc = m_constrained[e + 1], cca = m_constrained[e + 2];
+
+    const int t1 = newTriangle();
+    const int t2 = newTriangle();
+    setTriangle(t, a, b, v);
+    setTriangle(t1, b, c, v);
+    setTriangle(t2, c, a, v);
+
+    link(3 * t, hab);
+    link(3 * t1, hbc);
+    link(3 * t2, hca);
+    m_constrained[3 * t] = cab;
+    m_constrained[3 * t1] = cbc;
+    m_constrained[3 * t2] = cca;
+    link(3 * t + 1, 3 * t1 + 2);
+    link(3 * t1 + 1, 3 * t2 + 2);
+    link(3 * t2 + 1, 3 * t + 2);
+
+    QVector<int> edges{3 * t, 3 * t1, 3 * t2};
+    legalize(edges);
+}
+
+void ConstrainedTin::splitEdge(int e, int v)
+{
+    const int f = m_halfedges[e];
+    const int a = m_triangles[e];
+    const int b = m_triangles[nextEdge(e)];
+    const int c = m_triangles[previousEdge(e)];
+    const int hbc = m_halfedges[nextEdge(e)], hca = m_halfedges[previousEdge(e)];
+    const char cbc = m_constrained[nextEdge(e)], cca = m_constrained[previousEdge(e)];
+    const char split = m_constrained[e];
+
+    const int t1 = e / 3;
+    const int t2 = newTriangle();
+    setTriangle(t1, a, v, c);
+    setTriangle(t2, v, b, c);
+    link(3 * t1 + 2, hca);
+    link(3 * t2 + 1, hbc);
+    m_constrained[3 * t1 + 2] = cca;
+    m_constrained[3 * t2 + 1] = cbc;
+    link(3 * t1 + 1, 3 * t2 + 2);
+    m_constrained[3 * t1] = split;
+    m_constrained[3 * t2] = split;
+
+    QVector<int> edges{3 * t1 + 2, 3 * t2 + 1};
+
+    if (f != -1) {
+        const int d = m_triangles[previousEdge(f)];
+        const int had = m_halfedges[nextEdge(f)], hdb = m_halfedges[previousEdge(f)];
+        const char cad = m_constrained[nextEdge(f)], cdb = m_constrained[previousEdge(f)];
+
+        const int u1 = f / 3;
+        const int u2 = newTriangle();
+        setTriangle(u1, b, v, d);
+        setTriangle(u2, v, a, d);
+        link(3 * u1 + 2, hdb);
+        link(3 * u2 + 1, had);
+        m_constrained[3 * u1 + 2] = cdb;
+        m_constrained[3 * u2 + 1] = cad;
+        link(3 * u1 + 1, 3 * u2 + 2);
+
+        // The two halves of the split edge
+        link(3 * t1, 3 * u2);
+        link(3 * t2, 3 * u1);
+        m_constrained[3 * u1] = split;
+        m_constrained[3 * u2] = split;
+
+        edges.append(3 * u1 + 2);
+        edges.append(3 * u2 + 1);
+    }
+
+    legalize(edges);
+}
+
+// Hull half-edge that starts where the given hull half-edge ends
+int ConstrainedTin::nextHullEdge(int edge) const
+{
+    int e = nextEdge(edge);
+    while (m_halfedges[e] != -1) {
+        e = nextEdge(m_halfedges[e]);
+    }
+    return e;
+}
+
+// Hull half-edge that ends where the given hull half-edge starts
+int ConstrainedTin::previousHullEdge(int edge) const
+{
+    int e = previousEdge(edge);
+    while (m_halfedges[e] != -1) {
+        e = previousEdge(m_halfedges[e]);
+    }
+    return e;
+}
+
+// Fan the new vertex onto every hull edge it can see
+void ConstrainedTin::extendHull(int edge, int v)
+{
+    const QPointF p(m_points[v].x, m_points[v].y);
+    auto visible = [&](int e) {
+        const int a = m_triangles[e];
+        const int b = m_triangles[nextEdge(e)];
+        const double length = std::hypot(m_points[b].x - m_points[a].x, m_points[b].y - m_points[a].y);
+        return orient(a, b, p) < -m_tolerance * length;
+    };
+
+    QVector<int> edges;
+
+    // The located edge, then forward along the hull
+    int forward = nextHullEdge(edge);
+    int backward = previousHullEdge(edge);
+
+    int a = m_triangles[edge];
+    int b = m_triangles[nextEdge(edge)];
+    int t = newTriangle();
+    setTriangle(t, a, v, b);
+    link(3 * t + 2, edge);
+    edges.append(3 * t + 2);
+    const int firstIn = 3 * t;          // a -> v
+    int lastOut = 3 * t + 1;            // v -> b
+
+    while (forward != edge && visible(forward)) {
+        const int next = nextHullEdge(forward);
+        const int c = m_triangles[nextEdge(forward)];
+        const int from = m_triangles[forward];
+        t = newTriangle();
+        setTriangle(t, from, v, c);
+        link(3 * t + 2, forward);
+        link(3 * t, lastOut);
+        edges.append(3 * t + 2);
+        lastOut = 3 * t + 1;
+        forward = next;
+    }
+
+    int firstOut = firstIn;
+    while (backward != edge && visible(backward)) {
+        const int previous = previousHullEdge(backward);
+        const int z = m_triangles[backward];
+        const int to = m_triangles[nextEdge(backward)];
+        t = newTriangle();
+        setTriangle(t, z, v, to);
+        link(3 * t + 2, backward);
+        link(3 * t + 1, firstOut);
+        edges.append(3 * t + 2);
+        firstOut = 3 * t;
+        backward = previous;
+    }
+
+    legalize(edges);
+}
+
+QVector<int> ConstrainedTin::outgoingEdges(int vertex) const
+{
+    QVector<int> edges;
+    const int start = m_vertexEdge.value(vertex, -1);
+    if (start < 0) return edges;
+
+    // Counter-clockwise from the stored edge, then clockwise if the fan is
+    // open (hull vertex)
+    int e = start;
+    do {
+        edges.append(e);
+        const int twin = m_halfedges[previousEdge(e)];
+        if (twin == -1) {
+            e = -1;
+            break;
+        }
+        e = twin;
+    } while (e != start);
+
+    if (e == -1) {
+        int twin = m_halfedges[start];
+        while (twin != -1) {
+            e = nextEdge(twin);
+            edges.append(e);
+            twin = m_halfedges[e];
+        }
+    }
+    return edges;
+}
+
+int ConstrainedTin::findEdge(int a, int b) const
+{
+    for (int e : outgoingEdges(a)) {
+        if (m_triangles[nextEdge(e)] == b) return e;
+    }
+    // A hull edge b -> a only has the half-edge on b's side
+    for (int e : outgoingEdges(b)) {
+        if (m_triangles[nextEdge(e)] == a) return e;
+    }
+    return -1;
+}
+
+// Segments ab and cd cross at a point interior to both
+bool ConstrainedTin::crossesSegment(int a, int b, int c, int d) const
+{
+    if (a == c || a == d || b == c || b == d) return false;
+    const double d1 = orient(a, b, xy(c));
+    const double d2 = orient(a, b, xy(d));
+    const double d3 = orient(c, d, xy(a));
+    const double d4 = orient(c, d, xy(b));
+    return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0));
+}
+
+bool ConstrainedTin::insertConstraint(int a, int b)
+{
+    QVector<QPair<int, int>> pending;
+    pending.append(qMakePair(a, b));
+
+    // Segments split at collinear vertices or crossing constraints are
+    // queued as pieces
+    int guard = 0;
+    while (!pending.isEmpty()) {
+        const QPair<int, int> segment = pending.last();
+        pending.removeLast();
+        if (++guard > 100000) {
+            m_lastError = "Constraint insertion did not converge";
+            return false;
+        }
+        if (!insertSegment(segment.first, segment.second, pending)) return false;
+    }
+    return true;
+}
+
+bool ConstrainedTin::insertSegment(int a, int b, QVector<QPair<int, int>>& pending)
+{
+    if (a == b) return true;
+
+    int existing = findEdge(a, b);
+    if (existing >= 0) {
+        m_constrained[existing] = 1;
+        if (m_halfedges[existing] != -1) m_constrained[m_halfedges[existing]] = 1;
+        return true;
+    }
+
+    const QPointF pa = xy(a);
+    const QPointF pb = xy(b);
+    const double length = std::hypot(pb.x() - pa.x(), pb.y() - pa.y());
+    const double epsilon = m_tolerance * length;
+
+    // The edge of a's fan that the segment leaves through
+    int crossing = -1;
+    for (int e : outgoingEdges(a)) {
+        const int x = m_triangles[nextEdge(e)];
+        const int y = m_triangles[previousEdge(e)];
+        const double ox = orient(a, b, xy(x));
+        if (qAbs(ox) <= epsilon) {
+            const QPointF px = xy(x);
+            const double along = (px.x() - pa.x()) * (pb.x() - pa.x()) + (px.y() - pa.y()) * (pb.y() - pa.y());
+            if (along > 0.0 && along < length * length) {
+                // A vertex on the segment splits it
+                pending.append(qMakePair(x, b));
+                pending.append(qMakePair(a, x));
+                return true;
+            }
+        }
+        const double oy = orient(a, b, xy(y));
+        if (ox < -epsilon && oy > epsilon) {
+            crossing = nextEdge(e);
+            break;
+        }
+    }
+    if (crossing < 0) {
+        m_lastError = "Breakline leaves the triangulated area";
+        return false;
+    }
+
+    // Edges crossed from a to b; x stays right of the segment, y left
+    QVector<QPair<int, int>> crossed;
+    int target = b;
+    int c = crossing;
+    while (true) {
+        const int x = m_triangles[c];
+        const int y = m_triangles[nextEdge(c)];
+
+        if (m_constrained[c]) {
+            // Crossing breaklines meet at a new vertex on both
+            const QPointF px = xy(x), py = xy(y);
+            const double dx = orient(a, b, px), dy = orient(a, b, py);
+            const double s = dx / (dx - dy);
+            Point3D p(px.x() + s * (py.x() - px.x()), px.y() + s * (py.y() - px.y()),
+                      m_points[x].z + s * (m_points[y].z - m_points[x].z));
+            const int vertex = appendVertex(p);
+            splitEdge(c, vertex);
+            pending.append(qMakePair(vertex, b));
+            pending.append(qMakePair(a, vertex));
+            return true;
+        }
+
+        crossed.append(qMakePair(x, y));
+        const int f = m_halfedges[c];
+        if (f == -1) {
+            m_lastError = "Breakline leaves the triangulated area";
+            return false;
+        }
+        const int w = m_triangles[previousEdge(f)];
+        if (w == b) break;
+
+        const double ow = orient(a, b, xy(w));
+        if (qAbs(ow) <= epsilon) {
+            // The segment runs through w: finish at w, then continue from it
+            target = w;
+            pending.append(qMakePair(w, b));
+            break;
+        }
+        c = ow < 0 ? previousEdge(f) : nextEdge(f);
+    }
+
+    // Flip the crossed edges away (Sloan): a flip whose new diagonal still
+    // crosses goes back in the queue, non-convex quads wait for a later pass
+    QVector<QPair<int, int>> created;
+    int head = 0;
+    const int maxFlips = 64 * crossed.size() + 1024;
+    for (int flips = 0; head < crossed.size(); ++flips) {
+        if (flips > maxFlips) {
+            m_lastError = "Constraint insertion did not converge";
+            return false;
+        }
+        const QPair<int, int> edge = crossed[head++];
+        const int e = findEdge(edge.first, edge.second);
+        if (e < 0 || m_halfedges[e] == -1) continue;
+
+        const int f = m_halfedges[e];
+        const int p = m_triangles[previousEdge(e)];
+        const int q = m_triangles[previousEdge(f)];
+        const double ou = orient(p, q, xy(edge.first));
+        const double ov = orient(p, q, xy(edge.second));
+        if (!((ou > 0 && ov < 0) || (ou < 0 && ov > 0))) {
+            crossed.append(edge);
+            continue;
+        }
+
+        flip(e);
+        if (crossesSegment(a, target, p, q)) {
+            crossed.append(qMakePair(p, q));
+        } else {
+            created.append(qMakePair(p, q));
+        }
+    }
+
+    const int constraint = findEdge(a, target);
+    if (constraint < 0) {
+        m_lastError = "Failed to insert breakline edge";
+        return false;
+    }
+    m_constrained[constraint] = 1;
+    if (m_halfedges[constraint] != -1) m_constrained[m_halfedges[constraint]] = 1;
+
+    // Restore the Delaunay property among the new edges
+    bool swapped = true;
+    for (int pass = 0; swapped && pass < 64; ++pass) {
+        swapped = false;
+        for (auto& edge : created) {
+            const int e = findEdge(edge.first, edge.second);
+            if (e < 0 || m_constrained[e] || m_halfedges[e] == -1) continue;
+            const int f = m_halfedges[e];
+            const int p = m_triangles[previousEdge(e)];
+            const int q = m_triangles[previousEdge(f)];
+            if (inCircle(m_triangles[e], m_triangles[nextEdge(e)], p, q)) {
+                flip(e);
+                edge = qMakePair(p, q);
+                swapped = true;
+            }
+        }
+    }
+    return true;
+}
+
+bool ConstrainedTin::elevationAt(const QPointF& point, double& z) const
+{
+    int where = -1;
+    const Location location = locate(point, where);
+    if (location == Location::OnVertex) {
+        z = m_points[where].z;
+        return true;
+    }
+    if (location != Location::Inside && location != Location::OnEdge) return false;
+
+    const int t = location == Location::OnEdge ? where / 3 : where;
+    const Point3D& p0 = m_points[m_triangles[3 * t]];
+    const Point3D& p1 = m_points[m_triangles[3 * t + 1]];
+    const Point3D& p2 = m_points[m_triangles[3 * t + 2]];
+    const double ux = p1.x - p0.x, uy = p1.y - p0.y;
+    const double vx = p2.x - p0.x, vy = p2.y - p0.y;
+    const double det = ux * vy - vx * uy;
+    if (det == 0.0) return false;
+    const double dx = point.x() - p0.x, dy = point.y() - p0.y;
+    const double u = (dx * vy - vx * dy) / det;
+    const double v = (ux * dy - dx * uy) / det;
+    z = p0.z + u * (p1.z - p0.z) + v * (p2.z - p0.z);
+    return true;
+}
+
+bool ConstrainedTin::insertBreakline(const QVector<QPointF>& points, bool closed)
+{
+    if (m_triangles.isEmpty()) {
+        m_lastError = "No triangulation to insert breaklines into";
+        return false;
+    }
+
+    QVector<int> vertices;
+    for (const QPointF& p : points) {
+        int where = -1;
+        const Location location = locate(p, where);
+        int vertex = -1;
+        if (location == Location::OnVertex) {
+            vertex = where;
+        } else if (location == Location::Inside || location == Location::OnEdge) {
+            double z = 0.0;
+            elevationAt(p, z);
+            vertex = insertPoint(Point3D(p.x(), p.y(), z));
+        } else if (location == Location::Outside) {
+            // Beyond the surface: height of the nearest point of the hull edge
+            const Point3D& a = m_points[m_triangles[where]];
+            const Point3D& b = m_points[m_triangles[nextEdge(where)]];
+            const double lx = b.x - a.x, ly = b.y - a.y;
+            const double l2 = lx * lx + ly * ly;
+            const double s = l2 > 0 ? qBound(0.0, ((p.x() - a.x) * lx + (p.y() - a.y) * ly) / l2, 1.0) : 0.0;
+            vertex = insertPoint(Point3D(p.x(), p.y(), a.z + s * (b.z - a.z)));
+        }
+        if (vertex < 0) {
+            m_lastError = "Failed to insert breakline vertex";
+            return false;
+        }
+        if (vertices.isEmpty() || vertices.last() != vertex) vertices.append(vertex);
+    }
+    if (closed && vertices.size() > 2 && vertices.first() == vertices.last()) vertices.removeLast();
+
+    for (int i = 0; i + 1 < vertices.size(); ++i) {
+        if (!insertConstraint(vertices[i], vertices[i + 1])) return false;
+    }
+    if (closed && vertices.size() > 2) {
+        if (!insertConstraint(vertices.last(), vertices.first())) return false;
+    }
+    return true;
+}
+
+int ConstrainedTin::insertBreaklines(const QVector<CanvasPolyline>& polylines, const QVector<int>& indices)
+{
+    int inserted = 0;
+    for (int idx : indices) {
+        if (idx < 0 || idx >= polylines.size() || polylines[idx].points.size() < 2) continue;
+        if (insertBreakline(polylines[idx].points, polylines[idx].closed)) ++inserted;
+    }
+    return inserted;
+}
+
+bool ConstrainedTin::setBoundary(const QVector<QPointF>& ring)
+{
+    if (!insertBreakline(ring, true)) return false;
+    m_boundary.setRing(ring);
+    return true;
+}
+
+bool ConstrainedTin::isInside(int t) const
+{
+    const int a = m_triangles[3 * t], b = m_triangles[3 * t + 1], c = m_triangles[3 * t + 2];
+    if (a < 0) return false;
+    if (m_boundary.isEmpty()) return true;
+
+    // Boundary edges are constrained, so no triangle straddles it
+    const QPointF centroid((m_points[a].x + m_points[b].x + m_points[c].x) / 3.0,
+                           (m_points[a].y + m_points[b].y + m_points[c].y) / 3.0);
+    return m_boundary.contains(centroid);
+}
+
+QVector<int> ConstrainedTin::triangles() const
+{
+    QVector<int> result;
+    result.reserve(m_triangles.size());
+    for (int e = 0; e + 2 < m_triangles.size(); e += 3) {
+        if (!isInside(e / 3)) continue;
+        result << m_triangles[e] << m_triangles[e + 1] << m_triangles[e + 2];
+    }
+    return result;
+}
+
+int ConstrainedTin::constrainedEdgeCount() const
+{
+    int count = 0;
+    for (int e = 0; e < m_constrained.size(); ++e) {
+        // Count interior edges once, from their lower half-edge
+        if (m_constrained[e] && m_triangles[e] >= 0 && (m_halfedges[e] == -1 || e < m_halfedges[e])) ++count;
+    }
+    return count;
+}
@@ -0,0 +1,364 @@
+#include "surface/contourengine.h"
+#include <QHash>
+#include <QPair>
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+
+using GeosBridge::Point3D;
+
+// Undirected triangle edge, lower vertex index in the high word
+static quint64 edgeKey(int a, int b)
+{
+    const quint32 lo = static_cast<quint32>(qMin(a, b));
+    const quint32 hi = static_cast<quint32>(qMax(a, b));
+    return (static_cast<quint64>(lo) << 32) | hi;
+}
+
+// Crossing of a level on edge a-b, always interpolated from the lower
+// index so both triangles sharing the edge get the same bits
+static QPointF crossing(const QVector<Point3D>& points, int a, int b, double level)
+{
+    if (a > b) std::swap(a, b);
+    const Point3D& p = points[a];
+    const Point3D& q = points[b];
+    const double t = (level - p.z) / (q.z - p.z);
+    return QPointF(p.x + t * (q.x - p.x), p.y + t * (q.y - p.y));
+}
+
+static void appendPoint(QVector<QPointF>& points, const QPointF& point)
+{
+    if (points.isEmpty() || points.last() != point) points.append(point);
+}
+
+void ContourEngine::cutTriangle(int t, const QVector<Point3D>& points, const QVector<int>& triangles,
+                                const QVector<double>& levels, QVector<Segment>& segments,
+                                int& firstLevel, int& lastLevel)
+{
+    firstLevel = lastLevel = 0;
+    const int count = points.size();
+    const int v[3] = { triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2] };
+    if (v[0] < 0 || v[1] < 0 || v[2] < 0 || v[0] >= count || v[1] >= count || v[2] >= count) return;
+
+    const double z[3] = { points[v[0]].z, points[v[1]].z, points[v[2]].z };
+    const double lo = qMin(z[0], qMin(z[1], z[2]));
+    const double hi = qMax(z[0], qMax(z[1], z[2]));
+
+    // Levels with lo <= level < hi have vertices on both sides
+    int k = static_cast<int>(std::lower_bound(levels.begin(), levels.end(), lo) - levels.begin());
+    firstLevel = lastLevel = k;
+    for (; k < levels.size() && levels[k] < hi; ++k) {
+        const double level = levels[k];
+
+        // The edge climbing above the level is the entry, the one
+        // dropping back below is the exit
+        int up = -1, down = -1;
+        for (int i = 0; i < 3; ++i) {
+            const bool above = z[i] > level;
+            const bool nextAbove = z[(i + 1) % 3] > level;
+            if (!above && nextAbove) up = i;
+            else if (above && !nextAbove) down = i;
+        }
+        if (up < 0 || down < 0) continue;
+
+        Segment segment;
+        segment.triangle = t;
+        segment.level = k;
+        segment.from = edgeKey(v[up], v[(up + 1) % 3]);
+        segment.to = edgeKey(v[down], v[(down + 1) % 3]);
+        segment.start = crossing(points, v[up], v[(up + 1) % 3], level);
+        segment.end = crossing(points, v[down], v[(down + 1) % 3], level);
+        segments.append(segment);
+        lastLevel = k + 1;
+    }
+}
+
+void ContourEngine::addSegment(Level& level, const Segment& segment)
+{
+    level.segments.insert(segment.triangle, segment);
+    level.entering.insert(segment.from, segment.triangle);
+    level.leaving.insert(segment.to, segment.triangle);
+}
+
+void ContourEngine::traceLevel(Level& level, const QVector<int>& seeds)
+{
+    const int limit = level.segments.size();
+    for (int seed : seeds) {
+        if (!level.segments.contains(seed) || level.segments[seed].contour >= 0) continue;
+
+        // Back up to the start of an open line; coming round to the seed
+        // again means a loop
+        int first = seed;
+        bool closed = false;
+        for (int steps = 0; steps < limit; ++steps) {
+            const int previous = level.leaving.value(level.segments[first].from, -1);
+            if (previous < 0) break;
+            if (previous == seed) {
+                closed = true;
+                break;
+            }
+            first = previous;
+        }
+
+        int id;
+        if (!level.freeContours.isEmpty()) {
+            id = level.freeContours.takeLast();
+        } else {
+            id = level.contours.size();
+            level.contours.append(Contour());
+            level.members.append(QVector<int>());
+        }
+        Contour& contour = level.contours[id];
+        QVector<int>& members = level.members[id];
+        contour.elevation = level.elevation;
+        contour.closed = closed;
+        contour.points.clear();
+        members.clear();
+
+        int last = first;
+        for (int t = first; t >= 0; t = level.entering.value(level.segments[t].to, -1)) {
+            Segment& segment = level.segments[t];
+            if (segment.contour >= 0) break;
+            segment.contour = id;
+            members.append(t);
+            appendPoint(contour.points, segment.start);
+            last = t;
+        }
+        if (!closed) {
+            appendPoint(contour.points, level.segments[last].end);
+        } else if (contour.points.size() > 1 && contour.points.first() == contour.points.last()) {
+            contour.points.removeLast();
+        }
+    }
+}
+
+void ContourEngine::spliceLevel(Level& level)
+{
+    // Lines that lost or gained a segment are taken out and traced again
+    // from their remaining segments plus the new ones
+    QVector<int> seeds;
+    seeds.swap(level.seeds);
+    std::sort(level.touched.begin(), level.touched.end());
+    level.touched.erase(std::unique(level.touched.begin(), level.touched.end()), level.touched.end());
+    for (int id : level.touched) {
+        for (int t : level.members[id]) {
+            if (!level.segments.contains(t) || level.segments[t].contour != id) continue;
+            level.segments[t].contour = -1;
+            seeds.append(t);
+        }
+        level.contours[id] = Contour();
+        level.members[id].clear();
+        level.freeContours.append(id);
+    }
+    level.touched.clear();
+    traceLevel(level, seeds);
+}
+
+ContourEngine::ContourEngine()
+{
+}
+
+QVector<double> ContourEngine::levels(double minZ, double maxZ, double interval)
+{
+    QVector<double> result;
+    if (interval <= 0.0 || maxZ < minZ) return result;
+
+    const qint64 first = static_cast<qint64>(qCeil(minZ / interval));
+    const qint64 last = static_cast<qint64>(qFloor(maxZ / interval));
+    if (last - first > 100000) return result;
+    for (qint64 k = first; k <= last; ++k) {
+        result.append(k * interval);
+    }
+    return result;
+}
+
+void ContourEngine::build(const QVector<Point3D>& points,
+                          const QVector<int>& triangles,
+                          const QVector<double>& levels)
+{
+    m_levelValues = levels;
+    std::sort(m_levelValues.begin(), m_levelValues.end());
+    m_levelValues.erase(std::unique(m_levelValues.begin(), m_levelValues.end()), m_levelValues.end());
+    const int triangleCount = triangles.size() / 3;
+    m_levels = QVector<Level>(m_levelValues.size());
+    m_firstLevel = QVector<int>(triangleCount, 0);
+    m_lastLevel = QVector<int>(triangleCount, 0);
+    if (m_levels.isEmpty() || triangleCount == 0) return;
+
+    // Cut triangles against all levels, one chunk per task
+    struct Chunk {
+        int first;
+        int last;
+        QVector<Segment> segments;
+    };
+    QVector<Chunk> chunks;
+    for (int first = 0; first < triangleCount; first += m_chunkSize) {
+        chunks.append({first, qMin(triangleCount, first + m_chunkSize), QVector<Segment>()});
+    }
+    int* firstLevel = m_firstLevel.data();
+    int* lastLevel = m_lastLevel.data();
+    QtConcurrent::blockingMap(chunks, [&](Chunk& chunk) {
+        for (int t = chunk.first; t < chunk.last; ++t) {
+            cutTriangle(t, points, triangles, m_levelValues, chunk.segments, firstLevel[t], lastLevel[t]);
+        }
+    });
+
+    // Regroup by level, then index and join each level on its own task
+    QVector<QVector<Segment>> byLevel(m_levels.size());
+    for (Chunk& chunk : chunks) {
+        for (const Segment& segment : chunk.segments) {
+            byLevel[segment.level].append(segment);
+        }
+        chunk.segments.clear();
+    }
+    QVector<int> indices(m_levels.size());
+    for (int k = 0; k < indices.size(); ++k) {
+        indices[k] = k;
+    }
+    Level* level = m_levels.data();
+    QtConcurrent::blockingMap(indices, [&](int k) {
+        level[k].elevation = m_levelValues[k];
+        level[k].segments.reserve(byLevel[k].size());
+        level[k].entering.reserve(byLevel[k].size());
+        level[k].leaving.reserve(byLevel[k].size());
+        QVector<int> seeds;
+        seeds.reserve(byLevel[k].size());
+        for (const Segment& segment : byLevel[k]) {
+            addSegment(level[k], segment);
+            seeds.append(segment.triangle);
+        }
+        traceLevel(level[k], seeds);
+    });
+}
+
+int ContourEngine::update(const QVector<Point3D>& points,
+                          const QVector<int>& triangles,
+                          const QVector<int>& changedTriangles)
+{
+    const int triangleCount = triangles.size() / 3;
+    if (m_levels.isEmpty()) return 0;
+    if (m_firstLevel.size() < triangleCount) {
+        m_firstLevel.resize(triangleCount);
+        m_lastLevel.resize(triangleCount);
+    }
+
+    // Swap the changed triangles' segments for fresh ones, noting the
+    // lines they belonged to or now join
+    QVector<char> dirty(m_levels.size(), 0);
+    QVector<Segment> segments;
+    for (int t : changedTriangles) {
+        if (t < 0 || t >= triangleCount) continue;
+        for (int k = m_firstLevel[t]; k < m_lastLevel[t]; ++k) {
+            Level& level = m_levels[k];
+            if (!level.segments.contains(t)) continue;
+            const Segment old = level.segments[t];
+            if (old.contour >= 0) level.touched.append(old.contour);
+            level.segments.remove(t);
+            if (level.entering.value(old.from, -1) == t) level.entering.remove(old.from);
+            if (level.leaving.value(old.to, -1) == t) level.leaving.remove(old.to);
+            dirty[k] = 1;
+        }
+        segments.clear();
+        cutTriangle(t, points, triangles, m_levelValues, segments, m_firstLevel[t], m_lastLevel[t]);
+        for (const Segment& segment : segments) {
+            Level& level = m_levels[segment.level];
+            for (int neighbour : {level.leaving.value(segment.from, -1), level.entering.value(segment.to, -1)}) {
+                const int id = neighbour < 0 ? -1 : level.segments[neighbour].contour;
+                if (id >= 0) level.touched.append(id);
+            }
+            addSegment(level, segment);
+            level.seeds.append(t);
+            dirty[segment.level] = 1;
+        }
+    }
+
+    QVector<int> redo;
+    for (int k = 0; k < dirty.size(); ++k) {
+        if (dirty[k]) redo.append(k);
+    }
+    Level* level = m_levels.data();
+    QtConcurrent::blockingMap(redo, [&](int k) {
+        spliceLevel(level[k]);
+    });
+    return redo.size();
+}
+
+QVector<ContourEngine::Contour> ContourEngine::contours() const
+{
+    QVector<Contour> result;
+    for (const Level& level : m_levels) {
+        for (const Contour& contour : level.contours) {
+            if (contour.points.size() >= 2) result.append(contour);
+        }
+    }
+    return result;
+}
+
+QVector<ContourEngine::Contour> ContourEngine::generate(const QVector<Point3D>& points,
+                                                        const QVector<int>& triangles,
+                                                        const QVector<double>& levels) const
+{
+    ContourEngine engine;
+    engine.setChunkSize(m_chunkSize);
+    engine.build(points, triangles, levels);
+    return engine.contours();
+}
+
+QVector<ContourEngine::Contour> ContourEngine::stitchSegments(double elevation, const QVector<QPointF>& segments)
+{
+    QVector<Contour> result;
+    const int count = segments.size() / 2;
+
+    // Number the distinct end points; each is shared by at most two segments
+    QHash<QPair<double, double>, int> nodeOf;
+    QVector<int> segmentNodes(2 * count);
+    QVector<int> firstSegment, secondSegment;
+    nodeOf.reserve(count * 2);
+    for (int i = 0; i < 2 * count; ++i) {
+        const QPair<double, double> key(segments[i].x(), segments[i].y());
+        int node = nodeOf.value(key, -1);
+        if (node < 0) {
+            node = firstSegment.size();
+            nodeOf.insert(key, node);
+            firstSegment.append(-1);
+            secondSegment.append(-1);
+        }
+        segmentNodes[i] = node;
+        if (firstSegment[node] < 0) firstSegment[node] = i / 2;
+        else if (secondSegment[node] < 0) secondSegment[node] = i / 2;
+    }
+
+    QVector<char> used(count, 0);
+    auto follow = [&](int segment, int fromNode, bool closed) {
+        Contour contour;
+        contour.elevation = elevation;
+        contour.closed = closed;
+        int node = fromNode;
+        while (segment >= 0 && !used[segment]) {
+            used[segment] = 1;
+            const bool forward = segmentNodes[2 * segment] == node;
+            appendPoint(contour.points, segments[2 * segment + (forward ? 0 : 1)]);
+            node = segmentNodes[2 * segment + (forward ? 1 : 0)];
+            const int other = firstSegment[node] == segment ? secondSegment[node] : firstSegment[node];
+            if (other < 0) {
+                appendPoint(contour.points, segments[2 * segment + (forward ? 1 : 0)]);
+            }
+            segment = other;
+        }
+        if (closed && contour.points.size() > 1 && contour.points.first() == contour.points.last()) {
+            contour.points.removeLast();
+        }
+        if (contour.points.size() >= 2) result.append(contour);
+    };
+
+    // Chains start at points used by one segment, what is left are loops
+    for (int node = 0; node < firstSegment.size(); ++node) {
+        if (secondSegment[node] < 0 && firstSegment[node] >= 0 && !used[firstSegment[node]]) {
+            follow(firstSegment[node], node, false);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!used[i]) follow(i, segmentNodes[2 * i], true);
+    }
+    return result;
+}
@@ -0,0 +1,481 @@
+#include "surface/delaunaytriangulator.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Geometric predicates on the sweep's (y-flipped) coordinates
+
+// True when p, q, r turn counter-clockwise in the sweep's frame
+static inline bool orient(double px, double py, double qx, double qy, double rx, double ry)
+{
+    return (qy - py) * (rx - qx) - (qx - px) * (ry - qy) < 0.0;
+}
+
+static inline bool inCircle(double ax, double ay, double bx, double by,
+                            double cx, double cy, double px, double py)
+{
+    const double dx = ax - px, dy = ay - py;
+    const double ex = bx - px, ey = by - py;
+    const double fx = cx - px, fy = cy - py;
+    const double ap = dx * dx + dy * dy;
+    const double bp = ex * ex + ey * ey;
+    const double cp = fx * fx + fy * fy;
+    return dx * (ey * cp - bp * fy) - dy * (ex * cp - bp * fx) + ap * (ex * fy - ey * fx) < 0.0;
+}
+
+static inline double circumradius(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double dx = bx - ax, dy = by - ay;
+    const double ex = cx - ax, ey = cy - ay;
+    const double bl = dx * dx + dy * dy;
+    const double cl = ex * ex + ey * ey;
+    const double d = 0.5 / (dx * ey - dy * ex);
+    const double x = (ey * bl - dy * cl) * d;
+    const double y = (dx * cl - ex * bl) * d;
+    const double r = x * x + y * y;
+    return std::isfinite(r) ? r : std::numeric_limits<double>::infinity();
+}
+
+static inline QPointF circumcenter(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double dx = bx - ax, dy = by - ay;
+    const double ex = cx - ax, ey = cy - ay;
+    const double bl = dx * dx + dy * dy;
+    const double cl = ex * ex + ey * ey;
+    const double d = 0.5 / (dx * ey - dy * ex);
+    return QPointF(ax + (ey * bl - dy * cl) * d, ay + (dx * cl - ex * bl) * d);
+}
+
+// Monotonic stand-in for the angle of (dx, dy), in [0, 1)
+static inline double pseudoAngle(double dx, double dy)
+{
+    const double p = dx / (qAbs(dx) + qAbs(dy));
+    return (dy > 0.0 ? 3.0 - p : 1.0 + p) / 4.0;
+}
+
+// Sweep-hull state over the distinct points (indices 0..n-1)
+struct Sweep {
+    const double* coords;
+    int n;
+
+    QVector<int> triangles;
+    QVector<int> halfedges;
+    int length{0};
+
+    QVector<int> hullPrev;
+    QVector<int> hullNext;
+    QVector<int> hullTri;
+    QVector<int> hullHash;
+    int hullStart{0};
+    int hashSize{0};
+    double cx{0.0};
+    double cy{0.0};
+
+    QVector<int> edgeStack;
+    int skipped{0};
+
+    int hashKey(double x, double y) const
+    {
+        return static_cast<int>(std::floor(pseudoAngle(x - cx, y - cy) * hashSize)) % hashSize;
+    }
+
+    void link(int a, int b)
+    {
+        halfedges[a] = b;
+        if (b != -1) halfedges[b] = a;
+    }
+
+    int addTriangle(int i0, int i1, int i2, int a, int b, int c)
+    {
+        const int t = length;
+        triangles[t] = i0;
+        triangles[t + 1] = i1;
+        triangles[t + 2] = i2;
+        link(t, a);
+        link(t + 1, b);
+        link(t + 2, c);
+        length += 3;
+        return t;
+    }
+
+    // Flip edges from half-edge a until every affected pair is Delaunay
+    int legalize(int a)
+    {
+        int ar = 0;
+        edgeStack.clear();
+        while (true) {
+            const int b = halfedges[a];
+            const int a0 = a - a % 3;
+            ar = a0 + (a + 2) % 3;
+
+            if (b == -1) {
+                if (edgeStack.isEmpty()) break;
+                a = edgeStack.last();
+                edgeStack.removeLast();
+                continue;
+            }
+
+            const int b0 = b - b % 3;
+            const int al = a0 + (a + 1) % 3;
+            const int bl = b0 + (b + 2) % 3;
+
+            const int p0 = triangles[ar];
+            const int pr = triangles[a];
+            const int pl = triangles[al];
+            const int p1 = triangles[bl];
+
+            const bool illegal = inCircle(coords[2 * p0], coords[2 * p0 + 1],
+                                          coords[2 * pr], coords[2 * pr + 1],
+                                          coords[2 * pl], coords[2 * pl + 1],
+                                          coords[2 * p1], coords[2 * p1 + 1]);
+            if (illegal) {
+                triangles[a] = p1;
+                triangles[b] = p0;
+
+                const int hbl = halfedges[bl];
+                if (hbl == -1) {
+                    // The flipped edge was on the hull: repoint its hull triangle
+                    int e = hullStart;
+                    do {
+                        if (hullTri[e] == bl) {
+                            hullTri[e] = a;
+                            break;
+                        }
+                        e = hullPrev[e];
+                    } while (e != hullStart);
+                }
+                link(a, hbl);
+                link(b, halfedges[ar]);
+                link(ar, bl);
+
+                edgeStack.append(b0 + (b + 1) % 3);
+            } else {
+                if (edgeStack.isEmpty()) break;
+                a = edgeStack.last();
+                edgeStack.removeLast();
+            }
+        }
+        return ar;
+    }
+
+    bool run(QString& error);
+};
+
+bool Sweep::run(QString& error)
+{
+    double minX = std::numeric_limits<double>::infinity(), maxX = -minX;
+    double minY = minX, maxY = -minX;
+    for (int i = 0; i < n; ++i) {
+        minX = qMin(minX, coords[2 * i]);
+        maxX = qMax(maxX, coords[2 * i]);
+        minY = qMin(minY, coords[2 * i + 1]);
+        maxY = qMax(maxY, coords[2 * i + 1]);
+    }
+    const double midX = (minX + maxX) / 2.0;
+    const double midY = (minY + maxY) / 2.0;
+
+    // Seed triangle: the point nearest the centre, its nearest neighbour,
+    // and the point making the smallest circumcircle with them
+    int i0 = 0, i1 = -1, i2 = -1;
+    double minDist = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        const double dx = coords[2 * i] - midX, dy = coords[2 * i + 1] - midY;
+        const double d = dx * dx + dy * dy;
+        if (d < minDist) {
+            i0 = i;
+            minDist = d;
+        }
+    }
+    const double i0x = coords[2 * i0], i0y = coords[2 * i0 + 1];
+
+    minDist = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        if (i == i0) continue;
+        const double dx = coords[2 * i] - i0x, dy = coords[2 * i + 1] - i0y;
+        const double d = dx * dx + dy * dy;
+        if (d < minDist && d > 0.0) {
+            i1 = i;
+            minDist = d;
+        }
+    }
+    if (i1 < 0) {
+        error = "Need at least 3 distinct points for triangulation";
+        return false;
+    }
+    double i1x = coords[2 * i1], i1y = coords[2 * i1 + 1];
+
+    double minRadius = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < n; ++i) {
+        if (i == i0 || i == i1) continue;
+        const double r = circumradius(i0x, i0y, i1x, i1y, coords[2 * i], coords[2 * i + 1]);
+        if (r < minRadius) {
+            i2 = i;
+            minRadius = r;
+        }
+    }
+    if (i2 < 0 || !std::isfinite(minRadius)) {
+        error = "All points are collinear";
+        return false;
+    }
+    double i2x = coords[2 * i2], i2y = coords[2 * i2 + 1];
+
+    if (orient(i0x, i0y, i1x, i1y, i2x, i2y)) {
+        std::swap(i1, i2);
+        std::swap(i1x, i2x);
+        std::swap(i1y, i2y);
+    }
+
+    const QPointF center = circumcenter(i0x, i0y, i1x, i1y, i2x, i2y);
+    cx = center.x();
+    cy = center.y();
+
+    // Insertion order: distance from the seed circumcentre
+    QVector<int> ids(n);
+    QVector<double> dists(n);
+    for (int i = 0; i < n; ++i) {
+        ids[i] = i;
+        const double dx = coords[2 * i] - cx, dy = coords[2 * i + 1] - cy;
+        dists[i] = dx * dx + dy * dy;
+    }
+    const double* d = dists.constData();
+    std::sort(ids.begin(), ids.end(), [d](int a, int b) {
+        return d[a] < d[b] || (d[a] == d[b] && a < b);
+    });
+
+    const int maxTriangles = qMax(2 * n - 5, 1);
+    triangles.resize(maxTriangles * 3);
+    halfedges.resize(maxTriangles * 3);
+    length = 0;
+
+    hashSize = qMax(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n)))));
+    hullPrev.resize(n);
+    hullNext.resize(n);
+    hullTri.resize(n);
+    hullHash.fill(-1, hashSize);
+
+    hullStart = i0;
+    hullNext[i0] = hullPrev[i2] = i1;
+    hullNext[i1] = hullPrev[i0] = i2;
+    hullNext[i2] = hullPrev[i1] = i0;
+    hullTri[i0] = 0;
+    hullTri[i1] = 1;
+    hullTri[i2] = 2;
+    hullHash[hashKey(i0x, i0y)] = i0;
+    hullHash[hashKey(i1x, i1y)] = i1;
+    hullHash[hashKey(i2x, i2y)] = i2;
+
+    addTriangle(i0, i1, i2, -1, -1, -1);
+
+    for (int k = 0; k < n; ++k) {
+        const int i = ids[k];
+        if (i == i0 || i == i1 || i == i2) continue;
+        const double x = coords[2 * i], y = coords[2 * i + 1];
+
+        // A visible hull edge, starting from the hash bucket of the point's angle
+        int start = 0;
+        const int key = hashKey(x, y);
+        for (int j = 0; j < hashSize; ++j) {
+            start = hullHash[(key + j) % hashSize];
+            if (start != -1 && start != hullNext[start]) break;
+        }
+        start = hullPrev[start];
+        int e = start;
+        int q = hullNext[e];
+        while (!orient(x, y, coords[2 * e], coords[2 * e + 1], coords[2 * q], coords[2 * q + 1])) {
+            e = q;
+            if (e == start) {
+                e = -1;
+                break;
+            }
+            q = hullNext[e];
+        }
+        // Numerically on the hull: no visible edge to attach it to
+        if (e == -1) {
+            ++skipped;
+            continue;
+        }
+
+        int t = addTriangle(e, i, hullNext[e], -1, -1, hullTri[e]);
+        hullTri[i] = legalize(t + 2);
+        hullTri[e] = t;
+
+        // Walk forward through the hull, adding triangles and flipping
+        int next = hullNext[e];
+        q = hullNext[next];
+        while (orient(x, y, coords[2 * next], coords[2 * next + 1], coords[2 * q], coords[2 * q + 1])) {
+            t = addTriangle(next, i, q, hullTri[i], -1, hullTri[next]);
+            hullTri[i] = legalize(t + 2);
+            hullNext[next] = next; // removed from the hull
+            next = q;
+            q = hullNext[next];
+        }
+
+        // And backward from the other side
+        if (e == start) {
+            q = hullPrev[e];
+            while (orient(x, y, coords[2 * q], coords[2 * q + 1], coords[2 * e], coords[2 * e + 1])) {
+                t = addTriangle(q, i, e, -1, hullTri[e], hullTri[q]);
+                legalize(t + 2);
+                hullTri[q] = t;
+                hullNext[e] = e;
+                e = q;
+                q = hullPrev[e];
+            }
+        }
+
+        hullStart = hullPrev[i] = e;
+        hullNext[e] = hullPrev[next] = i;
+        hullNext[i] = next;
+
+        hullHash[hashKey(x, y)] = i;
+        hullHash[hashKey(coords[2 * e], coords[2 * e + 1])] = e;
+    }
+
+    triangles.resize(length);
+    halfedges.resize(length);
+    return true;
+}
+
+DelaunayTriangulator::DelaunayTriangulator()
+{
+}
+
+bool DelaunayTriangulator::triangulate(const QVector<QPointF>& points)
+{
+    m_triangles.clear();
+    m_halfedges.clear();
+    m_hull.clear();
+    m_lastError.clear();
+    m_duplicates = 0;
+    m_skipped = 0;
+
+    const int count = points.size();
+    m_representative.resize(count);
+    if (count < 3) {
+        m_lastError = "Need at least 3 points for triangulation";
+        return false;
+    }
+
+    const QPointF* p = points.constData();
+    double minX = p[0].x(), maxX = minX, minY = p[0].y(), maxY = minY;
+    for (int i = 1; i < count; ++i) {
+        minX = qMin(minX, p[i].x());
+        maxX = qMax(maxX, p[i].x());
+        minY = qMin(minY, p[i].y());
+        maxY = qMax(maxY, p[i].y());
+    }
+
+    // Merge coincident points on a grid of cells at least tolerance() wide:
+    // two points within tolerance are always in the same or neighbouring
+    // cells, whatever lies between them in x or y order. Points are taken in
+    // input order, so the lowest index of each cluster is the one kept. The
+    // floor on the cell size keeps cell numbers within 64 bits.
+    double cellSize = qMax(m_tolerance, qMax(maxX - minX, maxY - minY) * 1e-15);
+    if (cellSize <= 0.0) cellSize = 1.0;
+    QVector<qint64> cellX(count);
+    QVector<qint64> cellY(count);
+    QVector<int> order(count);
+    for (int i = 0; i < count; ++i) {
+        cellX[i] = static_cast<qint64>(std::floor((p[i].x() - minX) / cellSize));
+        cellY[i] = static_cast<qint64>(std::floor((p[i].y() - minY) / cellSize));
+        order[i] = i;
+    }
+    const qint64* gx = cellX.constData();
+    const qint64* gy = cellY.constData();
+    std::sort(order.begin(), order.end(), [gx, gy](int a, int b) {
+        return gy[a] < gy[b] || (gy[a] == gy[b] && (gx[a] < gx[b] || (gx[a] == gx[b] && a < b)));
+    });
+
+    // Occupied cells by row, then column; cell c holds order[begin, end),
+    // and rowStart[r] is the first cell of the row above (r = 0) and below
+    // (r = 1) that can neighbour it
+    struct Cell {
+        qint64 y, x;
+        int begin, end;
+        int rowStart[2];
+    };
+    QVector<Cell> cells;
+    QVector<int> cellOf(count);
+    for (int k = 0; k < count;) {
+        const int i = order[k];
+        Cell cell{gy[i], gx[i], k, k, {0, 0}};
+        while (cell.end < count && gx[order[cell.end]] == cell.x && gy[order[cell.end]] == cell.y) {
+            cellOf[order[cell.end++]] = cells.size();
+        }
+        cells.append(cell);
+        k = cell.end;
+    }
+    const int cellCount = cells.size();
+    for (int r = 0, dy = -1; r < 2; ++r, dy += 2) {
+        int s = 0;
+        for (Cell& cell : cells) {
+            while (s < cellCount && (cells[s].y < cell.y + dy
+                                     || (cells[s].y == cell.y + dy && cells[s].x < cell.x - 1))) {
+                ++s;
+            }
+            cell.rowStart[r] = s;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const int c = cellOf[i];
+        const Cell& home = cells[c];
+        const int same = c > 0 && cells[c - 1].y == home.y && cells[c - 1].x == home.x - 1 ? c - 1 : c;
+        const int starts[3] = {home.rowStart[0], same, home.rowStart[1]};
+        int match = -1;
+        for (int r = 0; r < 3 && match < 0; ++r) {
+            const qint64 y = home.y + r - 1;
+            for (int n = starts[r]; n < cellCount && cells[n].y == y && cells[n].x <= home.x + 1 && match < 0; ++n) {
+                // A cell's points are in index order; only earlier ones are settled
+                for (int k = cells[n].begin; k < cells[n].end && order[k] < i; ++k) {
+                    const int j = order[k];
+                    if (m_representative[j] == j && qAbs(p[j].x() - p[i].x()) <= m_tolerance
+                        && qAbs(p[j].y() - p[i].y()) <= m_tolerance) {
+                        match = j;
+                        break;
+                    }
+                }
+            }
+        }
+        m_representative[i] = match < 0 ? i : match;
+        if (match >= 0) ++m_duplicates;
+    }
+
+    // Cell order keeps neighbouring points close in memory for the sweep
+    QVector<int> unique;
+    unique.reserve(count - m_duplicates);
+    for (int i : order) {
+        if (m_representative[i] == i) unique.append(i);
+    }
+
+    // Centred coordinates keep the in-circle test precise for projected
+    // eastings/northings; y is flipped so the sweep's triangles come out
+    // counter-clockwise in world axes
+    const int n = unique.size();
+    const double originX = (minX + maxX) / 2.0;
+    const double originY = (minY + maxY) / 2.0;
+    QVector<double> coords(2 * n);
+    for (int k = 0; k < n; ++k) {
+        coords[2 * k] = p[unique[k]].x() - originX;
+        coords[2 * k + 1] = originY - p[unique[k]].y();
+    }
+
+    Sweep sweep;
+    sweep.coords = coords.constData();
+    sweep.n = n;
+    if (!sweep.run(m_lastError)) return false;
+
+    m_skipped = sweep.skipped;
+    m_triangles = std::move(sweep.triangles);
+    m_halfedges = std::move(sweep.halfedges);
+    for (int& v : m_triangles) v = unique[v];
+
+    int e = sweep.hullStart;
+    do {
+        m_hull.append(unique[e]);
+        e = sweep.hullNext[e];
+    } while (e != sweep.hullStart);
+
+    return true;
+}
@@ -0,0 +1,521 @@
+#include "surface/gridvolume.h"
+#include "surface/volumeengine.h"
+#include "gdal/elevationgrid.h"
+#include "gdal/rasterstretch.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRIDVOLUME_SSE2
+#endif
+
+using GeosBridge::Point3D;
+
+// Rows per parallel task
+static const int BandRows = 64;
+
+// A run of grid rows and its totals; filled in on a worker thread
+struct GridVolume::Band {
+    int firstRow;
+    int lastRow;
+    QVector<double> heights;    // Row by row, NaN = no data; freed once finished
+    VolumeEngine::CompensatedSum cut;   // m3
+    VolumeEngine::CompensatedSum fill;
+    double area{0.0};
+    qint64 cells{0};
+    double lastColumnShare{1.0};    // Part of a full cell the last column covers
+    double lastRowShare{1.0};       // The same for the band's last row
+};
+
+// Sum of the positive and negative parts of a row of height differences,
+// NaN cells skipped
+static void reduceRow(const float* dz, int count, double& cut, double& fill, qint64& cells)
+{
+    int i = 0;
+    double up = 0.0;
+    double down = 0.0;
+    qint64 valid = 0;
+
+#ifdef GRIDVOLUME_SSE2
+    // Four cells per iteration, summed in double so long rows keep their
+    // precision; the ordered mask (-1 per valid lane) doubles as a counter
+    const __m128 zero = _mm_setzero_ps();
+    __m128d up0 = _mm_setzero_pd(), up1 = _mm_setzero_pd();
+    __m128d down0 = _mm_setzero_pd(), down1 = _mm_setzero_pd();
+    __m128i counts = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_loadu_ps(dz + i);
+        const __m128 ordered = _mm_cmpord_ps(v, v);
+        const __m128 value = _mm_and_ps(v, ordered);
+        const __m128 above = _mm_max_ps(value, zero);
+        const __m128 below = _mm_max_ps(_mm_sub_ps(zero, value), zero);
+        up0 = _mm_add_pd(up0, _mm_cvtps_pd(above));
+        up1 = _mm_add_pd(up1, _mm_cvtps_pd(_mm_movehl_ps(above, above)));
+        down0 = _mm_add_pd(down0, _mm_cvtps_pd(below));
+        down1 = _mm_add_pd(down1, _mm_cvtps_pd(_mm_movehl_ps(below, below)));
+        counts = _mm_sub_epi32(counts, _mm_castps_si128(ordered));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(up0, up1));
+    up = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, _mm_add_pd(down0, down1));
+    down = lanes[0] + lanes[1];
+    int countLanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(countLanes), counts);
+    valid = qint64(countLanes[0]) + countLanes[1] + countLanes[2] + countLanes[3];
+#endif
+
+    for (; i < count; ++i) {
+        const float v = dz[i];
+        if (std::isnan(v)) continue;
+        if (v > 0.0f) up += v;
+        else down -= v;
+        ++valid;
+    }
+    cut = up;
+    fill = down;
+    cells = valid;
+}
+
+GridVolume::GridVolume()
+{
+}
+
+void GridVolume::setDesignLevel(double level)
+{
+    m_origin = QPointF();
+    m_level = level;
+    m_gradeX = m_gradeY = 0.0;
+}
+
+void GridVolume::setDesignPlane(const QPointF& origin, double level, double gradeX, double gradeY)
+{
+    m_origin = origin;
+    m_level = level;
+    m_gradeX = gradeX;
+    m_gradeY = gradeY;
+}
+
+double GridVolume::designAt(double x, double y) const
+{
+    return m_level + m_gradeX * (x - m_origin.x()) + m_gradeY * (y - m_origin.y());
+}
+
+void GridVolume::rowSpans(double y, const QVector<QPointF>& ring, QVector<double>& crossings)
+{
+    // Even-odd: cell centres between crossing pairs are inside
+    crossings.clear();
+    const int n = ring.size();
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        const QPointF& a = ring[i];
+        const QPointF& b = ring[j];
+        if ((a.y() > y) != (b.y() > y)) {
+            crossings.append(a.x() + (y - a.y()) * (b.x() - a.x()) / (b.y() - a.y()));
+        }
+    }
+    std::sort(crossings.begin(), crossings.end());
+}
+
+bool GridVolume::layout(const QRectF& extent, double cellWidth, double cellHeight, Result& result) const
+{
+    if (!(cellWidth > 0.0) || !(cellHeight > 0.0) || extent.width() < 0.0 || extent.height() < 0.0) return false;
+    const double columns = qMax(1.0, std::ceil(extent.width() / cellWidth));
+    const double rows = qMax(1.0, std::ceil(extent.height() / cellHeight));
+    if (columns * rows > static_cast<double>(MaxCells)) return false;
+
+    // Rows run from the north edge, like a north-up raster
+    result.columns = static_cast<int>(columns);
+    result.rows = static_cast<int>(rows);
+    result.cellWidth = cellWidth;
+    result.cellHeight = cellHeight;
+    result.bounds = QRectF(extent.left(), extent.bottom() - rows * cellHeight,
+                           columns * cellWidth, rows * cellHeight);
+    if (m_heatmap) {
+        result.heatmap = QImage(result.columns, result.rows, QImage::Format_Indexed8);
+        if (result.heatmap.isNull()) return false;
+
+        // Blue fill through white to red cut; index 0 is transparent
+        QVector<QRgb> colors(256);
+        colors[0] = qRgba(0, 0, 0, 0);
+        for (int i = 1; i < 256; ++i) {
+            const double t = (i - 128) / 127.0;
+            const int fade = static_cast<int>(255.0 * (1.0 - qAbs(t)));
+            colors[i] = t < 0.0 ? qRgba(fade, fade, 255, 170) : qRgba(255, fade, fade, 170);
+        }
+        result.heatmap.setColorTable(colors);
+    }
+    return true;
+}
+
+void GridVolume::finishBand(Band& band, const Result& grid, const ElevationGrid* dem,
+                            uchar* heatmap, int bytesPerLine) const
+{
+    const int columns = grid.columns;
+    const double left = grid.bounds.left() + 0.5 * grid.cellWidth;
+    const double top = grid.bounds.bottom() - 0.5 * grid.cellHeight;
+    const bool bounded = m_boundary.size() >= 3;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    // dz = -scale maps to 1, +scale to 255; NaN stays 0 (transparent)
+    const double span = 2.0 * qMax(grid.scale, 1e-6);
+    const RasterStretch::Params params = RasterStretch::uniform(-0.5 * span - span / 254.0, 0.5 * span);
+
+    // Heights stay in double until the design is taken off, so the float
+    // differences keep their centimetres at any orthometric height
+    QVector<double> crossings;
+    QVector<float> differences(columns);
+    float* dz = differences.data();
+    for (int row = band.firstRow; row < band.lastRow; ++row) {
+        double* values = band.heights.data() + qint64(row - band.firstRow) * columns;
+        const double rowShare = row == band.lastRow - 1 ? band.lastRowShare : 1.0;
+        const double y = top - (row - 0.5 * (1.0 - rowShare)) * grid.cellHeight;
+
+        if (bounded) {
+            rowSpans(y, m_boundary, crossings);
+            int column = 0;
+            for (int k = 0; k + 1 < crossings.size(); k += 2) {
+                const int from = qBound(0, qCeil((crossings[k] - left) / grid.cellWidth), columns);
+                const int to = qBound(0, qFloor((crossings[k + 1] - left) / grid.cellWidth) + 1, columns);
+                std::fill(values + column, values + qMax(column, from), nan);
+                column = qMax(column, to);
+            }
+            std::fill(values + column, values + columns, nan);
+        }
+
+        // The design is a ramp along the row too
+        const double design = designAt(left, y);
+        const double step = m_gradeX * grid.cellWidth;
+        for (int column = 0; column < columns; ++column) {
+            dz[column] = static_cast<float>(values[column] - (design + step * column));
+        }
+
+        // A partial last column is centred on the part it covers and
+        // counts for that part only
+        const int whole = band.lastColumnShare < 1.0 ? columns - 1 : columns;
+        double cut = 0.0, fill = 0.0;
+        qint64 cells = 0;
+        reduceRow(dz, whole, cut, fill, cells);
+        double shares = cells;
+        if (whole < columns) {
+            const double share = band.lastColumnShare;
+            const double difference = values[whole] - (design + step * (whole - 0.5 * (1.0 - share)));
+            dz[whole] = static_cast<float>(difference);
+            if (!std::isnan(difference)) {
+                cut += share * qMax(difference, 0.0);
+                fill += share * qMax(-difference, 0.0);
+                shares += share;
+                ++cells;
+            }
+        }
+
+        // Cells of a geographic DEM shrink towards the poles, so each row
+        // is weighted by its own area
+        const double area = grid.cellWidth * grid.cellHeight * rowShare * (dem ? dem->areaScale(y) : 1.0);
+        band.cut.add(cut * area);
+        band.fill.add(fill * area);
+        band.area += shares * area;
+        band.cells += cells;
+
+        if (heatmap) {
+            RasterStretch::stretchToByte(dz, heatmap + qint64(row) * bytesPerLine, columns, params);
+        }
+    }
+    band.heights = QVector<double>();
+}
+
+GridVolume::Result GridVolume::compute(const QVector<Point3D>& points, const QVector<int>& triangles)
+{
+    Result result;
+    m_lastError.clear();
+
+    const int count = points.size();
+    const int triangleCount = triangles.size() / 3;
+    auto valid = [&](int t) {
+        for (int i = 0; i < 3; ++i) {
+            const int v = triangles[3 * t + i];
+            if (v < 0 || v >= count) return false;
+        }
+        return true;
+    };
+
+    // Extent of the surface, and the largest height difference: it is
+    // linear over each triangle, so its extremes are at vertices
+    double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+    double minY = minX, maxY = maxX;
+    double scale = 0.0;
+    for (int t = 0; t < triangleCount; ++t) {
+        if (!valid(t)) continue;
+        for (int i = 0; i < 3; ++i) {
+            const Point3D& p = points[triangles[3 * t + i]];
+            minX = qMin(minX, p.x);
+            maxX = qMax(maxX, p.x);
+            minY = qMin(minY, p.y);
+            maxY = qMax(maxY, p.y);
+            scale = qMax(scale, qAbs(p.z - designAt(p.x, p.y)));
+        }
+    }
+    if (minX > maxX) {
+        m_lastError = "No triangles";
+        return result;
+    }
+    QRectF extent(minX, minY, maxX - minX, maxY - minY);
+    if (m_boundary.size() >= 3) {
+        double bx0 = m_boundary[0].x(), bx1 = bx0, by0 = m_boundary[0].y(), by1 = by0;
+        for (const QPointF& p : m_boundary) {
+            bx0 = qMin(bx0, p.x());
+            bx1 = qMax(bx1, p.x());
+            by0 = qMin(by0, p.y());
+            by1 = qMax(by1, p.y());
+        }
+        const double x0 = qMax(minX, bx0), x1 = qMin(maxX, bx1);
+        const double y0 = qMax(minY, by0), y1 = qMin(maxY, by1);
+        if (x0 > x1 || y0 > y1) {
+            m_lastError = "The boundary does not overlap the surface";
+            return result;
+        }
+        extent = QRectF(x0, y0, x1 - x0, y1 - y0);
+    }
+    if (!layout(extent, m_cellSize, m_cellSize, result)) {
+        m_lastError = QString("Cell size %1 gives too many cells").arg(m_cellSize);
+        return result;
+    }
+    result.scale = scale;
+
+    const int columns = result.columns;
+    const double left = result.bounds.left() + 0.5 * result.cellWidth;
+    const double top = result.bounds.bottom() - 0.5 * result.cellHeight;
+    const double cellWidth = result.cellWidth;
+    const double cellHeight = result.cellHeight;
+
+    // Rows of cell centres a triangle can cover
+    auto rowRange = [&](int t, int& first, int& last) {
+        double low = std::numeric_limits<double>::max(), high = std::numeric_limits<double>::lowest();
+        for (int i = 0; i < 3; ++i) {
+            low = qMin(low, points[triangles[3 * t + i]].y);
+            high = qMax(high, points[triangles[3 * t + i]].y);
+        }
+        first = qMax(0, qCeil((top - high) / cellHeight));
+        last = qMin(result.rows - 1, qFloor((top - low) / cellHeight));
+        return first <= last;
+    };
+
+    // Bucket triangles by band: count, then fill
+    const int bandCount = (result.rows + BandRows - 1) / BandRows;
+    QVector<int> bandStart(bandCount + 1, 0);
+    for (int t = 0; t < triangleCount; ++t) {
+        int first, last;
+        if (!valid(t) || !rowRange(t, first, last)) continue;
+        for (int b = first / BandRows; b <= last / BandRows; ++b) {
+            ++bandStart[b + 1];
+        }
+    }
+    for (int b = 0; b < bandCount; ++b) {
+        bandStart[b + 1] += bandStart[b];
+    }
+    QVector<int> bandTriangles(bandStart.last());
+    QVector<int> next = bandStart;
+    for (int t = 0; t < triangleCount; ++t) {
+        int first, last;
+        if (!valid(t) || !rowRange(t, first, last)) continue;
+        for (int b = first / BandRows; b <= last / BandRows; ++b) {
+            bandTriangles[next[b]++] = t;
+        }
+    }
+
+    uchar* heatmap = result.heatmap.isNull() ? nullptr : result.heatmap.bits();
+    const int bytesPerLine = heatmap ? result.heatmap.bytesPerLine() : 0;
+
+    QVector<Band> bands(bandCount);
+    for (int b = 0; b < bandCount; ++b) {
+        bands[b].firstRow = b * BandRows;
+        bands[b].lastRow = qMin(result.rows, (b + 1) * BandRows);
+    }
+    QtConcurrent::blockingMap(bands, [&](Band& band) {
+        const int b = band.firstRow / BandRows;
+        band.heights.fill(std::numeric_limits<double>::quiet_NaN(),
+                          (band.lastRow - band.firstRow) * columns);
+
+        for (int k = bandStart[b]; k < bandStart[b + 1]; ++k) {
+            const int t = bandTriangles[k];
+            const Point3D& p0 = points[triangles[3 * t]];
+            const Point3D& p1 = points[triangles[3 * t + 1]];
+            const Point3D& p2 = points[triangles[3 * t + 2]];
+            const double ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+            const double vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+            const double det = ux * vy - vx * uy;
+            if (det == 0.0) continue;
+
+            // z = p0.z + gx (x - p0.x) + gy (y - p0.y)
+            const double gx = (uz * vy - vz * uy) / det;
+            const double gy = (ux * vz - vx * uz) / det;
+
+            int first, last;
+            rowRange(t, first, last);
+            first = qMax(first, band.firstRow);
+            last = qMin(last, band.lastRow - 1);
+            const Point3D* corner[3] = { &p0, &p1, &p2 };
+            for (int row = first; row <= last; ++row) {
+                const double y = top - row * cellHeight;
+
+                // Where the row of centres crosses the triangle
+                double xl = std::numeric_limits<double>::max();
+                double xr = std::numeric_limits<double>::lowest();
+                for (int i = 0; i < 3; ++i) {
+                    const Point3D& a = *corner[i];
+                    const Point3D& c = *corner[(i + 1) % 3];
+                    if (a.y == c.y) {
+                        if (a.y == y) {
+                            xl = qMin(xl, qMin(a.x, c.x));
+                            xr = qMax(xr, qMax(a.x, c.x));
+                        }
+                    } else if ((a.y - y) * (c.y - y) <= 0.0) {
+                        const double x = a.x + (y - a.y) * (c.x - a.x) / (c.y - a.y);
+                        xl = qMin(xl, x);
+                        xr = qMax(xr, x);
+                    }
+                }
+                if (xl > xr) continue;
+                const int c0 = qMax(0, qCeil((xl - left) / cellWidth));
+                const int c1 = qMin(columns - 1, qFloor((xr - left) / cellWidth));
+                if (c0 > c1) continue;
+
+                // Barycentric height as a ramp: one multiply-add per cell
+                const double start = p0.z + gx * (left + c0 * cellWidth - p0.x) + gy * (y - p0.y);
+                const double step = gx * cellWidth;
+                double* values = band.heights.data() + qint64(row - band.firstRow) * columns;
+                for (int column = c0; column <= c1; ++column) {
+                    values[column] = start + step * (column - c0);
+                }
+            }
+        }
+        finishBand(band, result, nullptr, heatmap, bytesPerLine);
+    });
+
+    // Bands are added in order, so the totals are the same on every run
+    VolumeEngine::CompensatedSum cut, fill;
+    for (const Band& band : bands) {
+        cut.add(band.cut.value());
+        fill.add(band.fill.value());
+        result.area += band.area;
+        result.cells += band.cells;
+    }
+    result.cut = cut.value();
+    result.fill = fill.value();
+    return result;
+}
+
+GridVolume::Result GridVolume::compute(ElevationGrid* grid)
+{
+    Result result;
+    m_lastError.clear();
+    if (!grid || !grid->isOpen()) {
+        m_lastError = "No DEM";
+        return result;
+    }
+
+    // Whole DEM cells per grid cell; GDAL decimates as it reads. A grid
+    // cell is exactly factor x factor DEM cells, and any DEM cells left
+    // over at the right and bottom edges make one narrower last column
+    // and row
+    const int factor = qMax(1, qRound(m_cellSize / grid->cellWidthMetres()));
+    const int fullColumns = grid->columns() / factor;
+    const int fullRows = grid->rows() / factor;
+    const int restColumns = grid->columns() % factor;
+    const int restRows = grid->rows() % factor;
+    const int columns = fullColumns + (restColumns > 0 ? 1 : 0);
+    const int rows = fullRows + (restRows > 0 ? 1 : 0);
+    const double cellWidth = factor * grid->cellWidth();
+    const double cellHeight = factor * grid->cellHeight();
+    const QRectF bounds = grid->bounds();
+
+    // Half a cell short of the grid, so rounding cannot add a column or row
+    const QRectF extent(bounds.left(), bounds.bottom() - (rows - 0.5) * cellHeight,
+                        (columns - 0.5) * cellWidth, (rows - 0.5) * cellHeight);
+    if (!layout(extent, cellWidth, cellHeight, result)) {
+        m_lastError = QString("Cell size %1 gives too many cells").arg(m_cellSize);
+        return result;
+    }
+    double scale = 0.0;
+    for (const QPointF& corner : { bounds.topLeft(), bounds.topRight(), bounds.bottomLeft(), bounds.bottomRight() }) {
+        const double design = designAt(corner.x(), corner.y());
+        scale = qMax(scale, qMax(qAbs(grid->maximum() - design), qAbs(grid->minimum() - design)));
+    }
+    result.scale = scale;
+
+    uchar* heatmap = result.heatmap.isNull() ? nullptr : result.heatmap.bits();
+    const int bytesPerLine = heatmap ? result.heatmap.bytesPerLine() : 0;
+
+    // Grid cells [first, first + count) and the DEM cells they are read from
+    struct Span { int first; int count; int source; int sourceCount; };
+    auto spans = [factor](int first, int last, int full, int rest) {
+        QVector<Span> result;
+        const int wholeEnd = qMin(last, full);
+        if (first < wholeEnd) result.append({ first, wholeEnd - first, first * factor, (wholeEnd - first) * factor });
+        if (rest > 0 && last > full) result.append({ full, 1, full * factor, rest });
+        return result;
+    };
+    const QVector<Span> columnSpans = spans(0, columns, fullColumns, restColumns);
+    QVector<double> block;
+    auto readBlock = [&](Band& band, const Span& rowSpan, const Span& columnSpan) {
+        double* out = band.heights.data() + qint64(rowSpan.first - band.firstRow) * columns;
+        if (columnSpan.count == columns) {
+            return grid->readWindow(columnSpan.source, rowSpan.source, columnSpan.sourceCount, rowSpan.sourceCount,
+                                    out, columnSpan.count, rowSpan.count);
+        }
+        block.resize(columnSpan.count * rowSpan.count);
+        if (!grid->readWindow(columnSpan.source, rowSpan.source, columnSpan.sourceCount, rowSpan.sourceCount,
+                              block.data(), columnSpan.count, rowSpan.count)) {
+            return false;
+        }
+        for (int r = 0; r < rowSpan.count; ++r) {
+            std::copy(block.constData() + r * columnSpan.count, block.constData() + (r + 1) * columnSpan.count,
+                      out + qint64(r) * columns + columnSpan.first);
+        }
+        return true;
+    };
+
+    // The grid reads on this thread, a few bands at a time; the bands are
+    // then finished in parallel
+    const int bandCount = (rows + BandRows - 1) / BandRows;
+    const int groupSize = qMax(1, QThread::idealThreadCount());
+    VolumeEngine::CompensatedSum cut, fill;
+    QVector<Band> bands;
+    for (int group = 0; group < bandCount; group += groupSize) {
+        bands.clear();
+        for (int b = group; b < qMin(bandCount, group + groupSize); ++b) {
+            Band band;
+            band.firstRow = b * BandRows;
+            band.lastRow = qMin(rows, (b + 1) * BandRows);
+            band.heights.resize((band.lastRow - band.firstRow) * columns);
+            if (restColumns > 0) band.lastColumnShare = double(restColumns) / factor;
+            if (restRows > 0 && band.lastRow > fullRows) band.lastRowShare = double(restRows) / factor;
+            for (const Span& rowSpan : spans(band.firstRow, band.lastRow, fullRows, restRows)) {
+                for (const Span& columnSpan : columnSpans) {
+                    if (!readBlock(band, rowSpan, columnSpan)) {
+                        m_lastError = grid->lastError();
+                        return Result();
+                    }
+                }
+            }
+            bands.append(band);
+        }
+        QtConcurrent::blockingMap(bands, [&](Band& band) {
+            finishBand(band, result, grid, heatmap, bytesPerLine);
+        });
+        for (const Band& band : bands) {
+            cut.add(band.cut.value());
+            fill.add(band.fill.value());
+            result.area += band.area;
+            result.cells += band.cells;
+        }
+    }
+
+    result.cut = cut.value();
+    result.fill = fill.value();
+    return result;
+}
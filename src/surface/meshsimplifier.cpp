@@ -0,0 +1,394 @@
+#include "surface/meshsimplifier.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using GeosBridge::Point3D;
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix
+// [A b; b c] of q(p) = p.A.p + 2 b.p + c, upper triangle row by row
+struct Quadric {
+    double m[10] = {};
+
+    void addPlane(double a, double b, double c, double d, double weight)
+    {
+        const double p[4] = { a, b, c, d };
+        int k = 0;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = i; j < 4; ++j) {
+                m[k++] += weight * p[i] * p[j];
+            }
+        }
+    }
+
+    void add(const Quadric& other)
+    {
+        for (int k = 0; k < 10; ++k) m[k] += other.m[k];
+    }
+
+    double evaluate(double x, double y, double z) const
+    {
+        return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+             + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+             + m[7] * z * z + 2.0 * m[8] * z
+             + m[9];
+    }
+};
+
+// Vertices keyed by the cost of their cheapest collapse, each at most once,
+// so a re-costed vertex moves in place instead of leaving stale entries
+struct CollapseQueue {
+    QVector<int> heap;          // Vertices, cheapest first
+    QVector<int> position;      // Heap slot of each vertex, -1 if absent
+    QVector<double> cost;
+
+    explicit CollapseQueue(int count) : position(count, -1), cost(count, 0.0) {}
+
+    bool isEmpty() const { return heap.isEmpty(); }
+
+    // Ties go to the lower vertex, so the order does not depend on the heap
+    bool before(int a, int b) const
+    {
+        return cost[a] < cost[b] || (cost[a] == cost[b] && a < b);
+    }
+
+    void place(int slot, int vertex)
+    {
+        heap[slot] = vertex;
+        position[vertex] = slot;
+    }
+
+    void up(int slot)
+    {
+        const int vertex = heap[slot];
+        while (slot > 0) {
+            const int parent = (slot - 1) / 2;
+            if (!before(vertex, heap[parent])) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, vertex);
+    }
+
+    void down(int slot)
+    {
+        const int vertex = heap[slot];
+        const int size = heap.size();
+        for (;;) {
+            int child = 2 * slot + 1;
+            if (child >= size) break;
+            if (child + 1 < size && before(heap[child + 1], heap[child])) ++child;
+            if (!before(heap[child], vertex)) break;
+            place(slot, heap[child]);
+            slot = child;
+        }
+        place(slot, vertex);
+    }
+
+    void update(int vertex, double value)
+    {
+        cost[vertex] = value;
+        if (position[vertex] < 0) {
+            heap.append(vertex);
+            position[vertex] = heap.size() - 1;
+        }
+        up(position[vertex]);
+        down(position[vertex]);
+    }
+
+    void remove(int vertex)
+    {
+        const int slot = position[vertex];
+        if (slot < 0) return;
+        position[vertex] = -1;
+        const int last = heap.takeLast();
+        if (slot < heap.size()) {
+            place(slot, last);
+            up(slot);
+            down(position[last]);
+        }
+    }
+
+    int pop()
+    {
+        const int vertex = heap.first();
+        remove(vertex);
+        return vertex;
+    }
+};
+
+MeshSimplifier::MeshSimplifier()
+{
+}
+
+bool MeshSimplifier::simplify(const QVector<Point3D>& points, const QVector<int>& triangles,
+                              const QVector<int>& targets)
+{
+    m_levels.clear();
+
+    // Valid triangles only, flat
+    QVector<int> input;
+    input.reserve(triangles.size());
+    for (int i = 0; i + 2 < triangles.size(); i += 3) {
+        const int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+        if (a < 0 || b < 0 || c < 0 || a >= points.size() || b >= points.size() || c >= points.size()) continue;
+        if (a == b || b == c || a == c) continue;
+        input << a << b << c;
+    }
+    const int triangleCount = input.size() / 3;
+    if (triangleCount == 0) return false;
+
+    double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+    double minY = minX, maxY = maxX, minZ = minX, maxZ = maxX;
+    for (int v : input) {
+        minX = qMin(minX, points[v].x);
+        maxX = qMax(maxX, points[v].x);
+        minY = qMin(minY, points[v].y);
+        maxY = qMax(maxY, points[v].y);
+        minZ = qMin(minZ, points[v].z);
+        maxZ = qMax(maxZ, points[v].z);
+    }
+    const double extent = qMax(maxX - minX, maxY - minY);
+
+    // Work on the used vertices renumbered along a Morton curve, and on the
+    // triangles in the order of their first vertex: neighbours then sit
+    // close in memory, which matters more than anything else here once the
+    // mesh outgrows the cache
+    QVector<QPair<quint64, int>> keys;
+    {
+        QVector<bool> used(points.size(), false);
+        for (int v : input) used[v] = true;
+        const double scale = extent > 0.0 ? 65535.0 / extent : 0.0;
+        for (int i = 0; i < points.size(); ++i) {
+            if (!used[i]) continue;
+            quint64 key = 0;
+            const quint32 x = static_cast<quint32>((points[i].x - minX) * scale);
+            const quint32 y = static_cast<quint32>((points[i].y - minY) * scale);
+            for (int bit = 0; bit < 16; ++bit) {
+                key |= quint64((x >> bit) & 1u) << (2 * bit) | quint64((y >> bit) & 1u) << (2 * bit + 1);
+            }
+            keys.append(qMakePair(key, i));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    const int count = keys.size();
+    QVector<int> original(count);
+    QVector<int> local(points.size(), -1);
+    for (int i = 0; i < count; ++i) {
+        original[i] = keys[i].second;
+        local[keys[i].second] = i;
+    }
+    keys = QVector<QPair<quint64, int>>();
+
+    QVector<QPair<int, int>> order(triangleCount);
+    for (int t = 0; t < triangleCount; ++t) {
+        order[t] = qMakePair(qMin(local[input[3 * t]], qMin(local[input[3 * t + 1]], local[input[3 * t + 2]])), t);
+    }
+    std::sort(order.begin(), order.end());
+    QVector<int> tris(3 * triangleCount);
+    for (int t = 0; t < triangleCount; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            tris[3 * t + i] = local[input[3 * order[t].second + i]];
+        }
+    }
+    input = QVector<int>();
+    order = QVector<QPair<int, int>>();
+
+    // Relative to the middle of the data, so survey coordinates in the
+    // millions keep their precision in the quadrics
+    const double cx = 0.5 * (minX + maxX), cy = 0.5 * (minY + maxY), cz = 0.5 * (minZ + maxZ);
+    QVector<double> xyz(3 * count);
+    for (int i = 0; i < count; ++i) {
+        const Point3D& p = points[original[i]];
+        xyz[3 * i] = p.x - cx;
+        xyz[3 * i + 1] = p.y - cy;
+        xyz[3 * i + 2] = p.z - cz;
+    }
+    const double minArea = 1e-14 * extent * extent;
+
+    auto orient = [&](int a, int b, int c) {
+        const double* p = &xyz[3 * a];
+        const double* q = &xyz[3 * b];
+        const double* r = &xyz[3 * c];
+        return (q[0] - p[0]) * (r[1] - p[1]) - (q[1] - p[1]) * (r[0] - p[0]);
+    };
+
+    // Plane quadrics, weighted by area; the winding in plan is kept per
+    // triangle so collapses can be checked against it
+    QVector<Quadric> quadrics(count);
+    QVector<signed char> winding(triangleCount);
+    QVector<QVector<int>> around(count);
+    for (int t = 0; t < triangleCount; ++t) {
+        const int* v = &tris[3 * t];
+        const double* p = &xyz[3 * v[0]];
+        const double* q = &xyz[3 * v[1]];
+        const double* r = &xyz[3 * v[2]];
+        const double ux = q[0] - p[0], uy = q[1] - p[1], uz = q[2] - p[2];
+        const double wx = r[0] - p[0], wy = r[1] - p[1], wz = r[2] - p[2];
+        double nx = uy * wz - uz * wy, ny = uz * wx - ux * wz, nz = ux * wy - uy * wx;
+        const double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        winding[t] = nz >= 0.0 ? 1 : -1;
+        for (int i = 0; i < 3; ++i) {
+            around[v[i]].append(t);
+        }
+        if (length == 0.0) continue;
+        nx /= length;
+        ny /= length;
+        nz /= length;
+        Quadric plane;
+        plane.addPlane(nx, ny, nz, -(nx * p[0] + ny * p[1] + nz * p[2]), 0.5 * length);
+        for (int i = 0; i < 3; ++i) {
+            quadrics[v[i]].add(plane);
+        }
+    }
+
+    // Edges on one triangle (the outline) or more than two pin their ends
+    QVector<quint64> edges;
+    edges.reserve(tris.size());
+    for (int t = 0; t < triangleCount; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            const quint32 a = tris[3 * t + i], b = tris[3 * t + (i + 1) % 3];
+            edges.append(a < b ? (quint64(a) << 32 | b) : (quint64(b) << 32 | a));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    QVector<bool> locked(count, false);
+    for (int i = 0; i < edges.size();) {
+        int j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i]) ++j;
+        if (j - i != 2) {
+            locked[static_cast<int>(edges[i] >> 32)] = true;
+            locked[static_cast<int>(edges[i] & 0xffffffffu)] = true;
+        }
+        i = j;
+    }
+    edges = QVector<quint64>();
+
+    QVector<bool> alive(triangleCount, true);
+    QVector<int> targetOf(count, -1);
+    CollapseQueue queue(count);
+
+    // Error of each vertex at its own position (the second half of every
+    // collapse cost into it), kept up to date as quadrics merge
+    QVector<double> ownError(count);
+    for (int i = 0; i < count; ++i) {
+        ownError[i] = quadrics[i].evaluate(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+    }
+
+    // Cheapest collapse of u into a neighbour that folds no triangle over:
+    // neighbours are tried by cost, so usually only the first is checked
+    QVector<QPair<double, int>> candidates;
+    auto best = [&](int u) {
+        if (locked[u]) return;
+        candidates.clear();
+        for (int t : around[u]) {
+            if (!alive[t]) continue;
+            for (int i = 0; i < 3; ++i) {
+                const int v = tris[3 * t + i];
+                if (v != u) candidates.append(qMakePair(0.0, v));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const QPair<double, int>& a, const QPair<double, int>& b) { return a.second < b.second; });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                     [](const QPair<double, int>& a, const QPair<double, int>& b) {
+                                         return a.second == b.second;
+                                     }), candidates.end());
+        for (auto& candidate : candidates) {
+            const int v = candidate.second;
+            candidate.first = quadrics[u].evaluate(xyz[3 * v], xyz[3 * v + 1], xyz[3 * v + 2]) + ownError[v];
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (const auto& candidate : candidates) {
+            const int v = candidate.second;
+            bool valid = true;
+            for (int s : around[u]) {
+                if (!alive[s]) continue;
+                int corner[3] = { tris[3 * s], tris[3 * s + 1], tris[3 * s + 2] };
+                if (corner[0] == v || corner[1] == v || corner[2] == v) continue;
+                for (int k = 0; k < 3; ++k) {
+                    if (corner[k] == u) corner[k] = v;
+                }
+                if (winding[s] * orient(corner[0], corner[1], corner[2]) <= minArea) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid) {
+                targetOf[u] = v;
+                queue.update(u, candidate.first);
+                return;
+            }
+        }
+        queue.remove(u);
+    };
+
+    for (int u = 0; u < count; ++u) {
+        if (!around[u].isEmpty()) best(u);
+    }
+
+    QVector<int> sortedTargets = targets;
+    std::sort(sortedTargets.begin(), sortedTargets.end(), std::greater<int>());
+    auto snapshot = [&]() {
+        QVector<int> level;
+        for (int t = 0; t < triangleCount; ++t) {
+            if (alive[t]) level << original[tris[3 * t]] << original[tris[3 * t + 1]] << original[tris[3 * t + 2]];
+        }
+        m_levels.append(level);
+    };
+
+    int live = triangleCount;
+    int next = 0;
+    QVector<int> neighbours;
+    while (next < sortedTargets.size()) {
+        if (live <= sortedTargets[next]) {
+            snapshot();
+            ++next;
+            continue;
+        }
+        if (queue.isEmpty()) break;
+
+        // Collapse u into v: triangles on the edge go, the rest take v
+        const int u = queue.pop();
+        const int v = targetOf[u];
+        for (int t : around[u]) {
+            if (!alive[t]) continue;
+            int* corner = &tris[3 * t];
+            if (corner[0] == v || corner[1] == v || corner[2] == v) {
+                alive[t] = false;
+                --live;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                if (corner[k] == u) corner[k] = v;
+            }
+            around[v].append(t);
+        }
+        around[u] = QVector<int>();
+        quadrics[v].add(quadrics[u]);
+        ownError[v] = quadrics[v].evaluate(xyz[3 * v], xyz[3 * v + 1], xyz[3 * v + 2]);
+        around[v].erase(std::remove_if(around[v].begin(), around[v].end(),
+                                       [&](int t) { return !alive[t]; }), around[v].end());
+
+        // v and its neighbours have new stars; cost their collapses again
+        neighbours.clear();
+        for (int t : around[v]) {
+            for (int k = 0; k < 3; ++k) {
+                neighbours.append(tris[3 * t + k]);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (int w : neighbours) {
+            best(w);
+        }
+    }
+
+    // Targets below what the collapses could reach get the coarsest mesh
+    while (next < sortedTargets.size()) {
+        snapshot();
+        ++next;
+    }
+    return true;
+}
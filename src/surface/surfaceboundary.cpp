@@ -0,0 +1,267 @@
+#include "surface/surfaceboundary.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+// Keep the part of a polygon on the left of the directed line a->b
+// (Sutherland-Hodgman step; the clip window is convex, the subject need not be)
+static void clipLeftOf(const QVector<QPointF>& input, const QPointF& a, const QPointF& b,
+                       QVector<QPointF>& output)
+{
+    output.clear();
+    const int n = input.size();
+    if (n == 0) return;
+
+    const double ex = b.x() - a.x();
+    const double ey = b.y() - a.y();
+    auto side = [&](const QPointF& p) {
+        return ex * (p.y() - a.y()) - ey * (p.x() - a.x());
+    };
+
+    QPointF previous = input[n - 1];
+    double previousSide = side(previous);
+    for (int i = 0; i < n; ++i) {
+        const QPointF& current = input[i];
+        const double currentSide = side(current);
+        if ((currentSide >= 0.0) != (previousSide >= 0.0)) {
+            const double t = previousSide / (previousSide - currentSide);
+            output.append(previous + (current - previous) * t);
+        }
+        if (currentSide >= 0.0) output.append(current);
+        previous = current;
+        previousSide = currentSide;
+    }
+}
+
+SurfaceBoundary::SurfaceBoundary()
+{
+}
+
+SurfaceBoundary::SurfaceBoundary(const QVector<QPointF>& ring)
+{
+    setRing(ring);
+}
+
+void SurfaceBoundary::setRing(const QVector<QPointF>& ring)
+{
+    m_ring.clear();
+    m_bounds = QRectF();
+    m_columns = m_rows = 0;
+    m_cellSums.clear();
+    m_bands.clear();
+
+    // Drop repeated vertices and the closing point
+    for (const QPointF& p : ring) {
+        if (m_ring.isEmpty() || qAbs(p.x() - m_ring.last().x()) > 1e-12 || qAbs(p.y() - m_ring.last().y()) > 1e-12) {
+            m_ring.append(p);
+        }
+    }
+    while (m_ring.size() > 1 && qAbs(m_ring.first().x() - m_ring.last().x()) <= 1e-12
+           && qAbs(m_ring.first().y() - m_ring.last().y()) <= 1e-12) {
+        m_ring.removeLast();
+    }
+
+    const int n = m_ring.size();
+    if (n < 3) {
+        m_ring.clear();
+        return;
+    }
+
+    double minX = m_ring[0].x(), maxX = minX;
+    double minY = m_ring[0].y(), maxY = minY;
+    double twiceArea = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const QPointF& p = m_ring[i];
+        const QPointF& q = m_ring[(i + 1) % n];
+        minX = qMin(minX, p.x());
+        maxX = qMax(maxX, p.x());
+        minY = qMin(minY, p.y());
+        maxY = qMax(maxY, p.y());
+        twiceArea += (p.x() - m_ring[0].x()) * (q.y() - m_ring[0].y())
+                   - (q.x() - m_ring[0].x()) * (p.y() - m_ring[0].y());
+    }
+    if (twiceArea == 0.0 || maxX <= minX || maxY <= minY) {
+        m_ring.clear();
+        return;
+    }
+    m_orientation = twiceArea > 0.0 ? 1.0 : -1.0;
+    m_bounds = QRectF(minX, minY, maxX - minX, maxY - minY);
+
+    // A few edges per row keeps point tests short without a huge grid
+    const int dimension = qBound(16, 4 * static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n)))), 1024);
+    m_columns = dimension;
+    m_rows = dimension;
+    m_cellWidth = m_bounds.width() / m_columns;
+    m_cellHeight = m_bounds.height() / m_rows;
+    m_bands.resize(m_rows);
+
+    QVector<char> edgeCells(m_rows * m_columns, 0);
+    for (int i = 0; i < n; ++i) {
+        const QPointF& p = m_ring[i];
+        const QPointF& q = m_ring[(i + 1) % n];
+        const double y0 = qMin(p.y(), q.y());
+        const double y1 = qMax(p.y(), q.y());
+        const int firstRow = rowOf(y0);
+        const int lastRow = rowOf(y1);
+
+        for (int row = firstRow; row <= lastRow; ++row) {
+            m_bands[row].append(i);
+
+            // The edge's x extent within this row
+            double xa, xb;
+            if (q.y() == p.y()) {
+                xa = p.x();
+                xb = q.x();
+            } else {
+                const double ya = qMax(y0, m_bounds.top() + row * m_cellHeight);
+                const double yb = qMin(y1, m_bounds.top() + (row + 1) * m_cellHeight);
+                const double slope = (q.x() - p.x()) / (q.y() - p.y());
+                xa = p.x() + (ya - p.y()) * slope;
+                xb = p.x() + (yb - p.y()) * slope;
+            }
+            // One cell of slack either side absorbs rounding at cell edges
+            const int firstColumn = qMax(0, columnOf(qMin(xa, xb)) - 1);
+            const int lastColumn = qMin(m_columns - 1, columnOf(qMax(xa, xb)) + 1);
+            char* cells = edgeCells.data() + row * m_columns;
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                cells[column] = 1;
+            }
+        }
+    }
+
+    // Summed-area table, so a triangle's cell window is checked in O(1)
+    const int stride = m_columns + 1;
+    m_cellSums.fill(0, (m_rows + 1) * stride);
+    for (int row = 0; row < m_rows; ++row) {
+        int rowSum = 0;
+        for (int column = 0; column < m_columns; ++column) {
+            rowSum += edgeCells[row * m_columns + column];
+            m_cellSums[(row + 1) * stride + column + 1] = m_cellSums[row * stride + column + 1] + rowSum;
+        }
+    }
+}
+
+int SurfaceBoundary::rowOf(double y) const
+{
+    return qBound(0, static_cast<int>(std::floor((y - m_bounds.top()) / m_cellHeight)), m_rows - 1);
+}
+
+int SurfaceBoundary::columnOf(double x) const
+{
+    return qBound(0, static_cast<int>(std::floor((x - m_bounds.left()) / m_cellWidth)), m_columns - 1);
+}
+
+int SurfaceBoundary::edgeCellsIn(int col0, int row0, int col1, int row1) const
+{
+    const int stride = m_columns + 1;
+    return m_cellSums[(row1 + 1) * stride + col1 + 1] - m_cellSums[row0 * stride + col1 + 1]
+         - m_cellSums[(row1 + 1) * stride + col0] + m_cellSums[row0 * stride + col0];
+}
+
+bool SurfaceBoundary::contains(const QPointF& point) const
+{
+    if (isEmpty()) return false;
+    const double px = point.x();
+    const double py = point.y();
+    if (px < m_bounds.left() || px > m_bounds.right() || py < m_bounds.top() || py > m_bounds.bottom()) {
+        return false;
+    }
+
+    // Crossing number over the edges of the point's row only
+    const int n = m_ring.size();
+    bool inside = false;
+    for (int i : m_bands[rowOf(py)]) {
+        const QPointF& a = m_ring[i];
+        const QPointF& b = m_ring[(i + 1) % n];
+        if ((a.y() > py) != (b.y() > py)) {
+            const double x = a.x() + (py - a.y()) * (b.x() - a.x()) / (b.y() - a.y());
+            if (px < x) inside = !inside;
+        }
+    }
+    return inside;
+}
+
+SurfaceBoundary::Coverage SurfaceBoundary::classify(const QPointF& a, const QPointF& b, const QPointF& c) const
+{
+    if (isEmpty()) return Coverage::Outside;
+
+    const double minX = qMin(a.x(), qMin(b.x(), c.x()));
+    const double maxX = qMax(a.x(), qMax(b.x(), c.x()));
+    const double minY = qMin(a.y(), qMin(b.y(), c.y()));
+    const double maxY = qMax(a.y(), qMax(b.y(), c.y()));
+    if (maxX < m_bounds.left() || minX > m_bounds.right() || maxY < m_bounds.top() || minY > m_bounds.bottom()) {
+        return Coverage::Outside;
+    }
+
+    if (edgeCellsIn(columnOf(minX), rowOf(minY), columnOf(maxX), rowOf(maxY)) > 0) {
+        return Coverage::Partial;
+    }
+
+    // No edge comes near: the whole triangle is on one side
+    const QPointF centroid((a.x() + b.x() + c.x()) / 3.0, (a.y() + b.y() + c.y()) / 3.0);
+    return contains(centroid) ? Coverage::Inside : Coverage::Outside;
+}
+
+SurfaceBoundary::Clip SurfaceBoundary::clip(const QPointF& a, const QPointF& b, const QPointF& c) const
+{
+    return clipTriangle(a, b, c, nullptr);
+}
+
+SurfaceBoundary::Clip SurfaceBoundary::clip(const QPointF& a, const QPointF& b, const QPointF& c,
+                                            const QPointF& from, const QPointF& to) const
+{
+    const QPointF line[2] = { from, to };
+    return clipTriangle(a, b, c, line);
+}
+
+SurfaceBoundary::Clip SurfaceBoundary::clipTriangle(const QPointF& a, const QPointF& b, const QPointF& c,
+                                                    const QPointF* line) const
+{
+    Clip result;
+    if (isEmpty()) return result;
+
+    // Work relative to a, which keeps the shoelace sums precise for
+    // projected coordinates in the millions
+    QPointF q1 = b - a;
+    QPointF q2 = c - a;
+    if (q1.x() * q2.y() - q2.x() * q1.y() < 0.0) std::swap(q1, q2);
+    const QPointF q0(0.0, 0.0);
+
+    QVector<QPointF> subject;
+    subject.reserve(m_ring.size());
+    for (const QPointF& p : m_ring) {
+        subject.append(p - a);
+    }
+
+    // The ring clipped by the triangle's three half-planes is the part of the
+    // boundary inside the triangle; bridging edges left in concave cases
+    // enclose no area
+    QVector<QPointF> clipped;
+    clipLeftOf(subject, q0, q1, clipped);
+    clipLeftOf(clipped, q1, q2, subject);
+    clipLeftOf(subject, q2, q0, clipped);
+    if (line) {
+        clipLeftOf(clipped, line[0] - a, line[1] - a, subject);
+        clipped.swap(subject);
+    }
+
+    const int n = clipped.size();
+    if (n < 3) return result;
+
+    double twiceArea = 0.0;
+    double cx = 0.0;
+    double cy = 0.0;
+    for (int i = 0; i < n; ++i) {
+        const QPointF& p = clipped[i];
+        const QPointF& q = clipped[(i + 1) % n];
+        const double cross = p.x() * q.y() - q.x() * p.y();
+        twiceArea += cross;
+        cx += (p.x() + q.x()) * cross;
+        cy += (p.y() + q.y()) * cross;
+    }
+    if (twiceArea == 0.0) return result;
+
+    result.area = qMax(0.0, 0.5 * twiceArea * m_orientation);
+    result.centroid = a + QPointF(cx / (3.0 * twiceArea), cy / (3.0 * twiceArea));
+    return result;
+}
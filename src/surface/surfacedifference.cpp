@@ -0,0 +1,369 @@
+#include "surface/surfacedifference.h"
+#include <QtConcurrent>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using GeosBridge::Point3D;
+
+// A corner of an overlay piece and the edge leaving it: 0-2 are the
+// comparison triangle's edges, 3-5 the base triangle's
+struct OverlayCorner {
+    QPointF point;
+    double depth;       // Base minus comparison
+    int edge;
+};
+
+// A run of comparison triangles and what they add up to; filled in on a
+// worker thread
+struct DifferenceChunk {
+    int first;
+    int last;
+    VolumeEngine::CompensatedSum cut;
+    VolumeEngine::CompensatedSum fill;
+    VolumeEngine::CompensatedSum area;
+    int triangles{0};
+    int clipped{0};
+    int split{0};
+    QVector<QVector<QPointF>> segments;     // Isopach segments by level
+};
+
+// A run of vertices to sample the other surface at
+struct DepthRange {
+    int first;
+    int last;
+};
+
+static double cross(const QPointF& a, const QPointF& b)
+{
+    return a.x() * b.y() - a.y() * b.x();
+}
+
+// Height of the plane through three points at p
+static double planeAt(const Point3D& a, const Point3D& b, const Point3D& c, const QPointF& p)
+{
+    const double ux = b.x - a.x, uy = b.y - a.y;
+    const double vx = c.x - a.x, vy = c.y - a.y;
+    const double det = ux * vy - vx * uy;
+    if (det == 0.0) return a.z;
+    const double dx = p.x() - a.x, dy = p.y() - a.y;
+    const double u = (dx * vy - vx * dy) / det;
+    const double v = (ux * dy - dx * uy) / det;
+    return a.z + u * (b.z - a.z) + v * (c.z - a.z);
+}
+
+SurfaceDifference::SurfaceDifference()
+{
+}
+
+void SurfaceDifference::setBoundary(const QVector<QPointF>& boundary)
+{
+    m_engine.setBoundary(boundary);
+}
+
+void SurfaceDifference::setSurfaces(const QVector<Point3D>& basePoints,
+                                    const QVector<int>& baseTriangles,
+                                    const QVector<Point3D>& comparisonPoints,
+                                    const QVector<int>& comparisonTriangles)
+{
+    m_base.build(basePoints, baseTriangles);
+    m_comparison.build(comparisonPoints, comparisonTriangles);
+    m_isopachs.clear();
+
+    // Depth at every vertex of one surface over the other (NaN off it)
+    m_baseDepth.fill(std::numeric_limits<double>::quiet_NaN(), basePoints.size());
+    m_comparisonDepth.fill(std::numeric_limits<double>::quiet_NaN(), comparisonPoints.size());
+    auto sample = [&](const QVector<Point3D>& points, const TriangleIndex& other,
+                      QVector<double>& depths, double sign) {
+        QVector<DepthRange> ranges;
+        for (int first = 0; first < points.size(); first += m_chunkSize) {
+            ranges.append({first, qMin(points.size(), first + m_chunkSize)});
+        }
+        double* depth = depths.data();
+        QtConcurrent::blockingMap(ranges, [&](DepthRange& range) {
+            for (int i = range.first; i < range.last; ++i) {
+                const double z = other.elevationAt(QPointF(points[i].x, points[i].y));
+                depth[i] = sign * (points[i].z - z);
+            }
+        });
+    };
+    sample(basePoints, m_comparison, m_baseDepth, 1.0);
+    sample(comparisonPoints, m_base, m_comparisonDepth, -1.0);
+
+    m_minThickness = std::numeric_limits<double>::max();
+    m_maxThickness = std::numeric_limits<double>::lowest();
+    for (const QVector<double>* depths : { &m_baseDepth, &m_comparisonDepth }) {
+        for (double depth : *depths) {
+            if (std::isnan(depth)) continue;
+            m_minThickness = qMin(m_minThickness, -depth);
+            m_maxThickness = qMax(m_maxThickness, -depth);
+        }
+    }
+    if (m_minThickness > m_maxThickness) {
+        m_minThickness = m_maxThickness = 0.0;
+    }
+}
+
+VolumeEngine::Result SurfaceDifference::compute(const QVector<double>& isopachLevels)
+{
+    QVector<double> levels = isopachLevels;
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+    const QVector<Point3D>& basePoints = m_base.points();
+    const QVector<int>& baseTriangles = m_base.triangles();
+    const QVector<Point3D>& comparisonPoints = m_comparison.points();
+    const QVector<int>& comparisonTriangles = m_comparison.triangles();
+    const int comparisonCount = comparisonPoints.size();
+    const int triangleCount = comparisonTriangles.size() / 3;
+
+    auto overlay = [&](DifferenceChunk& chunk) {
+        chunk.segments.resize(levels.size());
+        QVector<int> candidates;
+        QVector<OverlayCorner> polygon, clipped;
+        QVector<double> sides;
+
+        for (int t = chunk.first; t < chunk.last; ++t) {
+            int c[3] = { comparisonTriangles[3 * t], comparisonTriangles[3 * t + 1], comparisonTriangles[3 * t + 2] };
+            if (c[0] < 0 || c[1] < 0 || c[2] < 0 ||
+                c[0] >= comparisonCount || c[1] >= comparisonCount || c[2] >= comparisonCount) {
+                continue;
+            }
+            const Point3D* cp[3] = { &comparisonPoints[c[0]], &comparisonPoints[c[1]], &comparisonPoints[c[2]] };
+            const double cdet = (cp[1]->x - cp[0]->x) * (cp[2]->y - cp[0]->y) -
+                                (cp[2]->x - cp[0]->x) * (cp[1]->y - cp[0]->y);
+            if (cdet == 0.0) continue;
+            if (cdet < 0.0) {
+                std::swap(c[1], c[2]);
+                std::swap(cp[1], cp[2]);
+            }
+
+            const double minX = qMin(cp[0]->x, qMin(cp[1]->x, cp[2]->x));
+            const double maxX = qMax(cp[0]->x, qMax(cp[1]->x, cp[2]->x));
+            const double minY = qMin(cp[0]->y, qMin(cp[1]->y, cp[2]->y));
+            const double maxY = qMax(cp[0]->y, qMax(cp[1]->y, cp[2]->y));
+            candidates.clear();
+            m_base.trianglesIn(QRectF(minX, minY, maxX - minX, maxY - minY), candidates);
+
+            for (int b : candidates) {
+                int q[3] = { baseTriangles[3 * b], baseTriangles[3 * b + 1], baseTriangles[3 * b + 2] };
+                const Point3D* bp[3] = { &basePoints[q[0]], &basePoints[q[1]], &basePoints[q[2]] };
+                if (qMax(bp[0]->x, qMax(bp[1]->x, bp[2]->x)) < minX || qMin(bp[0]->x, qMin(bp[1]->x, bp[2]->x)) > maxX ||
+                    qMax(bp[0]->y, qMax(bp[1]->y, bp[2]->y)) < minY || qMin(bp[0]->y, qMin(bp[1]->y, bp[2]->y)) > maxY) {
+                    continue;
+                }
+                const double bdet = (bp[1]->x - bp[0]->x) * (bp[2]->y - bp[0]->y) -
+                                    (bp[2]->x - bp[0]->x) * (bp[1]->y - bp[0]->y);
+                if (bdet == 0.0) continue;
+                if (bdet < 0.0) {
+                    std::swap(q[1], q[2]);
+                    std::swap(bp[1], bp[2]);
+                }
+
+                // Where the polygon edge leaving a corner meets base edge k.
+                // Every piece works a crossing out from the same two edges
+                // with their ends in index order, so neighbours agree on it
+                auto crossing = [&](const OverlayCorner& from, const OverlayCorner& to,
+                                    double fromSide, double toSide, int k) {
+                    OverlayCorner corner;
+                    corner.edge = from.edge;
+                    if (from.edge >= 3) {
+                        // Two base edges meet at a base vertex
+                        const int j = from.edge - 3;
+                        const int vertex = (j + 1) % 3 == k ? k : ((k + 1) % 3 == j ? j : -1);
+                        if (vertex >= 0) {
+                            corner.point = QPointF(bp[vertex]->x, bp[vertex]->y);
+                            corner.depth = m_baseDepth[q[vertex]];
+                            return corner;
+                        }
+                    } else {
+                        int a0 = c[from.edge], a1 = c[(from.edge + 1) % 3];
+                        int b0 = q[k], b1 = q[(k + 1) % 3];
+                        if (a0 > a1) std::swap(a0, a1);
+                        if (b0 > b1) std::swap(b0, b1);
+                        const Point3D& p0 = comparisonPoints[a0];
+                        const Point3D& p1 = comparisonPoints[a1];
+                        const Point3D& r0 = basePoints[b0];
+                        const Point3D& r1 = basePoints[b1];
+                        const QPointF along(p1.x - p0.x, p1.y - p0.y);
+                        const QPointF across(r1.x - r0.x, r1.y - r0.y);
+                        const QPointF offset(r0.x - p0.x, r0.y - p0.y);
+                        const double denominator = cross(along, across);
+                        if (denominator != 0.0) {
+                            const double s = qBound(0.0, cross(offset, across) / denominator, 1.0);
+                            // The base edge's line may be met beyond its ends
+                            // (that corner is clipped by another edge later)
+                            const double u = cross(offset, along) / denominator;
+
+                            // An edge through a vertex of the other surface
+                            // meets it there, as the pieces around it see it
+                            const double snap = 1e-12;
+                            const int vertex = qAbs(u) <= snap ? b0 : (qAbs(1.0 - u) <= snap ? b1 : -1);
+                            if (vertex >= 0 && !std::isnan(m_baseDepth[vertex])) {
+                                corner.point = QPointF(basePoints[vertex].x, basePoints[vertex].y);
+                                corner.depth = m_baseDepth[vertex];
+                                return corner;
+                            }
+                            const int apex = s <= snap ? a0 : (s >= 1.0 - snap ? a1 : -1);
+                            if (apex >= 0 && !std::isnan(m_comparisonDepth[apex])) {
+                                corner.point = QPointF(comparisonPoints[apex].x, comparisonPoints[apex].y);
+                                corner.depth = m_comparisonDepth[apex];
+                                return corner;
+                            }
+                            corner.point = QPointF(p0.x + s * along.x(), p0.y + s * along.y());
+                            corner.depth = (r0.z + u * (r1.z - r0.z)) - (p0.z + s * (p1.z - p0.z));
+                            return corner;
+                        }
+                    }
+                    // Parallel edges (only through rounding): interpolate
+                    const double s = fromSide / (fromSide - toSide);
+                    corner.point = from.point + (to.point - from.point) * s;
+                    corner.depth = from.depth + s * (to.depth - from.depth);
+                    return corner;
+                };
+
+                // Sutherland-Hodgman against the base triangle's edges
+                polygon.clear();
+                for (int k = 0; k < 3; ++k) {
+                    polygon.append({ QPointF(cp[k]->x, cp[k]->y), m_comparisonDepth[c[k]], k });
+                }
+                for (int k = 0; k < 3 && polygon.size() >= 3; ++k) {
+                    const QPointF origin(bp[k]->x, bp[k]->y);
+                    const QPointF direction(bp[(k + 1) % 3]->x - origin.x(), bp[(k + 1) % 3]->y - origin.y());
+                    const int n = polygon.size();
+                    sides.resize(n);
+                    for (int i = 0; i < n; ++i) {
+                        sides[i] = cross(direction, polygon[i].point - origin);
+                    }
+                    clipped.clear();
+                    for (int i = 0; i < n; ++i) {
+                        const int next = (i + 1) % n;
+                        if (sides[i] >= 0.0) {
+                            clipped.append(polygon[i]);
+                            if (sides[next] < 0.0) {
+                                if (sides[i] > 0.0) {
+                                    OverlayCorner exit = crossing(polygon[i], polygon[next], sides[i], sides[next], k);
+                                    exit.edge = 3 + k;
+                                    clipped.append(exit);
+                                } else {
+                                    clipped.last().edge = 3 + k;
+                                }
+                            }
+                        } else if (sides[next] > 0.0) {
+                            clipped.append(crossing(polygon[i], polygon[next], sides[i], sides[next], k));
+                        }
+                    }
+                    polygon.swap(clipped);
+                }
+                const int n = polygon.size();
+                if (n < 3) continue;
+
+                // A vertex found just off the other surface by its index
+                // lies on this piece's edge; take it from the two planes
+                for (OverlayCorner& corner : polygon) {
+                    if (std::isnan(corner.depth)) {
+                        corner.depth = planeAt(*bp[0], *bp[1], *bp[2], corner.point) -
+                                       planeAt(*cp[0], *cp[1], *cp[2], corner.point);
+                    }
+                }
+
+                // Volumes of the fan from the first corner
+                double pieceArea = 0.0;
+                for (int i = 1; i + 1 < n; ++i) {
+                    const double d[3] = { polygon[0].depth, polygon[i].depth, polygon[i + 1].depth };
+                    const VolumeEngine::Result facet = m_engine.prism(polygon[0].point, polygon[i].point,
+                                                                      polygon[i + 1].point, d);
+                    chunk.cut.add(facet.cut);
+                    chunk.fill.add(facet.fill);
+                    chunk.area.add(facet.area);
+                    chunk.triangles += facet.triangles;
+                    chunk.clipped += facet.clipped;
+                    chunk.split += facet.split;
+                    pieceArea += facet.area;
+                }
+                if (levels.isEmpty() || pieceArea <= 0.0) continue;
+
+                // Isopachs: thickness is linear over the convex piece, so a
+                // level crosses one rising and one falling edge. A corner
+                // exactly on a level counts as below it, as in ContourEngine
+                double low = std::numeric_limits<double>::max();
+                double high = std::numeric_limits<double>::lowest();
+                for (const OverlayCorner& corner : polygon) {
+                    low = qMin(low, -corner.depth);
+                    high = qMax(high, -corner.depth);
+                }
+                const int firstLevel = std::lower_bound(levels.begin(), levels.end(), low) - levels.begin();
+                const int lastLevel = std::lower_bound(levels.begin(), levels.end(), high) - levels.begin();
+                for (int level = firstLevel; level < lastLevel; ++level) {
+                    const double value = levels[level];
+                    QPointF start, end;
+                    bool rising = false, falling = false;
+                    for (int i = 0; i < n; ++i) {
+                        const OverlayCorner* p = &polygon[i];
+                        const OverlayCorner* r = &polygon[(i + 1) % n];
+                        const bool up = -p->depth <= value && -r->depth > value;
+                        const bool down = -p->depth > value && -r->depth <= value;
+                        if (!up && !down) continue;
+
+                        // Interpolate from the lower-left end so the piece
+                        // across the edge computes the same point
+                        if (r->point.x() < p->point.x() || (r->point.x() == p->point.x() && r->point.y() < p->point.y())) {
+                            std::swap(p, r);
+                        }
+                        const double s = (value + p->depth) / (p->depth - r->depth);
+                        const QPointF point = p->point + (r->point - p->point) * s;
+                        if (up) {
+                            start = point;
+                            rising = true;
+                        } else {
+                            end = point;
+                            falling = true;
+                        }
+                    }
+                    if (rising && falling && start != end) {
+                        chunk.segments[level].append(start);
+                        chunk.segments[level].append(end);
+                    }
+                }
+            }
+        }
+    };
+
+    QVector<DifferenceChunk> chunks;
+    for (int first = 0; first < triangleCount; first += m_chunkSize) {
+        DifferenceChunk chunk;
+        chunk.first = first;
+        chunk.last = qMin(triangleCount, first + m_chunkSize);
+        chunks.append(chunk);
+    }
+    QtConcurrent::blockingMap(chunks, overlay);
+
+    // Chunks are added in order, so the totals are the same on every run
+    VolumeEngine::Result result;
+    VolumeEngine::CompensatedSum cut, fill, area;
+    for (const DifferenceChunk& chunk : chunks) {
+        cut.add(chunk.cut.value());
+        fill.add(chunk.fill.value());
+        area.add(chunk.area.value());
+        result.triangles += chunk.triangles;
+        result.clipped += chunk.clipped;
+        result.split += chunk.split;
+    }
+    result.cut = cut.value();
+    result.fill = fill.value();
+    result.area = area.value();
+
+    m_isopachs.clear();
+    for (int level = 0; level < levels.size(); ++level) {
+        QVector<QPointF> segments;
+        for (DifferenceChunk& chunk : chunks) {
+            segments += chunk.segments[level];
+            chunk.segments[level] = QVector<QPointF>();
+        }
+        if (!segments.isEmpty()) {
+            m_isopachs += ContourEngine::stitchSegments(levels[level], segments);
+        }
+    }
+    return result;
+}
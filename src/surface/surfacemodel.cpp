@@ -0,0 +1,209 @@
+#include "surface/surfacemodel.h"
+#include "canvas/canvaswidget.h"
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+
+using GeosBridge::Point3D;
+
+SurfaceModel::SurfaceModel()
+{
+}
+
+bool SurfaceModel::build(const QVector<Point3D>& points,
+                         const QVector<CanvasPolyline>& polylines,
+                         const QVector<int>& breaklines,
+                         const QVector<QPointF>& boundary)
+{
+    m_triangles.clear();
+    m_neighbours.clear();
+    m_info.clear();
+    m_changed.clear();
+    m_inputVertex.resize(points.size());
+    for (int i = 0; i < points.size(); ++i) {
+        m_inputVertex[i] = i;
+    }
+    m_triangleCount = 0;
+    m_breaklineCount = 0;
+    m_editable = breaklines.isEmpty() && boundary.size() < 3;
+    m_lastError.clear();
+
+    if (!m_tin.build(points)) {
+        m_lastError = m_tin.lastError();
+        return false;
+    }
+    // A surface missing a breakline or its boundary would pass for a good
+    // one, so either failure fails the build
+    int requested = 0;
+    for (int index : breaklines) {
+        if (index >= 0 && index < polylines.size() && polylines[index].points.size() >= 2) ++requested;
+    }
+    m_breaklineCount = m_tin.insertBreaklines(polylines, breaklines);
+    if (m_breaklineCount < requested) {
+        m_lastError = QString("Only %1 of %2 breaklines could be inserted: %3")
+                          .arg(m_breaklineCount).arg(requested).arg(m_tin.lastError());
+        return false;
+    }
+    if (boundary.size() >= 3 && !m_tin.setBoundary(boundary)) {
+        m_lastError = QString("Boundary could not be inserted: %1").arg(m_tin.lastError());
+        return false;
+    }
+
+    m_tin.takeChangedTriangles();
+    m_minZ = std::numeric_limits<double>::max();
+    m_maxZ = std::numeric_limits<double>::lowest();
+    m_planArea = 0.0;
+    m_surfaceArea = 0.0;
+    QVector<int> all(m_tin.triangleSlots().size() / 3);
+    for (int t = 0; t < all.size(); ++t) {
+        all[t] = t;
+    }
+    refreshTriangles(all);
+    m_changed.clear();
+
+    if (m_triangleCount == 0) {
+        m_lastError = "No triangles inside the boundary";
+        return false;
+    }
+    return true;
+}
+
+bool SurfaceModel::insertPoint(int index, const Point3D& point)
+{
+    if (!m_editable || index < 0 || index > m_inputVertex.size()) return false;
+
+    m_inputVertex.insert(index, m_tin.addVertex(point));
+    refreshTriangles(m_tin.takeChangedTriangles());
+    return true;
+}
+
+bool SurfaceModel::removePoint(int index)
+{
+    if (!m_editable || index < 0 || index >= m_inputVertex.size()) return false;
+
+    const int vertex = m_inputVertex[index];
+    const bool attached = m_tin.isAttached(vertex);
+    if (!m_tin.removeVertex(vertex)) return false;
+    m_inputVertex.remove(index);
+    if (attached) attachDuplicate(m_tin.points()[vertex]);
+    refreshTriangles(m_tin.takeChangedTriangles());
+    return true;
+}
+
+bool SurfaceModel::movePoint(int index, const Point3D& point)
+{
+    if (!m_editable || index < 0 || index >= m_inputVertex.size()) return false;
+
+    const int vertex = m_inputVertex[index];
+    const Point3D old = m_tin.points()[vertex];
+    const bool attached = m_tin.isAttached(vertex);
+    if (!m_tin.moveVertex(vertex, point)) return false;
+    if (attached && (old.x != point.x || old.y != point.y)) attachDuplicate(old);
+    refreshTriangles(m_tin.takeChangedTriangles());
+    return true;
+}
+
+void SurfaceModel::attachDuplicate(const Point3D& position)
+{
+    // A point that build() or an earlier edit skipped as a duplicate of the
+    // vertex that just left takes its place
+    const double tolerance = m_tin.tolerance();
+    const QVector<Point3D>& points = m_tin.points();
+    for (int vertex : m_inputVertex) {
+        if (m_tin.isAttached(vertex)) continue;
+        const Point3D& p = points[vertex];
+        if (qAbs(p.x - position.x) <= tolerance && qAbs(p.y - position.y) <= tolerance) {
+            m_tin.moveVertex(vertex, p);
+            return;
+        }
+    }
+}
+
+void SurfaceModel::refreshTriangles(const QVector<int>& changed)
+{
+    const QVector<int>& tinSlots = m_tin.triangleSlots();
+    const QVector<int>& halfedges = m_tin.halfedges();
+    const QVector<Point3D>& points = m_tin.points();
+    const int slotCount = tinSlots.size() / 3;
+    m_changed = changed;
+    if (m_triangles.size() < tinSlots.size()) {
+        m_triangles.resize(tinSlots.size());
+        m_neighbours.resize(tinSlots.size());
+        std::fill(m_triangles.begin() + 3 * m_info.size(), m_triangles.end(), -1);
+        std::fill(m_neighbours.begin() + 3 * m_info.size(), m_neighbours.end(), -1);
+        m_info.resize(slotCount);
+    }
+
+    bool rescan = false;
+    for (int t : changed) {
+        // Take out what the slot held before
+        if (m_triangles[3 * t] >= 0) {
+            const TriangleInfo& info = m_info[t];
+            m_planArea -= info.area;
+            if (info.nz > 0.0) m_surfaceArea -= info.area / info.nz;
+            if (info.minZ <= m_minZ || info.maxZ >= m_maxZ) rescan = true;
+            --m_triangleCount;
+        }
+
+        if (!m_tin.isInside(t)) {
+            m_triangles[3 * t] = m_triangles[3 * t + 1] = m_triangles[3 * t + 2] = -1;
+            m_info[t] = TriangleInfo();
+            continue;
+        }
+        for (int i = 0; i < 3; ++i) {
+            m_triangles[3 * t + i] = tinSlots[3 * t + i];
+        }
+
+        const Point3D& p0 = points[m_triangles[3 * t]];
+        const Point3D& p1 = points[m_triangles[3 * t + 1]];
+        const Point3D& p2 = points[m_triangles[3 * t + 2]];
+
+        // Cross product of the two edges from p0; z is twice the plan area
+        const double ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+        const double vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+        const double cx = uy * vz - uz * vy;
+        const double cy = uz * vx - ux * vz;
+        const double cz = ux * vy - uy * vx;
+        const double length = qSqrt(cx * cx + cy * cy + cz * cz);
+
+        TriangleInfo& info = m_info[t];
+        info = TriangleInfo();
+        info.area = 0.5 * cz;
+        if (length > 0.0) {
+            info.nx = cx / length;
+            info.ny = cy / length;
+            info.nz = cz / length;
+        }
+        info.minZ = qMin(p0.z, qMin(p1.z, p2.z));
+        info.maxZ = qMax(p0.z, qMax(p1.z, p2.z));
+
+        m_minZ = qMin(m_minZ, info.minZ);
+        m_maxZ = qMax(m_maxZ, info.maxZ);
+        m_planArea += info.area;
+        if (info.nz > 0.0) m_surfaceArea += info.area / info.nz;
+        ++m_triangleCount;
+    }
+
+    // Relinked neighbours are in the list too, so only these slots change
+    for (int t : changed) {
+        for (int i = 0; i < 3; ++i) {
+            const int opposite = halfedges[3 * t + i];
+            const bool live = m_triangles[3 * t] >= 0 && opposite >= 0 && m_triangles[opposite - opposite % 3] >= 0;
+            m_neighbours[3 * t + i] = live ? opposite / 3 : -1;
+        }
+    }
+
+    // A removed triangle held an extreme; find the new one
+    if (rescan) {
+        m_minZ = std::numeric_limits<double>::max();
+        m_maxZ = std::numeric_limits<double>::lowest();
+        for (int t = 0; t < slotCount; ++t) {
+            if (m_triangles[3 * t] < 0) continue;
+            m_minZ = qMin(m_minZ, m_info[t].minZ);
+            m_maxZ = qMax(m_maxZ, m_info[t].maxZ);
+        }
+    }
+    if (m_triangleCount == 0) {
+        m_minZ = m_maxZ = 0.0;
+    }
+}
@@ -0,0 +1,166 @@
+#include "surface/triangleindex.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using GeosBridge::Point3D;
+
+TriangleIndex::TriangleIndex()
+{
+}
+
+int TriangleIndex::columnOf(double x) const
+{
+    return qBound(0, static_cast<int>(std::floor((x - m_bounds.left()) / m_cellWidth)), m_columns - 1);
+}
+
+int TriangleIndex::rowOf(double y) const
+{
+    return qBound(0, static_cast<int>(std::floor((y - m_bounds.top()) / m_cellHeight)), m_rows - 1);
+}
+
+void TriangleIndex::build(const QVector<Point3D>& points, const QVector<int>& triangles)
+{
+    m_points = points;
+    m_triangles = triangles;
+    m_bounds = QRectF();
+    m_columns = m_rows = 0;
+    m_cellStart.clear();
+    m_cellTriangles.clear();
+
+    const int count = points.size();
+    auto valid = [&](int t) {
+        for (int i = 0; i < 3; ++i) {
+            const int v = triangles[3 * t + i];
+            if (v < 0 || v >= count) return false;
+        }
+        return true;
+    };
+
+    double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+    double minY = minX, maxY = maxX;
+    int live = 0;
+    const int triangleCount = triangles.size() / 3;
+    for (int t = 0; t < triangleCount; ++t) {
+        if (!valid(t)) continue;
+        for (int i = 0; i < 3; ++i) {
+            const Point3D& p = points[triangles[3 * t + i]];
+            minX = qMin(minX, p.x);
+            maxX = qMax(maxX, p.x);
+            minY = qMin(minY, p.y);
+            maxY = qMax(maxY, p.y);
+        }
+        ++live;
+    }
+    if (live == 0 || maxX <= minX || maxY <= minY) return;
+
+    // About one cell per triangle, shaped like the extent
+    m_bounds = QRectF(minX, minY, maxX - minX, maxY - minY);
+    const double aspect = m_bounds.width() / m_bounds.height();
+    const double cells = qMin(static_cast<double>(live), 16.0e6);
+    m_columns = qBound(1, static_cast<int>(std::ceil(std::sqrt(cells * aspect))), 8192);
+    m_rows = qBound(1, static_cast<int>(std::ceil(cells / m_columns)), 8192);
+    m_cellWidth = m_bounds.width() / m_columns;
+    m_cellHeight = m_bounds.height() / m_rows;
+
+    // Count, then fill: two passes over the bounding boxes
+    m_cellStart.fill(0, m_columns * m_rows + 1);
+    auto forCells = [&](int t, auto&& visit) {
+        const Point3D& a = points[triangles[3 * t]];
+        const Point3D& b = points[triangles[3 * t + 1]];
+        const Point3D& c = points[triangles[3 * t + 2]];
+        const int col0 = columnOf(qMin(a.x, qMin(b.x, c.x)));
+        const int col1 = columnOf(qMax(a.x, qMax(b.x, c.x)));
+        const int row0 = rowOf(qMin(a.y, qMin(b.y, c.y)));
+        const int row1 = rowOf(qMax(a.y, qMax(b.y, c.y)));
+        for (int row = row0; row <= row1; ++row) {
+            for (int col = col0; col <= col1; ++col) {
+                visit(row * m_columns + col);
+            }
+        }
+    };
+    for (int t = 0; t < triangleCount; ++t) {
+        if (valid(t)) forCells(t, [&](int cell) { ++m_cellStart[cell + 1]; });
+    }
+    for (int cell = 0; cell < m_columns * m_rows; ++cell) {
+        m_cellStart[cell + 1] += m_cellStart[cell];
+    }
+    m_cellTriangles.resize(m_cellStart.last());
+    QVector<int> next = m_cellStart;
+    for (int t = 0; t < triangleCount; ++t) {
+        if (valid(t)) forCells(t, [&](int cell) { m_cellTriangles[next[cell]++] = t; });
+    }
+}
+
+int TriangleIndex::triangleAt(const QPointF& point, double& u, double& v) const
+{
+    if (isEmpty()) return -1;
+    const double px = point.x();
+    const double py = point.y();
+    if (px < m_bounds.left() || px > m_bounds.right() || py < m_bounds.top() || py > m_bounds.bottom()) {
+        return -1;
+    }
+
+    const int cell = rowOf(py) * m_columns + columnOf(px);
+    for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+        const int t = m_cellTriangles[i];
+        const Point3D& a = m_points[m_triangles[3 * t]];
+        const Point3D& b = m_points[m_triangles[3 * t + 1]];
+        const Point3D& c = m_points[m_triangles[3 * t + 2]];
+        const double ux = b.x - a.x, uy = b.y - a.y;
+        const double vx = c.x - a.x, vy = c.y - a.y;
+        const double det = ux * vy - vx * uy;
+        if (det == 0.0) continue;
+
+        // A point on a shared edge may land in either triangle
+        const double dx = px - a.x, dy = py - a.y;
+        const double s = (dx * vy - vx * dy) / det;
+        const double r = (ux * dy - dx * uy) / det;
+        const double epsilon = 1e-12;
+        if (s >= -epsilon && r >= -epsilon && s + r <= 1.0 + epsilon) {
+            u = s;
+            v = r;
+            return t;
+        }
+    }
+    return -1;
+}
+
+double TriangleIndex::elevationAt(const QPointF& point) const
+{
+    double u = 0.0, v = 0.0;
+    const int t = triangleAt(point, u, v);
+    if (t < 0) return std::numeric_limits<double>::quiet_NaN();
+    const double z0 = m_points[m_triangles[3 * t]].z;
+    const double z1 = m_points[m_triangles[3 * t + 1]].z;
+    const double z2 = m_points[m_triangles[3 * t + 2]].z;
+    return z0 + u * (z1 - z0) + v * (z2 - z0);
+}
+
+void TriangleIndex::trianglesIn(const QRectF& rect, QVector<int>& triangles) const
+{
+    if (isEmpty()) return;
+    if (rect.right() < m_bounds.left() || rect.left() > m_bounds.right() ||
+        rect.bottom() < m_bounds.top() || rect.top() > m_bounds.bottom()) {
+        return;
+    }
+
+    const int first = triangles.size();
+    const int col0 = columnOf(rect.left()), col1 = columnOf(rect.right());
+    const int row0 = rowOf(rect.top()), row1 = rowOf(rect.bottom());
+    for (int row = row0; row <= row1; ++row) {
+        for (int col = col0; col <= col1; ++col) {
+            const int cell = row * m_columns + col;
+            for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                triangles.append(m_cellTriangles[i]);
+            }
+        }
+    }
+
+    // A triangle spanning several cells is listed in each
+    if (row1 > row0 || col1 > col0) {
+        std::sort(triangles.begin() + first, triangles.end());
+        triangles.erase(std::unique(triangles.begin() + first, triangles.end()), triangles.end());
+    }
+}
@@ -0,0 +1,279 @@
+#include "surface/volumeengine.h"
+#include "gdal/elevationgrid.h"
+#include <QtConcurrent>
+#include <QtMath>
+#include <cmath>
+#include <limits>
+
+using GeosBridge::Point3D;
+
+// A run of triangles and its totals; filled in on a worker thread
+struct VolumeChunk {
+    int first;
+    int last;
+    VolumeEngine::CompensatedSum cut;
+    VolumeEngine::CompensatedSum fill;
+    VolumeEngine::CompensatedSum area;
+    int triangles{0};
+    int clipped{0};
+    int split{0};
+    int uncovered{0};
+};
+
+// A run of vertices to sample the design at
+struct VertexRange {
+    int first;
+    int last;
+};
+
+// Volume above and below zero of the linear function with corner values d
+// over a triangle of the given plan area. When the corners straddle zero,
+// the corner alone on its side cuts off a triangle of height d[k] and
+// relative area d[k]^2 / ((d[k] - d[i]) (d[k] - d[j])), a pyramid of
+// volume area * d[k]^3 / (3 (d[k] - d[i]) (d[k] - d[j])).
+static bool splitVolume(const double d[3], double area, double& cut, double& fill)
+{
+    const double net = area * (d[0] + d[1] + d[2]) / 3.0;
+    int positive = 0, negative = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (d[i] > 0.0) ++positive;
+        else if (d[i] < 0.0) ++negative;
+    }
+    if (negative == 0 || positive == 0) {
+        cut = qMax(0.0, net);
+        fill = qMax(0.0, -net);
+        return false;
+    }
+
+    int k = 0;
+    for (int i = 0; i < 3; ++i) {
+        if ((positive == 1 && d[i] > 0.0) || (positive != 1 && d[i] < 0.0)) k = i;
+    }
+    const double dk = d[k], di = d[(k + 1) % 3], dj = d[(k + 2) % 3];
+    const double corner = area * dk * dk * dk / (3.0 * (dk - di) * (dk - dj));
+    if (dk > 0.0) {
+        cut = corner;
+        fill = qMax(0.0, corner - net);
+    } else {
+        fill = -corner;
+        cut = qMax(0.0, net - corner);
+    }
+    return true;
+}
+
+VolumeEngine::VolumeEngine()
+{
+}
+
+void VolumeEngine::setBoundary(const QVector<QPointF>& boundary)
+{
+    m_boundary.setRing(boundary);
+}
+
+void VolumeEngine::setDesignLevel(double level)
+{
+    m_design = Design::Level;
+    m_origin = QPointF();
+    m_level = level;
+    m_gradeX = m_gradeY = 0.0;
+}
+
+void VolumeEngine::setDesignPlane(const QPointF& origin, double level, double gradeX, double gradeY)
+{
+    m_design = Design::Plane;
+    m_origin = origin;
+    m_level = level;
+    m_gradeX = gradeX;
+    m_gradeY = gradeY;
+}
+
+void VolumeEngine::setDesignSurface(const QVector<Point3D>& points, const QVector<int>& triangles)
+{
+    m_design = Design::Surface;
+    m_designSurface.build(points, triangles);
+}
+
+void VolumeEngine::setDesignGrid(ElevationGrid* grid)
+{
+    m_design = Design::Grid;
+    m_designGrid = grid;
+}
+
+QVector<double> VolumeEngine::designHeights(const QVector<Point3D>& points,
+                                            const QVector<int>& triangles) const
+{
+    // Planes are evaluated in place
+    QVector<double> heights;
+    if (m_design == Design::Level || m_design == Design::Plane) return heights;
+
+    const int count = points.size();
+    heights.fill(std::numeric_limits<double>::quiet_NaN(), count);
+    double* height = heights.data();
+
+    if (m_design == Design::Surface) {
+        QVector<VertexRange> ranges;
+        for (int first = 0; first < count; first += m_chunkSize) {
+            ranges.append({first, qMin(count, first + m_chunkSize)});
+        }
+        QtConcurrent::blockingMap(ranges, [&](VertexRange& range) {
+            for (int i = range.first; i < range.last; ++i) {
+                height[i] = m_designSurface.elevationAt(QPointF(points[i].x, points[i].y));
+            }
+        });
+    } else if (m_designGrid) {
+        // Only the vertices in use, so unused points cost no DEM reads
+        QVector<char> used(count, 0);
+        for (int v : triangles) {
+            if (v >= 0 && v < count) used[v] = 1;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (used[i]) height[i] = m_designGrid->elevationAt(QPointF(points[i].x, points[i].y));
+        }
+    }
+    return heights;
+}
+
+VolumeEngine::Result VolumeEngine::prism(const QPointF& a, const QPointF& b, const QPointF& c,
+                                         const double d[3]) const
+{
+    Result result;
+    const double ux = b.x() - a.x(), uy = b.y() - a.y();
+    const double vx = c.x() - a.x(), vy = c.y() - a.y();
+    const double det = ux * vy - vx * uy;
+    if (det == 0.0) return result;
+    if (std::isnan(d[0]) || std::isnan(d[1]) || std::isnan(d[2])) {
+        result.uncovered = 1;
+        return result;
+    }
+
+    double area = 0.5 * qAbs(det);
+    SurfaceBoundary::Coverage coverage = SurfaceBoundary::Coverage::Inside;
+    if (!m_boundary.isEmpty()) {
+        coverage = m_boundary.classify(a, b, c);
+        if (coverage == SurfaceBoundary::Coverage::Outside) return result;
+    }
+
+    bool split = false;
+    if (coverage == SurfaceBoundary::Coverage::Partial) {
+        const SurfaceBoundary::Clip clip = m_boundary.clip(a, b, c);
+        if (clip.area <= 0.0) return result;
+        if (clip.area < area * (1.0 - 1e-9)) result.clipped = 1;
+        area = qMin(area, clip.area);
+
+        // The difference is linear over the facet, so a piece's volume is
+        // its area times the difference at its centroid
+        auto differenceAt = [&](const QPointF& point) {
+            const double dx = point.x() - a.x();
+            const double dy = point.y() - a.y();
+            const double u = (dx * vy - vx * dy) / det;
+            const double v = (ux * dy - dx * uy) / det;
+            return d[0] + u * (d[1] - d[0]) + v * (d[2] - d[0]);
+        };
+        const double net = area * differenceAt(clip.centroid);
+
+        double wholeCut = 0.0, wholeFill = 0.0;
+        split = splitVolume(d, 0.5 * qAbs(det), wholeCut, wholeFill);
+        if (!split) {
+            result.cut = qMax(0.0, net);
+            result.fill = qMax(0.0, -net);
+        } else {
+            // Clip again to the side of the zero line above the design
+            int k = 0;
+            for (int i = 0; i < 3; ++i) {
+                const int j = (i + 1) % 3, l = (i + 2) % 3;
+                if ((d[i] > 0.0) != (d[j] > 0.0) && (d[i] > 0.0) != (d[l] > 0.0)) k = i;
+            }
+            const QPointF corner[3] = { a, b, c };
+            const int i = (k + 1) % 3, j = (k + 2) % 3;
+            QPointF from = corner[k] + (corner[i] - corner[k]) * (d[k] / (d[k] - d[i]));
+            QPointF to = corner[k] + (corner[j] - corner[k]) * (d[k] / (d[k] - d[j]));
+            const QPointF above = d[k] > 0.0 ? corner[k] : (d[i] > 0.0 ? corner[i] : corner[j]);
+            const QPointF direction = to - from;
+            if (direction.x() * (above.y() - from.y()) - direction.y() * (above.x() - from.x()) < 0.0) {
+                std::swap(from, to);
+            }
+            const SurfaceBoundary::Clip upper = m_boundary.clip(a, b, c, from, to);
+            result.cut = upper.area > 0.0 ? qMax(0.0, upper.area * differenceAt(upper.centroid)) : 0.0;
+            result.fill = qMax(0.0, result.cut - net);
+        }
+    } else {
+        split = splitVolume(d, area, result.cut, result.fill);
+    }
+
+    result.area = area;
+    result.triangles = 1;
+    result.split = split ? 1 : 0;
+    return result;
+}
+
+VolumeEngine::Result VolumeEngine::compute(const QVector<Point3D>& points,
+                                           const QVector<int>& triangles) const
+{
+    const QVector<double> heights = designHeights(points, triangles);
+    const int count = points.size();
+    const int triangleCount = triangles.size() / 3;
+
+    auto designAt = [&](int v) {
+        if (!heights.isEmpty()) return heights[v];
+        return m_level + m_gradeX * (points[v].x - m_origin.x()) + m_gradeY * (points[v].y - m_origin.y());
+    };
+
+    auto cutTriangles = [&](VolumeChunk& chunk) {
+        for (int t = chunk.first; t < chunk.last; ++t) {
+            const int i0 = triangles[3 * t];
+            const int i1 = triangles[3 * t + 1];
+            const int i2 = triangles[3 * t + 2];
+            if (i0 < 0 || i1 < 0 || i2 < 0 || i0 >= count || i1 >= count || i2 >= count) continue;
+
+            const Point3D& p0 = points[i0];
+            const Point3D& p1 = points[i1];
+            const Point3D& p2 = points[i2];
+
+            // Surface height above the design at each corner
+            const double d[3] = { p0.z - designAt(i0), p1.z - designAt(i1), p2.z - designAt(i2) };
+            const Result piece = prism(QPointF(p0.x, p0.y), QPointF(p1.x, p1.y), QPointF(p2.x, p2.y), d);
+            chunk.cut.add(piece.cut);
+            chunk.fill.add(piece.fill);
+            chunk.area.add(piece.area);
+            chunk.triangles += piece.triangles;
+            chunk.clipped += piece.clipped;
+            chunk.split += piece.split;
+            chunk.uncovered += piece.uncovered;
+        }
+    };
+
+    QVector<VolumeChunk> chunks;
+    for (int first = 0; first < triangleCount; first += m_chunkSize) {
+        VolumeChunk chunk;
+        chunk.first = first;
+        chunk.last = qMin(triangleCount, first + m_chunkSize);
+        chunks.append(chunk);
+    }
+    QtConcurrent::blockingMap(chunks, cutTriangles);
+
+    // Chunks are added in order, so the totals are the same on every run
+    Result result;
+    CompensatedSum cut, fill, area;
+    for (const VolumeChunk& chunk : chunks) {
+        cut.add(chunk.cut.value());
+        fill.add(chunk.fill.value());
+        area.add(chunk.area.value());
+        result.triangles += chunk.triangles;
+        result.clipped += chunk.clipped;
+        result.split += chunk.split;
+        result.uncovered += chunk.uncovered;
+    }
+    result.cut = cut.value();
+    result.fill = fill.value();
+    result.area = area.value();
+    return result;
+}
+
+VolumeEngine::Result VolumeEngine::computeAgainstLevel(const QVector<Point3D>& points,
+                                                       const QVector<int>& triangles,
+                                                       double level) const
+{
+    VolumeEngine engine(*this);
+    engine.setDesignLevel(level);
+    return engine.compute(points, triangles);
+}
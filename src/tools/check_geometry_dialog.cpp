@@ -6,7 +6,6 @@
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QDebug>
-#include <QRegularExpression>
 
 CheckGeometryDialog::CheckGeometryDialog(CanvasWidget* canvas, CheckMode mode, QWidget *parent)
     : QDialog(parent), m_canvas(canvas), m_mode(mode)
@@ -34,6 +33,27 @@ void CheckGeometryDialog::setupUi()
     m_statusLabel->setFont(headerFont);
     mainLayout->addWidget(m_statusLabel);
 
+    // Topology options (overlaps and gaps between polygons)
+    QHBoxLayout* optionsLayout = new QHBoxLayout();
+    m_topologyCheck = new QCheckBox("Check overlaps and gaps", this);
+    m_topologyCheck->setChecked(true);
+    m_topologyCheck->setToolTip("Report polygons that overlap each other and small gaps between neighbours");
+    connect(m_topologyCheck, &QCheckBox::toggled, this, &CheckGeometryDialog::onRefreshClicked);
+    
+    m_gapAreaSpin = new QDoubleSpinBox(this);
+    m_gapAreaSpin->setRange(0.0, 1e6);
+    m_gapAreaSpin->setDecimals(3);
+    m_gapAreaSpin->setValue(1.0);
+    m_gapAreaSpin->setSuffix(" sq units");
+    m_gapAreaSpin->setToolTip("Holes larger than this are treated as intentional voids, not gaps");
+    
+    optionsLayout->addWidget(m_topologyCheck);
+    optionsLayout->addSpacing(12);
+    optionsLayout->addWidget(new QLabel("Max gap area:", this));
+    optionsLayout->addWidget(m_gapAreaSpin);
+    optionsLayout->addStretch();
+    mainLayout->addLayout(optionsLayout);
+
     // Table
     m_issueTable = new QTableWidget(this);
     m_issueTable->setColumnCount(3);
@@ -101,35 +121,43 @@ void CheckGeometryDialog::runAnalysis()
         for(int i=0; i<polylines.size(); ++i) indicesToCheck.append(i);
     }
     
+    // Validity and topology run in parallel, each thread with its own GEOS context
+    GeometryValidator::Options options;
+    options.checkTopology = m_topologyCheck->isChecked();
+    options.maxGapArea = m_gapAreaSpin->value();
+    
     int processed = 0;
-    int issuesFound = 0;
+    const QVector<GeometryValidator::Issue> results =
+        GeometryValidator::validate(polylines, indicesToCheck, options, &processed);
+    int issuesFound = results.size();
     
     // Disable updates for speed
     m_issueTable->setUpdatesEnabled(false);
     
-    for (int idx : indicesToCheck) {
-        if (idx < 0 || idx >= polylines.size()) continue;
-        const auto& poly = polylines[idx];
-        
-        if (!poly.closed) continue; // Skip lines, only check polygons
+    for (const auto& result : results) {
+        Issue issue;
+        issue.type = result.type;
+        issue.polyIndex = result.index;
+        issue.error = result.reason;
+        if (result.hasLocation) {
+            issue.error += QString(" at %1, %2").arg(result.location.x(), 0, 'f', 3).arg(result.location.y(), 0, 'f', 3);
+        }
+        issue.errorLocation = result.hasLocation ? result.location : QPointF(0, 0);
         
-        processed++;
-        bool valid = GeosBridge::isValid(poly.points);
-        if (!valid) {
-             QString error = GeosBridge::lastError();
-             
-             Issue issue;
-             issue.polyIndex = idx;
-             issue.layer = poly.layer;
-             issue.error = error;
-             issue.originalPoints = poly.points;
-             issue.errorLocation = parseErrorLocation(error);
-             
-             m_issues.append(issue); // Append to list
-             addIssueRow(idx, poly.layer, error); // Add to table
-             
-             issuesFound++;
+        QString id = QString::number(result.index);
+        if (result.type == GeometryValidator::IssueType::Invalid) {
+            issue.layer = polylines[result.index].layer;
+            issue.originalPoints = polylines[result.index].points;
+        } else if (result.type == GeometryValidator::IssueType::Overlap) {
+            issue.layer = polylines[result.index].layer;
+            id = QString("%1 / %2").arg(result.index).arg(result.otherIndex);
+        } else {
+            issue.layer = "-";
+            id = "Gap";
         }
+        
+        m_issues.append(issue); // Append to list
+        addIssueRow(id, issue.polyIndex, issue.layer, issue.error); // Add to table
     }
     
     m_issueTable->setUpdatesEnabled(true);
@@ -144,12 +172,12 @@ void CheckGeometryDialog::runAnalysis()
     }
 }
 
-void CheckGeometryDialog::addIssueRow(int polyIndex, const QString& layer, const QString& error)
+void CheckGeometryDialog::addIssueRow(const QString& id, int polyIndex, const QString& layer, const QString& error)
 {
     int row = m_issueTable->rowCount();
     m_issueTable->insertRow(row);
     
-    QTableWidgetItem* idItem = new QTableWidgetItem(QString::number(polyIndex));
+    QTableWidgetItem* idItem = new QTableWidgetItem(id);
     idItem->setData(Qt::UserRole, polyIndex); // Store ID for safe keeping
     m_issueTable->setItem(row, 0, idItem);
     
@@ -214,7 +242,9 @@ void CheckGeometryDialog::onZoomToClicked()
         int polyIdx = m_issues[row].polyIndex;
         // Tell canvas to zoom or select
         m_canvas->clearSelection();
-        m_canvas->addToSelection(polyIdx);
+        if (polyIdx >= 0) {
+            m_canvas->addToSelection(polyIdx);
+        }
         
         // Zoom to error location if available
         QPointF loc = m_issues[row].errorLocation;
@@ -239,6 +269,7 @@ void CheckGeometryDialog::onFixSelectedClicked()
     for (int row : rows) {
         if (row < 0 || row >= m_issues.size()) continue;
         const Issue& issue = m_issues[row];
+        if (issue.type != GeometryValidator::IssueType::Invalid) continue; // Topology needs manual editing
         
         QVector<QPointF> points = issue.originalPoints;
         // Reload current points from canvas just in case?
@@ -284,6 +315,7 @@ void CheckGeometryDialog::onAutoFixSelectedClicked()
     for (int row : rows) {
         if (row < 0 || row >= m_issues.size()) continue;
         const Issue& issue = m_issues[row];
+        if (issue.type != GeometryValidator::IssueType::Invalid) continue; // Topology needs manual editing
         
         // Re-fetch current points from canvas to ensure we are working on latest state
         // (Though replacePolylinePoints uses index, so it's fine).
@@ -304,17 +336,3 @@ void CheckGeometryDialog::onAutoFixSelectedClicked()
     runAnalysis(); // Refresh list
     QMessageBox::information(this, "Fix Complete", QString("Applied Auto Fix to %1 geometries.").arg(fixedCount));
 }
-
-QPointF CheckGeometryDialog::parseErrorLocation(const QString& error)
-{
-    // Example: "Self-intersection at or near point 39.53 1.19"
-    static QRegularExpression re(R"(point\s+([-\d.]+)\s+([-\d.]+))");
-    QRegularExpressionMatch match = re.match(error);
-    if (match.hasMatch()) {
-        bool okX, okY;
-        double x = match.captured(1).toDouble(&okX);
-        double y = match.captured(2).toDouble(&okY);
-        if (okX && okY) return QPointF(x, y);
-    }
-    return QPointF(0,0);
-}
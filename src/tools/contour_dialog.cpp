@@ -1,6 +1,9 @@
 #include "tools/contour_dialog.h"
 #include "canvas/canvaswidget.h"
 #include "gdal/geosbridge.h"
+#include "gdal/elevationgrid.h"
+#include "surface/surfacemodel.h"
+#include "surface/contourengine.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -11,7 +14,10 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QMessageBox>
+#include <QApplication>
+#include <QtMath>
 
 ContourDialog::ContourDialog(CanvasWidget* canvas, QWidget *parent)
     : QDialog(parent), m_canvas(canvas)
@@ -27,7 +33,7 @@ void ContourDialog::setupUi()
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
     
     // Instructions
-    QLabel* infoLabel = new QLabel("Generate contour lines from survey points using Delaunay triangulation.");
+    QLabel* infoLabel = new QLabel("Generate contour lines from survey points using Delaunay triangulation, or from a loaded DEM.");
     infoLabel->setWordWrap(true);
     mainLayout->addWidget(infoLabel);
     
@@ -35,6 +41,17 @@ void ContourDialog::setupUi()
     QGroupBox* settingsGroup = new QGroupBox("Contour Settings");
     QFormLayout* formLayout = new QFormLayout(settingsGroup);
     
+    m_surfaceCombo = new QComboBox();
+    m_surfaceCombo->addItem("Survey Points (TIN)", -1);
+    if (m_canvas) {
+        const auto& rasters = m_canvas->rasters();
+        for (int i = 0; i < rasters.size(); ++i) {
+            if (!rasters[i].elevation) continue;
+            m_surfaceCombo->addItem(QString("DEM: %1").arg(rasters[i].elevation->name()), i);
+        }
+    }
+    formLayout->addRow("Surface:", m_surfaceCombo);
+    
     m_intervalSpin = new QDoubleSpinBox();
     m_intervalSpin->setRange(0.1, 100.0);
     m_intervalSpin->setValue(1.0);
@@ -70,6 +87,22 @@ void ContourDialog::setupUi()
         m_maxElevSpin->setEnabled(!checked);
     });
     
+    m_breaklineCheck = new QCheckBox("Use selected polylines as breaklines");
+    m_breaklineCheck->setChecked(m_canvas && !m_canvas->getSelectedIndices().isEmpty());
+    formLayout->addRow("", m_breaklineCheck);
+    
+    m_boundaryCombo = new QComboBox();
+    m_boundaryCombo->addItem("None", -1);
+    if (m_canvas) {
+        const auto& polylines = m_canvas->polylines();
+        for (int i = 0; i < polylines.size(); ++i) {
+            if (!polylines[i].closed || polylines[i].points.size() < 3) continue;
+            m_boundaryCombo->addItem(QString("Polygon %1 (%2 pts)")
+                .arg(i + 1).arg(polylines[i].points.size()), i);
+        }
+    }
+    formLayout->addRow("Boundary:", m_boundaryCombo);
+    
     mainLayout->addWidget(settingsGroup);
     
     // Status
@@ -108,24 +141,34 @@ void ContourDialog::generate()
 {
     if (!m_canvas) return;
     
+    int rasterIndex = m_surfaceCombo->currentData().toInt();
+    if (rasterIndex >= 0 && rasterIndex < m_canvas->rasters().size()) {
+        m_fromSurface = false;
+        generateFromElevationGrid(m_canvas->rasters()[rasterIndex].elevation.get());
+        return;
+    }
+    
     const auto& pegs = m_canvas->pegs();
     if (pegs.size() < 3) {
         QMessageBox::warning(this, "Contour Generator", "Need at least 3 pegs with Z coordinates.");
         return;
     }
     
-    // Collect 3D points
-    QVector<GeosBridge::Point3D> points3D;
-    for (const auto& peg : pegs) {
-        points3D.append(GeosBridge::Point3D(peg.position.x(), peg.position.y(), peg.z));
+    // Shared TIN, with breaklines and boundary as fixed edges
+    m_breaklines.clear();
+    if (m_breaklineCheck->isChecked()) {
+        m_breaklines = m_canvas->getSelectedIndices();
+    }
+    m_boundary = m_boundaryCombo->currentData().toInt();
+    std::shared_ptr<const SurfaceModel> model = m_canvas->surfaceModel(QVector<int>(), m_breaklines, m_boundary);
+    if (!model) {
+        QMessageBox::warning(this, "Contour Generator",
+            QString("Failed to create triangulation.\n%1").arg(m_canvas->surfaceModelError()));
+        return;
     }
     
     // Get elevation range
-    double minZ = points3D[0].z, maxZ = points3D[0].z;
-    for (const auto& p : points3D) {
-        minZ = qMin(minZ, p.z);
-        maxZ = qMax(maxZ, p.z);
-    }
+    double minZ = model->minZ(), maxZ = model->maxZ();
     
     if (m_autoRangeCheck->isChecked()) {
         m_minElevSpin->setValue(minZ);
@@ -136,103 +179,88 @@ void ContourDialog::generate()
     }
     
     double interval = m_intervalSpin->value();
-    double majorInterval = interval * m_majorFactorSpin->value();
+    m_majorInterval = interval * m_majorFactorSpin->value();
+    
+    // All levels in one pass over the triangles, joined into polylines; the
+    // engine is handed to the canvas so the lines can follow peg edits
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    m_engine.build(model->points(), model->triangles(), ContourEngine::levels(minZ, maxZ, interval));
+    m_engineRevision = model->revision();
+    m_fromSurface = true;
+    QVector<ContourEngine::Contour> contours = m_engine.contours();
+    QApplication::restoreOverrideCursor();
     
-    // Generate triangulation
-    QVector<QPointF> points2D;
-    for (const auto& p : points3D) {
-        points2D.append(QPointF(p.x, p.y));
+    m_contours.clear();
+    m_contours.reserve(contours.size());
+    for (const auto& c : contours) {
+        CanvasWidget::ContourLine contour;
+        contour.elevation = c.elevation;
+        contour.isMajor = (qAbs(fmod(c.elevation, m_majorInterval)) < 0.001);
+        contour.points = c.points;
+        contour.closed = c.closed;
+        m_contours.append(contour);
     }
     
-    auto triangles = GeosBridge::delaunayTriangulate(points2D);
-    if (triangles.isEmpty()) {
-        QMessageBox::warning(this, "Contour Generator", "Failed to create triangulation.");
-        return;
+    showSummary(QString());
+}
+
+void ContourDialog::generateFromElevationGrid(ElevationGrid* grid)
+{
+    if (!grid) return;
+    
+    double minZ = grid->minimum();
+    double maxZ = grid->maximum();
+    if (m_autoRangeCheck->isChecked()) {
+        m_minElevSpin->setValue(minZ);
+        m_maxElevSpin->setValue(maxZ);
+    } else {
+        minZ = m_minElevSpin->value();
+        maxZ = m_maxElevSpin->value();
     }
     
-    m_contours.clear();
+    double interval = m_intervalSpin->value();
+    double majorInterval = interval * m_majorFactorSpin->value();
+    double startElev = qCeil(minZ / interval) * interval;
+    double endElev = qFloor(maxZ / interval) * interval;
     
-    // Round min/max to interval
-    double startElev = qFloor(minZ / interval) * interval;
-    double endElev = qCeil(maxZ / interval) * interval;
+    // Full resolution up to ~16M cells, coarser sampling beyond that
+    qint64 cells = static_cast<qint64>(grid->columns()) * grid->rows();
+    int step = qMax(1, static_cast<int>(qCeil(qSqrt(cells / 16.0e6))));
     
-    // For each contour level
-    for (double elev = startElev; elev <= endElev; elev += interval) {
-        CanvasWidget::ContourLine contour;
-        contour.elevation = elev;
-        contour.isMajor = (qAbs(fmod(elev, majorInterval)) < 0.001);
-        
-        // Process each triangle
-        for (const auto& tri : triangles) {
-            if (tri.size() != 3) continue;
-            
-            const auto& p0 = points3D[tri[0]];
-            const auto& p1 = points3D[tri[1]];
-            const auto& p2 = points3D[tri[2]];
-            
-            // Find intersections with triangle edges
-            QVector<QPointF> intersections;
-            
-            // Edge 0-1
-            if ((p0.z <= elev && p1.z >= elev) || (p0.z >= elev && p1.z <= elev)) {
-                if (qAbs(p1.z - p0.z) > 0.0001) {
-                    double t = (elev - p0.z) / (p1.z - p0.z);
-                    if (t >= 0 && t <= 1) {
-                        intersections.append(QPointF(
-                            p0.x + t * (p1.x - p0.x),
-                            p0.y + t * (p1.y - p0.y)
-                        ));
-                    }
-                }
-            }
-            
-            // Edge 1-2
-            if ((p1.z <= elev && p2.z >= elev) || (p1.z >= elev && p2.z <= elev)) {
-                if (qAbs(p2.z - p1.z) > 0.0001) {
-                    double t = (elev - p1.z) / (p2.z - p1.z);
-                    if (t >= 0 && t <= 1) {
-                        intersections.append(QPointF(
-                            p1.x + t * (p2.x - p1.x),
-                            p1.y + t * (p2.y - p1.y)
-                        ));
-                    }
-                }
-            }
-            
-            // Edge 2-0
-            if ((p2.z <= elev && p0.z >= elev) || (p2.z >= elev && p0.z <= elev)) {
-                if (qAbs(p0.z - p2.z) > 0.0001) {
-                    double t = (elev - p2.z) / (p0.z - p2.z);
-                    if (t >= 0 && t <= 1) {
-                        intersections.append(QPointF(
-                            p2.x + t * (p0.x - p2.x),
-                            p2.y + t * (p0.y - p2.y)
-                        ));
-                    }
-                }
-            }
-            
-            // If we have exactly 2 intersections, add line segment
-            if (intersections.size() == 2) {
-                contour.points.append(intersections[0]);
-                contour.points.append(intersections[1]);
-            }
-        }
-        
-        if (!contour.points.isEmpty()) {
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    auto levels = grid->contours(startElev, interval, endElev, step);
+    QApplication::restoreOverrideCursor();
+    
+    m_contours.clear();
+    for (const auto& level : levels) {
+        bool major = (qAbs(fmod(level.elevation, majorInterval)) < 0.001);
+        for (const auto& c : ContourEngine::stitchSegments(level.elevation, level.segments)) {
+            CanvasWidget::ContourLine contour;
+            contour.elevation = c.elevation;
+            contour.isMajor = major;
+            contour.points = c.points;
+            contour.closed = c.closed;
             m_contours.append(contour);
         }
     }
     
-    int totalSegments = 0;
+    QString sampling = (step > 1) ? QString(", sampled every %1 cells").arg(step) : QString();
+    showSummary(QString(" from DEM%1").arg(sampling));
+}
+
+void ContourDialog::showSummary(const QString& source)
+{
+    QVector<double> levels;
     int majorCount = 0;
     for (const auto& c : m_contours) {
-        totalSegments += c.points.size() / 2;
-        if (c.isMajor) majorCount++;
+        if (levels.isEmpty() || levels.last() != c.elevation) {
+            levels.append(c.elevation);
+            if (c.isMajor) majorCount++;
+        }
     }
     
-    m_statusLabel->setText(QString("Generated %1 contour levels (%2 major), %3 segments")
-        .arg(m_contours.size()).arg(majorCount).arg(totalSegments));
+    m_statusLabel->setText(QString("Generated %1 contour lines at %2 levels (%3 major)%4")
+        .arg(m_contours.size()).arg(levels.size()).arg(majorCount).arg(source));
     m_statusLabel->setStyleSheet("color: green;");
     m_applyBtn->setEnabled(!m_contours.isEmpty());
 }
@@ -253,7 +281,11 @@ void ContourDialog::applyToCanvas()
 {
     if (!m_canvas || m_contours.isEmpty()) return;
     
-    m_canvas->setContours(m_contours);
+    if (m_fromSurface) {
+        m_canvas->setSurfaceContours(m_engine, m_engineRevision, m_majorInterval, m_breaklines, m_boundary);
+    } else {
+        m_canvas->setContours(m_contours);
+    }
     m_statusLabel->setText("Contours applied to canvas.");
 }
 
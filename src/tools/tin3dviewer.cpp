@@ -1,6 +1,7 @@
 #include "tools/tin3dviewer.h"
 #include "canvas/canvaswidget.h"
-#include "gdal/geosbridge.h"
+#include "surface/surfacemodel.h"
+#include "surface/meshsimplifier.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -8,8 +9,32 @@
 #include <QLabel>
 #include <QPainter>
 #include <QPainterPath>
+#include <QtConcurrent>
+#include <QFutureWatcher>
 #include <algorithm>
 #include <cmath>
+#include <limits>
+
+// Screen tiles (pixels square) rasterized in parallel
+static const int TileSize = 64;
+
+// Triangles are outlined once every edge is at least this long (pixels)
+static const float OutlineLength = 8.0f;
+
+// Most triangles drawn while the view is moving; larger meshes get coarser
+// levels of detail (each a quarter of the one before, down to MinTriangles)
+static const int InteractiveTriangles = 150000;
+static const int MinTriangles = 2000;
+static const int MaxLevels = 3;
+
+// Full detail returns once the mouse has been still this long (ms)
+static const int IdleDelay = 200;
+
+struct RasterTile {
+    QRect rect;
+    int first;      // Range of the tile's triangles in the binned list
+    int last;
+};
 
 // ==================== TIN3DSoftwareWidget ====================
 
@@ -21,42 +46,142 @@ TIN3DSoftwareWidget::TIN3DSoftwareWidget(QWidget *parent)
     QPalette pal = palette();
     pal.setColor(QPalette::Window, QColor(25, 25, 35));
     setPalette(pal);
+    
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(IdleDelay);
+    connect(&m_idleTimer, &QTimer::timeout, this, [this]() {
+        m_interacting = false;
+        update();
+    });
 }
 
-void TIN3DSoftwareWidget::setTINData(const QVector<QVector3D>& vertices, 
-                                      const QVector<QVector<int>>& triangles,
+void TIN3DSoftwareWidget::setTINData(const QVector<GeosBridge::Point3D>& points, 
+                                      const QVector<int>& triangles,
                                       double minZ, double maxZ)
 {
-    m_vertices = vertices;
-    m_triangles = triangles;
     m_minZ = minZ;
     m_maxZ = maxZ;
     
-    // Calculate center and scale
-    if (!vertices.isEmpty()) {
-        QVector3D minPt(1e10, 1e10, 1e10);
-        QVector3D maxPt(-1e10, -1e10, -1e10);
-        
-        for (const auto& v : vertices) {
-            minPt.setX(qMin(minPt.x(), v.x()));
-            minPt.setY(qMin(minPt.y(), v.y()));
-            minPt.setZ(qMin(minPt.z(), v.z()));
-            maxPt.setX(qMax(maxPt.x(), v.x()));
-            maxPt.setY(qMax(maxPt.y(), v.y()));
-            maxPt.setZ(qMax(maxPt.z(), v.z()));
+    // Calculate center and scale in double: survey coordinates run to
+    // millions, so vertices are stored relative to the centre and the view
+    // never adds and cancels them in float
+    double minX = 0.0, minY = 0.0, minPtZ = 0.0, maxX = 0.0, maxY = 0.0, maxPtZ = 0.0;
+    for (int i = 0; i < points.size(); ++i) {
+        const GeosBridge::Point3D& p = points[i];
+        if (i == 0 || p.x < minX) minX = p.x;
+        if (i == 0 || p.y < minY) minY = p.y;
+        if (i == 0 || p.z < minPtZ) minPtZ = p.z;
+        if (i == 0 || p.x > maxX) maxX = p.x;
+        if (i == 0 || p.y > maxY) maxY = p.y;
+        if (i == 0 || p.z > maxPtZ) maxPtZ = p.z;
+    }
+    const double centerX = (minX + maxX) / 2.0;
+    const double centerY = (minY + maxY) / 2.0;
+    const double centerZ = (minPtZ + maxPtZ) / 2.0;
+    m_scale = static_cast<float>(qMax(maxX - minX, qMax(maxY - minY, maxPtZ - minPtZ)));
+    if (m_scale < 0.001f) m_scale = 1.0f;
+    
+    m_vertices.resize(points.size());
+    for (int i = 0; i < points.size(); ++i) {
+        m_vertices[i] = QVector3D(static_cast<float>(points[i].x - centerX),
+                                  static_cast<float>(points[i].y - centerY),
+                                  static_cast<float>(points[i].z - centerZ));
+    }
+    
+    // Vertex normals from the faces around each vertex (the cross product
+    // weights them by area); the shading does not depend on the view
+    m_triangles.clear();
+    m_triangles.reserve(triangles.size());
+    m_normals.fill(QVector3D(), m_vertices.size());
+    for (int e = 0; e + 2 < triangles.size(); e += 3) {
+        const int* tri = triangles.constData() + e;
+        if (tri[0] < 0 || tri[1] < 0 || tri[2] < 0
+            || tri[0] >= m_vertices.size() || tri[1] >= m_vertices.size() || tri[2] >= m_vertices.size()) {
+            continue;
+        }
+        m_triangles.append(tri[0]);
+        m_triangles.append(tri[1]);
+        m_triangles.append(tri[2]);
+        const QVector3D normal = QVector3D::crossProduct(m_vertices[tri[1]] - m_vertices[tri[0]],
+                                                         m_vertices[tri[2]] - m_vertices[tri[0]]);
+        for (int i = 0; i < 3; ++i) {
+            m_normals[tri[i]] += normal;
         }
-        
-        m_center = (minPt + maxPt) / 2.0f;
-        float rangeX = maxPt.x() - minPt.x();
-        float rangeY = maxPt.y() - minPt.y();
-        float rangeZ = maxPt.z() - minPt.z();
-        m_scale = qMax(rangeX, qMax(rangeY, rangeZ));
-        if (m_scale < 0.001f) m_scale = 1.0f;
+    }
+    m_colors.resize(m_vertices.size());
+    for (int i = 0; i < m_vertices.size(); ++i) {
+        m_normals[i].normalize();
+        const QColor color = getColorForElevation(points[i].z, minZ, maxZ);
+        const float shade = qAbs(m_normals[i].z()) * 0.5f + 0.5f;
+        m_colors[i] = qRgb(static_cast<int>(color.red() * shade),
+                           static_cast<int>(color.green() * shade),
+                           static_cast<int>(color.blue() * shade));
     }
     
+    m_viewDirty = true;
+    m_frameValid = false;
+    buildDetailLevels();
     update();
 }
 
+void TIN3DSoftwareWidget::buildDetailLevels()
+{
+    m_levels.clear();
+    const quint64 generation = ++m_levelGeneration;
+    const int triangleCount = m_triangles.size() / 3;
+    if (triangleCount <= InteractiveTriangles) return;
+    
+    QVector<int> targets;
+    for (int target = triangleCount / 4; target >= MinTriangles && targets.size() < MaxLevels; target /= 4) {
+        targets.append(target);
+    }
+    if (targets.isEmpty()) return;
+    
+    // Simplify a copy on a worker thread; the full mesh is drawn meanwhile
+    QVector<GeosBridge::Point3D> points;
+    points.reserve(m_vertices.size());
+    for (const auto& v : m_vertices) {
+        points.append(GeosBridge::Point3D(v.x(), v.y(), v.z()));
+    }
+    const QVector<int> triangles = m_triangles;
+    const int vertexCount = m_vertices.size();
+    
+    auto* watcher = new QFutureWatcher<QVector<DetailLevel>>(this);
+    connect(watcher, &QFutureWatcher<QVector<DetailLevel>>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation != m_levelGeneration) return;    // The data changed since
+        m_levels = watcher->result();
+        m_frameValid = false;
+        update();
+    });
+    watcher->setFuture(QtConcurrent::run([points, triangles, targets, vertexCount]() {
+        QVector<DetailLevel> levels;
+        MeshSimplifier simplifier;
+        if (!simplifier.simplify(points, triangles, targets)) return levels;
+        for (int i = 0; i < simplifier.levelCount(); ++i) {
+            DetailLevel level;
+            level.triangles = simplifier.level(i);
+            
+            // Only the vertices still in use need projecting
+            QVector<bool> used(vertexCount, false);
+            for (int index : level.triangles) {
+                used[index] = true;
+            }
+            for (int v = 0; v < vertexCount; ++v) {
+                if (used[v]) level.vertices.append(v);
+            }
+            levels.append(level);
+        }
+        return levels;
+    }));
+}
+
+void TIN3DSoftwareWidget::interact()
+{
+    m_interacting = true;
+    m_idleTimer.start();
+}
+
 void TIN3DSoftwareWidget::resetView()
 {
     m_rotationX = 30.0f;
@@ -64,39 +189,29 @@ void TIN3DSoftwareWidget::resetView()
     m_zoom = 1.0f;
     m_panX = 0.0f;
     m_panY = 0.0f;
+    m_viewDirty = true;
     update();
 }
 
-QPointF TIN3DSoftwareWidget::project3Dto2D(const QVector3D& point3D)
+void TIN3DSoftwareWidget::updateView()
 {
-    // Center the point
-    float x = point3D.x() - m_center.x();
-    float y = point3D.y() - m_center.y();
-    float z = (point3D.z() - m_center.z()) * 3.0f; // Exaggerate Z
-    
-    // Scale
-    float scale = 2.0f / m_scale;
-    x *= scale;
-    y *= scale;
-    z *= scale;
-    
-    // Rotate around Z axis
-    float cosZ = cos(m_rotationZ * M_PI / 180.0f);
-    float sinZ = sin(m_rotationZ * M_PI / 180.0f);
-    float x1 = x * cosZ - y * sinZ;
-    float y1 = x * sinZ + y * cosZ;
-    
-    // Rotate around X axis
-    float cosX = cos(m_rotationX * M_PI / 180.0f);
-    float sinX = sin(m_rotationX * M_PI / 180.0f);
-    float y2 = y1 * cosX - z * sinX;
-    float z2 = y1 * sinX + z * cosX;
-    
-    // Isometric projection to screen
-    float screenX = x1 * m_zoom * 150.0f + width() / 2.0f + m_panX * 100.0f;
-    float screenY = -y2 * m_zoom * 150.0f + height() / 2.0f + m_panY * 100.0f;
-    
-    return QPointF(screenX, screenY);
+    if (!m_viewDirty && m_viewSize == size()) return;
+    
+    // Applied bottom up to the centred vertices: scale (Z exaggerated),
+    // rotate about Z and then X, and map to pixels with Y down; depth stays
+    // larger towards the viewer
+    const float scale = 2.0f / m_scale;
+    const float pixels = m_zoom * 150.0f;
+    m_view.setToIdentity();
+    m_view.translate(width() / 2.0f + m_panX * 100.0f, height() / 2.0f + m_panY * 100.0f);
+    m_view.scale(pixels, -pixels, 1.0f);
+    m_view.rotate(m_rotationX, 1.0f, 0.0f, 0.0f);
+    m_view.rotate(m_rotationZ, 0.0f, 0.0f, 1.0f);
+    m_view.scale(scale, scale, scale * 3.0f);
+    
+    m_viewSize = size();
+    m_viewDirty = false;
+    m_frameValid = false;
 }
 
 QColor TIN3DSoftwareWidget::getColorForElevation(double z, double minZ, double maxZ)
@@ -125,12 +240,178 @@ QColor TIN3DSoftwareWidget::getColorForElevation(double z, double minZ, double m
     return QColor(r, g, b);
 }
 
+// Fill the pixels of one triangle that lie in a tile, nearest surface
+// wins. Screen x, y and depth are in a, b, c. Pixels on an edge count as
+// inside both triangles sharing it, so rounding never leaves a crack.
+static void rasterizeTriangle(const QRect& tile, QVector3D a, QVector3D b, QVector3D c,
+                              QRgb colorA, QRgb colorB, QRgb colorC,
+                              QRgb* pixels, float* depth, int stride)
+{
+    float area = (b.x() - a.x()) * (c.y() - a.y()) - (b.y() - a.y()) * (c.x() - a.x());
+    if (area == 0.0f) return;
+    if (area < 0.0f) {
+        std::swap(b, c);
+        std::swap(colorB, colorC);
+        area = -area;
+    }
+    
+    // Bounds clamped to the tile before rounding (vertices can be far off screen)
+    const int x0 = static_cast<int>(std::floor(qMax(qMin(a.x(), qMin(b.x(), c.x())), float(tile.left()))));
+    const int x1 = static_cast<int>(std::ceil(qMin(qMax(a.x(), qMax(b.x(), c.x())), float(tile.right()))));
+    const int y0 = static_cast<int>(std::floor(qMax(qMin(a.y(), qMin(b.y(), c.y())), float(tile.top()))));
+    const int y1 = static_cast<int>(std::ceil(qMin(qMax(a.y(), qMax(b.y(), c.y())), float(tile.bottom()))));
+    if (x0 > x1 || y0 > y1) return;
+    
+    // Edge functions w = A x + B y + C, opposite a, b and c; each is
+    // positive inside and they sum to the area
+    const float ax = b.y() - c.y(), bx = c.y() - a.y(), cx = a.y() - b.y();
+    const float ay = c.x() - b.x(), by = a.x() - c.x(), cy = b.x() - a.x();
+    const float ac = b.x() * c.y() - c.x() * b.y();
+    const float bc = c.x() * a.y() - a.x() * c.y();
+    const float cc = a.x() * b.y() - b.x() * a.y();
+    const float inverse = 1.0f / area;
+    
+    // Depth and colour channels are planes in the edge functions
+    const float za = a.z() * inverse, zb = b.z() * inverse, zc = c.z() * inverse;
+    const float ra = qRed(colorA) * inverse, rb = qRed(colorB) * inverse, rc = qRed(colorC) * inverse;
+    const float ga = qGreen(colorA) * inverse, gb = qGreen(colorB) * inverse, gc = qGreen(colorC) * inverse;
+    const float ba = qBlue(colorA) * inverse, bb = qBlue(colorB) * inverse, bc2 = qBlue(colorC) * inverse;
+    
+    // Large triangles get a thin outline, like the old polygon pen
+    const float lengthA = std::hypot(ax, ay), lengthB = std::hypot(bx, by), lengthC = std::hypot(cx, cy);
+    const bool outline = qMin(lengthA, qMin(lengthB, lengthC)) >= OutlineLength;
+    const QRgb outlineColor = qRgb(50, 50, 60);
+    
+    for (int y = y0; y <= y1; ++y) {
+        const float py = y + 0.5f;
+        float wa = ax * (x0 + 0.5f) + ay * py + ac;
+        float wb = bx * (x0 + 0.5f) + by * py + bc;
+        float wc = cx * (x0 + 0.5f) + cy * py + cc;
+        QRgb* line = pixels + qint64(y) * stride;
+        float* zLine = depth + qint64(y) * stride;
+        for (int x = x0; x <= x1; ++x, wa += ax, wb += bx, wc += cx) {
+            if (wa < 0.0f || wb < 0.0f || wc < 0.0f) continue;
+            const float z = wa * za + wb * zb + wc * zc;
+            if (z <= zLine[x]) continue;
+            zLine[x] = z;
+            if (outline && (wa < lengthA || wb < lengthB || wc < lengthC)) {
+                line[x] = outlineColor;
+                continue;
+            }
+            line[x] = qRgb(static_cast<int>(wa * ra + wb * rb + wc * rc),
+                           static_cast<int>(wa * ga + wb * gb + wc * gc),
+                           static_cast<int>(wa * ba + wb * bb + wc * bc2));
+        }
+    }
+}
+
+void TIN3DSoftwareWidget::render(const QVector<int>& triangles, const QVector<int>* vertices)
+{
+    const int w = width();
+    const int h = height();
+    if (m_image.size() != size()) {
+        m_image = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+        m_depth.resize(w * h);
+    }
+    m_image.fill(Qt::transparent);
+    std::fill(m_depth.begin(), m_depth.end(), -std::numeric_limits<float>::max());
+    if (m_image.bytesPerLine() != w * int(sizeof(QRgb))) return;
+    
+    // Each vertex in use is projected once through the affine view matrix
+    const int count = m_vertices.size();
+    m_screen.resize(count);
+    const float m00 = m_view(0, 0), m01 = m_view(0, 1), m02 = m_view(0, 2), m03 = m_view(0, 3);
+    const float m10 = m_view(1, 0), m11 = m_view(1, 1), m12 = m_view(1, 2), m13 = m_view(1, 3);
+    const float m20 = m_view(2, 0), m21 = m_view(2, 1), m22 = m_view(2, 2), m23 = m_view(2, 3);
+    const QVector3D* source = m_vertices.constData();
+    QVector3D* screen = m_screen.data();
+    auto project = [&](int i) {
+        const float x = source[i].x(), y = source[i].y(), z = source[i].z();
+        screen[i] = QVector3D(m00 * x + m01 * y + m02 * z + m03,
+                              m10 * x + m11 * y + m12 * z + m13,
+                              m20 * x + m21 * y + m22 * z + m23);
+    };
+    if (vertices) {
+        for (int i : *vertices) {
+            project(i);
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            project(i);
+        }
+    }
+    
+    // Bin triangles into the tiles their screen bounds touch: count, then fill
+    const int columns = (w + TileSize - 1) / TileSize;
+    const int rows = (h + TileSize - 1) / TileSize;
+    QVector<int> tileStart(columns * rows + 1, 0);
+    auto tileRange = [&](const int* tri, QRect& range) {
+        const QVector3D& a = m_screen[tri[0]];
+        const QVector3D& b = m_screen[tri[1]];
+        const QVector3D& c = m_screen[tri[2]];
+        const float left = qMin(a.x(), qMin(b.x(), c.x())), right = qMax(a.x(), qMax(b.x(), c.x()));
+        const float top = qMin(a.y(), qMin(b.y(), c.y())), bottom = qMax(a.y(), qMax(b.y(), c.y()));
+        if (right < 0.0f || bottom < 0.0f || left >= w || top >= h) return false;
+        range.setCoords(static_cast<int>(qMax(left, 0.0f)) / TileSize, static_cast<int>(qMax(top, 0.0f)) / TileSize,
+                        static_cast<int>(qMin(right, w - 1.0f)) / TileSize,
+                        static_cast<int>(qMin(bottom, h - 1.0f)) / TileSize);
+        return true;
+    };
+    const int triangleCount = triangles.size() / 3;
+    const int* indices = triangles.constData();
+    QRect range;
+    for (int t = 0; t < triangleCount; ++t) {
+        if (!tileRange(indices + t * 3, range)) continue;
+        for (int ty = range.top(); ty <= range.bottom(); ++ty) {
+            for (int tx = range.left(); tx <= range.right(); ++tx) {
+                ++tileStart[ty * columns + tx + 1];
+            }
+        }
+    }
+    for (int i = 0; i < columns * rows; ++i) {
+        tileStart[i + 1] += tileStart[i];
+    }
+    QVector<int> binned(tileStart.last());
+    QVector<int> next = tileStart;
+    for (int t = 0; t < triangleCount; ++t) {
+        if (!tileRange(indices + t * 3, range)) continue;
+        for (int ty = range.top(); ty <= range.bottom(); ++ty) {
+            for (int tx = range.left(); tx <= range.right(); ++tx) {
+                binned[next[ty * columns + tx]++] = t;
+            }
+        }
+    }
+    
+    // Tiles own disjoint pixels, so they need no locking
+    QVector<RasterTile> tiles;
+    tiles.reserve(columns * rows);
+    for (int ty = 0; ty < rows; ++ty) {
+        for (int tx = 0; tx < columns; ++tx) {
+            const int index = ty * columns + tx;
+            if (tileStart[index] == tileStart[index + 1]) continue;
+            RasterTile tile;
+            tile.rect = QRect(tx * TileSize, ty * TileSize, TileSize, TileSize).intersected(rect());
+            tile.first = tileStart[index];
+            tile.last = tileStart[index + 1];
+            tiles.append(tile);
+        }
+    }
+    QRgb* pixels = reinterpret_cast<QRgb*>(m_image.bits());
+    float* depth = m_depth.data();
+    QtConcurrent::blockingMap(tiles, [&](const RasterTile& tile) {
+        for (int k = tile.first; k < tile.last; ++k) {
+            const int* tri = indices + binned[k] * 3;
+            rasterizeTriangle(tile.rect, m_screen[tri[0]], m_screen[tri[1]], m_screen[tri[2]],
+                              m_colors[tri[0]], m_colors[tri[1]], m_colors[tri[2]], pixels, depth, w);
+        }
+    });
+}
+
 void TIN3DSoftwareWidget::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
     
     QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, true);
     
     if (m_triangles.isEmpty() || m_vertices.isEmpty()) {
         painter.setPen(Qt::gray);
@@ -138,89 +419,46 @@ void TIN3DSoftwareWidget::paintEvent(QPaintEvent *event)
         return;
     }
     
-    // Sort triangles by depth (painter's algorithm)
-    struct TriangleDepth {
-        int index;
-        float depth;
-        QVector3D centroid;
-    };
-    
-    QVector<TriangleDepth> sortedTriangles;
-    for (int i = 0; i < m_triangles.size(); ++i) {
-        const auto& tri = m_triangles[i];
-        if (tri.size() != 3) continue;
-        
-        int i0 = tri[0], i1 = tri[1], i2 = tri[2];
-        if (i0 >= m_vertices.size() || i1 >= m_vertices.size() || i2 >= m_vertices.size()) {
-            continue;
+    // While the view moves, the finest level that is quick enough to draw
+    int levelIndex = -1;
+    if (m_interacting) {
+        for (int i = 0; i < m_levels.size(); ++i) {
+            levelIndex = i;
+            if (m_levels[i].triangles.size() / 3 <= InteractiveTriangles) break;
         }
-        
-        const QVector3D& v0 = m_vertices[i0];
-        const QVector3D& v1 = m_vertices[i1];
-        const QVector3D& v2 = m_vertices[i2];
-        
-        QVector3D centroid = (v0 + v1 + v2) / 3.0f;
-        
-        // Calculate depth after rotation
-        float y = centroid.y() - m_center.y();
-        float z = centroid.z() - m_center.z();
-        float cosX = cos(m_rotationX * M_PI / 180.0f);
-        float sinX = sin(m_rotationX * M_PI / 180.0f);
-        float depth = y * sinX + z * cosX;
-        
-        sortedTriangles.append({i, depth, centroid});
     }
-    
-    // Sort back to front
-    std::sort(sortedTriangles.begin(), sortedTriangles.end(), 
-              [](const TriangleDepth& a, const TriangleDepth& b) {
-                  return a.depth < b.depth;
-              });
-    
-    // Draw triangles
-    for (const auto& td : sortedTriangles) {
-        const auto& tri = m_triangles[td.index];
-        
-        const QVector3D& v0 = m_vertices[tri[0]];
-        const QVector3D& v1 = m_vertices[tri[1]];
-        const QVector3D& v2 = m_vertices[tri[2]];
-        
-        QPointF p0 = project3Dto2D(v0);
-        QPointF p1 = project3Dto2D(v1);
-        QPointF p2 = project3Dto2D(v2);
-        
-        // Calculate average Z for coloring
-        double avgZ = (v0.z() + v1.z() + v2.z()) / 3.0;
-        QColor fillColor = getColorForElevation(avgZ, m_minZ, m_maxZ);
-        
-        // Add shading based on normal
-        QVector3D edge1 = v1 - v0;
-        QVector3D edge2 = v2 - v0;
-        QVector3D normal = QVector3D::crossProduct(edge1, edge2).normalized();
-        float shade = qAbs(normal.z()) * 0.5f + 0.5f;
-        fillColor = QColor(
-            static_cast<int>(fillColor.red() * shade),
-            static_cast<int>(fillColor.green() * shade),
-            static_cast<int>(fillColor.blue() * shade)
-        );
-        
-        QPolygonF triangle;
-        triangle << p0 << p1 << p2;
-        
-        painter.setBrush(fillColor);
-        painter.setPen(QPen(QColor(50, 50, 60), 0.5));
-        painter.drawPolygon(triangle);
+    const DetailLevel* level = levelIndex >= 0 ? &m_levels[levelIndex] : nullptr;
+    
+    // Repaints of an unchanged view (expose, idle timer at full detail)
+    // reuse the last frame
+    updateView();
+    if (!m_frameValid || m_frameLevel != levelIndex) {
+        if (level) {
+            render(level->triangles, &level->vertices);
+        } else {
+            render(m_triangles, nullptr);
+        }
+        m_frameValid = true;
+        m_frameLevel = levelIndex;
     }
+    painter.drawImage(0, 0, m_image);
     
     // Draw legend
+    painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setPen(Qt::white);
     painter.drawText(10, 20, QString("Z Range: %1 - %2").arg(m_minZ, 0, 'f', 1).arg(m_maxZ, 0, 'f', 1));
-    painter.drawText(10, 40, QString("Triangles: %1").arg(m_triangles.size()));
+    if (level) {
+        painter.drawText(10, 40, QString("Triangles: %1 (preview %2)")
+            .arg(m_triangles.size() / 3).arg(level->triangles.size() / 3));
+    } else {
+        painter.drawText(10, 40, QString("Triangles: %1").arg(m_triangles.size() / 3));
+    }
 }
 
 void TIN3DSoftwareWidget::mousePressEvent(QMouseEvent *event)
 {
     m_lastMousePos = event->pos();
+    interact();
 }
 
 void TIN3DSoftwareWidget::mouseMoveEvent(QMouseEvent *event)
@@ -240,6 +478,20 @@ void TIN3DSoftwareWidget::mouseMoveEvent(QMouseEvent *event)
     }
     
     m_lastMousePos = event->pos();
+    if (event->buttons() & (Qt::LeftButton | Qt::RightButton)) {
+        m_viewDirty = true;
+        interact();
+    }
+    update();
+}
+
+void TIN3DSoftwareWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    Q_UNUSED(event);
+    
+    // Full detail as soon as the drag ends
+    m_idleTimer.stop();
+    m_interacting = false;
     update();
 }
 
@@ -248,6 +500,8 @@ void TIN3DSoftwareWidget::wheelEvent(QWheelEvent *event)
     float delta = event->angleDelta().y() / 120.0f;
     m_zoom *= (1.0f + delta * 0.1f);
     m_zoom = qBound(0.1f, m_zoom, 10.0f);
+    m_viewDirty = true;
+    interact();
     update();
 }
 
@@ -301,23 +555,11 @@ void TIN3DViewerDialog::loadTINFromCanvas()
 {
     if (!m_canvas || !m_viewer) return;
     
-    const auto& pegs = m_canvas->pegs();
-    if (pegs.size() < 3) return;
-    
-    // Collect 3D points
-    QVector<QVector3D> vertices;
-    QVector<QPointF> points2D;
-    double minZ = 1e10, maxZ = -1e10;
-    
-    for (const auto& peg : pegs) {
-        vertices.append(QVector3D(peg.position.x(), peg.position.y(), peg.z));
-        points2D.append(peg.position);
-        minZ = qMin(minZ, peg.z);
-        maxZ = qMax(maxZ, peg.z);
-    }
+    if (m_canvas->pegs().size() < 3) return;
     
-    // Triangulate using GEOS
-    auto triangles = GeosBridge::delaunayTriangulate(points2D);
+    // Same TIN the canvas and the surface tools use
+    std::shared_ptr<const SurfaceModel> model = m_canvas->surfaceModel();
+    if (!model) return;
     
-    m_viewer->setTINData(vertices, triangles, minZ, maxZ);
+    m_viewer->setTINData(model->points(), model->triangles(), model->minZ(), model->maxZ());
 }
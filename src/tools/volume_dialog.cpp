@@ -2,6 +2,12 @@
 #include "tools/tin3dviewer.h"
 #include "canvas/canvaswidget.h"
 #include "gdal/geosbridge.h"
+#include "gdal/elevationgrid.h"
+#include "surface/contourengine.h"
+#include "surface/gridvolume.h"
+#include "surface/surfacedifference.h"
+#include "surface/surfacemodel.h"
+#include "surface/volumeengine.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -24,12 +30,20 @@
 #include <QPainter>
 #include <QTextDocument>
 #include <QBuffer>
+#include <QMap>
 
+// Design combo entries that are not DEMs (DEM entries hold the raster index)
+static const int DesignLevel = -1;
+static const int DesignPlane = -2;
+static const int DesignLayer = -3;      // Pegs of a later survey, layer name in LayerRole
+static const int LayerRole = Qt::UserRole + 1;
 
 VolumeDialog::VolumeDialog(CanvasWidget* canvas, QWidget *parent)
     : QDialog(parent), m_canvas(canvas)
 {
     setupUi();
+    populateSurfaceList();
+    populateLayerList();
     populateBoundaryList();
     populatePegTable();
 }
@@ -42,7 +56,7 @@ void VolumeDialog::setupUi()
     QVBoxLayout* mainLayout = new QVBoxLayout(this);
     
     // Instructions
-    QLabel* infoLabel = new QLabel("Calculate cut and fill volumes between survey points and a design level using Delaunay triangulation.");
+    QLabel* infoLabel = new QLabel("Calculate cut and fill volumes between survey points (Delaunay triangulation) or a DEM and a design level, sloped plane, DEM or a later survey (pegs on another layer).");
     infoLabel->setWordWrap(true);
     mainLayout->addWidget(infoLabel);
     
@@ -90,12 +104,41 @@ void VolumeDialog::setupUi()
     QGroupBox* paramsGroup = new QGroupBox("Parameters");
     QFormLayout* formLayout = new QFormLayout(paramsGroup);
     
+    m_surfaceCombo = new QComboBox();
+    m_surfaceCombo->addItem("Survey Points (TIN)", -1);
+    connect(m_surfaceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &VolumeDialog::onSurfaceChanged);
+    formLayout->addRow("Surface:", m_surfaceCombo);
+    
     m_boundaryCombo = new QComboBox();
     m_boundaryCombo->addItem("Convex Hull (All Points)", -1);
     connect(m_boundaryCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &VolumeDialog::onBoundaryChanged);
     formLayout->addRow("Boundary:", m_boundaryCombo);
     
+    m_designCombo = new QComboBox();
+    m_designCombo->addItem("Level", DesignLevel);
+    m_designCombo->addItem("Sloped Plane", DesignPlane);
+    connect(m_designCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &VolumeDialog::onDesignChanged);
+    formLayout->addRow("Design:", m_designCombo);
+    
+    // Exact prisms, or cell-centre samples on a grid of the chosen size
+    m_methodCombo = new QComboBox();
+    m_methodCombo->addItem("Exact (TIN / DEM cells)");
+    m_methodCombo->addItem("Grid");
+    connect(m_methodCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &VolumeDialog::onMethodChanged);
+    formLayout->addRow("Method:", m_methodCombo);
+    
+    m_cellSizeSpin = new QDoubleSpinBox();
+    m_cellSizeSpin->setRange(0.01, 10000.0);
+    m_cellSizeSpin->setDecimals(3);
+    m_cellSizeSpin->setSuffix(" m");
+    m_cellSizeSpin->setValue(1.0);
+    m_cellSizeSpin->setEnabled(false);
+    formLayout->addRow("Cell Size:", m_cellSizeSpin);
+    
     m_designLevelSpin = new QDoubleSpinBox();
     m_designLevelSpin->setRange(-10000.0, 10000.0);
     m_designLevelSpin->setDecimals(3);
@@ -103,6 +146,45 @@ void VolumeDialog::setupUi()
     m_designLevelSpin->setValue(0.0);
     formLayout->addRow("Design Level:", m_designLevelSpin);
     
+    // Sloped plane: the design level holds at the reference point
+    m_originXSpin = new QDoubleSpinBox();
+    m_originXSpin->setRange(-1e9, 1e9);
+    m_originXSpin->setDecimals(3);
+    formLayout->addRow("Reference X:", m_originXSpin);
+    
+    m_originYSpin = new QDoubleSpinBox();
+    m_originYSpin->setRange(-1e9, 1e9);
+    m_originYSpin->setDecimals(3);
+    formLayout->addRow("Reference Y:", m_originYSpin);
+    
+    m_slopeXSpin = new QDoubleSpinBox();
+    m_slopeXSpin->setRange(-100.0, 100.0);
+    m_slopeXSpin->setDecimals(3);
+    m_slopeXSpin->setSuffix(" %");
+    formLayout->addRow("Slope X (east):", m_slopeXSpin);
+    
+    m_slopeYSpin = new QDoubleSpinBox();
+    m_slopeYSpin->setRange(-100.0, 100.0);
+    m_slopeYSpin->setDecimals(3);
+    m_slopeYSpin->setSuffix(" %");
+    formLayout->addRow("Slope Y (north):", m_slopeYSpin);
+    
+    // Survey to survey: lines of equal thickness between the two
+    m_isopachSpin = new QDoubleSpinBox();
+    m_isopachSpin->setRange(0.0, 1000.0);
+    m_isopachSpin->setDecimals(2);
+    m_isopachSpin->setSingleStep(0.25);
+    m_isopachSpin->setSuffix(" m");
+    m_isopachSpin->setSpecialValueText("None");
+    m_isopachSpin->setValue(0.5);
+    formLayout->addRow("Isopach Interval:", m_isopachSpin);
+    
+    m_breaklineCheck = new QCheckBox("Use selected polylines as breaklines");
+    m_breaklineCheck->setChecked(m_canvas && !m_canvas->getSelectedIndices().isEmpty());
+    formLayout->addRow("", m_breaklineCheck);
+    
+    onDesignChanged(0);
+    
     mainLayout->addWidget(paramsGroup);
     
     // ===== Action Buttons =====
@@ -124,6 +206,17 @@ void VolumeDialog::setupUi()
     connect(m_view3DBtn, &QPushButton::clicked, this, &VolumeDialog::view3D);
     actionLayout->addWidget(m_view3DBtn);
     
+    m_isopachBtn = new QPushButton("Show Isopachs");
+    m_isopachBtn->setEnabled(false);
+    connect(m_isopachBtn, &QPushButton::clicked, this, &VolumeDialog::showIsopachs);
+    actionLayout->addWidget(m_isopachBtn);
+    
+    m_heatmapBtn = new QPushButton("Show Heatmap");
+    m_heatmapBtn->setCheckable(true);
+    m_heatmapBtn->setEnabled(false);
+    connect(m_heatmapBtn, &QPushButton::toggled, this, &VolumeDialog::toggleHeatmap);
+    actionLayout->addWidget(m_heatmapBtn);
+    
     mainLayout->addLayout(actionLayout);
     
     // ===== Results Group =====
@@ -132,7 +225,7 @@ void VolumeDialog::setupUi()
     
     m_resultText = new QTextEdit();
     m_resultText->setReadOnly(true);
-    m_resultText->setMaximumHeight(100);
+    m_resultText->setMaximumHeight(130);
     m_resultText->setPlaceholderText("Select points and click 'Calculate' to see results...");
     resultLayout->addWidget(m_resultText);
     
@@ -161,6 +254,16 @@ void VolumeDialog::populatePegTable()
     const auto& pegs = m_canvas->pegs();
     m_pegTable->setRowCount(pegs.size());
     
+    // Start a sloped design at the middle of the pegs
+    QPointF centre;
+    for (const auto& peg : pegs) {
+        centre += peg.position;
+    }
+    if (!pegs.isEmpty()) {
+        m_originXSpin->setValue(centre.x() / pegs.size());
+        m_originYSpin->setValue(centre.y() / pegs.size());
+    }
+    
     for (int i = 0; i < pegs.size(); ++i) {
         const auto& peg = pegs[i];
         
@@ -198,6 +301,110 @@ void VolumeDialog::populateBoundaryList()
     }
 }
 
+void VolumeDialog::populateSurfaceList()
+{
+    if (!m_canvas) return;
+    
+    const auto& rasters = m_canvas->rasters();
+    for (int i = 0; i < rasters.size(); ++i) {
+        const auto& grid = rasters[i].elevation;
+        if (!grid) continue;
+        QString name = QString("DEM: %1 (%2 x %3 cells)")
+            .arg(grid->name()).arg(grid->columns()).arg(grid->rows());
+        m_surfaceCombo->addItem(name, i);
+        m_designCombo->addItem(QString("DEM: %1").arg(grid->name()), i);
+    }
+}
+
+ElevationGrid* VolumeDialog::selectedElevationGrid() const
+{
+    if (!m_canvas || !m_surfaceCombo) return nullptr;
+    int index = m_surfaceCombo->currentData().toInt();
+    if (index < 0 || index >= m_canvas->rasters().size()) return nullptr;
+    return m_canvas->rasters()[index].elevation.get();
+}
+
+void VolumeDialog::populateLayerList()
+{
+    if (!m_canvas) return;
+    
+    // A layer of pegs can be a second survey of the site (TIN vs TIN)
+    QMap<QString, int> counts;
+    for (const auto& peg : m_canvas->pegs()) {
+        counts[peg.layer]++;
+    }
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        if (it.key().isEmpty() || it.value() < 3) continue;
+        m_designCombo->addItem(QString("Pegs on layer: %1").arg(it.key()), DesignLayer);
+        m_designCombo->setItemData(m_designCombo->count() - 1, it.key(), LayerRole);
+    }
+}
+
+ElevationGrid* VolumeDialog::designElevationGrid() const
+{
+    if (!m_canvas || !m_designCombo) return nullptr;
+    int index = m_designCombo->currentData().toInt();
+    if (index < 0 || index >= m_canvas->rasters().size()) return nullptr;
+    return m_canvas->rasters()[index].elevation.get();
+}
+
+QString VolumeDialog::designLayer() const
+{
+    if (!m_designCombo || m_designCombo->currentData().toInt() != DesignLayer) return QString();
+    return m_designCombo->currentData(LayerRole).toString();
+}
+
+QString VolumeDialog::designDescription() const
+{
+    if (!designLayer().isEmpty()) {
+        return QString("Survey on layer %1").arg(designLayer());
+    }
+    if (ElevationGrid* grid = designElevationGrid()) {
+        return QString("DEM %1").arg(grid->name());
+    }
+    if (m_designCombo->currentData().toInt() == DesignPlane) {
+        return QString("Plane %1 m at (%2, %3), slope %4 % east, %5 % north")
+            .arg(m_designLevelSpin->value(), 0, 'f', 3)
+            .arg(m_originXSpin->value(), 0, 'f', 3).arg(m_originYSpin->value(), 0, 'f', 3)
+            .arg(m_slopeXSpin->value(), 0, 'f', 3).arg(m_slopeYSpin->value(), 0, 'f', 3);
+    }
+    return QString("Level %1 m").arg(m_designLevelSpin->value(), 0, 'f', 3);
+}
+
+void VolumeDialog::onSurfaceChanged(int)
+{
+    // Pegs and breaklines are only used for the TIN surface, and a DEM
+    // surface is measured against a level only
+    const bool demSurface = selectedElevationGrid() != nullptr;
+    m_pegTable->setEnabled(!demSurface);
+    m_breaklineCheck->setEnabled(!demSurface);
+    if (demSurface) m_designCombo->setCurrentIndex(0);
+    m_designCombo->setEnabled(!demSurface);
+    updateSelectedCount();
+}
+
+void VolumeDialog::onDesignChanged(int)
+{
+    const int design = m_designCombo->currentData().toInt();
+    const bool plane = design == DesignPlane;
+    m_designLevelSpin->setEnabled(design == DesignLevel || design == DesignPlane);
+    m_isopachSpin->setEnabled(design == DesignLayer);
+    m_originXSpin->setEnabled(plane);
+    m_originYSpin->setEnabled(plane);
+    m_slopeXSpin->setEnabled(plane);
+    m_slopeYSpin->setEnabled(plane);
+}
+
+void VolumeDialog::onMethodChanged(int)
+{
+    m_cellSizeSpin->setEnabled(gridMethod());
+}
+
+bool VolumeDialog::gridMethod() const
+{
+    return m_methodCombo && m_methodCombo->currentIndex() == 1;
+}
+
 void VolumeDialog::selectAllPegs()
 {
     for (int i = 0; i < m_pegTable->rowCount(); ++i) {
@@ -226,9 +433,10 @@ void VolumeDialog::updateSelectedCount()
     m_selectedCountLabel->setText(QString("Selected: %1 points").arg(count));
     
     bool canCalc = count >= 3;
-    m_calculateBtn->setEnabled(canCalc);
-    m_showTinBtn->setEnabled(canCalc);
-    m_view3DBtn->setEnabled(canCalc);
+    bool demSurface = selectedElevationGrid() != nullptr;
+    m_calculateBtn->setEnabled(canCalc || demSurface);
+    m_showTinBtn->setEnabled(canCalc && !demSurface);
+    m_view3DBtn->setEnabled(canCalc && !demSurface);
 }
 
 QVector<int> VolumeDialog::getSelectedPegIndices()
@@ -252,6 +460,51 @@ void VolumeDialog::calculate()
 {
     if (!m_canvas) return;
     
+    if (ElevationGrid* grid = selectedElevationGrid()) {
+        QVector<QPointF> boundary;
+        int boundaryIdx = m_boundaryCombo->currentData().toInt();
+        if (boundaryIdx >= 0 && boundaryIdx < m_canvas->polylines().size()) {
+            boundary = m_canvas->polylines()[boundaryIdx].points;
+        }
+        
+        if (gridMethod()) {
+            calculateGrid(grid, nullptr, boundary);
+            return;
+        }
+        
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        auto result = grid->volumeAgainstLevel(m_designLevelSpin->value(), boundary);
+        QApplication::restoreOverrideCursor();
+        
+        if (result.cells == 0) {
+            QMessageBox::warning(this, "Volume Calculation",
+                "No DEM cells with data inside the boundary.");
+            return;
+        }
+        
+        double netVol = result.cut - result.fill;
+        m_lastCutVol = result.cut;
+        m_lastFillVol = result.fill;
+        m_lastSurfaceArea = result.area;
+        m_lastTriangleCount = 0;
+        m_lastSplitCount = 0;
+        m_lastCellCount = result.cells;
+        m_lastSurfaceName = grid->name();
+        m_lastDesign = designDescription();
+        m_lastMethod.clear();
+        
+        QString resultText;
+        resultText += QString("Cut Volume:     %1 m3\n").arg(result.cut, 0, 'f', 2);
+        resultText += QString("Fill Volume:    %1 m3\n").arg(result.fill, 0, 'f', 2);
+        resultText += QString("Net Volume:     %1 m3 (%2)\n").arg(qAbs(netVol), 0, 'f', 2).arg(netVol > 0 ? "Net Cut" : "Net Fill");
+        resultText += QString("Surface Area:   %1 m2\n").arg(result.area, 0, 'f', 2);
+        resultText += QString("DEM Cells:      %1 (%2 x %3 m)\n").arg(result.cells)
+            .arg(grid->cellWidthMetres(), 0, 'f', 3).arg(grid->cellHeightMetres(), 0, 'f', 3);
+        
+        m_resultText->setPlainText(resultText);
+        return;
+    }
+    
     QVector<int> selectedIndices = getSelectedPegIndices();
     if (selectedIndices.size() < 3) {
         QMessageBox::warning(this, "Volume Calculation", 
@@ -259,69 +512,279 @@ void VolumeDialog::calculate()
         return;
     }
     
-    QVector<GeosBridge::Point3D> surfacePoints;
-    const auto& pegs = m_canvas->pegs();
-    for (int idx : selectedIndices) {
-        if (idx < pegs.size()) {
-            const auto& peg = pegs[idx];
-            surfacePoints.append(GeosBridge::Point3D(peg.position.x(), peg.position.y(), peg.z));
-        }
-    }
-    
     QVector<QPointF> boundary;
     int boundaryIdx = m_boundaryCombo->currentData().toInt();
     if (boundaryIdx >= 0 && boundaryIdx < m_canvas->polylines().size()) {
         boundary = m_canvas->polylines()[boundaryIdx].points;
     }
     
-    double designLevel = m_designLevelSpin->value();
-    auto result = GeosBridge::calculateVolume(surfacePoints, designLevel, boundary);
+    if (!designLayer().isEmpty()) {
+        calculateBetweenSurveys(selectedIndices, boundary);
+        return;
+    }
     
-    double cutVol = result.first;
-    double fillVol = result.second;
-    double netVol = cutVol - fillVol;
+    // The shared TIN covers the hull; the engine clips it to the boundary
+    std::shared_ptr<const SurfaceModel> model = m_canvas->surfaceModel(selectedIndices, breaklineIndices());
+    if (!model) {
+        QMessageBox::warning(this, "Volume Calculation",
+            QString("Failed to triangulate the selected points.\n%1").arg(m_canvas->surfaceModelError()));
+        return;
+    }
+    const int triangleCount = model->triangleCount();
     
-    QVector<QPointF> points2D;
-    for (const auto& p : surfacePoints) {
-        points2D.append(QPointF(p.x, p.y));
+    if (gridMethod()) {
+        calculateGrid(nullptr, model.get(), boundary);
+        return;
     }
     
-    double surfaceArea = 0.0;
-    auto triangles = GeosBridge::delaunayTriangulate(points2D);
-    for (const auto& tri : triangles) {
-        if (tri.size() != 3) continue;
-        const auto& p0 = surfacePoints[tri[0]];
-        const auto& p1 = surfacePoints[tri[1]];
-        const auto& p2 = surfacePoints[tri[2]];
-        
-        if (!boundary.isEmpty()) {
-            QPointF centroid((p0.x + p1.x + p2.x) / 3.0, (p0.y + p1.y + p2.y) / 3.0);
-            if (!GeosBridge::pointInPolygon(centroid, boundary)) continue;
-        }
-        
-        surfaceArea += qAbs((p0.x * (p1.y - p2.y) + p1.x * (p2.y - p0.y) + p2.x * (p0.y - p1.y)) / 2.0);
+    // One pass gives cut, fill and the plan area, with triangles on the
+    // boundary clipped to it and triangles crossing the design split
+    VolumeEngine engine;
+    engine.setBoundary(boundary);
+    if (ElevationGrid* designGrid = designElevationGrid()) {
+        engine.setDesignGrid(designGrid);
+    } else if (m_designCombo->currentData().toInt() == DesignPlane) {
+        engine.setDesignPlane(QPointF(m_originXSpin->value(), m_originYSpin->value()),
+                              m_designLevelSpin->value(),
+                              m_slopeXSpin->value() / 100.0, m_slopeYSpin->value() / 100.0);
+    } else {
+        engine.setDesignLevel(m_designLevelSpin->value());
     }
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    VolumeEngine::Result result = engine.compute(model->points(), model->triangles());
+    QApplication::restoreOverrideCursor();
+    
+    if (result.triangles == 0 && result.uncovered > 0) {
+        QMessageBox::warning(this, "Volume Calculation",
+            "The design DEM has no data under the surface.");
+        return;
+    }
+    
+    double cutVol = result.cut;
+    double fillVol = result.fill;
+    double netVol = cutVol - fillVol;
+    double surfaceArea = result.area;
     
     // Store results for export
+    m_lastCellCount = 0;
+    m_lastSurfaceName.clear();
     m_lastCutVol = cutVol;
     m_lastFillVol = fillVol;
     m_lastSurfaceArea = surfaceArea;
-    m_lastTriangleCount = triangles.size();
+    m_lastTriangleCount = triangleCount;
+    m_lastSplitCount = result.split;
+    m_lastDesign = designDescription();
+    m_lastMethod.clear();
     
     QString resultText;
     resultText += QString("Cut Volume:     %1 m3\n").arg(cutVol, 0, 'f', 2);
     resultText += QString("Fill Volume:    %1 m3\n").arg(fillVol, 0, 'f', 2);
     resultText += QString("Net Volume:     %1 m3 (%2)\n").arg(qAbs(netVol), 0, 'f', 2).arg(netVol > 0 ? "Net Cut" : "Net Fill");
     resultText += QString("Surface Area:   %1 m2\n").arg(surfaceArea, 0, 'f', 2);
-    resultText += QString("Triangles:      %1\n").arg(triangles.size());
+    resultText += QString("Triangles:      %1\n").arg(triangleCount);
+    if (!boundary.isEmpty()) {
+        resultText += QString("In Boundary:    %1 (%2 clipped)\n").arg(result.triangles).arg(result.clipped);
+    }
+    resultText += QString("Split Triangles: %1\n").arg(result.split);
+    if (result.uncovered > 0) {
+        resultText += QString("Off Design DEM: %1 triangles skipped\n").arg(result.uncovered);
+    }
+    
+    m_resultText->setPlainText(resultText);
+}
+
+void VolumeDialog::calculateBetweenSurveys(const QVector<int>& selectedIndices, const QVector<QPointF>& boundary)
+{
+    // The selected pegs off the layer are the base survey, the pegs on it
+    // the later one; cut is ground removed since the base survey
+    const QString layer = designLayer();
+    const auto& pegs = m_canvas->pegs();
+    QVector<int> baseIndices, comparisonIndices;
+    for (int i : selectedIndices) {
+        if (pegs[i].layer != layer) baseIndices.append(i);
+    }
+    for (int i = 0; i < pegs.size(); ++i) {
+        if (pegs[i].layer == layer) comparisonIndices.append(i);
+    }
+    if (baseIndices.size() < 3) {
+        QMessageBox::warning(this, "Volume Calculation",
+            QString("Need at least 3 selected points off layer %1 for the base survey.").arg(layer));
+        return;
+    }
+    
+    // Breaklines belong to the survey of their layer; forcing one survey's
+    // breaklines into the other would stretch it past its own hull
+    const auto& polylines = m_canvas->polylines();
+    QVector<int> baseBreaklines, comparisonBreaklines;
+    for (int i : breaklineIndices()) {
+        if (i < 0 || i >= polylines.size()) continue;
+        if (polylines[i].layer == layer) {
+            comparisonBreaklines.append(i);
+        } else {
+            baseBreaklines.append(i);
+        }
+    }
+    std::shared_ptr<const SurfaceModel> base = m_canvas->surfaceModel(baseIndices, baseBreaklines);
+    if (!base) {
+        QMessageBox::warning(this, "Volume Calculation",
+            QString("Failed to triangulate the base survey.\n%1").arg(m_canvas->surfaceModelError()));
+        return;
+    }
+    std::shared_ptr<const SurfaceModel> comparison = m_canvas->surfaceModel(comparisonIndices, comparisonBreaklines);
+    if (!comparison) {
+        QMessageBox::warning(this, "Volume Calculation",
+            QString("Failed to triangulate survey layer %1.\n%2").arg(layer).arg(m_canvas->surfaceModelError()));
+        return;
+    }
+    
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    SurfaceDifference difference;
+    difference.setBoundary(boundary);
+    difference.setSurfaces(base->points(), base->triangles(), comparison->points(), comparison->triangles());
+    const QVector<double> levels = ContourEngine::levels(difference.minThickness(), difference.maxThickness(),
+                                                         m_isopachSpin->value());
+    VolumeEngine::Result result = difference.compute(levels);
+    QApplication::restoreOverrideCursor();
+    
+    if (result.triangles == 0) {
+        QMessageBox::warning(this, "Volume Calculation",
+            "The two surveys do not overlap inside the boundary.");
+        return;
+    }
+    
+    // Every fifth isopach is drawn as major
+    const double majorInterval = 5.0 * m_isopachSpin->value();
+    m_isopachs.clear();
+    for (const auto& c : difference.isopachs()) {
+        CanvasWidget::ContourLine isopach;
+        isopach.elevation = c.elevation;
+        isopach.isMajor = (qAbs(fmod(c.elevation, majorInterval)) < 0.001);
+        isopach.points = c.points;
+        isopach.closed = c.closed;
+        m_isopachs.append(isopach);
+    }
+    m_isopachBtn->setEnabled(!m_isopachs.isEmpty());
+    
+    double netVol = result.cut - result.fill;
+    m_lastCellCount = 0;
+    m_lastSurfaceName.clear();
+    m_lastCutVol = result.cut;
+    m_lastFillVol = result.fill;
+    m_lastSurfaceArea = result.area;
+    m_lastTriangleCount = base->triangleCount();
+    m_lastSplitCount = result.split;
+    m_lastDesign = designDescription();
+    m_lastMethod.clear();
+    
+    QString resultText;
+    resultText += QString("Cut Volume:     %1 m3\n").arg(result.cut, 0, 'f', 2);
+    resultText += QString("Fill Volume:    %1 m3\n").arg(result.fill, 0, 'f', 2);
+    resultText += QString("Net Volume:     %1 m3 (%2)\n").arg(qAbs(netVol), 0, 'f', 2).arg(netVol > 0 ? "Net Cut" : "Net Fill");
+    resultText += QString("Overlap Area:   %1 m2\n").arg(result.area, 0, 'f', 2);
+    resultText += QString("Triangles:      %1 base, %2 on %3\n")
+        .arg(base->triangleCount()).arg(comparison->triangleCount()).arg(layer);
+    resultText += QString("Overlay:        %1 facets (%2 split)\n").arg(result.triangles).arg(result.split);
+    resultText += QString("Thickness:      %1 to %2 m\n")
+        .arg(difference.minThickness(), 0, 'f', 3).arg(difference.maxThickness(), 0, 'f', 3);
+    if (!levels.isEmpty()) {
+        resultText += QString("Isopachs:       %1 lines at %2 levels\n").arg(m_isopachs.size()).arg(levels.size());
+    }
     
     m_resultText->setPlainText(resultText);
 }
 
+void VolumeDialog::calculateGrid(ElevationGrid* surface, const SurfaceModel* model, const QVector<QPointF>& boundary)
+{
+    const int design = m_designCombo->currentData().toInt();
+    if (design != DesignLevel && design != DesignPlane) {
+        QMessageBox::warning(this, "Volume Calculation",
+            "The grid method works against a level or sloped plane design.");
+        return;
+    }
+    
+    GridVolume gridVolume;
+    gridVolume.setCellSize(m_cellSizeSpin->value());
+    gridVolume.setBoundary(boundary);
+    gridVolume.setHeatmap(true);
+    if (design == DesignPlane) {
+        gridVolume.setDesignPlane(QPointF(m_originXSpin->value(), m_originYSpin->value()),
+                                  m_designLevelSpin->value(),
+                                  m_slopeXSpin->value() / 100.0, m_slopeYSpin->value() / 100.0);
+    } else {
+        gridVolume.setDesignLevel(m_designLevelSpin->value());
+    }
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    GridVolume::Result result = surface ? gridVolume.compute(surface)
+                                        : gridVolume.compute(model->points(), model->triangles());
+    QApplication::restoreOverrideCursor();
+    
+    if (!gridVolume.lastError().isEmpty()) {
+        QMessageBox::warning(this, "Volume Calculation", gridVolume.lastError());
+        return;
+    }
+    if (result.cells == 0) {
+        QMessageBox::warning(this, "Volume Calculation",
+            "No grid cells with data inside the boundary.");
+        return;
+    }
+    
+    m_heatmap = result.heatmap;
+    m_heatmapBounds = result.bounds;
+    m_heatmapBtn->setEnabled(!m_heatmap.isNull());
+    toggleHeatmap(m_heatmapBtn->isChecked());
+    
+    double netVol = result.cut - result.fill;
+    m_lastCutVol = result.cut;
+    m_lastFillVol = result.fill;
+    m_lastSurfaceArea = result.area;
+    m_lastTriangleCount = model ? model->triangleCount() : 0;
+    m_lastSplitCount = 0;
+    m_lastCellCount = surface ? result.cells : 0;
+    m_lastSurfaceName = surface ? surface->name() : QString();
+    m_lastDesign = designDescription();
+    m_lastMethod = QString("Grid, %1 x %2 m cells (%3 sampled)")
+        .arg(result.cellWidth, 0, 'f', 3).arg(result.cellHeight, 0, 'f', 3).arg(result.cells);
+    
+    QString resultText;
+    resultText += QString("Cut Volume:     %1 m3\n").arg(result.cut, 0, 'f', 2);
+    resultText += QString("Fill Volume:    %1 m3\n").arg(result.fill, 0, 'f', 2);
+    resultText += QString("Net Volume:     %1 m3 (%2)\n").arg(qAbs(netVol), 0, 'f', 2).arg(netVol > 0 ? "Net Cut" : "Net Fill");
+    resultText += QString("Grid Area:      %1 m2\n").arg(result.area, 0, 'f', 2);
+    resultText += QString("Grid Cells:     %1 of %2 x %3 (%4 x %5 m)\n").arg(result.cells)
+        .arg(result.columns).arg(result.rows)
+        .arg(result.cellWidth, 0, 'f', 3).arg(result.cellHeight, 0, 'f', 3);
+    resultText += QString("Heatmap Range:  +/- %1 m\n").arg(result.scale, 0, 'f', 3);
+    
+    m_resultText->setPlainText(resultText);
+}
+
+void VolumeDialog::toggleHeatmap(bool shown)
+{
+    if (!m_canvas) return;
+    if (shown && !m_heatmap.isNull()) {
+        m_canvas->setVolumeHeatmap(m_heatmap, m_heatmapBounds);
+    } else {
+        m_canvas->clearVolumeHeatmap();
+    }
+}
+
+void VolumeDialog::showIsopachs()
+{
+    if (!m_canvas || m_isopachs.isEmpty()) return;
+    m_canvas->setContours(m_isopachs);
+}
+
 void VolumeDialog::showTIN()
 {
     if (!m_canvas) return;
-    m_canvas->generateTINFromPegs(m_designLevelSpin->value());
+    m_canvas->generateTINFromPegs(m_designLevelSpin->value(), breaklineIndices(),
+                                  m_boundaryCombo->currentData().toInt());
+}
+
+QVector<int> VolumeDialog::breaklineIndices() const
+{
+    if (!m_canvas || !m_breaklineCheck->isChecked()) return QVector<int>();
+    return m_canvas->getSelectedIndices();
 }
 
 void VolumeDialog::hideTIN()
@@ -461,9 +924,18 @@ void VolumeDialog::exportReport()
     if (chkParams->isChecked()) {
         html += "<h2>Calculation Parameters</h2>";
         html += "<table>";
-        html += QString("<tr><th>Design Level</th><td>%1 m</td></tr>").arg(m_designLevelSpin->value(), 0, 'f', 3);
-        html += QString("<tr><th>Points Used</th><td>%1</td></tr>").arg(getSelectedPegIndices().size());
-        html += QString("<tr><th>Triangles</th><td>%1</td></tr>").arg(m_lastTriangleCount);
+        html += QString("<tr><th>Design</th><td>%1</td></tr>").arg((m_lastDesign.isEmpty() ? designDescription() : m_lastDesign).toHtmlEscaped());
+        if (!m_lastMethod.isEmpty()) {
+            html += QString("<tr><th>Method</th><td>%1</td></tr>").arg(m_lastMethod.toHtmlEscaped());
+        }
+        if (m_lastCellCount > 0) {
+            html += QString("<tr><th>Surface</th><td>DEM %1</td></tr>").arg(m_lastSurfaceName.toHtmlEscaped());
+            html += QString("<tr><th>DEM Cells</th><td>%1</td></tr>").arg(m_lastCellCount);
+        } else {
+            html += QString("<tr><th>Points Used</th><td>%1</td></tr>").arg(getSelectedPegIndices().size());
+            html += QString("<tr><th>Triangles</th><td>%1</td></tr>").arg(m_lastTriangleCount);
+            html += QString("<tr><th>Split Triangles</th><td>%1</td></tr>").arg(m_lastSplitCount);
+        }
         html += "</table>";
     }
     